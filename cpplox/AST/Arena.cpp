@@ -0,0 +1,64 @@
+#include "cpplox/AST/Arena.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+
+namespace cpplox::AST {
+
+namespace {
+
+// Blocks double in size up to this, so small units stay small and big ones
+// make few allocations.
+const size_t MAX_BLOCK_SIZE = 1024 * 1024;
+
+thread_local Arena* currentArena = nullptr;
+
+}  // namespace
+
+Arena::~Arena() {
+  // Children are linked by NodePtrs, which don't destroy anything, so the
+  // order doesn't matter; newest first mirrors how the nodes were built.
+  for (auto it = destructors.rbegin(); it != destructors.rend(); ++it)
+    it->destroy(it->node);
+}
+
+auto Arena::allocate(size_t size, size_t alignment) -> void* {
+  auto address = reinterpret_cast<uintptr_t>(next);
+  uintptr_t aligned = (address + alignment - 1) & ~(alignment - 1);
+  if (next == nullptr || aligned + size > reinterpret_cast<uintptr_t>(limit)) {
+    const size_t blockSize = std::max(nextBlockSize, size + alignment);
+    nextBlockSize = std::min(nextBlockSize * 2, MAX_BLOCK_SIZE);
+    blocks.emplace_back(new char[blockSize]);
+    next = blocks.back().get();
+    limit = next + blockSize;
+    address = reinterpret_cast<uintptr_t>(next);
+    aligned = (address + alignment - 1) & ~(alignment - 1);
+  }
+  next = reinterpret_cast<char*>(aligned + size);
+  allocated += size;
+  return reinterpret_cast<void*>(aligned);
+}
+
+auto Arena::own(std::string text) -> std::string_view {
+  return *make<std::string>(std::move(text));
+}
+
+auto Arena::bytesAllocated() const -> size_t { return allocated; }
+
+auto Arena::current() -> Arena& {
+  if (currentArena != nullptr) return *currentArena;
+  thread_local Arena threadArena;
+  return threadArena;
+}
+
+Arena::Scope::Scope(Arena& arena) : previous(currentArena) {
+  currentArena = &arena;
+}
+
+Arena::Scope::~Scope() { currentArena = previous; }
+
+}  // namespace cpplox::AST
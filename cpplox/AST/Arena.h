@@ -0,0 +1,91 @@
+#ifndef CPPLOX_AST_ARENA_H
+#define CPPLOX_AST_ARENA_H
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "cpplox/Types/Uncopyable.h"
+
+namespace cpplox::AST {
+
+// AST nodes belong to the Arena they were made in, not to the pointers that
+// link them; NodePtr only borrows unique_ptr's move-only handling.
+struct NodeDeleter {
+  void operator()(const void* /*node*/) const {}
+};
+
+template <typename T>
+using NodePtr = std::unique_ptr<T, NodeDeleter>;
+
+// Holds the AST nodes of one compilation unit (a script or a REPL line).
+// Nodes are bump allocated from large blocks, so they sit next to each other
+// in the order the parser made them, and they are all destroyed together
+// with the arena. Since NodePtrs don't delete anything, tearing down a tree
+// is a flat loop over its nodes however deep the tree is.
+// An arena owned by a shared_ptr can be kept alive by what the nodes are used
+// for: see FuncExpr::share.
+class Arena : public Types::Uncopyable,
+              public std::enable_shared_from_this<Arena> {
+ public:
+  Arena() = default;
+  ~Arena() override;
+
+  template <typename T, typename... Args>
+  auto make(Args&&... args) -> NodePtr<T>;
+
+  // Keeps text as long as the nodes, for a source their tokens point into.
+  auto own(std::string text) -> std::string_view;
+
+  [[nodiscard]] auto bytesAllocated() const -> size_t;
+
+  // The arena nodes are made in: the one made current by the innermost live
+  // Scope on this thread, or else a per-thread arena that lives as long as
+  // the thread.
+  static auto current() -> Arena&;
+
+  // Makes an arena current for as long as the Scope lives.
+  class Scope : public Types::Uncopyable {
+   public:
+    explicit Scope(Arena& arena);
+    ~Scope() override;
+
+   private:
+    Arena* previous;
+  };
+
+ private:
+  struct Destructor {
+    void* node;
+    void (*destroy)(void* node);
+  };
+
+  auto allocate(size_t size, size_t alignment) -> void*;
+
+  std::vector<std::unique_ptr<char[]>> blocks;
+  char* next = nullptr;
+  char* limit = nullptr;
+  size_t nextBlockSize = 4 * 1024;
+  size_t allocated = 0;
+  std::vector<Destructor> destructors;
+};
+
+template <typename T, typename... Args>
+auto Arena::make(Args&&... args) -> NodePtr<T> {
+  void* memory = allocate(sizeof(T), alignof(T));
+  T* node = new (memory) T(std::forward<Args>(args)...);
+  if constexpr (!std::is_trivially_destructible_v<T>)
+    destructors.push_back(
+        {node, [](void* p) { static_cast<T*>(p)->~T(); }});
+  return NodePtr<T>(node);
+}
+
+}  // namespace cpplox::AST
+
+#endif  // CPPLOX_AST_ARENA_H
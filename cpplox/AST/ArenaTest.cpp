@@ -0,0 +1,112 @@
+#include "gtest/gtest.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <variant>
+#include <vector>
+
+#include "cpplox/AST/Arena.h"
+#include "cpplox/AST/NodeTypes.h"
+#include "cpplox/Types/Literal.h"
+#include "cpplox/Types/Token.h"
+
+namespace cpplox::AST {
+
+namespace {
+
+struct Counted {
+  int* destroyed;
+  explicit Counted(int* destroyed) : destroyed(destroyed) {}
+  ~Counted() { ++*destroyed; }
+};
+
+}  // namespace
+
+TEST(ArenaTest, nodes_are_contiguous_and_aligned) {
+  Arena arena;
+  auto a = arena.make<char>('a');
+  auto b = arena.make<double>(1.0);
+  auto c = arena.make<double>(2.0);
+  EXPECT_EQ(0, reinterpret_cast<uintptr_t>(b.get()) % alignof(double));
+  EXPECT_EQ(b.get() + 1, c.get());
+  EXPECT_LT(reinterpret_cast<uintptr_t>(a.get()),
+            reinterpret_cast<uintptr_t>(b.get()));
+  EXPECT_EQ(*a, 'a');
+  EXPECT_EQ(*c, 2.0);
+}
+
+TEST(ArenaTest, destroys_nodes_with_the_arena) {
+  int destroyed = 0;
+  {
+    Arena arena;
+    for (int i = 0; i < 10000; ++i) {
+      // Dropping the pointer mustn't destroy the node.
+      arena.make<Counted>(&destroyed);
+    }
+    EXPECT_EQ(0, destroyed);
+  }
+  EXPECT_EQ(10000, destroyed);
+}
+
+TEST(ArenaTest, scope_sets_the_current_arena) {
+  Arena outer;
+  Arena inner;
+  {
+    Arena::Scope outerScope(outer);
+    createLiteralEPV(Types::makeOptionalLiteral(1.0));
+    {
+      Arena::Scope innerScope(inner);
+      EXPECT_EQ(&inner, &Arena::current());
+      createLiteralEPV(Types::makeOptionalLiteral(2.0));
+    }
+    EXPECT_EQ(&outer, &Arena::current());
+  }
+  EXPECT_NE(&outer, &Arena::current());
+  EXPECT_EQ(outer.bytesAllocated(), inner.bytesAllocated());
+  EXPECT_LT(0, outer.bytesAllocated());
+}
+
+// A chain of unary minuses a million deep would overflow the stack if each
+// node deleted its child.
+TEST(ArenaTest, deep_trees_are_freed_without_recursion) {
+  Arena arena;
+  Arena::Scope scope(arena);
+  ExprPtrVariant expr = createLiteralEPV(Types::makeOptionalLiteral(1.0));
+  for (int i = 0; i < 1000000; ++i)
+    expr = createUnaryEPV(Types::Token(Types::TokenType::MINUS, "-"),
+                          std::move(expr));
+  SUCCEED();
+}
+
+TEST(ArenaTest, shared_functions_keep_their_arena_alive) {
+  int destroyed = 0;
+  std::shared_ptr<const FuncExpr> function;
+  {
+    auto arena = std::make_shared<Arena>();
+    Arena::Scope scope(*arena);
+    const std::string_view name = arena->own("f");
+    arena->make<Counted>(&destroyed);
+    ExprPtrVariant expr
+        = createFuncEPV({Types::Token(Types::TokenType::IDENTIFIER, name, 1)},
+                        std::vector<StmtPtrVariant>());
+    function = std::get<FuncExprPtr>(expr)->share();
+  }
+  EXPECT_EQ(0, destroyed);
+  EXPECT_EQ("f", function->parameters[0].getLexeme());
+  function.reset();
+  EXPECT_EQ(1, destroyed);
+}
+
+TEST(ArenaTest, sharing_from_an_unshared_arena_only_points) {
+  Arena arena;
+  Arena::Scope scope(arena);
+  ExprPtrVariant expr = createFuncEPV({}, std::vector<StmtPtrVariant>());
+  std::shared_ptr<const FuncExpr> function
+      = std::get<FuncExprPtr>(expr)->share();
+  EXPECT_EQ(std::get<FuncExprPtr>(expr).get(), function.get());
+  EXPECT_EQ(0, function.use_count());
+}
+
+}  // namespace cpplox::AST
@@ -0,0 +1,482 @@
+#include "cpplox/AST/FlatAST.h"
+
+#include <cstddef>
+#include <optional>
+#include <unordered_map>
+#include <utility>
+#include <variant>
+#include <vector>
+
+namespace cpplox::AST {
+
+using Types::TokenType;
+
+namespace {
+
+auto range(const std::vector<Index>& list, Index first, Index last)
+    -> IndexRange {
+  return IndexRange{list.data() + first, list.data() + last};
+}
+
+template <typename T>
+auto usedBytes(const std::vector<T>& v) -> size_t {
+  return v.size() * sizeof(T);
+}
+
+// Builds a FlatAST bottom up: children are added before their parents, and
+// a node's list children are appended as one contiguous run once they have
+// all been added.
+class Flattener {
+ public:
+  explicit Flattener(
+      FlatAST& ast,
+      std::unordered_map<const FuncExpr*, Index>* functionIndices = nullptr)
+      : ast(ast), functionIndices(functionIndices) {}
+
+  auto addStmts(const std::vector<StmtPtrVariant>& statements)
+      -> std::pair<Index, Index> {
+    std::vector<Index> indices;
+    indices.reserve(statements.size());
+    for (const StmtPtrVariant& stmt : statements)
+      indices.push_back(addStmt(stmt));
+    return appendList(ast.stmtLists, indices);
+  }
+
+  auto addStmt(const StmtPtrVariant& statement) -> Index {
+    switch (statement.index()) {
+      case 0: {  // ExprStmtPtr
+        const auto& stmt = std::get<ExprStmtPtr>(statement);
+        return pushStmt(StmtKind::EXPR, NO_INDEX, addExpr(stmt->expression));
+      }
+      case 1: {  // PrintStmtPtr
+        const auto& stmt = std::get<PrintStmtPtr>(statement);
+        return pushStmt(StmtKind::PRINT, NO_INDEX, addExpr(stmt->expression));
+      }
+      case 2: {  // BlockStmtPtr
+        const auto& stmt = std::get<BlockStmtPtr>(statement);
+        auto [first, last] = addStmts(stmt->statements);
+        return pushStmt(StmtKind::BLOCK, NO_INDEX, first, last);
+      }
+      case 3: {  // VarStmtPtr
+        const auto& stmt = std::get<VarStmtPtr>(statement);
+        return pushStmt(StmtKind::VAR, addToken(stmt->varName),
+                        addExpr(stmt->initializer));
+      }
+      case 4: {  // IfStmtPtr
+        const auto& stmt = std::get<IfStmtPtr>(statement);
+        Index condition = addExpr(stmt->condition);
+        Index thenBranch = addStmt(stmt->thenBranch);
+        Index elseBranch = stmt->elseBranch.has_value()
+                               ? addStmt(stmt->elseBranch.value())
+                               : NO_INDEX;
+        return pushStmt(StmtKind::IF, NO_INDEX, condition, thenBranch,
+                        elseBranch);
+      }
+      case 5: {  // WhileStmtPtr
+        const auto& stmt = std::get<WhileStmtPtr>(statement);
+        Index condition = addExpr(stmt->condition);
+        return pushStmt(StmtKind::WHILE, NO_INDEX, condition,
+                        addStmt(stmt->loopBody));
+      }
+      case 6: {  // ForStmtPtr
+        const auto& stmt = std::get<ForStmtPtr>(statement);
+        Index initializer = stmt->initializer.has_value()
+                                ? addStmt(stmt->initializer.value())
+                                : NO_INDEX;
+        Index condition = addExpr(stmt->condition);
+        Index increment = addExpr(stmt->increment);
+        return pushStmt(StmtKind::FOR, NO_INDEX, initializer, condition,
+                        increment, addStmt(stmt->loopBody));
+      }
+      case 7: {  // FuncStmtPtr
+        const auto& stmt = std::get<FuncStmtPtr>(statement);
+        Index function = addFunction(*stmt->funcExpr);
+        return pushStmt(StmtKind::FUNC, addToken(stmt->funcName), function);
+      }
+      case 8: {  // RetStmtPtr
+        const auto& stmt = std::get<RetStmtPtr>(statement);
+        Index value = addExpr(stmt->value);
+        return pushStmt(StmtKind::RETURN, addToken(stmt->ret), value);
+      }
+      case 9: {  // ClassStmtPtr
+        const auto& stmt = std::get<ClassStmtPtr>(statement);
+        Index superClass = addExpr(stmt->superClass);
+        auto [first, last] = addStmts(stmt->methods);
+        return pushStmt(StmtKind::CLASS, addToken(stmt->className), superClass,
+                        first, last);
+      }
+      default:
+        static_assert(std::variant_size_v<StmtPtrVariant> == 10,
+                      "Looks like you forgot to update the cases in "
+                      "Flattener::addStmt(const StmtPtrVariant&)!");
+        return NO_INDEX;
+    }
+  }
+
+  auto addExpr(const std::optional<ExprPtrVariant>& expression) -> Index {
+    return expression.has_value() ? addExpr(expression.value()) : NO_INDEX;
+  }
+
+  auto addExpr(const ExprPtrVariant& expression) -> Index {
+    switch (expression.index()) {
+      case 0: {  // BinaryExprPtr
+        const auto& expr = std::get<BinaryExprPtr>(expression);
+        Index left = addExpr(expr->left);
+        Index right = addExpr(expr->right);
+        return pushExpr(ExprKind::BINARY, expr->op, left, right);
+      }
+      case 1: {  // GroupingExprPtr
+        const auto& expr = std::get<GroupingExprPtr>(expression);
+        return pushExpr(ExprKind::GROUPING, NO_INDEX,
+                        addExpr(expr->expression));
+      }
+      case 2: {  // LiteralExprPtr
+        const auto& expr = std::get<LiteralExprPtr>(expression);
+        Index literal = NO_INDEX;
+        if (expr->literalVal.has_value()) {
+          literal = static_cast<Index>(ast.literals.size());
+          ast.literals.push_back(expr->literalVal.value());
+        }
+        return pushExpr(ExprKind::LITERAL, NO_INDEX, literal);
+      }
+      case 3: {  // UnaryExprPtr
+        const auto& expr = std::get<UnaryExprPtr>(expression);
+        return pushExpr(ExprKind::UNARY, expr->op, addExpr(expr->right));
+      }
+      case 4: {  // ConditionalExprPtr
+        const auto& expr = std::get<ConditionalExprPtr>(expression);
+        Index condition = addExpr(expr->condition);
+        Index thenBranch = addExpr(expr->thenBranch);
+        Index elseBranch = addExpr(expr->elseBranch);
+        return pushExpr(ExprKind::CONDITIONAL, NO_INDEX, condition, thenBranch,
+                        elseBranch);
+      }
+      case 5: {  // PostfixExprPtr
+        const auto& expr = std::get<PostfixExprPtr>(expression);
+        return pushExpr(ExprKind::POSTFIX, expr->op, addExpr(expr->left));
+      }
+      case 6: {  // VariableExprPtr
+        const auto& expr = std::get<VariableExprPtr>(expression);
+        return pushExpr(ExprKind::VARIABLE, addToken(expr->varName));
+      }
+      case 7: {  // AssignmentExprPtr
+        const auto& expr = std::get<AssignmentExprPtr>(expression);
+        Index value = addExpr(expr->right);
+        return pushExpr(ExprKind::ASSIGNMENT, addToken(expr->varName), value);
+      }
+      case 8: {  // LogicalExprPtr
+        const auto& expr = std::get<LogicalExprPtr>(expression);
+        Index left = addExpr(expr->left);
+        Index right = addExpr(expr->right);
+        return pushExpr(ExprKind::LOGICAL, expr->op, left, right);
+      }
+      case 9: {  // CallExprPtr
+        const auto& expr = std::get<CallExprPtr>(expression);
+        Index callee = addExpr(expr->callee);
+        std::vector<Index> arguments;
+        arguments.reserve(expr->arguments.size());
+        for (const ExprPtrVariant& argument : expr->arguments)
+          arguments.push_back(addExpr(argument));
+        auto [first, last] = appendList(ast.exprLists, arguments);
+        return pushExpr(ExprKind::CALL, addToken(expr->paren), callee, first,
+                        last);
+      }
+      case 10: {  // FuncExprPtr
+        const auto& expr = std::get<FuncExprPtr>(expression);
+        return pushExpr(ExprKind::FUNC, NO_INDEX, addFunction(*expr));
+      }
+      case 11: {  // GetExprPtr
+        const auto& expr = std::get<GetExprPtr>(expression);
+        Index object = addExpr(expr->expr);
+        return pushExpr(ExprKind::GET, addToken(expr->name), object);
+      }
+      case 12: {  // SetExprPtr
+        const auto& expr = std::get<SetExprPtr>(expression);
+        Index object = addExpr(expr->expr);
+        Index value = addExpr(expr->value);
+        return pushExpr(ExprKind::SET, addToken(expr->name), object, value);
+      }
+      case 13: {  // ThisExprPtr
+        const auto& expr = std::get<ThisExprPtr>(expression);
+        return pushExpr(ExprKind::THIS, addToken(expr->keyword));
+      }
+      case 14: {  // SuperExprPtr
+        const auto& expr = std::get<SuperExprPtr>(expression);
+        Index keyword = addToken(expr->keyword);
+        return pushExpr(ExprKind::SUPER, keyword, addToken(expr->method));
+      }
+      default:
+        static_assert(std::variant_size_v<ExprPtrVariant> == 15,
+                      "Looks like you forgot to update the cases in "
+                      "Flattener::addExpr(const ExprPtrVariant&)!");
+        return NO_INDEX;
+    }
+  }
+
+ private:
+  auto addToken(const Types::Token& token) -> Index {
+    ast.tokens.push_back(token);
+    return static_cast<Index>(ast.tokens.size() - 1);
+  }
+
+  auto addFunction(const FuncExpr& func) -> Index {
+    std::vector<Index> params;
+    params.reserve(func.parameters.size());
+    for (const Types::Token& param : func.parameters)
+      params.push_back(addToken(param));
+    auto [firstParam, lastParam] = appendList(ast.tokenLists, params);
+    auto [firstStmt, lastStmt] = addStmts(func.getBody());
+    ast.functions.push_back(FlatFunction{firstParam, lastParam - firstParam,
+                                         firstStmt, lastStmt - firstStmt});
+    const auto index = static_cast<Index>(ast.functions.size() - 1);
+    if (functionIndices != nullptr) functionIndices->emplace(&func, index);
+    return index;
+  }
+
+  static auto appendList(std::vector<Index>& list,
+                         const std::vector<Index>& items)
+      -> std::pair<Index, Index> {
+    const auto first = static_cast<Index>(list.size());
+    list.insert(list.end(), items.begin(), items.end());
+    return {first, static_cast<Index>(list.size())};
+  }
+
+  // The operator's token, decoded.
+  auto pushExpr(ExprKind kind, const Types::Token& op, Index a,
+                Index b = NO_INDEX, Index c = NO_INDEX) -> Index {
+    return pushExpr(kind, addToken(op), a, b, c, toOp(op.getType()));
+  }
+
+  auto pushExpr(ExprKind kind, Index token, Index a = NO_INDEX,
+                Index b = NO_INDEX, Index c = NO_INDEX, Op op = Op::NONE)
+      -> Index {
+    FlatAST::ExprPool& exprs = ast.exprs;
+    exprs.kind.push_back(kind);
+    exprs.op.push_back(op);
+    exprs.token.push_back(token);
+    exprs.a.push_back(a);
+    exprs.b.push_back(b);
+    exprs.c.push_back(c);
+    return static_cast<Index>(exprs.kind.size() - 1);
+  }
+
+  auto pushStmt(StmtKind kind, Index token, Index a = NO_INDEX,
+                Index b = NO_INDEX, Index c = NO_INDEX, Index d = NO_INDEX)
+      -> Index {
+    FlatAST::StmtPool& stmts = ast.stmts;
+    stmts.kind.push_back(kind);
+    stmts.token.push_back(token);
+    stmts.a.push_back(a);
+    stmts.b.push_back(b);
+    stmts.c.push_back(c);
+    stmts.d.push_back(d);
+    return static_cast<Index>(stmts.kind.size() - 1);
+  }
+
+  FlatAST& ast;
+  std::unordered_map<const FuncExpr*, Index>* functionIndices;
+};
+
+// Rebuilds the tree a FlatAST was flattened from, top down.
+class Unflattener {
+ public:
+  explicit Unflattener(const FlatAST& ast,
+                       std::vector<const FuncExpr*>* functions = nullptr)
+      : ast(ast), functions(functions) {
+    if (functions != nullptr) functions->assign(ast.functions.size(), nullptr);
+  }
+
+  auto stmts(IndexRange indices) -> std::vector<StmtPtrVariant> {
+    std::vector<StmtPtrVariant> statements;
+    statements.reserve(indices.size());
+    for (Index index : indices) statements.push_back(stmt(index));
+    return statements;
+  }
+
+  auto stmt(Index index) -> StmtPtrVariant {
+    const FlatAST::StmtPool& s = ast.stmts;
+    switch (s.kind[index]) {
+      case StmtKind::EXPR: return createExprSPV(expr(s.a[index]));
+      case StmtKind::PRINT: return createPrintSPV(expr(s.a[index]));
+      case StmtKind::BLOCK:
+        return createBlockSPV(stmts(ast.blockStatements(index)));
+      case StmtKind::VAR:
+        return createVarSPV(token(s.token[index]), optionalExpr(s.a[index]));
+      case StmtKind::IF:
+        return createIfSPV(expr(s.a[index]), stmt(s.b[index]),
+                           optionalStmt(s.c[index]));
+      case StmtKind::WHILE:
+        return createWhileSPV(expr(s.a[index]), stmt(s.b[index]));
+      case StmtKind::FOR:
+        return createForSPV(optionalStmt(s.a[index]),
+                            optionalExpr(s.b[index]),
+                            optionalExpr(s.c[index]), stmt(s.d[index]));
+      case StmtKind::FUNC:
+        return createFuncSPV(token(s.token[index]),
+                             std::get<FuncExprPtr>(function(s.a[index])));
+      case StmtKind::RETURN:
+        return createRetSPV(token(s.token[index]), optionalExpr(s.a[index]));
+      case StmtKind::CLASS:
+        return createClassSPV(token(s.token[index]), optionalExpr(s.a[index]),
+                              stmts(ast.classMethods(index)));
+    }
+    return {};
+  }
+
+  auto expr(Index index) -> ExprPtrVariant {
+    const FlatAST::ExprPool& e = ast.exprs;
+    switch (e.kind[index]) {
+      case ExprKind::BINARY:
+        return createBinaryEPV(expr(e.a[index]), token(e.token[index]),
+                               expr(e.b[index]));
+      case ExprKind::GROUPING: return createGroupingEPV(expr(e.a[index]));
+      case ExprKind::LITERAL:
+        return createLiteralEPV(
+            e.a[index] == NO_INDEX
+                ? std::nullopt
+                : Types::OptionalLiteral(ast.literals[e.a[index]]));
+      case ExprKind::UNARY:
+        return createUnaryEPV(token(e.token[index]), expr(e.a[index]));
+      case ExprKind::CONDITIONAL:
+        return createConditionalEPV(expr(e.a[index]), expr(e.b[index]),
+                                    expr(e.c[index]));
+      case ExprKind::POSTFIX:
+        return createPostfixEPV(expr(e.a[index]), token(e.token[index]));
+      case ExprKind::VARIABLE: return createVariableEPV(token(e.token[index]));
+      case ExprKind::ASSIGNMENT:
+        return createAssignmentEPV(token(e.token[index]), expr(e.a[index]));
+      case ExprKind::LOGICAL:
+        return createLogicalEPV(expr(e.a[index]), token(e.token[index]),
+                                expr(e.b[index]));
+      case ExprKind::CALL: {
+        std::vector<ExprPtrVariant> arguments;
+        IndexRange indices = ast.callArguments(index);
+        arguments.reserve(indices.size());
+        for (Index argument : indices) arguments.push_back(expr(argument));
+        return createCallEPV(expr(e.a[index]), token(e.token[index]),
+                             std::move(arguments));
+      }
+      case ExprKind::FUNC: return function(e.a[index]);
+      case ExprKind::GET:
+        return createGetEPV(expr(e.a[index]), token(e.token[index]));
+      case ExprKind::SET:
+        return createSetEPV(expr(e.a[index]), token(e.token[index]),
+                            expr(e.b[index]));
+      case ExprKind::THIS: return createThisEPV(token(e.token[index]));
+      case ExprKind::SUPER:
+        return createSuperEPV(token(e.token[index]), token(e.a[index]));
+    }
+    return {};
+  }
+
+ private:
+  auto optionalExpr(Index index) -> std::optional<ExprPtrVariant> {
+    if (index == NO_INDEX) return std::nullopt;
+    return expr(index);
+  }
+
+  auto optionalStmt(Index index) -> std::optional<StmtPtrVariant> {
+    if (index == NO_INDEX) return std::nullopt;
+    return stmt(index);
+  }
+
+  auto function(Index index) -> ExprPtrVariant {
+    std::vector<Types::Token> params;
+    IndexRange indices = ast.functionParams(index);
+    params.reserve(indices.size());
+    for (Index param : indices) params.push_back(token(param));
+    ExprPtrVariant func
+        = createFuncEPV(std::move(params), stmts(ast.functionBody(index)));
+    if (functions != nullptr)
+      (*functions)[index] = std::get<FuncExprPtr>(func).get();
+    return func;
+  }
+
+  auto token(Index index) -> const Types::Token& { return ast.tokens[index]; }
+
+  const FlatAST& ast;
+  std::vector<const FuncExpr*>* functions;
+};
+
+}  // namespace
+
+auto FlatAST::callArguments(Index expr) const -> IndexRange {
+  return range(exprLists, exprs.b[expr], exprs.c[expr]);
+}
+
+auto FlatAST::blockStatements(Index stmt) const -> IndexRange {
+  return range(stmtLists, stmts.a[stmt], stmts.b[stmt]);
+}
+
+auto FlatAST::classMethods(Index stmt) const -> IndexRange {
+  return range(stmtLists, stmts.b[stmt], stmts.c[stmt]);
+}
+
+auto FlatAST::functionParams(Index function) const -> IndexRange {
+  const FlatFunction& f = functions[function];
+  return range(tokenLists, f.firstParam, f.firstParam + f.paramCount);
+}
+
+auto FlatAST::functionBody(Index function) const -> IndexRange {
+  const FlatFunction& f = functions[function];
+  return range(stmtLists, f.firstStmt, f.firstStmt + f.stmtCount);
+}
+
+auto FlatAST::bytesUsed() const -> size_t {
+  size_t bytes = usedBytes(exprs.kind) + usedBytes(exprs.op)
+                 + usedBytes(exprs.token) + usedBytes(exprs.a)
+                 + usedBytes(exprs.b) + usedBytes(exprs.c);
+  bytes += usedBytes(stmts.kind) + usedBytes(stmts.token)
+           + usedBytes(stmts.a) + usedBytes(stmts.b)
+           + usedBytes(stmts.c) + usedBytes(stmts.d);
+  bytes += usedBytes(tokens) + usedBytes(literals)
+           + usedBytes(functions) + usedBytes(exprLists)
+           + usedBytes(stmtLists) + usedBytes(tokenLists)
+           + usedBytes(program);
+  return bytes;
+}
+
+namespace {
+
+auto flattenWith(const std::vector<StmtPtrVariant>& statements,
+                 std::unordered_map<const FuncExpr*, Index>* functionIndices)
+    -> FlatAST {
+  FlatAST ast;
+  Flattener flattener(ast, functionIndices);
+  for (const StmtPtrVariant& stmt : statements)
+    ast.program.push_back(flattener.addStmt(stmt));
+  return ast;
+}
+
+auto unflattenWith(const FlatAST& ast,
+                   std::vector<const FuncExpr*>* functions)
+    -> std::vector<StmtPtrVariant> {
+  Unflattener unflattener(ast, functions);
+  std::vector<StmtPtrVariant> statements;
+  statements.reserve(ast.program.size());
+  for (Index stmt : ast.program) statements.push_back(unflattener.stmt(stmt));
+  return statements;
+}
+
+}  // namespace
+
+auto flatten(const std::vector<StmtPtrVariant>& statements) -> FlatAST {
+  return flattenWith(statements, nullptr);
+}
+
+auto flatten(const std::vector<StmtPtrVariant>& statements,
+             std::unordered_map<const FuncExpr*, Index>& functionIndices)
+    -> FlatAST {
+  return flattenWith(statements, &functionIndices);
+}
+
+auto unflatten(const FlatAST& ast) -> std::vector<StmtPtrVariant> {
+  return unflattenWith(ast, nullptr);
+}
+
+auto unflatten(const FlatAST& ast, std::vector<const FuncExpr*>& functions)
+    -> std::vector<StmtPtrVariant> {
+  return unflattenWith(ast, &functions);
+}
+
+}  // namespace cpplox::AST
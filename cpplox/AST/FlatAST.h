@@ -0,0 +1,176 @@
+#ifndef CPPLOX_AST_FLATAST_H
+#define CPPLOX_AST_FLATAST_H
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "cpplox/AST/NodeTypes.h"
+#include "cpplox/Types/Literal.h"
+#include "cpplox/Types/Token.h"
+
+// A flattened copy of an AST. Instead of a separate allocation per node linked
+// by 16 byte variants, nodes live in two pools (expressions and statements)
+// stored column by column, and refer to each other with 32 bit indices.
+// Variable length children (call arguments, block statements, parameters,
+// methods) are contiguous ranges in shared list pools. Operators are decoded
+// from their tokens to Op when flattening.
+//
+// What the a/b/c/d columns hold depends on the node's kind; see ExprKind and
+// StmtKind. Indices that may be absent (else branches, initializers, ...) are
+// NO_INDEX when they are.
+
+namespace cpplox::AST {
+
+using Index = uint32_t;
+constexpr Index NO_INDEX = UINT32_MAX;
+
+enum class ExprKind : uint8_t {
+  BINARY,       // a: left, b: right, op, token: operator
+  GROUPING,     // a: expression
+  LITERAL,      // a: literal, or NO_INDEX for nil
+  UNARY,        // a: operand, op, token: operator
+  CONDITIONAL,  // a: condition, b: then, c: else
+  POSTFIX,      // a: operand, op, token: operator
+  VARIABLE,     // token: name
+  ASSIGNMENT,   // a: value, token: name
+  LOGICAL,      // a: left, b: right, op, token: operator
+  CALL,         // a: callee, [b, c): arguments in exprLists, token: paren
+  FUNC,         // a: function
+  GET,          // a: object, token: name
+  SET,          // a: object, b: value, token: name
+  THIS,         // token: keyword
+  SUPER,        // a: method name (a token), token: keyword
+};
+
+enum class StmtKind : uint8_t {
+  EXPR,    // a: expression
+  PRINT,   // a: expression
+  BLOCK,   // [a, b): statements in stmtLists
+  VAR,     // a: initializer, token: name
+  IF,      // a: condition, b: then, c: else
+  WHILE,   // a: condition, b: body
+  FOR,     // a: initializer, b: condition, c: increment, d: body
+  FUNC,    // a: function, token: name
+  RETURN,  // a: value, token: return keyword
+  CLASS,   // a: superclass, [b, c): methods in stmtLists, token: name
+};
+
+enum class Op : uint8_t {
+  NONE,
+  COMMA,
+  EQUAL_EQUAL,
+  BANG_EQUAL,
+  LESS,
+  LESS_EQUAL,
+  GREATER,
+  GREATER_EQUAL,
+  PLUS,
+  MINUS,
+  STAR,
+  SLASH,
+  BANG,
+  PLUS_PLUS,
+  MINUS_MINUS,
+  AND,
+  OR,
+};
+
+// Inline, as the evaluator decodes tree operators with it too.
+constexpr auto toOp(Types::TokenType type) -> Op {
+  using Types::TokenType;
+  switch (type) {
+    case TokenType::COMMA: return Op::COMMA;
+    case TokenType::EQUAL_EQUAL: return Op::EQUAL_EQUAL;
+    case TokenType::BANG_EQUAL: return Op::BANG_EQUAL;
+    case TokenType::LESS: return Op::LESS;
+    case TokenType::LESS_EQUAL: return Op::LESS_EQUAL;
+    case TokenType::GREATER: return Op::GREATER;
+    case TokenType::GREATER_EQUAL: return Op::GREATER_EQUAL;
+    case TokenType::PLUS: return Op::PLUS;
+    case TokenType::MINUS: return Op::MINUS;
+    case TokenType::STAR: return Op::STAR;
+    case TokenType::SLASH: return Op::SLASH;
+    case TokenType::BANG: return Op::BANG;
+    case TokenType::PLUS_PLUS: return Op::PLUS_PLUS;
+    case TokenType::MINUS_MINUS: return Op::MINUS_MINUS;
+    case TokenType::AND: return Op::AND;
+    case TokenType::OR: return Op::OR;
+    default: return Op::NONE;
+  }
+}
+
+// A function's parameters (in tokenLists) and body (in stmtLists).
+struct FlatFunction {
+  Index firstParam;
+  Index paramCount;
+  Index firstStmt;
+  Index stmtCount;
+};
+
+// [begin, end) of a list pool.
+struct IndexRange {
+  const Index* first;
+  const Index* last;
+  [[nodiscard]] auto begin() const -> const Index* { return first; }
+  [[nodiscard]] auto end() const -> const Index* { return last; }
+  [[nodiscard]] auto size() const -> size_t {
+    return static_cast<size_t>(last - first);
+  }
+};
+
+struct FlatAST {
+  struct ExprPool {
+    std::vector<ExprKind> kind;
+    std::vector<Op> op;
+    std::vector<Index> token;
+    std::vector<Index> a;
+    std::vector<Index> b;
+    std::vector<Index> c;
+  } exprs;
+
+  struct StmtPool {
+    std::vector<StmtKind> kind;
+    std::vector<Index> token;
+    std::vector<Index> a;
+    std::vector<Index> b;
+    std::vector<Index> c;
+    std::vector<Index> d;
+  } stmts;
+
+  std::vector<Types::Token> tokens;
+  std::vector<Types::Literal> literals;
+  std::vector<FlatFunction> functions;
+  std::vector<Index> exprLists;
+  std::vector<Index> stmtLists;
+  std::vector<Index> tokenLists;
+  // The top-level statements.
+  std::vector<Index> program;
+
+  [[nodiscard]] auto callArguments(Index expr) const -> IndexRange;
+  [[nodiscard]] auto blockStatements(Index stmt) const -> IndexRange;
+  [[nodiscard]] auto classMethods(Index stmt) const -> IndexRange;
+  [[nodiscard]] auto functionParams(Index function) const -> IndexRange;
+  [[nodiscard]] auto functionBody(Index function) const -> IndexRange;
+
+  // Bytes of nodes, tokens, literals and lists, not counting spare capacity.
+  [[nodiscard]] auto bytesUsed() const -> size_t;
+};
+
+auto flatten(const std::vector<StmtPtrVariant>& statements) -> FlatAST;
+// Also records which of the FlatAST's functions each FuncExpr became.
+auto flatten(const std::vector<StmtPtrVariant>& statements,
+             std::unordered_map<const FuncExpr*, Index>& functionIndices)
+    -> FlatAST;
+// The inverse of flatten: a tree of nodes allocated from the current arena.
+// The tokens' lexemes still point wherever the FlatAST's do.
+auto unflatten(const FlatAST& ast) -> std::vector<StmtPtrVariant>;
+// Also records the FuncExpr made for each of the FlatAST's functions.
+auto unflatten(const FlatAST& ast, std::vector<const FuncExpr*>& functions)
+    -> std::vector<StmtPtrVariant>;
+
+}  // namespace cpplox::AST
+
+#endif  // CPPLOX_AST_FLATAST_H
@@ -0,0 +1,345 @@
+#include "cpplox/AST/FlatASTImage.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <type_traits>
+#include <variant>
+#include <vector>
+
+#if defined(__linux__)
+#include <elf.h>
+#include <link.h>
+#endif
+
+namespace cpplox::AST {
+
+namespace {
+
+constexpr char MAGIC[8] = {'c', 'p', 'p', 'l', 'o', 'x', 'A', 'S'};
+
+struct Header {
+  char magic[8];
+  uint32_t version;
+  uint32_t reserved;
+  uint64_t build;
+  uint64_t sourceSize;
+  uint64_t sourceHash;
+  uint64_t payloadSize;
+  // Catches images that were cut short or scribbled on.
+  uint64_t payloadHash;
+};
+
+// A token with its lexeme as an offset into the source. The literal index is
+// dropped: it refers to a TokenList, which isn't kept.
+struct ImageToken {
+  uint32_t offset;
+  uint32_t length;
+  int32_t line;
+  Types::TokenType type;
+  uint8_t padding[3];  // spelled out, so images don't contain junk
+};
+
+enum class LiteralTag : uint8_t { NUMBER, STRING };
+
+// Columns are written as a count followed by the raw elements, padded so the
+// next column starts 8 byte aligned.
+class ImageWriter {
+ public:
+  template <typename T>
+  void put(const T& value) {
+    static_assert(std::is_trivially_copyable_v<T>);
+    bytes.append(reinterpret_cast<const char*>(&value), sizeof(T));
+  }
+
+  template <typename T>
+  void column(const std::vector<T>& values) {
+    static_assert(std::is_trivially_copyable_v<T>);
+    put(static_cast<uint64_t>(values.size()));
+    bytes.append(reinterpret_cast<const char*>(values.data()),
+                 values.size() * sizeof(T));
+    pad();
+  }
+
+  void literals(const std::vector<Types::Literal>& values) {
+    put(static_cast<uint64_t>(values.size()));
+    for (const Types::Literal& literal : values) {
+      if (const auto* number = std::get_if<double>(&literal)) {
+        put(LiteralTag::NUMBER);
+        put(*number);
+      } else {
+        const auto& string = std::get<std::string>(literal);
+        put(LiteralTag::STRING);
+        put(static_cast<uint64_t>(string.size()));
+        bytes += string;
+      }
+    }
+    pad();
+  }
+
+  void pad() { bytes.resize((bytes.size() + 7) & ~size_t{7}); }
+
+  std::string bytes;
+};
+
+// Reads what ImageWriter wrote. Every read fails, rather than running off the
+// end, if there aren't enough bytes left.
+class ImageReader {
+ public:
+  explicit ImageReader(std::string_view bytes) : bytes(bytes) {}
+
+  template <typename T>
+  auto get(T& value) -> bool {
+    if (bytes.size() - position < sizeof(T)) return false;
+    std::memcpy(&value, bytes.data() + position, sizeof(T));
+    position += sizeof(T);
+    return true;
+  }
+
+  template <typename T>
+  auto column(std::vector<T>& values) -> bool {
+    uint64_t count = 0;
+    if (!get(count) || count > (bytes.size() - position) / sizeof(T))
+      return false;
+    values.resize(count);
+    std::memcpy(values.data(), bytes.data() + position, count * sizeof(T));
+    position += count * sizeof(T);
+    return skipPadding();
+  }
+
+  auto literals(std::vector<Types::Literal>& values) -> bool {
+    uint64_t count = 0;
+    if (!get(count) || count > bytes.size() - position) return false;
+    values.reserve(count);
+    for (uint64_t i = 0; i < count; ++i) {
+      LiteralTag tag{};
+      if (!get(tag)) return false;
+      if (tag == LiteralTag::NUMBER) {
+        double number = 0;
+        if (!get(number)) return false;
+        values.emplace_back(number);
+      } else {
+        uint64_t size = 0;
+        if (!get(size) || size > bytes.size() - position) return false;
+        values.emplace_back(std::string(bytes.substr(position, size)));
+        position += size;
+      }
+    }
+    return skipPadding();
+  }
+
+  [[nodiscard]] auto atEnd() const -> bool { return position == bytes.size(); }
+
+ private:
+  auto skipPadding() -> bool {
+    position = (position + 7) & ~size_t{7};
+    return position <= bytes.size();
+  }
+
+  std::string_view bytes;
+  size_t position = 0;
+};
+
+#if defined(__linux__)
+using ProgramHeader = ElfW(Phdr);
+using NoteHeader = ElfW(Nhdr);
+
+// Finds the loaded object (executable or shared library) that holds address,
+// and its build ID note if it has one.
+struct ObjectSearch {
+  uintptr_t address = 0;
+  bool found = false;
+  std::string path;
+  std::optional<std::string> buildId;
+};
+
+auto findBuildId(const dl_phdr_info& object, const ProgramHeader& segment)
+    -> std::optional<std::string> {
+  const size_t align = segment.p_align == 8 ? 8 : 4;
+  const auto padded = [align](size_t size) {
+    return (size + align - 1) & ~(align - 1);
+  };
+  const char* note
+      = reinterpret_cast<const char*>(object.dlpi_addr + segment.p_vaddr);
+  const char* const end = note + segment.p_memsz;
+  while (static_cast<size_t>(end - note) >= sizeof(NoteHeader)) {
+    NoteHeader header;
+    std::memcpy(&header, note, sizeof header);
+    const char* name = note + sizeof header;
+    const size_t left = static_cast<size_t>(end - name);
+    if (padded(header.n_namesz) > left
+        || padded(header.n_descsz) > left - padded(header.n_namesz))
+      return std::nullopt;
+    const char* desc = name + padded(header.n_namesz);
+    if (header.n_type == NT_GNU_BUILD_ID && header.n_namesz == 4
+        && std::memcmp(name, "GNU", 4) == 0)
+      return std::string(desc, header.n_descsz);
+    note = desc + padded(header.n_descsz);
+  }
+  return std::nullopt;
+}
+
+auto searchObject(dl_phdr_info* object, size_t /*size*/, void* data) -> int {
+  auto& search = *static_cast<ObjectSearch*>(data);
+  const ProgramHeader* const first = object->dlpi_phdr;
+  const ProgramHeader* const last = first + object->dlpi_phnum;
+  const auto holdsAddress = [&](const ProgramHeader& segment) {
+    const uintptr_t start = object->dlpi_addr + segment.p_vaddr;
+    return segment.p_type == PT_LOAD && search.address >= start
+           && search.address - start < segment.p_memsz;
+  };
+  if (std::none_of(first, last, holdsAddress)) return 0;
+
+  search.found = true;
+  // The executable has no name here.
+  search.path = object->dlpi_name != nullptr && object->dlpi_name[0] != '\0'
+                    ? object->dlpi_name
+                    : "/proc/self/exe";
+  for (const ProgramHeader* segment = first; segment != last; ++segment) {
+    if (segment->p_type != PT_NOTE) continue;
+    search.buildId = findBuildId(*object, *segment);
+    if (search.buildId.has_value()) break;
+  }
+  return 1;
+}
+#endif
+
+}  // namespace
+
+auto hashBytes(std::string_view bytes) -> uint64_t {
+  constexpr uint64_t K = 0x9E3779B97F4A7C15ULL;
+  const char* data = bytes.data();
+  const size_t size = bytes.size();
+  uint64_t hash = size * K;
+  size_t i = 0;
+  for (; i + 8 <= size; i += 8) {
+    uint64_t word = 0;
+    std::memcpy(&word, data + i, 8);
+    hash = (hash ^ word) * K;
+    hash ^= hash >> 29;
+  }
+  uint64_t tail = 0;
+  if (i < size) std::memcpy(&tail, data + i, size - i);
+  hash = (hash ^ tail) * K;
+  // The splitmix64 finalizer.
+  hash ^= hash >> 30;
+  hash *= 0xBF58476D1CE4E5B9ULL;
+  hash ^= hash >> 27;
+  hash *= 0x94D049BB133111EBULL;
+  return hash ^ (hash >> 31);
+}
+
+auto buildIdentity() -> uint64_t {
+  static const uint64_t identity = [] {
+#if defined(__linux__)
+    ObjectSearch search;
+    search.address = reinterpret_cast<uintptr_t>(&buildIdentity);
+    dl_iterate_phdr(searchObject, &search);
+    if (search.buildId.has_value()) return hashBytes(*search.buildId);
+    if (search.found) {
+      std::ifstream file(search.path, std::ios::binary);
+      std::ostringstream contents;
+      contents << file.rdbuf();
+      if (file) return hashBytes(contents.str());
+    }
+#endif
+    return uint64_t{0};
+  }();
+  return identity;
+}
+
+auto writeImage(const FlatAST& ast, std::string_view source)
+    -> std::optional<std::string> {
+  std::vector<ImageToken> tokens;
+  tokens.reserve(ast.tokens.size());
+  for (const Types::Token& token : ast.tokens) {
+    const std::string_view lexeme = token.getLexeme();
+    const auto offset = static_cast<size_t>(lexeme.data() - source.data());
+    if (lexeme.data() < source.data() || offset > source.size()
+        || lexeme.size() > source.size() - offset)
+      return std::nullopt;
+    tokens.push_back(ImageToken{static_cast<uint32_t>(offset),
+                                static_cast<uint32_t>(lexeme.size()),
+                                token.getLine(), token.getType(), {}});
+  }
+
+  ImageWriter writer;
+  writer.bytes.resize(sizeof(Header));
+  writer.column(ast.exprs.kind);
+  writer.column(ast.exprs.op);
+  writer.column(ast.exprs.token);
+  writer.column(ast.exprs.a);
+  writer.column(ast.exprs.b);
+  writer.column(ast.exprs.c);
+  writer.column(ast.stmts.kind);
+  writer.column(ast.stmts.token);
+  writer.column(ast.stmts.a);
+  writer.column(ast.stmts.b);
+  writer.column(ast.stmts.c);
+  writer.column(ast.stmts.d);
+  writer.column(tokens);
+  writer.literals(ast.literals);
+  writer.column(ast.functions);
+  writer.column(ast.exprLists);
+  writer.column(ast.stmtLists);
+  writer.column(ast.tokenLists);
+  writer.column(ast.program);
+
+  const std::string_view payload
+      = std::string_view(writer.bytes).substr(sizeof(Header));
+  Header header{};
+  std::memcpy(header.magic, MAGIC, sizeof MAGIC);
+  header.version = IMAGE_VERSION;
+  header.build = buildIdentity();
+  header.sourceSize = source.size();
+  header.sourceHash = hashBytes(source);
+  header.payloadSize = payload.size();
+  header.payloadHash = hashBytes(payload);
+  std::memcpy(writer.bytes.data(), &header, sizeof header);
+  return std::move(writer.bytes);
+}
+
+auto readImage(std::string_view image, std::string_view source)
+    -> std::optional<FlatAST> {
+  Header header{};
+  if (image.size() < sizeof header) return std::nullopt;
+  std::memcpy(&header, image.data(), sizeof header);
+  const std::string_view payload = image.substr(sizeof header);
+  if (std::memcmp(header.magic, MAGIC, sizeof MAGIC) != 0
+      || header.version != IMAGE_VERSION || header.build != buildIdentity()
+      || header.sourceSize != source.size()
+      || header.payloadSize != payload.size()
+      || header.payloadHash != hashBytes(payload)
+      || header.sourceHash != hashBytes(source))
+    return std::nullopt;
+
+  FlatAST ast;
+  std::vector<ImageToken> tokens;
+  ImageReader reader(payload);
+  if (!(reader.column(ast.exprs.kind) && reader.column(ast.exprs.op)
+        && reader.column(ast.exprs.token) && reader.column(ast.exprs.a)
+        && reader.column(ast.exprs.b) && reader.column(ast.exprs.c)
+        && reader.column(ast.stmts.kind) && reader.column(ast.stmts.token)
+        && reader.column(ast.stmts.a) && reader.column(ast.stmts.b)
+        && reader.column(ast.stmts.c) && reader.column(ast.stmts.d)
+        && reader.column(tokens) && reader.literals(ast.literals)
+        && reader.column(ast.functions) && reader.column(ast.exprLists)
+        && reader.column(ast.stmtLists) && reader.column(ast.tokenLists)
+        && reader.column(ast.program) && reader.atEnd()))
+    return std::nullopt;
+
+  ast.tokens.reserve(tokens.size());
+  for (const ImageToken& token : tokens) {
+    if (token.offset > source.size()
+        || token.length > source.size() - token.offset)
+      return std::nullopt;
+    ast.tokens.emplace_back(token.type,
+                            source.substr(token.offset, token.length),
+                            token.line);
+  }
+  return ast;
+}
+
+}  // namespace cpplox::AST
@@ -0,0 +1,49 @@
+#ifndef CPPLOX_AST_FLATASTIMAGE_H
+#define CPPLOX_AST_FLATASTIMAGE_H
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include "cpplox/AST/FlatAST.h"
+
+// A FlatAST as a flat run of bytes, for saving a parsed program and loading
+// it again without scanning or parsing. The image holds the FlatAST's pools
+// column by column, so loading one is mostly a copy per column, and it can be
+// read straight out of a memory mapped file.
+//
+// Tokens are saved as offsets into the source they were scanned from rather
+// than as pointers, so an image is only good for that exact source: it
+// records the source's size and hash, and reading it against anything else
+// fails. The format is native endian and versioned by IMAGE_VERSION, which
+// must be bumped whenever it, or the meaning of a FlatAST, changes. Since a
+// change to the parser can change the tree without anyone bumping it, an image
+// also records the build that wrote it, and only that build reads it.
+
+namespace cpplox::AST {
+
+constexpr uint32_t IMAGE_VERSION = 2;
+
+// A fast 64 bit hash, for telling sources (and images) apart; not for
+// defending against anyone.
+auto hashBytes(std::string_view bytes) -> uint64_t;
+
+// Tells builds of cpplox apart: the hash of the build ID the linker stamped on
+// the binary (or, lacking one, of the binary itself). 0 where there's no way
+// of finding out.
+auto buildIdentity() -> uint64_t;
+
+// nullopt if a token's lexeme isn't in source.
+auto writeImage(const FlatAST& ast, std::string_view source)
+    -> std::optional<std::string>;
+
+// nullopt if image isn't a complete image of source, written by this build.
+// The tokens of the FlatAST point into source.
+auto readImage(std::string_view image, std::string_view source)
+    -> std::optional<FlatAST>;
+
+}  // namespace cpplox::AST
+
+#endif  // CPPLOX_AST_FLATASTIMAGE_H
@@ -0,0 +1,92 @@
+#include "gtest/gtest.h"
+
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "cpplox/AST/FlatAST.h"
+#include "cpplox/AST/FlatASTImage.h"
+#include "cpplox/AST/NodeTypes.h"
+#include "cpplox/AST/PrettyPrinter.h"
+#include "cpplox/ErrorsAndDebug/ErrorReporter.h"
+#include "cpplox/Parser/Parser.h"
+#include "cpplox/Scanner/Scanner.h"
+
+namespace cpplox::AST {
+
+namespace {
+
+const std::string SOURCE = R"(
+  var a = 1.5;
+  var s = "a string";
+  print -a * (2 + 3) >= 4 == !true or a and nil;
+  fun add(x, y) { return x + y; }
+  class Base { init() { this.value = 1; } }
+  class Derived < Base { get() { return super.get() + f(1, 2)(3); } }
+  for (var i = 0; i < 3; i = i + 1) { if (i) print i; else print s; }
+)";
+
+auto image(const std::string& source) -> std::string {
+  ErrorsAndDebug::ErrorReporter eReporter;
+  Types::TokenList tokens = Scanner(source, eReporter).tokenize();
+  std::optional<std::string> bytes = writeImage(
+      flatten(Parser::RDParser(tokens, eReporter).parse()), source);
+  EXPECT_TRUE(bytes.has_value());
+  return bytes.value_or("");
+}
+
+}  // namespace
+
+TEST(FlatASTImageTest, reads_back_what_was_written) {
+  const std::string bytes = image(SOURCE);
+  // A copy of the source, so nothing can point into the original.
+  const std::string source = SOURCE;
+  std::optional<FlatAST> flat = readImage(bytes, source);
+  ASSERT_TRUE(flat.has_value());
+
+  ErrorsAndDebug::ErrorReporter eReporter;
+  Types::TokenList tokens = Scanner(source, eReporter).tokenize();
+  const std::vector<StmtPtrVariant> parsed
+      = Parser::RDParser(tokens, eReporter).parse();
+  EXPECT_EQ(PrettyPrinter::toString(parsed), PrettyPrinter::toString(*flat));
+  EXPECT_EQ(PrettyPrinter::toString(parsed),
+            PrettyPrinter::toString(unflatten(*flat)));
+  for (const Types::Token& token : flat->tokens) {
+    EXPECT_GE(token.getLexeme().data(), source.data());
+    EXPECT_LE(token.getLexeme().data(), source.data() + source.size());
+  }
+}
+
+TEST(FlatASTImageTest, only_matches_its_own_source) {
+  const std::string bytes = image(SOURCE);
+  std::string edited = SOURCE;
+  edited[edited.find("1.5")] = '2';
+  EXPECT_FALSE(readImage(bytes, edited).has_value());
+  EXPECT_FALSE(readImage(bytes, SOURCE + " ").has_value());
+}
+
+TEST(FlatASTImageTest, rejects_damaged_images) {
+  const std::string bytes = image(SOURCE);
+  EXPECT_FALSE(readImage("", SOURCE).has_value());
+  const std::string truncated = bytes.substr(0, bytes.size() - 8);
+  EXPECT_FALSE(readImage(truncated, SOURCE).has_value());
+  for (size_t i : {size_t{0}, size_t{8}, bytes.size() / 2, bytes.size() - 1}) {
+    std::string damaged = bytes;
+    damaged[i] = static_cast<char>(damaged[i] ^ 0x10);
+    EXPECT_FALSE(readImage(damaged, SOURCE).has_value()) << i;
+  }
+}
+
+TEST(FlatASTImageTest, only_matches_the_build_that_wrote_it) {
+#if defined(__linux__)
+  EXPECT_NE(0U, buildIdentity());
+#endif
+  EXPECT_EQ(buildIdentity(), buildIdentity());
+  // The build identity follows the magic, version and a reserved word.
+  const size_t build = 16;
+  std::string otherBuild = image(SOURCE);
+  otherBuild[build] = static_cast<char>(otherBuild[build] ^ 0x01);
+  EXPECT_FALSE(readImage(otherBuild, SOURCE).has_value());
+}
+
+}  // namespace cpplox::AST
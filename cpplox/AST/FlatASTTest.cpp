@@ -0,0 +1,85 @@
+#include "gtest/gtest.h"
+
+#include <string>
+#include <vector>
+
+#include "cpplox/AST/FlatAST.h"
+#include "cpplox/AST/NodeTypes.h"
+#include "cpplox/AST/PrettyPrinter.h"
+#include "cpplox/TestUtil/TestUtil.h"
+
+namespace cpplox::AST {
+
+TEST(FlatASTTest, prints_like_the_tree_it_came_from) {
+  const std::string source = R"(
+    var a = 1;
+    var b;
+    print -a * (2 + 3) >= 4 == !true or a and nil;
+    b = a ? "yes" : "no";
+    a++;
+    {
+      var c = f(1, 2, 3) + g() + h(4);
+      if (c < 0) print c; else { c = 0; }
+    }
+    while (a > 0) a = a - 1;
+    for (var i = 0; i < 3; i = i + 1) print i;
+    for (;;) { print 1; }
+    fun add(x, y) { return x + y; }
+    fun nothing() { return; }
+    class Base { init() { this.value = 1; } get() { return this.value; } }
+    class Derived < Base { get() { return super.get() + obj.field.other; } }
+  )";
+  const std::vector<StmtPtrVariant> program = TestUtil::parse(source);
+  const FlatAST flat = flatten(program);
+
+  EXPECT_EQ(program.size(), flat.program.size());
+  EXPECT_EQ(PrettyPrinter::toString(program), PrettyPrinter::toString(flat));
+}
+
+TEST(FlatASTTest, unflattens_to_the_tree_it_came_from) {
+  const std::string source = R"(
+    var a = "s" + 1;
+    a = -a++ or nil ? f(a, b).c : fun (x) { return x; };
+    for (;;) { while (a) { a.b = 1; } }
+    class C < B { m() { return super.m(this); } }
+  )";
+  const std::vector<StmtPtrVariant> program = TestUtil::parse(source);
+  EXPECT_EQ(PrettyPrinter::toString(program),
+            PrettyPrinter::toString(unflatten(flatten(program))));
+}
+
+TEST(FlatASTTest, call_arguments_are_contiguous) {
+  const std::string source = "f(a, b + 1, g(c));";
+  const FlatAST flat = flatten(TestUtil::parse(source));
+
+  // The outermost call is the last expression added.
+  const auto call = static_cast<Index>(flat.exprs.kind.size() - 1);
+  ASSERT_EQ(ExprKind::CALL, flat.exprs.kind[call]);
+  const IndexRange arguments = flat.callArguments(call);
+  ASSERT_EQ(3, arguments.size());
+  EXPECT_EQ(ExprKind::VARIABLE, flat.exprs.kind[arguments.first[0]]);
+  EXPECT_EQ(ExprKind::BINARY, flat.exprs.kind[arguments.first[1]]);
+  EXPECT_EQ(Op::PLUS, flat.exprs.op[arguments.first[1]]);
+  EXPECT_EQ(ExprKind::CALL, flat.exprs.kind[arguments.first[2]]);
+  EXPECT_EQ(1, flat.callArguments(arguments.first[2]).size());
+}
+
+TEST(FlatASTTest, functions_keep_params_and_body) {
+  const std::string source = "fun f(a, b) { print a; return b; }";
+  const FlatAST flat = flatten(TestUtil::parse(source));
+
+  ASSERT_EQ(1, flat.program.size());
+  const Index stmt = flat.program[0];
+  ASSERT_EQ(StmtKind::FUNC, flat.stmts.kind[stmt]);
+  EXPECT_EQ("f", flat.tokens[flat.stmts.token[stmt]].getLexeme());
+  const Index function = flat.stmts.a[stmt];
+  const IndexRange params = flat.functionParams(function);
+  ASSERT_EQ(2, params.size());
+  EXPECT_EQ("b", flat.tokens[params.first[1]].getLexeme());
+  const IndexRange body = flat.functionBody(function);
+  ASSERT_EQ(2, body.size());
+  EXPECT_EQ(StmtKind::PRINT, flat.stmts.kind[body.first[0]]);
+  EXPECT_EQ(StmtKind::RETURN, flat.stmts.kind[body.first[1]]);
+}
+
+}  // namespace cpplox::AST
@@ -7,6 +7,8 @@
 #include <string>
 #include <utility>
 
+#include "cpplox/AST/Arena.h"
+
 namespace cpplox::AST {
 // ========================== //
 // Expr AST Type Constructors //
@@ -47,9 +49,32 @@ CallExpr::CallExpr(ExprPtrVariant callee, Token paren,
       paren(std::move(paren)),
       arguments(std::move(arguments)) {}
 
+// FuncExprs are made in Arena::current(), like every node.
 FuncExpr::FuncExpr(std::vector<Token> parameters,
                    std::vector<StmtPtrVariant> body)
-    : parameters(std::move(parameters)), body(std::move(body)) {}
+    : parameters(std::move(parameters)),
+      body(std::move(body)),
+      arena(Arena::current().weak_from_this()) {}
+
+FuncExpr::FuncExpr(std::vector<Token> parameters, BodyParser bodyParser)
+    : parameters(std::move(parameters)),
+      bodyParser(std::move(bodyParser)),
+      arena(Arena::current().weak_from_this()) {}
+
+auto FuncExpr::getBody() const -> const std::vector<StmtPtrVariant>& {
+  if (bodyParser) {
+    // If this throws, the body stays unparsed and the next call fails again.
+    body = bodyParser();
+    bodyParser = nullptr;
+  }
+  return body;
+}
+
+auto FuncExpr::isBodyParsed() const -> bool { return !bodyParser; }
+
+auto FuncExpr::share() const -> std::shared_ptr<const FuncExpr> {
+  return std::shared_ptr<const FuncExpr>(arena.lock(), this);
+}
 
 GetExpr::GetExpr(ExprPtrVariant expr, Token name)
     : expr(std::move(expr)), name(std::move(name)) {}
@@ -67,71 +92,80 @@ SuperExpr::SuperExpr(Token keyword, Token method)
 // ==============================//
 auto createBinaryEPV(ExprPtrVariant left, Token op, ExprPtrVariant right)
     -> ExprPtrVariant {
-  return std::make_unique<BinaryExpr>(std::move(left), op, std::move(right));
+  return Arena::current().make<BinaryExpr>(std::move(left), op,
+                                           std::move(right));
 }
 
 auto createUnaryEPV(Token op, ExprPtrVariant right) -> ExprPtrVariant {
-  return std::make_unique<UnaryExpr>(op, std::move(right));
+  return Arena::current().make<UnaryExpr>(op, std::move(right));
 }
 
 auto createGroupingEPV(ExprPtrVariant right) -> ExprPtrVariant {
-  return std::make_unique<GroupingExpr>(std::move(right));
+  return Arena::current().make<GroupingExpr>(std::move(right));
 }
 
 auto createLiteralEPV(OptionalLiteral literal) -> ExprPtrVariant {
-  return std::make_unique<LiteralExpr>(std::move(literal));
+  return Arena::current().make<LiteralExpr>(std::move(literal));
 }
 
 auto createConditionalEPV(ExprPtrVariant condition, ExprPtrVariant then,
                           ExprPtrVariant elseBranch) -> ExprPtrVariant {
-  return std::make_unique<ConditionalExpr>(
+  return Arena::current().make<ConditionalExpr>(
       std::move(condition), std::move(then), std::move(elseBranch));
 }
 
 auto createPostfixEPV(ExprPtrVariant left, Token op) -> ExprPtrVariant {
-  return std::make_unique<PostfixExpr>(std::move(left), op);
+  return Arena::current().make<PostfixExpr>(std::move(left), op);
 }
 
 auto createVariableEPV(Token varName) -> ExprPtrVariant {
-  return std::make_unique<VariableExpr>(varName);
+  return Arena::current().make<VariableExpr>(varName);
 }
 
 auto createAssignmentEPV(Token varName, ExprPtrVariant expr) -> ExprPtrVariant {
-  return std::make_unique<AssignmentExpr>(varName, std::move(expr));
+  return Arena::current().make<AssignmentExpr>(varName, std::move(expr));
 }
 
 auto createLogicalEPV(ExprPtrVariant left, Token op, ExprPtrVariant right)
     -> ExprPtrVariant {
-  return std::make_unique<LogicalExpr>(std::move(left), op, std::move(right));
+  return Arena::current().make<LogicalExpr>(std::move(left), op,
+                                            std::move(right));
 }
 
 auto createCallEPV(ExprPtrVariant callee, Token paren,
                    std::vector<ExprPtrVariant> arguments) -> ExprPtrVariant {
-  return std::make_unique<CallExpr>(std::move(callee), std::move(paren),
-                                    std::move(arguments));
+  return Arena::current().make<CallExpr>(std::move(callee), std::move(paren),
+                                         std::move(arguments));
 }
 
 auto createFuncEPV(std::vector<Token> params,
                    std::vector<StmtPtrVariant> fnBody) -> ExprPtrVariant {
-  return std::make_unique<FuncExpr>(std::move(params), std::move(fnBody));
+  return Arena::current().make<FuncExpr>(std::move(params), std::move(fnBody));
+}
+
+auto createFuncEPV(std::vector<Token> params, BodyParser bodyParser)
+    -> ExprPtrVariant {
+  return Arena::current().make<FuncExpr>(std::move(params),
+                                         std::move(bodyParser));
 }
 
 auto createGetEPV(ExprPtrVariant expr, Token name) -> ExprPtrVariant {
-  return std::make_unique<GetExpr>(std::move(expr), std::move(name));
+  return Arena::current().make<GetExpr>(std::move(expr), std::move(name));
 }
 
 auto createSetEPV(ExprPtrVariant expr, Token name, ExprPtrVariant value)
     -> ExprPtrVariant {
-  return std::make_unique<SetExpr>(std::move(expr), std::move(name),
-                                   std::move(value));
+  return Arena::current().make<SetExpr>(std::move(expr), std::move(name),
+                                        std::move(value));
 }
 
 auto createThisEPV(Token keyword) -> ExprPtrVariant {
-  return std::make_unique<ThisExpr>(std::move(keyword));
+  return Arena::current().make<ThisExpr>(std::move(keyword));
 }
 
 auto createSuperEPV(Token keyword, Token method) -> ExprPtrVariant {
-  return std::make_unique<SuperExpr>(std::move(keyword), std::move(method));
+  return Arena::current().make<SuperExpr>(std::move(keyword),
+                                          std::move(method));
 }
 
 // =================== //
@@ -181,54 +215,57 @@ ClassStmt::ClassStmt(Token className, std::optional<ExprPtrVariant> superClass,
 // Helper functions to create StmtPtrVariants for each Stmt type //
 // ============================================================= //
 auto createExprSPV(ExprPtrVariant expr) -> StmtPtrVariant {
-  return std::make_unique<ExprStmt>(std::move(expr));
+  return Arena::current().make<ExprStmt>(std::move(expr));
 }
 
 auto createPrintSPV(ExprPtrVariant expr) -> StmtPtrVariant {
-  return std::make_unique<PrintStmt>(std::move(expr));
+  return Arena::current().make<PrintStmt>(std::move(expr));
 }
 
 auto createBlockSPV(std::vector<StmtPtrVariant> statements) -> StmtPtrVariant {
-  return std::make_unique<BlockStmt>(std::move(statements));
+  return Arena::current().make<BlockStmt>(std::move(statements));
 }
 
 auto createVarSPV(Token varName, std::optional<ExprPtrVariant> initializer)
     -> StmtPtrVariant {
-  return std::make_unique<VarStmt>(varName, std::move(initializer));
+  return Arena::current().make<VarStmt>(varName, std::move(initializer));
 }
 
 auto createIfSPV(ExprPtrVariant condition, StmtPtrVariant thenBranch,
                  std::optional<StmtPtrVariant> elseBranch) -> StmtPtrVariant {
-  return std::make_unique<IfStmt>(std::move(condition), std::move(thenBranch),
-                                  std::move(elseBranch));
+  return Arena::current().make<IfStmt>(
+      std::move(condition), std::move(thenBranch), std::move(elseBranch));
 }
 
 auto createWhileSPV(ExprPtrVariant condition, StmtPtrVariant loopBody)
     -> StmtPtrVariant {
-  return std::make_unique<WhileStmt>(std::move(condition), std::move(loopBody));
+  return Arena::current().make<WhileStmt>(std::move(condition),
+                                          std::move(loopBody));
 }
 
 auto createForSPV(std::optional<StmtPtrVariant> initializer,
                   std::optional<ExprPtrVariant> condition,
                   std::optional<ExprPtrVariant> increment,
                   StmtPtrVariant loopBody) -> StmtPtrVariant {
-  return std::make_unique<ForStmt>(std::move(initializer), std::move(condition),
-                                   std::move(increment), std::move(loopBody));
+  return Arena::current().make<ForStmt>(
+      std::move(initializer), std::move(condition), std::move(increment),
+      std::move(loopBody));
 }
 
 auto createFuncSPV(Token fName, FuncExprPtr funcExpr) -> StmtPtrVariant {
-  return std::make_unique<FuncStmt>(std::move(fName), std::move(funcExpr));
+  return Arena::current().make<FuncStmt>(std::move(fName),
+                                         std::move(funcExpr));
 }
 
 auto createRetSPV(Token ret, std::optional<ExprPtrVariant> value)
     -> StmtPtrVariant {
-  return std::make_unique<RetStmt>(std::move(ret), std::move(value));
+  return Arena::current().make<RetStmt>(std::move(ret), std::move(value));
 }
 
 auto createClassSPV(Token className, std::optional<ExprPtrVariant> superClass,
                     std::vector<StmtPtrVariant> methods) -> StmtPtrVariant {
-  return std::make_unique<ClassStmt>(std::move(className),
-                                     std::move(superClass), std::move(methods));
+  return Arena::current().make<ClassStmt>(
+      std::move(className), std::move(superClass), std::move(methods));
 }
 
 }  // namespace cpplox::AST
\ No newline at end of file
@@ -3,12 +3,14 @@
 #pragma once
 
 // This header file describes AST node Types for both Expressions and Statements
+#include <functional>
 #include <memory>
 #include <optional>
 #include <string>
 #include <variant>
 #include <vector>
 
+#include "cpplox/AST/Arena.h"
 #include "cpplox/Types/Literal.h"
 #include "cpplox/Types/Token.h"
 #include "cpplox/Types/Uncopyable.h"
@@ -37,22 +39,22 @@ struct SetExpr;
 struct ThisExpr;
 struct SuperExpr;
 
-// Unique_pointer sugar for Exprs.
-using BinaryExprPtr = std::unique_ptr<BinaryExpr>;
-using GroupingExprPtr = std::unique_ptr<GroupingExpr>;
-using LiteralExprPtr = std::unique_ptr<LiteralExpr>;
-using UnaryExprPtr = std::unique_ptr<UnaryExpr>;
-using ConditionalExprPtr = std::unique_ptr<ConditionalExpr>;
-using PostfixExprPtr = std::unique_ptr<PostfixExpr>;
-using VariableExprPtr = std::unique_ptr<VariableExpr>;
-using AssignmentExprPtr = std::unique_ptr<AssignmentExpr>;
-using LogicalExprPtr = std::unique_ptr<LogicalExpr>;
-using CallExprPtr = std::unique_ptr<CallExpr>;
-using FuncExprPtr = std::unique_ptr<FuncExpr>;
-using GetExprPtr = std::unique_ptr<GetExpr>;
-using SetExprPtr = std::unique_ptr<SetExpr>;
-using ThisExprPtr = std::unique_ptr<ThisExpr>;
-using SuperExprPtr = std::unique_ptr<SuperExpr>;
+// Pointer sugar for Exprs. Nodes are owned by the Arena they were made in.
+using BinaryExprPtr = NodePtr<BinaryExpr>;
+using GroupingExprPtr = NodePtr<GroupingExpr>;
+using LiteralExprPtr = NodePtr<LiteralExpr>;
+using UnaryExprPtr = NodePtr<UnaryExpr>;
+using ConditionalExprPtr = NodePtr<ConditionalExpr>;
+using PostfixExprPtr = NodePtr<PostfixExpr>;
+using VariableExprPtr = NodePtr<VariableExpr>;
+using AssignmentExprPtr = NodePtr<AssignmentExpr>;
+using LogicalExprPtr = NodePtr<LogicalExpr>;
+using CallExprPtr = NodePtr<CallExpr>;
+using FuncExprPtr = NodePtr<FuncExpr>;
+using GetExprPtr = NodePtr<GetExpr>;
+using SetExprPtr = NodePtr<SetExpr>;
+using ThisExprPtr = NodePtr<ThisExpr>;
+using SuperExprPtr = NodePtr<SuperExpr>;
 
 // The variant that we will use to pass around pointers to each of these
 // expression types. I'm exploring this so we don't have to rely on vTables
@@ -75,17 +77,17 @@ struct FuncStmt;
 struct RetStmt;
 struct ClassStmt;
 
-// Unique pointer sugar for Stmts
-using ExprStmtPtr = std::unique_ptr<ExprStmt>;
-using PrintStmtPtr = std::unique_ptr<PrintStmt>;
-using BlockStmtPtr = std::unique_ptr<BlockStmt>;
-using VarStmtPtr = std::unique_ptr<VarStmt>;
-using IfStmtPtr = std::unique_ptr<IfStmt>;
-using WhileStmtPtr = std::unique_ptr<WhileStmt>;
-using ForStmtPtr = std::unique_ptr<ForStmt>;
-using FuncStmtPtr = std::unique_ptr<FuncStmt>;
-using RetStmtPtr = std::unique_ptr<RetStmt>;
-using ClassStmtPtr = std::unique_ptr<ClassStmt>;
+// Pointer sugar for Stmts
+using ExprStmtPtr = NodePtr<ExprStmt>;
+using PrintStmtPtr = NodePtr<PrintStmt>;
+using BlockStmtPtr = NodePtr<BlockStmt>;
+using VarStmtPtr = NodePtr<VarStmt>;
+using IfStmtPtr = NodePtr<IfStmt>;
+using WhileStmtPtr = NodePtr<WhileStmt>;
+using ForStmtPtr = NodePtr<ForStmt>;
+using FuncStmtPtr = NodePtr<FuncStmt>;
+using RetStmtPtr = NodePtr<RetStmt>;
+using ClassStmtPtr = NodePtr<ClassStmt>;
 
 // We use this variant to pass around pointers to each of these Stmt types,
 // without having to resort to virtual functions and dynamic dispatch
@@ -94,7 +96,12 @@ using StmtPtrVariant
                    IfStmtPtr, WhileStmtPtr, ForStmtPtr, FuncStmtPtr, RetStmtPtr,
                    ClassStmtPtr>;
 
-// Helper functions to create ExprPtrVariants for each Expr type
+// Parses a function body that the parser skipped over (see RDParser's lazy
+// mode). Throws if the body has syntax errors.
+using BodyParser = std::function<std::vector<StmtPtrVariant>()>;
+
+// Helper functions to create ExprPtrVariants for each Expr type. These, and
+// the Stmt helpers below, make nodes in Arena::current().
 auto createBinaryEPV(ExprPtrVariant left, Token op, ExprPtrVariant right)
     -> ExprPtrVariant;
 auto createUnaryEPV(Token op, ExprPtrVariant right) -> ExprPtrVariant;
@@ -111,6 +118,8 @@ auto createCallEPV(ExprPtrVariant callee, Token paren,
                    std::vector<ExprPtrVariant> arguments) -> ExprPtrVariant;
 auto createFuncEPV(std::vector<Token> params,
                    std::vector<StmtPtrVariant> fnBody) -> ExprPtrVariant;
+auto createFuncEPV(std::vector<Token> params, BodyParser bodyParser)
+    -> ExprPtrVariant;
 auto createGetEPV(ExprPtrVariant expr, Token name) -> ExprPtrVariant;
 auto createSetEPV(ExprPtrVariant expr, Token name, ExprPtrVariant value)
     -> ExprPtrVariant;
@@ -204,8 +213,22 @@ struct CallExpr final : public Uncopyable {
 
 struct FuncExpr final : public Uncopyable {
   std::vector<Token> parameters;
-  std::vector<StmtPtrVariant> body;
   FuncExpr(std::vector<Token> parameters, std::vector<StmtPtrVariant> body);
+  FuncExpr(std::vector<Token> parameters, BodyParser bodyParser);
+
+  // The body, parsed now if that was put off until it was first needed.
+  [[nodiscard]] auto getBody() const -> const std::vector<StmtPtrVariant>&;
+  [[nodiscard]] auto isBodyParsed() const -> bool;
+
+  // A pointer to this node that keeps the arena it's in (and so the rest of
+  // its tree) alive. Only points at it if that arena isn't owned by a
+  // shared_ptr.
+  [[nodiscard]] auto share() const -> std::shared_ptr<const FuncExpr>;
+
+ private:
+  mutable std::vector<StmtPtrVariant> body;
+  mutable BodyParser bodyParser;
+  std::weak_ptr<Arena> arena;
 };
 
 struct GetExpr final : public Uncopyable {
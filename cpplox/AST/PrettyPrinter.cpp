@@ -24,7 +24,8 @@ auto parenthesize(const std::string& name, const ExprPtrVariant& expr1,
 }
 
 auto printBinaryExpr(const BinaryExprPtr& expr) -> std::string {
-  return parenthesize(expr->op.getLexeme(), expr->left, expr->right);
+  return parenthesize(std::string(expr->op.getLexeme()), expr->left,
+                      expr->right);
 }
 auto printGroupingExpr(const GroupingExprPtr& expr) -> std::string {
   std::string name = "group";
@@ -38,7 +39,7 @@ auto printLiteralExpr(const LiteralExprPtr& expr) -> std::string {
 }
 
 auto printUnaryExpr(const UnaryExprPtr& expr) -> std::string {
-  return parenthesize(expr->op.getLexeme(), expr->right);
+  return parenthesize(std::string(expr->op.getLexeme()), expr->right);
 }
 
 auto printConditionalExpr(const ConditionalExprPtr& expr) -> std::string {
@@ -47,19 +48,23 @@ auto printConditionalExpr(const ConditionalExprPtr& expr) -> std::string {
 }
 
 auto printPostfixExpr(const PostfixExprPtr& expr) -> std::string {
-  return parenthesize("POSTFIX " + expr->op.getLexeme(), expr->left);
+  return parenthesize("POSTFIX " + std::string(expr->op.getLexeme()),
+                      expr->left);
 }
 
 auto printVariableExpr(const VariableExprPtr& expr) -> std::string {
-  return "(" + expr->varName.getLexeme() + ")";
+  return "(" + std::string(expr->varName.getLexeme()) + ")";
 }
 
 auto printAssignmentExpr(const AssignmentExprPtr& expr) -> std::string {
-  return parenthesize("= " + expr->varName.getLexeme(), expr->right) + ";";
+  return parenthesize("= " + std::string(expr->varName.getLexeme()),
+                      expr->right)
+         + ";";
 }
 
 auto printLogicalExpr(const LogicalExprPtr& expr) -> std::string {
-  return parenthesize(expr->op.getLexeme(), expr->left, expr->right);
+  return parenthesize(std::string(expr->op.getLexeme()), expr->left,
+                      expr->right);
 }
 // myGloriousFn(arg1, expr1+expr2)
 // ( ((arg1), (+ expr1 expr2)) myGloriousFn )
@@ -76,10 +81,10 @@ auto printFuncExpr(const FuncExprPtr& expr) -> std::string {
   std::string funcStr = "(";
   for (size_t i = 0; i < expr->parameters.size(); ++i) {
     if (0 != i) funcStr += ", ";
-    funcStr += expr->parameters[i].getLexeme();
+    funcStr += std::string(expr->parameters[i].getLexeme());
   }
   funcStr += ") {\n";
-  for (auto& bodyStmt : expr->body) {
+  for (auto& bodyStmt : expr->getBody()) {
     for (const auto& str : PrettyPrinter::toString(bodyStmt)) {
       funcStr += str + "\n";
     }
@@ -90,14 +95,14 @@ auto printFuncExpr(const FuncExprPtr& expr) -> std::string {
 
 auto printGetExpr(const GetExprPtr& expr) -> std::string {
   std::string str = PrettyPrinter::toString(expr->expr);
-  str += " .( get " + expr->name.getLexeme() + " )";
+  str += " .( get " + std::string(expr->name.getLexeme()) + " )";
   return str;
 }
 
 auto printSetExpr(const SetExprPtr& expr) -> std::string {
   std::string str = PrettyPrinter::toString(expr->expr);
   std::string val = PrettyPrinter::toString(expr->value);
-  str += " .( set " + expr->name.getLexeme() + " ) = " + val;
+  str += " .( set " + std::string(expr->name.getLexeme()) + " ) = " + val;
   return str;
 }
 
@@ -175,7 +180,7 @@ auto printBlockStmt(const BlockStmtPtr& blkStmts) -> std::vector<std::string> {
 }
 
 auto printVarStmt(const VarStmtPtr& stmt) -> std::string {
-  std::string str = "var " + stmt->varName.getLexeme();
+  std::string str = "var " + std::string(stmt->varName.getLexeme());
   if (stmt->initializer.has_value()) {
     str = "( = ( " + str + " ) "
           + PrettyPrinter::toString(stmt->initializer.value()) + " )";
@@ -240,7 +245,8 @@ auto printForStmt(const ForStmtPtr& stmt) {
 // Token funcName, FuncExprPtr funcExpr
 auto printFuncStmt(const FuncStmtPtr& stmt) -> std::vector<std::string> {
   std::vector<std::string> funcStrVec;
-  funcStrVec.emplace_back("( ( " + stmt->funcName.getLexeme() + ") ");
+  funcStrVec.emplace_back("( ( " + std::string(stmt->funcName.getLexeme())
+                          + ") ");
   funcStrVec.emplace_back(printFuncExpr(stmt->funcExpr));
   funcStrVec.emplace_back(")");
   return funcStrVec;
@@ -255,7 +261,8 @@ auto printRetStmt(const RetStmtPtr& stmt) -> std::string {
 
 auto printClassStmt(const ClassStmtPtr& stmt) -> std::vector<std::string> {
   std::vector<std::string> strVec;
-  strVec.emplace_back("(CLASS " + stmt->className.getLexeme() + " )");
+  strVec.emplace_back("(CLASS " + std::string(stmt->className.getLexeme())
+                      + " )");
   if (stmt->superClass.has_value())
     strVec.emplace_back(" < "
                         + PrettyPrinter::toString(stmt->superClass.value()));
@@ -314,4 +321,175 @@ auto PrettyPrinter::toString(const std::vector<AST::StmtPtrVariant>& statements)
   return stmtStrsVec;
 }
 
+//==============================//
+// Flat AST Printing functions  //
+//==============================//
+namespace {
+
+// Mirrors the functions above node for node, reading the flat pools instead
+// of following pointers.
+class FlatPrinter {
+ public:
+  explicit FlatPrinter(const FlatAST& ast) : ast(ast) {}
+
+  auto expr(Index e) const -> std::string {
+    const auto& exprs = ast.exprs;
+    const Index a = exprs.a[e];
+    const Index b = exprs.b[e];
+    const Index c = exprs.c[e];
+    switch (exprs.kind[e]) {
+      case ExprKind::BINARY:
+      case ExprKind::LOGICAL:
+        return parenthesize(lexeme(exprs.token[e]), a, b);
+      case ExprKind::GROUPING: return parenthesize("group", a);
+      case ExprKind::LITERAL:
+        return a != NO_INDEX ? Types::getLiteralString(ast.literals[a])
+                             : "nil";
+      case ExprKind::UNARY: return parenthesize(lexeme(exprs.token[e]), a);
+      case ExprKind::CONDITIONAL:
+        return parenthesize(": " + parenthesize("?", a), b, c);
+      case ExprKind::POSTFIX:
+        return parenthesize("POSTFIX " + lexeme(exprs.token[e]), a);
+      case ExprKind::VARIABLE: return "(" + lexeme(exprs.token[e]) + ")";
+      case ExprKind::ASSIGNMENT:
+        return parenthesize("= " + lexeme(exprs.token[e]), a) + ";";
+      case ExprKind::CALL: {
+        const IndexRange arguments = ast.callArguments(e);
+        std::string result;
+        for (size_t i = 0; i < arguments.size(); ++i) {
+          if (i > 0 && i < arguments.size() - 1) result += ", ";
+          result += "(" + expr(arguments.first[i]) + ")";
+        }
+        return parenthesize("(" + result + ")", a);
+      }
+      case ExprKind::FUNC: return function(a);
+      case ExprKind::GET:
+        return expr(a) + " .( get " + lexeme(exprs.token[e]) + " )";
+      case ExprKind::SET:
+        return expr(a) + " .( set " + lexeme(exprs.token[e]) + " ) = "
+               + expr(b);
+      case ExprKind::THIS: return "( this )";
+      case ExprKind::SUPER: return "( super." + ast.tokens[a].toString() + " )";
+    }
+    return "";
+  }
+
+  auto stmt(Index s) const -> std::vector<std::string> {
+    const auto& stmts = ast.stmts;
+    const Index a = stmts.a[s];
+    const Index b = stmts.b[s];
+    const Index c = stmts.c[s];
+    std::vector<std::string> strs;
+    switch (stmts.kind[s]) {
+      case StmtKind::EXPR: strs.push_back(parenthesize("", a) + ";"); break;
+      case StmtKind::PRINT:
+        strs.push_back(parenthesize("print", a) + ";");
+        break;
+      case StmtKind::BLOCK:
+        strs.emplace_back("{");
+        append(strs, ast.blockStatements(s));
+        strs.emplace_back("}");
+        break;
+      case StmtKind::VAR: {
+        std::string str = "var " + lexeme(stmts.token[s]);
+        if (a != NO_INDEX) str = "( = ( " + str + " ) " + expr(a) + " )";
+        strs.push_back(str + ";");
+        break;
+      }
+      case StmtKind::IF:
+        strs.push_back("( if (" + expr(a) + ")");
+        append(strs, stmt(b));
+        if (c != NO_INDEX) {
+          strs.emplace_back(" else ");
+          append(strs, stmt(c));
+        }
+        strs.emplace_back(" );");
+        break;
+      case StmtKind::WHILE:
+        strs.push_back("( while (" + expr(a) + ")");
+        append(strs, stmt(b));
+        strs.emplace_back(" );");
+        break;
+      case StmtKind::FOR:
+        strs.emplace_back("( for (");
+        if (a != NO_INDEX) append(strs, stmt(a));
+        strs.push_back("; " + optionalExpr(b) + ";" + optionalExpr(c) + ")");
+        append(strs, stmt(stmts.d[s]));
+        strs.emplace_back(" );");
+        break;
+      case StmtKind::FUNC:
+        strs.push_back("( ( " + lexeme(stmts.token[s]) + ") ");
+        strs.push_back(function(a));
+        strs.emplace_back(")");
+        break;
+      case StmtKind::RETURN:
+        strs.push_back("( return" + (a != NO_INDEX ? expr(a) : " ") + ");");
+        break;
+      case StmtKind::CLASS:
+        strs.push_back("(CLASS " + lexeme(stmts.token[s]) + " )");
+        if (a != NO_INDEX) strs.push_back(" < " + expr(a));
+        strs.emplace_back("{");
+        append(strs, ast.classMethods(s));
+        strs.emplace_back("}");
+        break;
+    }
+    return strs;
+  }
+
+ private:
+  auto lexeme(Index token) const -> std::string {
+    return std::string(ast.tokens[token].getLexeme());
+  }
+
+  auto optionalExpr(Index e) const -> std::string {
+    return e != NO_INDEX ? expr(e) : std::string();
+  }
+
+  auto parenthesize(const std::string& name, Index e) const -> std::string {
+    return "(" + name + " " + expr(e) + ")";
+  }
+
+  auto parenthesize(const std::string& name, Index e1, Index e2) const
+      -> std::string {
+    return "(" + name + " " + expr(e1) + " " + expr(e2) + ")";
+  }
+
+  auto function(Index f) const -> std::string {
+    std::string funcStr = "(";
+    const IndexRange params = ast.functionParams(f);
+    for (size_t i = 0; i < params.size(); ++i) {
+      if (0 != i) funcStr += ", ";
+      funcStr += lexeme(params.first[i]);
+    }
+    funcStr += ") {\n";
+    for (Index bodyStmt : ast.functionBody(f))
+      for (const auto& str : stmt(bodyStmt)) funcStr += str + "\n";
+    funcStr += "\n}";
+    return funcStr;
+  }
+
+  static void append(std::vector<std::string>& strs,
+                     std::vector<std::string>&& more) {
+    std::move(more.begin(), more.end(), std::back_inserter(strs));
+  }
+
+  void append(std::vector<std::string>& strs, IndexRange statements) const {
+    for (Index s : statements) append(strs, stmt(s));
+  }
+
+  const FlatAST& ast;
+};
+
+}  // namespace
+
+auto PrettyPrinter::toString(const FlatAST& ast) -> std::vector<std::string> {
+  const FlatPrinter printer(ast);
+  std::vector<std::string> stmtStrsVec;
+  for (Index stmt : ast.program) {
+    auto stmtStr = printer.stmt(stmt);
+    std::move(stmtStr.begin(), stmtStr.end(), std::back_inserter(stmtStrsVec));
+  }
+  return stmtStrsVec;
+}
+
 }  // namespace cpplox::AST
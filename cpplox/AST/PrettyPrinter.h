@@ -4,6 +4,7 @@
 #include <string>
 #include <vector>
 
+#include "cpplox/AST/FlatAST.h"
 #include "cpplox/AST/NodeTypes.h"
 
 namespace cpplox::AST::PrettyPrinter {
@@ -13,6 +14,8 @@ namespace cpplox::AST::PrettyPrinter {
 [[nodiscard]] auto toString(const ExprPtrVariant& expression) -> std::string;
 [[nodiscard]] auto toString(const StmtPtrVariant& statement)
     -> std::vector<std::string>;
+// Prints a flattened AST exactly as the statements it was flattened from.
+[[nodiscard]] auto toString(const FlatAST& ast) -> std::vector<std::string>;
 
 }  // namespace cpplox::AST::PrettyPrinter
 
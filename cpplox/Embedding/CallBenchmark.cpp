@@ -0,0 +1,97 @@
+// How long a C++ host takes to call a Lox function through Embedding::Script,
+// next to the same calls made from a loop in Lox, and to running a line of
+// source per call through the scanner, parser and evaluator. Run with:
+//   bazel run -c opt //cpplox/Embedding:call_benchmark -- [calls]
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "cpplox/AST/Arena.h"
+#include "cpplox/AST/NodeTypes.h"
+#include "cpplox/Embedding/Script.h"
+#include "cpplox/ErrorsAndDebug/ErrorReporter.h"
+#include "cpplox/Evaluator/Evaluator.h"
+#include "cpplox/Parser/Parser.h"
+#include "cpplox/Scanner/Scanner.h"
+
+namespace {
+
+using cpplox::Embedding::fromLox;
+
+const char* const DEFINITIONS
+    = "var total = 0;\n"
+      "fun add(a, b) { total = total + a; return a + b; }\n"
+      "fun loop(n) { for (var i = 0; i < n; i = i + 1) add(i, 1); }\n";
+
+auto secondsSince(std::chrono::steady_clock::time_point start) -> double {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now()
+                                       - start)
+      .count();
+}
+
+auto nanosPerCall(double seconds, size_t calls) -> double {
+  return seconds * 1e9 / static_cast<double>(calls);
+}
+
+// What a host without a call API does: print each call as source and run it.
+auto runAsSource(size_t calls) -> double {
+  cpplox::ErrorsAndDebug::ErrorReporter eReporter;
+  cpplox::Evaluator::Evaluator evaluator(eReporter);
+  // Every line's source and tree stays around, as in the REPL.
+  std::vector<std::string> sources;
+  std::vector<std::vector<cpplox::AST::StmtPtrVariant>> programs;
+  auto arena = std::make_shared<cpplox::AST::Arena>();
+  cpplox::AST::Arena::Scope arenaScope(*arena);
+  auto run = [&](std::string source) {
+    sources.push_back(std::move(source));
+    const cpplox::Types::TokenList tokens
+        = cpplox::Scanner(sources.back(), eReporter).tokenize();
+    programs.push_back(cpplox::Parser::RDParser(tokens, eReporter).parse());
+    evaluator.evaluateStmts(programs.back());
+  };
+  run(DEFINITIONS);
+  const auto start = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < calls; ++i)
+    run("add(" + std::to_string(i) + ", 1);");
+  return secondsSince(start);
+}
+
+}  // namespace
+
+auto main(int argc, char const* argv[]) -> int {
+  const size_t calls
+      = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1000000;
+
+  cpplox::Embedding::Script script(DEFINITIONS);
+  const cpplox::Embedding::Function add = script.function("add").value();
+  const cpplox::Embedding::Function loop = script.function("loop").value();
+
+  double bestHost = 1e9;
+  double bestLox = 1e9;
+  double checksum = 0;
+  for (int round = 0; round < 5; ++round) {
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < calls; ++i) checksum += fromLox<double>(add(i, 1));
+    bestHost = std::min(bestHost, secondsSince(start));
+
+    start = std::chrono::steady_clock::now();
+    loop(calls);
+    bestLox = std::min(bestLox, secondsSince(start));
+  }
+  // Scanning and parsing per call is much slower; fewer calls will do.
+  const size_t sourceCalls = std::max<size_t>(1, calls / 10);
+  const double source = runAsSource(sourceCalls);
+
+  std::cout << calls << " calls to a two-argument Lox function\n"
+            << "  from C++ via Function:     "
+            << nanosPerCall(bestHost, calls) << " ns/call\n"
+            << "  from a loop in Lox:        " << nanosPerCall(bestLox, calls)
+            << " ns/call (loop overhead included)\n"
+            << "  as source, one line each:  "
+            << nanosPerCall(source, sourceCalls) << " ns/call\n"
+            << "(checksum " << checksum << ")\n";
+  return 0;
+}
@@ -0,0 +1,115 @@
+#include "cpplox/Embedding/Script.h"
+
+#include <functional>
+#include <utility>
+
+#include "cpplox/ErrorsAndDebug/RuntimeError.h"
+#include "cpplox/Evaluator/Environment.h"
+#include "cpplox/Parser/Parser.h"
+#include "cpplox/Scanner/Scanner.h"
+
+namespace cpplox::Embedding {
+
+using ErrorsAndDebug::LoxStatus;
+
+ScriptError::ScriptError(const std::string& messages)
+    : std::runtime_error(messages) {}
+
+Function::Function(Script& script, Evaluator::FuncShrdPtr function)
+    : script(&script), function(std::move(function)) {}
+
+auto Function::arity() const -> size_t { return function->arity(); }
+
+auto Function::call(const std::vector<LoxObject>& args) const -> LoxObject {
+  if (args.size() != function->arity()) {
+    throw std::invalid_argument(
+        function->getFnName() + " takes " + std::to_string(function->arity())
+        + " arguments, not " + std::to_string(args.size()));
+  }
+  LoxObject result;
+  try {
+    result = script->evaluator.call(function, args);
+  } catch (const ErrorsAndDebug::RuntimeError& e) {
+    // Already reported; thrown below.
+  } catch (const Evaluator::BudgetExceeded& e) {
+    // Errors from before it stopped aren't for the next call to throw.
+    script->eReporter.clearErrors();
+    throw;
+  }
+  // Runtime errors inside the body are reported without unwinding the call.
+  script->throwIfErrors();
+  return result;
+}
+
+Script::Script(std::string sourceText)
+    : arena(std::make_shared<AST::Arena>()),
+      source(arena->own(std::move(sourceText))),
+      evaluator(eReporter) {
+  {
+    AST::Arena::Scope arenaScope(*arena);
+    Types::TokenList tokens = Scanner(source, eReporter).tokenize();
+    if (eReporter.getStatus() == LoxStatus::OK)
+      program = Parser::RDParser(tokens, eReporter).parse();
+  }
+  throwIfErrors();
+  try {
+    evaluator.evaluateStmts(program);
+  } catch (const ErrorsAndDebug::RuntimeError& e) {
+    // Too many errors; they're all in eReporter.
+  }
+  throwIfErrors();
+}
+
+auto Script::function(std::string_view name) -> std::optional<Function> {
+  std::optional<LoxObject> object = global(name);
+  if (!object) return std::nullopt;
+  if (auto* func = std::get_if<Evaluator::FuncShrdPtr>(&object.value()))
+    return Function(*this, std::move(*func));
+  return std::nullopt;
+}
+
+auto Script::global(std::string_view name) -> std::optional<LoxObject> {
+  const size_t hashedName = std::hash<std::string_view>()(name);
+  // Each function declaration opens an environment, so globals are spread
+  // along the chain from the current one.
+  for (auto environ = evaluator.getCurrEnv(); environ != nullptr;
+       environ = environ->getParentEnv()) {
+    const auto& objects = environ->getObjects();
+    if (auto found = objects.find(hashedName); found != objects.end())
+      return found->second;
+  }
+  return std::nullopt;
+}
+
+void Script::setBudget(const Evaluator::Budget& budget) {
+  evaluator.setBudget(budget);
+}
+
+void Script::setMemoryLimit(size_t limit) {
+  evaluator.getHeap().setLimit(limit);
+}
+
+void Script::setReclaimStep(size_t objects) {
+  evaluator.getHeap().setReclaimStep(objects);
+}
+
+void Script::setReclaimThread(bool on) {
+  evaluator.getHeap().setReclaimThread(on);
+}
+
+auto Script::getMemoryStats() const -> Evaluator::MemoryStats {
+  return evaluator.getHeap().getStats();
+}
+
+void Script::throwIfErrors() {
+  if (eReporter.getStatus() == LoxStatus::OK) return;
+  std::string messages;
+  for (const std::string& message : eReporter.getMessages()) {
+    if (!messages.empty()) messages += '\n';
+    messages += message;
+  }
+  eReporter.clearErrors();
+  throw ScriptError(messages);
+}
+
+}  // namespace cpplox::Embedding
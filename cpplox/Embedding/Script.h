@@ -0,0 +1,157 @@
+#ifndef CPPLOX_EMBEDDING_SCRIPT_H
+#define CPPLOX_EMBEDDING_SCRIPT_H
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <variant>
+#include <vector>
+
+#include "cpplox/AST/Arena.h"
+#include "cpplox/AST/NodeTypes.h"
+#include "cpplox/ErrorsAndDebug/ErrorReporter.h"
+#include "cpplox/Evaluator/Evaluator.h"
+#include "cpplox/Evaluator/Objects.h"
+#include "cpplox/Types/Uncopyable.h"
+
+// An API for C++ programs that run Lox code: load a script once, then call
+// the functions it defines as often as needed, passing C++ values in and out.
+//
+//   Script script("fun add(a, b) { return a + b; }");
+//   Function add = script.function("add").value();
+//   double sum = fromLox<double>(add(1, 2));
+namespace cpplox::Embedding {
+
+using Evaluator::LoxObject;
+
+// Syntax errors when loading a script, and runtime errors when running it or
+// calling into it. what() has each of the errors reported, one per line.
+class ScriptError : public std::runtime_error {
+ public:
+  explicit ScriptError(const std::string& messages);
+};
+
+// C++ values as Lox values: bools, numbers (as doubles), nullptr (nil),
+// strings, and LoxObjects as they are.
+template <typename T>
+auto toLox(T&& value) -> LoxObject {
+  using Value = std::decay_t<T>;
+  if constexpr (std::is_same_v<Value, LoxObject>
+                || std::is_same_v<Value, bool>
+                || std::is_same_v<Value, std::nullptr_t>) {
+    return LoxObject(std::forward<T>(value));
+  } else if constexpr (std::is_arithmetic_v<Value>) {
+    return LoxObject(static_cast<double>(value));
+  } else {
+    static_assert(std::is_convertible_v<T, std::string_view>,
+                  "no Lox equivalent for this type");
+    return LoxObject(Evaluator::LoxString(std::string(value)));
+  }
+}
+
+// The C++ value of a Lox bool, number or string; T can also be LoxObject.
+// Throws std::invalid_argument if object holds some other type.
+template <typename T>
+auto fromLox(const LoxObject& object) -> T {
+  if constexpr (std::is_same_v<T, LoxObject>) {
+    return object;
+  } else if constexpr (std::is_same_v<T, bool>) {
+    if (const bool* value = std::get_if<bool>(&object)) return *value;
+    throw std::invalid_argument("expected a bool, got "
+                                + Evaluator::getObjectString(object));
+  } else if constexpr (std::is_arithmetic_v<T>) {
+    if (const double* value = std::get_if<double>(&object))
+      return static_cast<T>(*value);
+    throw std::invalid_argument("expected a number, got "
+                                + Evaluator::getObjectString(object));
+  } else {
+    static_assert(std::is_same_v<T, std::string>,
+                  "no C++ equivalent for Lox values of this type");
+    if (const auto* value = std::get_if<Evaluator::LoxString>(&object))
+      return value->str();
+    throw std::invalid_argument("expected a string, got "
+                                + Evaluator::getObjectString(object));
+  }
+}
+
+class Script;
+
+// A Lox function defined by a Script, ready to be called from C++. Only valid
+// while its Script is alive.
+class Function {
+ public:
+  [[nodiscard]] auto arity() const -> size_t;
+
+  // Runs the function in its script, and returns what it returned (nil if it
+  // didn't). Throws std::invalid_argument if args has the wrong length, and
+  // ScriptError if the call reported runtime errors, or
+  // Evaluator::BudgetExceeded if it went over the script's budget; either
+  // way the script's globals keep whatever the call did before it stopped.
+  auto call(const std::vector<LoxObject>& args) const -> LoxObject;
+
+  // call() with each argument converted by toLox.
+  template <typename... Args>
+  auto operator()(Args&&... args) const -> LoxObject {
+    return call({toLox(std::forward<Args>(args))...});
+  }
+
+ private:
+  friend class Script;
+  Function(Script& script, Evaluator::FuncShrdPtr function);
+
+  Script* script;
+  Evaluator::FuncShrdPtr function;
+};
+
+// A script that has been scanned, parsed and run once, along with the
+// interpreter state it left behind. Calls into it share that state: a global
+// one call sets is there for the next. print writes to Output::stdOut().
+class Script : public Types::Uncopyable {
+ public:
+  // Throws ScriptError if source has syntax errors, or hits runtime errors
+  // while its top-level statements run.
+  explicit Script(std::string source);
+
+  // The global function named name; std::nullopt if there's no such global or
+  // it isn't a function declared in Lox.
+  auto function(std::string_view name) -> std::optional<Function>;
+  // The global variable (or function, or class) named name.
+  auto global(std::string_view name) -> std::optional<LoxObject>;
+
+  // Limits the calls made from now on, between them, to budget, e.g. so
+  // that a host can give up on a function that never returns.
+  void setBudget(const Evaluator::Budget& budget);
+  // Calls that would take the script's objects over limit bytes fail with a
+  // ScriptError; 0 for no limit.
+  void setMemoryLimit(size_t limit);
+  // Frees what calls let go of at most objects at a time, as
+  // ScriptOptions::reclaimStep does.
+  void setReclaimStep(size_t objects);
+  // Frees what calls let go of on a thread of its own, as
+  // ScriptOptions::reclaimThread does.
+  void setReclaimThread(bool on);
+  // The memory the script's objects take, by kind, and the pauses taken to
+  // free them a step at a time.
+  [[nodiscard]] auto getMemoryStats() const -> Evaluator::MemoryStats;
+
+ private:
+  friend class Function;
+  // Throws ScriptError if anything reported errors since the last check.
+  void throwIfErrors();
+
+  // Owns the source and the tree; functions keep it alive as long as they
+  // need it.
+  std::shared_ptr<AST::Arena> arena;
+  std::string_view source;
+  std::vector<AST::StmtPtrVariant> program;
+  ErrorsAndDebug::ErrorReporter eReporter;
+  Evaluator::Evaluator evaluator;
+};
+
+}  // namespace cpplox::Embedding
+#endif  // CPPLOX_EMBEDDING_SCRIPT_H
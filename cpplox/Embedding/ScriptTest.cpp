@@ -0,0 +1,118 @@
+#include "gtest/gtest.h"
+
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <variant>
+
+#include "cpplox/Embedding/Script.h"
+#include "cpplox/Evaluator/Budget.h"
+#include "cpplox/Evaluator/Objects.h"
+#include "cpplox/Output/OutputBuffer.h"
+
+namespace cpplox::Embedding {
+
+TEST(ScriptTest, calls_functions_with_converted_values) {
+  Script script(
+      "fun add(a, b) { return a + b; }\n"
+      "fun not(x) { return !x; }\n"
+      "fun nothing() {}\n");
+  const Function add = script.function("add").value();
+  EXPECT_EQ(2, add.arity());
+  EXPECT_EQ(3, fromLox<double>(add(1, 2)));
+  EXPECT_EQ(7, fromLox<int>(add(2.5, 4.5f)));
+  EXPECT_EQ("ab", fromLox<std::string>(add("a", std::string("b"))));
+  EXPECT_TRUE(fromLox<bool>(script.function("not").value()(false)));
+  EXPECT_FALSE(fromLox<bool>(script.function("not").value()(true)));
+  EXPECT_TRUE(std::holds_alternative<std::nullptr_t>(
+      script.function("nothing").value()()));
+}
+
+TEST(ScriptTest, calls_share_the_scripts_state) {
+  Script script(
+      "var count = 10;\n"
+      "fun next() { count = count + 1; return count; }\n"
+      "class Point { init(x) { this.x = x; } }\n"
+      "fun makePoint(x) { return Point(x); }\n"
+      "fun getX(point) { return point.x; }\n");
+  const Function next = script.function("next").value();
+  EXPECT_EQ(11, fromLox<double>(next()));
+  EXPECT_EQ(12, fromLox<double>(next()));
+  EXPECT_EQ(12, fromLox<double>(script.global("count").value()));
+  // Lox objects pass back in as they came out.
+  const LoxObject point = script.function("makePoint").value()(5);
+  EXPECT_EQ(5, fromLox<double>(script.function("getX").value()(point)));
+  EXPECT_FALSE(script.global("missing"));
+  EXPECT_FALSE(script.function("missing"));
+  EXPECT_FALSE(script.function("count"));
+  // Classes and builtins aren't functions declared in Lox.
+  EXPECT_FALSE(script.function("Point"));
+  EXPECT_FALSE(script.function("clock"));
+}
+
+TEST(ScriptTest, reports_errors) {
+  try {
+    Script script("fun broken( { }\n");
+    FAIL() << "expected a syntax error";
+  } catch (const ScriptError& e) {
+    EXPECT_NE(std::string::npos, std::string(e.what()).find("[Line 1] Error"));
+  }
+  EXPECT_THROW(Script("print -\"x\";\n"), ScriptError);
+
+  Script script(
+      "var calls = 0;\n"
+      "fun negate(x) { calls = calls + 1; return -x; }\n");
+  const Function negate = script.function("negate").value();
+  EXPECT_THROW(negate("x"), ScriptError);
+  EXPECT_THROW(negate(1, 2), std::invalid_argument);
+  EXPECT_THROW(fromLox<std::string>(negate(1)), std::invalid_argument);
+  // The script carries on after an error, with what the call did before it.
+  EXPECT_EQ(-4, fromLox<double>(negate(4)));
+  EXPECT_EQ(3, fromLox<double>(script.global("calls").value()));
+}
+
+TEST(ScriptTest, stops_calls_that_go_over_budget) {
+  Script script(
+      "var n = 0;\n"
+      "fun count(to) { while (n < to) n = n + 1; return n; }\n");
+  const Function count = script.function("count").value();
+  Evaluator::Budget budget;
+  budget.fuel = 100;
+  script.setBudget(budget);
+  // Each call takes one, as does each iteration.
+  EXPECT_EQ(50, fromLox<double>(count(50)));
+  EXPECT_THROW(count(1000), Evaluator::BudgetExceeded);
+  EXPECT_EQ(50 + 48, fromLox<double>(script.global("n").value()));
+  // Calls made after it get a new budget.
+  script.setBudget(Evaluator::Budget{});
+  EXPECT_EQ(1000, fromLox<double>(count(1000)));
+}
+
+TEST(ScriptTest, limits_the_memory_calls_can_take) {
+  Script script(
+      "var kept = Map();\n"
+      "fun keep(s) { kept.set(kept.size(), s + \"!\"); }\n");
+  const Function keep = script.function("keep").value();
+  script.setMemoryLimit(script.getMemoryStats().total.liveBytes + 100000);
+  keep(std::string(50000, 'x'));
+  EXPECT_GT(script.getMemoryStats()[Evaluator::ObjectKind::STRING].liveBytes,
+            50000);
+  EXPECT_THROW(keep(std::string(50000, 'y')), ScriptError);
+  const auto kept = std::get<Evaluator::LoxMapShrdPtr>(
+      script.global("kept").value());
+  EXPECT_EQ(1, kept->size());
+}
+
+TEST(ScriptTest, prints_to_the_current_output) {
+  std::string printed;
+  {
+    Output::OutputBuffer out(printed);
+    Output::OutputBuffer err(printed);
+    Output::Redirect redirect(out, err);
+    Script script("print \"loaded\";\nfun show(x) { print x; }\n");
+    script.function("show").value()(42);
+  }
+  EXPECT_EQ(">loaded\n>42\n", printed);
+}
+
+}  // namespace cpplox::Embedding
@@ -1,9 +1,18 @@
-#include <iostream>
-
 #include "cpplox/ErrorsAndDebug/ErrorReporter.h"
 
+#include <string>
+
+#include "cpplox/Output/OutputBuffer.h"
+
 namespace cpplox::ErrorsAndDebug {
 
+void ErrorReporter::append(const ErrorReporter& other) {
+  if (other.status == LoxStatus::OK) return;
+  errorMessages.insert(errorMessages.end(), other.errorMessages.begin(),
+                       other.errorMessages.end());
+  status = LoxStatus::ERROR;
+}
+
 void ErrorReporter::clearErrors() {
   errorMessages.clear();
   status = LoxStatus::OK;
@@ -11,9 +20,17 @@ void ErrorReporter::clearErrors() {
 
 auto ErrorReporter::getStatus() -> LoxStatus { return status; }
 
+auto ErrorReporter::getMessages() const -> const std::vector<std::string>& {
+  return errorMessages;
+}
+
 void ErrorReporter::printToStdErr() {
+  // Anything printed before the error should appear before it.
+  Output::stdOut().flush();
+  Output::OutputBuffer& err = Output::stdErr();
   for (auto& s : errorMessages) {
-    std::cerr << s << std::endl;
+    err.write(s);
+    err.endLine();
   }
 }
 
@@ -23,4 +40,9 @@ void ErrorReporter::setError(int line, const std::string& message) {
   status = LoxStatus::ERROR;
 }
 
+void ErrorReporter::setError(const std::string& message) {
+  errorMessages.emplace_back("Error: " + message);
+  status = LoxStatus::ERROR;
+}
+
 }  // namespace cpplox::ErrorsAndDebug
\ No newline at end of file
@@ -13,8 +13,13 @@ class ErrorReporter {
  public:
   void clearErrors();
   auto getStatus() -> LoxStatus;
+  [[nodiscard]] auto getMessages() const -> const std::vector<std::string>&;
   void printToStdErr();
   void setError(int line, const std::string& message);
+  // For errors that can't be put down to a line.
+  void setError(const std::string& message);
+  // Adds other's errors after this reporter's own.
+  void append(const ErrorReporter& other);
 
  private:
   std::vector<std::string> errorMessages;
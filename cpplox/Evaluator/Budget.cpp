@@ -0,0 +1,18 @@
+#include "cpplox/Evaluator/Budget.h"
+
+namespace cpplox::Evaluator {
+
+BudgetExceeded::BudgetExceeded(Reason reason) : reason(reason) {}
+
+auto BudgetExceeded::what() const noexcept -> const char* {
+  switch (reason) {
+    case Reason::FUEL: return "Ran out of fuel.";
+    case Reason::DEADLINE: return "Ran out of time.";
+    case Reason::INTERRUPT: return "Interrupted.";
+  }
+  return "Over budget.";
+}
+
+auto BudgetExceeded::getReason() const -> Reason { return reason; }
+
+}  // namespace cpplox::Evaluator
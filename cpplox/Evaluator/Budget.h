@@ -0,0 +1,40 @@
+#ifndef CPPLOX_EVALUATOR_BUDGET__H
+#define CPPLOX_EVALUATOR_BUDGET__H
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <exception>
+#include <optional>
+
+namespace cpplox::Evaluator {
+
+// Limits on how far evaluation may go, so a runaway script can't hold on to
+// its thread forever. They're checked at safepoints: each iteration of a loop,
+// and each call to a function declared in Lox.
+struct Budget {
+  // How many safepoints evaluation may pass; 0 for no limit.
+  uint64_t fuel = 0;
+  // Evaluation stops at the first check after this.
+  std::optional<std::chrono::steady_clock::time_point> deadline;
+  // Evaluation stops at the first check after this is set, from any thread.
+  const std::atomic<bool>* interrupt = nullptr;
+};
+
+// Thrown from a safepoint once evaluation goes over its Budget. Unlike a
+// RuntimeError it isn't caught at the next statement, so it unwinds the run.
+class BudgetExceeded : public std::exception {
+ public:
+  enum class Reason { FUEL, DEADLINE, INTERRUPT };
+
+  explicit BudgetExceeded(Reason reason);
+  [[nodiscard]] auto what() const noexcept -> const char* override;
+  [[nodiscard]] auto getReason() const -> Reason;
+
+ private:
+  Reason reason;
+};
+
+}  // namespace cpplox::Evaluator
+#endif  // CPPLOX_EVALUATOR_BUDGET__H
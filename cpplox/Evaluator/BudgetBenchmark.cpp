@@ -0,0 +1,87 @@
+// How much enforcing a Budget slows evaluation down: loop-, call- and
+// method-heavy scripts run with no limits, then with fuel, a deadline and an
+// interrupt flag all set (none of them reached). Run with:
+//   bazel run -c opt //cpplox/Evaluator:budget_benchmark -- [rounds]
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "cpplox/AST/NodeTypes.h"
+#include "cpplox/ErrorsAndDebug/ErrorReporter.h"
+#include "cpplox/Evaluator/Budget.h"
+#include "cpplox/Evaluator/Evaluator.h"
+#include "cpplox/Parser/Parser.h"
+#include "cpplox/Scanner/Scanner.h"
+
+namespace {
+
+struct Workload {
+  const char* name;
+  std::string source;
+};
+
+const std::vector<Workload> WORKLOADS = {
+    {"loops", "var sum = 0;\n"
+              "for (var i = 0; i < 300; i = i + 1) {\n"
+              "  var j = 0;\n"
+              "  while (j < 1000) { sum = sum + j; j = j + 1; }\n"
+              "}\n"},
+    {"calls", "fun fib(n) { if (n < 2) return n; return fib(n - 2) + "
+              "fib(n - 1); }\n"
+              "fib(22);\n"},
+    {"methods", "class Counter {\n"
+                "  init() { this.n = 0; }\n"
+                "  add(x) { this.n = this.n + x; return this; }\n"
+                "}\n"
+                "var c = Counter();\n"
+                "for (var i = 0; i < 100000; i = i + 1) c.add(i);\n"},
+};
+
+// Seconds to run source in a fresh evaluator under budget.
+auto timeRun(const std::string& source,
+             const cpplox::Evaluator::Budget& budget) -> double {
+  cpplox::ErrorsAndDebug::ErrorReporter eReporter;
+  const cpplox::Types::TokenList tokens
+      = cpplox::Scanner(source, eReporter).tokenize();
+  const std::vector<cpplox::AST::StmtPtrVariant> program
+      = cpplox::Parser::RDParser(tokens, eReporter).parse();
+  cpplox::Evaluator::Evaluator evaluator(eReporter);
+  evaluator.setBudget(budget);
+  const auto start = std::chrono::steady_clock::now();
+  evaluator.evaluateStmts(program);
+  return std::chrono::duration<double>(std::chrono::steady_clock::now()
+                                       - start)
+      .count();
+}
+
+}  // namespace
+
+auto main(int argc, char const* argv[]) -> int {
+  const int rounds = argc > 1 ? std::atoi(argv[1]) : 10;
+  std::atomic<bool> interrupt = false;
+  const cpplox::Evaluator::Budget unlimited;
+  const cpplox::Evaluator::Budget limited{
+      UINT64_MAX / 2, std::chrono::steady_clock::now() + std::chrono::hours(1),
+      &interrupt};
+
+  for (const Workload& workload : WORKLOADS) {
+    // Alternate, so drift in the machine's speed hits both alike.
+    double bestUnlimited = 1e9;
+    double bestLimited = 1e9;
+    for (int round = 0; round < rounds; ++round) {
+      bestUnlimited
+          = std::min(bestUnlimited, timeRun(workload.source, unlimited));
+      bestLimited = std::min(bestLimited, timeRun(workload.source, limited));
+    }
+    std::cout << workload.name << ": " << bestUnlimited * 1e3
+              << " ms unlimited, " << bestLimited * 1e3
+              << " ms with a budget ("
+              << (bestLimited / bestUnlimited - 1) * 100 << "%)\n";
+  }
+  return 0;
+}
@@ -0,0 +1,110 @@
+#include "gtest/gtest.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <variant>
+#include <vector>
+
+#include "cpplox/AST/NodeTypes.h"
+#include "cpplox/ErrorsAndDebug/ErrorReporter.h"
+#include "cpplox/Evaluator/Budget.h"
+#include "cpplox/Evaluator/Evaluator.h"
+#include "cpplox/Parser/Parser.h"
+#include "cpplox/Scanner/Scanner.h"
+
+namespace cpplox::Evaluator {
+
+namespace {
+
+using Reason = BudgetExceeded::Reason;
+
+// A budget of fuel alone.
+auto withFuel(uint64_t fuel) -> Budget {
+  Budget budget;
+  budget.fuel = fuel;
+  return budget;
+}
+
+// Runs source in an evaluator limited to budget, and returns why it stopped.
+class BudgetTest : public ::testing::Test {
+ protected:
+  auto run(const std::string& sourceText, const Budget& budget)
+      -> std::optional<Reason> {
+    source = sourceText;
+    Types::TokenList tokens = Scanner(source, eReporter).tokenize();
+    program = Parser::RDParser(tokens, eReporter).parse();
+    evaluator.setBudget(budget);
+    try {
+      evaluator.evaluateStmts(program);
+    } catch (const BudgetExceeded& e) {
+      return e.getReason();
+    }
+    return std::nullopt;
+  }
+
+  auto global(std::string_view name) -> double {
+    return std::get<double>(
+        evaluator.getCurrEnv()->get(std::hash<std::string_view>()(name)));
+  }
+
+  ErrorsAndDebug::ErrorReporter eReporter;
+  Evaluator evaluator{eReporter};
+  std::string source;
+  std::vector<AST::StmtPtrVariant> program;
+};
+
+}  // namespace
+
+TEST_F(BudgetTest, fuel_counts_loop_iterations_and_calls) {
+  EXPECT_EQ(Reason::FUEL,
+            run("var n = 0;\nwhile (true) n = n + 1;\n", withFuel(5000)));
+  EXPECT_EQ(5000, global("n"));
+
+  EXPECT_EQ(Reason::FUEL, run("var i;\nfor (i = 0; true; i = i + 1) {}\n",
+                              withFuel(3)));
+  EXPECT_EQ(3, global("i"));
+
+  EXPECT_EQ(Reason::FUEL,
+            run("var depth = 0;\n"
+                "fun recurse() { depth = depth + 1; recurse(); }\n"
+                "recurse();\n",
+                withFuel(100)));
+  EXPECT_EQ(100, global("depth"));
+}
+
+TEST_F(BudgetTest, runs_to_completion_within_budget) {
+  EXPECT_EQ(std::nullopt,
+            run("var n = 0;\nwhile (n < 10000) n = n + 1;\n", Budget{}));
+  EXPECT_EQ(10000, global("n"));
+  EXPECT_EQ(std::nullopt,
+            run("var m = 0;\nwhile (m < 10) m = m + 1;\n", withFuel(10)));
+  EXPECT_EQ(10, global("m"));
+}
+
+TEST_F(BudgetTest, stops_at_the_deadline) {
+  const auto start = std::chrono::steady_clock::now();
+  EXPECT_EQ(Reason::DEADLINE,
+            run("while (true) {}\n",
+                Budget{0, start + std::chrono::milliseconds(50)}));
+  EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::seconds(5));
+}
+
+TEST_F(BudgetTest, stops_when_interrupted_from_another_thread) {
+  std::atomic<bool> interrupt = false;
+  std::thread interrupter([&]() {
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    interrupt = true;
+  });
+  EXPECT_EQ(Reason::INTERRUPT,
+            run("fun spin() { while (true) {} }\nspin();\n",
+                Budget{0, std::nullopt, &interrupt}));
+  interrupter.join();
+}
+
+}  // namespace cpplox::Evaluator
@@ -0,0 +1,132 @@
+#include "cpplox/Evaluator/Builtins.h"
+
+#include <chrono>
+#include <cmath>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <variant>
+#include <vector>
+
+namespace cpplox::Evaluator {
+
+// clockBuiltin
+clockBuiltin::clockBuiltin(Environment::EnvironmentPtr closure)
+    : BuiltinFunc("clock", std::move(closure)) {}
+
+auto clockBuiltin::arity() -> size_t { return 0; }
+
+auto clockBuiltin::run(const std::vector<LoxObject>& /*args*/) -> LoxObject {
+  return static_cast<double>(
+      std::chrono::duration_cast<std::chrono::milliseconds>(
+          std::chrono::high_resolution_clock::now().time_since_epoch())
+          .count());
+}
+
+auto clockBuiltin::getFnName() -> std::string { return "< builtin-fn_clock >"; }
+
+// mapBuiltin
+mapBuiltin::mapBuiltin(Environment::EnvironmentPtr closure)
+    : BuiltinFunc("Map", std::move(closure)) {}
+
+auto mapBuiltin::arity() -> size_t { return 0; }
+
+auto mapBuiltin::run(const std::vector<LoxObject>& /*args*/) -> LoxObject {
+  return makeObject<LoxMap>();
+}
+
+auto mapBuiltin::getFnName() -> std::string { return "< builtin-fn_Map >"; }
+
+// Map methods
+namespace {
+// Slots come in from Lox as numbers; anything that isn't a whole number can't
+// name a slot.
+auto getSlot(const LoxObject& arg) -> size_t {
+  if (!std::holds_alternative<double>(arg) || std::get<double>(arg) < 0
+      || std::get<double>(arg) != std::trunc(std::get<double>(arg)))
+    throw std::runtime_error("Map slots must be whole numbers.");
+  return static_cast<size_t>(std::get<double>(arg));
+}
+
+auto getMethodName(MapMethodKind kind) -> std::string {
+  switch (kind) {
+    case MapMethodKind::GET: return "get";
+    case MapMethodKind::SET: return "set";
+    case MapMethodKind::DELETE: return "delete";
+    case MapMethodKind::CONTAINS: return "contains";
+    case MapMethodKind::SIZE: return "size";
+    case MapMethodKind::NEXT: return "next";
+    case MapMethodKind::KEY_AT: return "keyAt";
+    case MapMethodKind::VALUE_AT: return "valueAt";
+  }
+  return "";
+}
+
+class mapMethod : public BuiltinFunc {
+  LoxMapShrdPtr map;
+  MapMethodKind kind;
+
+ public:
+  mapMethod(LoxMapShrdPtr map, MapMethodKind kind)
+      : BuiltinFunc(getMethodName(kind), nullptr),
+        map(std::move(map)),
+        kind(kind) {}
+
+  auto arity() -> size_t override { return mapMethodArity(kind); }
+
+  auto run(const std::vector<LoxObject>& args) -> LoxObject override {
+    return callMapMethod(*map, kind, args.data());
+  }
+
+  auto getFnName() -> std::string override {
+    return "< builtin-fn_Map." + getMethodName(kind) + " >";
+  }
+};
+}  // namespace
+
+auto findMapMethod(std::string_view methodName)
+    -> std::optional<MapMethodKind> {
+  if (methodName == "get") return MapMethodKind::GET;
+  if (methodName == "set") return MapMethodKind::SET;
+  if (methodName == "delete") return MapMethodKind::DELETE;
+  if (methodName == "contains") return MapMethodKind::CONTAINS;
+  if (methodName == "size") return MapMethodKind::SIZE;
+  if (methodName == "next") return MapMethodKind::NEXT;
+  if (methodName == "keyAt") return MapMethodKind::KEY_AT;
+  if (methodName == "valueAt") return MapMethodKind::VALUE_AT;
+  return std::nullopt;
+}
+
+auto mapMethodArity(MapMethodKind kind) -> size_t {
+  switch (kind) {
+    case MapMethodKind::SET: return 2;
+    case MapMethodKind::SIZE: return 0;
+    default: return 1;
+  }
+}
+
+auto callMapMethod(LoxMap& map, MapMethodKind kind, const LoxObject* args)
+    -> LoxObject {
+  switch (kind) {
+    case MapMethodKind::GET: return map.get(args[0]);
+    case MapMethodKind::SET: map.set(args[0], args[1]); return args[1];
+    case MapMethodKind::DELETE: return map.remove(args[0]);
+    case MapMethodKind::CONTAINS: return map.contains(args[0]);
+    case MapMethodKind::SIZE: return static_cast<double>(map.size());
+    case MapMethodKind::NEXT:
+      return static_cast<double>(map.nextSlot(getSlot(args[0])));
+    case MapMethodKind::KEY_AT: return map.keyAt(getSlot(args[0]));
+    case MapMethodKind::VALUE_AT: return map.valueAt(getSlot(args[0]));
+  }
+  return nullptr;
+}
+
+auto bindMapMethod(const LoxMapShrdPtr& map, MapMethodKind kind)
+    -> BuiltinFuncShrdPtr {
+  return makeObject<mapMethod>(map, kind);
+}
+
+}  // namespace cpplox::Evaluator
@@ -0,0 +1,62 @@
+#ifndef CPPLOX_EVALUATOR_BUILTINS__H
+#define CPPLOX_EVALUATOR_BUILTINS__H
+#pragma once
+
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "cpplox/Evaluator/Environment.h"
+#include "cpplox/Evaluator/Objects.h"
+
+namespace cpplox::Evaluator {
+
+// clock() -> milliseconds since the epoch.
+class clockBuiltin : public BuiltinFunc {
+ public:
+  explicit clockBuiltin(Environment::EnvironmentPtr closure);
+  auto arity() -> size_t override;
+  auto run(const std::vector<LoxObject>& args) -> LoxObject override;
+  auto getFnName() -> std::string override;
+};
+
+// Map() -> a new, empty LoxMap.
+class mapBuiltin : public BuiltinFunc {
+ public:
+  explicit mapBuiltin(Environment::EnvironmentPtr closure);
+  auto arity() -> size_t override;
+  auto run(const std::vector<LoxObject>& args) -> LoxObject override;
+  auto getFnName() -> std::string override;
+};
+
+enum class MapMethodKind {
+  GET,
+  SET,
+  DELETE,
+  CONTAINS,
+  SIZE,
+  NEXT,
+  KEY_AT,
+  VALUE_AT
+};
+
+// Looks up one of the Map methods (get, set, delete, contains, size, and the
+// slot iterators next, keyAt, valueAt), or std::nullopt if there's no such
+// method.
+auto findMapMethod(std::string_view methodName) -> std::optional<MapMethodKind>;
+
+auto mapMethodArity(MapMethodKind kind) -> size_t;
+
+// Runs a Map method on 'map' with its mapMethodArity(kind) arguments. Throws
+// std::runtime_error for bad arguments, as builtins do. The Evaluator calls
+// m.get(k) and friends this way, without binding the method first.
+auto callMapMethod(LoxMap& map, MapMethodKind kind, const LoxObject* args)
+    -> LoxObject;
+
+// A Map method as a value of its own (var get = m.get;), bound to 'map'.
+auto bindMapMethod(const LoxMapShrdPtr& map, MapMethodKind kind)
+    -> BuiltinFuncShrdPtr;
+
+}  // namespace cpplox::Evaluator
+#endif  // CPPLOX_EVALUATOR_BUILTINS__H
@@ -25,6 +25,13 @@ class UninitializedVarAccess : public std::exception {};
 Environment::Environment(EnvironmentPtr parentEnviron)
     : parentEnviron(std::move(parentEnviron)) {}
 
+Environment::~Environment() {
+  if (Heap* heap = Heap::deferring()) {
+    for (auto& object : objects) deferRelease(*heap, object.second);
+    deferRelease(*heap, parentEnviron);
+  }
+}
+
 auto Environment::assign(size_t hashedVarName, LoxObject object) -> bool {
   auto iter = objects.find(hashedVarName);
   if (iter != objects.end()) {
@@ -58,12 +65,18 @@ auto Environment::isGlobal() -> bool { return (parentEnviron == nullptr); }
 
 auto Environment::getParentEnv() -> EnvironmentPtr { return parentEnviron; }
 
+auto Environment::getObjects() const
+    -> const Members<ObjectKind::ENVIRONMENT>& {
+  return objects;
+}
+
 // ======================== //
 // class EnvironmentManager
 // ======================== //
-EnvironmentManager::EnvironmentManager(ErrorReporter& eReporter)
-    : eReporter(eReporter),
-      currEnviron(std::make_shared<Environment>(nullptr)) {
+EnvironmentManager::EnvironmentManager(ErrorReporter& eReporter, Heap& heap)
+    : eReporter(eReporter) {
+  const Heap::Scope heapScope(heap);
+  currEnviron = makeObject<Environment>(nullptr);
 #ifdef ENVIRON_DEBUG
   ErrorsAndDebug::debugPrint(
       "EnvironmentManager is now alive! Global Envrion = "
@@ -72,7 +85,7 @@ EnvironmentManager::EnvironmentManager(ErrorReporter& eReporter)
 }
 
 void EnvironmentManager::createNewEnviron(const std::string& caller) {
-  currEnviron = std::make_shared<Environment>(currEnviron);
+  currEnviron = makeObject<Environment>(currEnviron);
 #ifdef ENVIRON_DEBUG
   ErrorsAndDebug::debugPrint(caller + " requested new environ: "
                              + std::to_string((uint64_t)currEnviron.get())
@@ -8,8 +8,11 @@
 #include <map>
 #include <memory>
 #include <optional>
+#include <string>
+#include <string_view>
 
 #include "cpplox/ErrorsAndDebug/ErrorReporter.h"
+#include "cpplox/Evaluator/Heap.h"
 #include "cpplox/Evaluator/Objects.h"
 #include "cpplox/Types/Token.h"
 #include "cpplox/Types/Uncopyable.h"
@@ -25,21 +28,25 @@ class Environment : public Types::Uncopyable,
   using EnvironmentPtr = std::shared_ptr<Environment>;
 
   explicit Environment(EnvironmentPtr parentEnviron);
+  ~Environment() override;
 
   auto assign(size_t hashedVarName, LoxObject object) -> bool;
   void define(size_t hashedVarName, LoxObject object);
   auto get(size_t hashedVarName) -> LoxObject;
   auto getParentEnv() -> EnvironmentPtr;
   auto isGlobal() -> bool;
+  [[nodiscard]] auto getObjects() const
+      -> const Members<ObjectKind::ENVIRONMENT>&;
 
  private:
-  std::map<size_t, LoxObject> objects;
+  Members<ObjectKind::ENVIRONMENT> objects;
   EnvironmentPtr parentEnviron = nullptr;
 };
 
 class EnvironmentManager : public Types::Uncopyable {
  public:
-  explicit EnvironmentManager(ErrorReporter& eReporter);
+  // The global environment is charged to heap.
+  EnvironmentManager(ErrorReporter& eReporter, Heap& heap);
 
   void assign(const Types::Token& varToken, LoxObject object);
   void createNewEnviron(const std::string& caller = __builtin_FUNCTION());
@@ -56,7 +63,7 @@ class EnvironmentManager : public Types::Uncopyable {
  private:
   ErrorReporter& eReporter;
   Environment::EnvironmentPtr currEnviron;
-  std::hash<std::string> hasher;
+  std::hash<std::string_view> hasher;
 };
 
 }  // namespace cpplox::Evaluator
@@ -1,19 +1,27 @@
 #include "cpplox/Evaluator/Evaluator.h"
 
+#include <algorithm>
+#include <array>
 #include <chrono>
 #include <cstddef>
-#include <iostream>
+#include <functional>
 #include <iterator>
 #include <memory>
 #include <optional>
+#include <stdexcept>
 #include <string>
+#include <string_view>
+#include <type_traits>
 #include <utility>
 #include <variant>
 
 #include "cpplox/AST/PrettyPrinter.h"
 #include "cpplox/ErrorsAndDebug/DebugPrint.h"
 #include "cpplox/ErrorsAndDebug/RuntimeError.h"
+#include "cpplox/Evaluator/Builtins.h"
+#include "cpplox/Evaluator/Heap.h"
 #include "cpplox/Evaluator/Objects.h"
+#include "cpplox/Output/OutputBuffer.h"
 #include "cpplox/Types/Literal.h"
 #include "cpplox/Types/Token.h"
 
@@ -22,6 +30,37 @@
 
 namespace cpplox::Evaluator {
 
+inline void Evaluator::safepoint() {
+  if (EXPECT_FALSE(--safepointsUntilCheck <= 0)) checkBudget();
+}
+
+void Evaluator::checkBudget() {
+  using Reason = BudgetExceeded::Reason;
+  if (budget.interrupt != nullptr
+      && budget.interrupt->load(std::memory_order_relaxed))
+    throw BudgetExceeded(Reason::INTERRUPT);
+  if (budget.deadline.has_value()
+      && std::chrono::steady_clock::now() >= budget.deadline.value())
+    throw BudgetExceeded(Reason::DEADLINE);
+  if (budget.fuel == 0) {
+    safepointsUntilCheck = CHECK_INTERVAL;
+    return;
+  }
+  if (fuelLeft == 0) throw BudgetExceeded(Reason::FUEL);
+  // This safepoint takes the first of the next slice.
+  const uint64_t slice
+      = std::min(fuelLeft, static_cast<uint64_t>(CHECK_INTERVAL));
+  fuelLeft -= slice;
+  safepointsUntilCheck = static_cast<int64_t>(slice);
+}
+
+void Evaluator::setBudget(const Budget& newBudget) {
+  budget = newBudget;
+  fuelLeft = budget.fuel;
+  // Check at the next safepoint.
+  safepointsUntilCheck = 0;
+}
+
 // throws RuntimeError if right isn't a double
 auto Evaluator::getDouble(const Token& token, const LoxObject& right)
     -> double {
@@ -35,19 +74,21 @@ auto Evaluator::getDouble(const Token& token, const LoxObject& right)
 
 auto Evaluator::bindInstance(const FuncShrdPtr& method,
                              LoxInstanceShrdPtr instance) -> FuncShrdPtr {
-  auto environToRestore = environManager.getCurrEnv();
-  // Set the currentEnviron to the function's closure,
-  environManager.setCurrEnv(method->getClosure());
-  // Create a new environment and define 'this' to point to the instance
-  environManager.createNewEnviron();
-  auto methodClosure = environManager.getCurrEnv();
-  environManager.define("this", instance);
-  // restore the environ.
-  environManager.setCurrEnv(environToRestore);
+  // Create a new environment inside the method's closure, and define 'this'
+  // there to point to the instance. The current environ is left alone, so
+  // running out of memory part way doesn't leave it changed.
+  auto methodClosure = makeObject<Environment>(method->getClosure());
+  methodClosure->define(std::hash<std::string_view>()("this"),
+                        std::move(instance));
   // create and return a new FuncObj that uses this new environ as its closure.
-  return std::make_shared<FuncObj>(method->getDecl(), method->getFnName(),
-                                   methodClosure, method->getIsMethod(),
-                                   method->getIsInitializer());
+  if (method->getFlatProgram() != nullptr)
+    return makeObject<FuncObj>(method->getFlatProgram(),
+                               method->getFlatFunction(), method->getFnName(),
+                               std::move(methodClosure), method->getIsMethod(),
+                               method->getIsInitializer());
+  return makeObject<FuncObj>(method->getDecl(), method->getFnName(),
+                             std::move(methodClosure), method->getIsMethod(),
+                             method->getIsInitializer());
 }
 
 //===============================//
@@ -56,48 +97,62 @@ auto Evaluator::bindInstance(const FuncShrdPtr& method,
 auto Evaluator::evaluateBinaryExpr(const BinaryExprPtr& expr) -> LoxObject {
   auto left = evaluateExpr(expr->left);
   auto right = evaluateExpr(expr->right);
-  switch (expr->op.getType()) {
-    case TokenType::COMMA: return right;
-    case TokenType::BANG_EQUAL: return !areEqual(left, right);
-    case TokenType::EQUAL_EQUAL: return areEqual(left, right);
-    case TokenType::MINUS:
-      return getDouble(expr->op, left) - getDouble(expr->op, right);
-    case TokenType::SLASH: {
-      double denominator = getDouble(expr->op, right);
+  return binaryOp(AST::toOp(expr->op.getType()), expr->op, left, right);
+}
+
+auto Evaluator::binaryOp(AST::Op op, const Token& token, const LoxObject& left,
+                         const LoxObject& right) -> LoxObject {
+  switch (op) {
+    case AST::Op::COMMA: return right;
+    case AST::Op::BANG_EQUAL: return !areEqual(left, right);
+    case AST::Op::EQUAL_EQUAL: return areEqual(left, right);
+    case AST::Op::MINUS:
+      return getDouble(token, left) - getDouble(token, right);
+    case AST::Op::SLASH: {
+      double denominator = getDouble(token, right);
       if (EXPECT_FALSE(denominator == 0.0))
-        throw reportRuntimeError(eReporter, expr->op,
+        throw reportRuntimeError(eReporter, token,
                                  "Division by zero is illegal");
-      return getDouble(expr->op, left) / denominator;
+      return getDouble(token, left) / denominator;
     }
-    case TokenType::STAR:
-      return getDouble(expr->op, left) * getDouble(expr->op, right);
-    case TokenType::LESS:
-      return getDouble(expr->op, left) < getDouble(expr->op, right);
-    case TokenType::LESS_EQUAL:
-      return getDouble(expr->op, left) <= getDouble(expr->op, right);
-    case TokenType::GREATER:
-      return getDouble(expr->op, left) > getDouble(expr->op, right);
-    case TokenType::GREATER_EQUAL:
-      return getDouble(expr->op, left) >= getDouble(expr->op, right);
-    case TokenType::PLUS: {
+    case AST::Op::STAR:
+      return getDouble(token, left) * getDouble(token, right);
+    case AST::Op::LESS:
+      return getDouble(token, left) < getDouble(token, right);
+    case AST::Op::LESS_EQUAL:
+      return getDouble(token, left) <= getDouble(token, right);
+    case AST::Op::GREATER:
+      return getDouble(token, left) > getDouble(token, right);
+    case AST::Op::GREATER_EQUAL:
+      return getDouble(token, left) >= getDouble(token, right);
+    case AST::Op::PLUS: {
       if (std::holds_alternative<double>(left)
           && std::holds_alternative<double>(right)) {
         return std::get<double>(left) + std::get<double>(right);
       }
-      if (std::holds_alternative<std::string>(left)
-          || std::holds_alternative<std::string>(right)) {
-        return getObjectString(left) + getObjectString(right);
+      // Concatenating onto a string appends to its buffer in place when it
+      // can, so building a string up in a loop doesn't copy it every time.
+      if (std::holds_alternative<LoxString>(left)) {
+        if (std::holds_alternative<LoxString>(right))
+          return LoxString::concat(std::get<LoxString>(left),
+                                   std::get<LoxString>(right).view());
+        return LoxString::concat(std::get<LoxString>(left),
+                                 getObjectString(right));
+      }
+      if (std::holds_alternative<LoxString>(right)) {
+        return LoxString::concat(getObjectString(left),
+                                 std::get<LoxString>(right));
       }
       throw reportRuntimeError(
-          eReporter, expr->op,
+          eReporter, token,
           "Operands to 'plus' must be numbers or strings; This is invalid: "
               + getObjectString(left) + " + " + getObjectString(right));
     }
     default:
       throw reportRuntimeError(
-          eReporter, expr->op,
+          eReporter, token,
           "Attempted to apply invalid operator to binary expr: "
-              + expr->op.getTypeString());
+              + token.getTypeString());
   }
 }
 
@@ -106,6 +161,10 @@ auto Evaluator::evaluateGroupingExpr(const GroupingExprPtr& expr) -> LoxObject {
 }
 
 namespace {
+// Functions made by function expressions have no name of their own.
+const char* const ANONYMOUS_FUNCTION_NAME
+    = "LoxAnonFuncDoNotUseThisNameAADWAED";
+
 auto getLoxObjectfromStringLiteral(const Literal& strLiteral) -> LoxObject {
   const auto& str = std::get<std::string>(strLiteral);
   if (str == "true") return LoxObject(true);
@@ -113,27 +172,109 @@ auto getLoxObjectfromStringLiteral(const Literal& strLiteral) -> LoxObject {
   if (str == "nil") return LoxObject(nullptr);
   return LoxObject(str);
 };
+
+auto getLoxObjectfromLiteral(const Literal& literal) -> LoxObject {
+  return std::holds_alternative<std::string>(literal)
+             ? getLoxObjectfromStringLiteral(literal)
+             : LoxObject(std::get<double>(literal));
+}
+
+// The token an error in expr (or stmt) is reported against, if it has one.
+auto tokenOf(const ExprPtrVariant& expr) -> const Token* {
+  return std::visit(
+      [](const auto& node) -> const Token* {
+        using Node = std::decay_t<decltype(*node)>;
+        if constexpr (std::is_same_v<Node, AST::CallExpr>) {
+          return &node->paren;
+        } else if constexpr (std::is_same_v<Node, AST::VariableExpr>
+                             || std::is_same_v<Node, AST::AssignmentExpr>) {
+          return &node->varName;
+        } else if constexpr (std::is_same_v<Node, AST::GetExpr>
+                             || std::is_same_v<Node, AST::SetExpr>) {
+          return &node->name;
+        } else if constexpr (std::is_same_v<Node, AST::ThisExpr>
+                             || std::is_same_v<Node, AST::SuperExpr>) {
+          return &node->keyword;
+        } else if constexpr (std::is_same_v<Node, AST::BinaryExpr>
+                             || std::is_same_v<Node, AST::UnaryExpr>
+                             || std::is_same_v<Node, AST::PostfixExpr>
+                             || std::is_same_v<Node, AST::LogicalExpr>) {
+          return &node->op;
+        } else {
+          return nullptr;
+        }
+      },
+      expr);
+}
+
+auto tokenOf(const StmtPtrVariant& stmt) -> const Token* {
+  return std::visit(
+      [](const auto& node) -> const Token* {
+        using Node = std::decay_t<decltype(*node)>;
+        if constexpr (std::is_same_v<Node, AST::ExprStmt>
+                      || std::is_same_v<Node, AST::PrintStmt>) {
+          return tokenOf(node->expression);
+        } else if constexpr (std::is_same_v<Node, AST::IfStmt>
+                             || std::is_same_v<Node, AST::WhileStmt>) {
+          return tokenOf(node->condition);
+        } else if constexpr (std::is_same_v<Node, AST::VarStmt>) {
+          return &node->varName;
+        } else if constexpr (std::is_same_v<Node, AST::FuncStmt>) {
+          return &node->funcName;
+        } else if constexpr (std::is_same_v<Node, AST::RetStmt>) {
+          return &node->ret;
+        } else if constexpr (std::is_same_v<Node, AST::ClassStmt>) {
+          return &node->className;
+        } else {
+          return nullptr;
+        }
+      },
+      stmt);
+}
+
+// The same for a flattened statement; each expression's token column holds
+// the token tokenOf would find for its node.
+auto tokenOf(const AST::FlatAST& ast, AST::Index stmt) -> const Token* {
+  const auto tokenAt = [&](AST::Index token) -> const Token* {
+    return token != AST::NO_INDEX ? &ast.tokens[token] : nullptr;
+  };
+  switch (ast.stmts.kind[stmt]) {
+    case AST::StmtKind::EXPR:
+    case AST::StmtKind::PRINT:
+    case AST::StmtKind::IF:
+    case AST::StmtKind::WHILE:
+      return tokenAt(ast.exprs.token[ast.stmts.a[stmt]]);
+    case AST::StmtKind::VAR:
+    case AST::StmtKind::FUNC:
+    case AST::StmtKind::RETURN:
+    case AST::StmtKind::CLASS: return tokenAt(ast.stmts.token[stmt]);
+    default: return nullptr;
+  }
+}
 }  // namespace
 
 auto Evaluator::evaluateLiteralExpr(const LiteralExprPtr& expr) -> LoxObject {
   return expr->literalVal.has_value()
-             ? std::holds_alternative<std::string>(expr->literalVal.value())
-                   ? getLoxObjectfromStringLiteral(expr->literalVal.value())
-                   : LoxObject(std::get<double>(expr->literalVal.value()))
+             ? getLoxObjectfromLiteral(expr->literalVal.value())
              : LoxObject(nullptr);
 }
 
 auto Evaluator::evaluateUnaryExpr(const UnaryExprPtr& expr) -> LoxObject {
-  LoxObject right = evaluateExpr(expr->right);
-  switch (expr->op.getType()) {
-    case TokenType::BANG: return !isTrue(right);
-    case TokenType::MINUS: return -getDouble(expr->op, right);
-    case TokenType::PLUS_PLUS: return getDouble(expr->op, right) + 1;
-    case TokenType::MINUS_MINUS: return getDouble(expr->op, right) - 1;
+  return unaryOp(AST::toOp(expr->op.getType()), expr->op,
+                 evaluateExpr(expr->right));
+}
+
+auto Evaluator::unaryOp(AST::Op op, const Token& token, const LoxObject& right)
+    -> LoxObject {
+  switch (op) {
+    case AST::Op::BANG: return !isTrue(right);
+    case AST::Op::MINUS: return -getDouble(token, right);
+    case AST::Op::PLUS_PLUS: return getDouble(token, right) + 1;
+    case AST::Op::MINUS_MINUS: return getDouble(token, right) - 1;
     default:
       throw reportRuntimeError(
-          eReporter, expr->op,
-          "Illegal unary expression: " + expr->op.getLexeme()
+          eReporter, token,
+          "Illegal unary expression: " + std::string(token.getLexeme())
               + getObjectString(right));
   }
 }
@@ -186,30 +327,59 @@ auto Evaluator::evaluateLogicalExpr(const LogicalExprPtr& expr) -> LoxObject {
   if (expr->op.getType() == TokenType::AND)
     return !isTrue(leftVal) ? leftVal : evaluateExpr(expr->right);
 
-  throw reportRuntimeError(eReporter, expr->op,
-                           "Illegal logical operator: " + expr->op.getLexeme());
+  throw reportRuntimeError(
+      eReporter, expr->op,
+      "Illegal logical operator: " + std::string(expr->op.getLexeme()));
 }
 
 auto Evaluator::evaluateCallExpr(const CallExprPtr& expr) -> LoxObject {
-  LoxObject callee = evaluateExpr(expr->callee);
+  const auto evaluateArg
+      = [&](size_t i) { return evaluateExpr(expr->arguments[i]); };
+  const size_t numArgs = expr->arguments.size();
+  // m.get(k) and the other Map methods are called right where they're looked
+  // up, rather than being bound to m first.
+  if (std::holds_alternative<GetExprPtr>(expr->callee)) {
+    const GetExprPtr& getExpr = std::get<GetExprPtr>(expr->callee);
+    LoxObject object = evaluateExpr(getExpr->expr);
+    if (EXPECT_FALSE(std::holds_alternative<LoxMapShrdPtr>(object)))
+      return evaluateMapCall(*std::get<LoxMapShrdPtr>(object), getExpr->name,
+                             expr->paren, numArgs, evaluateArg);
+    return callObject(getProperty(getExpr->name, std::move(object)),
+                      expr->paren, numArgs, evaluateArg);
+  }
+  return callObject(evaluateExpr(expr->callee), expr->paren, numArgs,
+                    evaluateArg);
+}
 
+template <typename EvaluateArg>
+auto Evaluator::callObject(const LoxObject& callee, const Token& paren,
+                           size_t numArgs, const EvaluateArg& evaluateArg)
+    -> LoxObject {
 #ifdef EVAL_DEBUG
   ErrorsAndDebug::debugPrint("evaluateCallExpr called. Callee:"
                              + getObjectString(callee));
 #endif  // EVAL_DEBUG
 
   if (EXPECT_FALSE(std::holds_alternative<BuiltinFuncShrdPtr>(callee))) {
-    // TODO(aakshintala): Currently this doesn't check arity or copy params, cos
-    // we don't need that at the moment cos we just have one builtin: clock.
-    // A correct implementation would look more like the rest of function call.
-    // Also just use the visitor pattern with double dispatch next time.
-    return std::get<BuiltinFuncShrdPtr>(callee)->run();
+    const auto& builtin = std::get<BuiltinFuncShrdPtr>(callee);
+    if (size_t arity = builtin->arity(); EXPECT_FALSE(arity != numArgs))
+      throw reportRuntimeError(
+          eReporter, paren,
+          "Expected " + std::to_string(arity) + " arguments. Got "
+              + std::to_string(numArgs) + " arguments. ");
+    std::vector<LoxObject> evaldArgs;
+    for (size_t i = 0; i < numArgs; ++i) evaldArgs.push_back(evaluateArg(i));
+    try {
+      return builtin->run(evaldArgs);
+    } catch (const std::runtime_error& e) {
+      throw reportRuntimeError(eReporter, paren, e.what());
+    }
   }
 
   LoxObject instanceOrNull = ([&]() -> LoxObject {
     if (EXPECT_FALSE(std::holds_alternative<LoxClassShrdPtr>(callee)))
       return LoxObject(
-          std::make_shared<LoxInstance>(std::get<LoxClassShrdPtr>(callee)));
+          makeObject<LoxInstance>(std::get<LoxClassShrdPtr>(callee)));
     return LoxObject(nullptr);
   })();
 
@@ -227,7 +397,7 @@ auto Evaluator::evaluateCallExpr(const CallExprPtr& expr) -> LoxObject {
     if (EXPECT_TRUE(std::holds_alternative<FuncShrdPtr>(callee)))
       return std::get<FuncShrdPtr>(callee);
 
-    throw reportRuntimeError(eReporter, expr->paren,
+    throw reportRuntimeError(eReporter, paren,
                              "Attempted to invoke a non-function");
   })();
 
@@ -238,9 +408,8 @@ auto Evaluator::evaluateCallExpr(const CallExprPtr& expr) -> LoxObject {
   }
 
   // Throw error if arity doesn't match the number of arguments supplied
-  if (size_t arity = funcObj->arity(), numArgs = expr->arguments.size();
-      EXPECT_FALSE(arity != numArgs))
-    throw reportRuntimeError(eReporter, expr->paren,
+  if (size_t arity = funcObj->arity(); EXPECT_FALSE(arity != numArgs))
+    throw reportRuntimeError(eReporter, paren,
                              "Expected " + std::to_string(arity)
                                  + " arguments. Got " + std::to_string(numArgs)
                                  + " arguments. ");
@@ -249,24 +418,32 @@ auto Evaluator::evaluateCallExpr(const CallExprPtr& expr) -> LoxObject {
   // may rely on values in this context (e.g., passing a local variable to a
   // function call.)
   std::vector<LoxObject> evaldArgs;
-  for (const auto& arg : expr->arguments)
-    evaldArgs.push_back(evaluateExpr(arg));
+  for (size_t i = 0; i < numArgs; ++i) evaldArgs.push_back(evaluateArg(i));
 
-  // Save caller's environ so we can restore it later
-  auto environToRestore = environManager.getCurrEnv();
-  // Set the currentEnviron to the function's closure,
-  environManager.setCurrEnv(funcObj->getClosure());
-  // Create a new Environ for the function so it doesn't dirty the closure.
-  environManager.createNewEnviron();
+  return callFunction(funcObj, evaldArgs, std::move(instanceOrNull), paren);
+}
 
+auto Evaluator::callFunction(const FuncShrdPtr& funcObj,
+                             const std::vector<LoxObject>& evaldArgs,
+                             LoxObject instanceOrNull, const Token& paren)
+    -> LoxObject {
+  safepoint();
+  // Create a new Environ inside the function's closure so it doesn't dirty
+  // the closure. It's only made current once it's complete, so running out
+  // of memory here leaves the caller's environ as it was.
+  auto fnEnviron = makeObject<Environment>(funcObj->getClosure());
   {  // Define each parameter with evaluated argument
     const auto& params = funcObj->getParams();
     auto param = params.begin();
     auto arg = evaldArgs.begin();
     for (; param != params.end() && arg != evaldArgs.end(); ++param, ++arg) {
-      environManager.define(*param, *arg);
+      fnEnviron->define(std::hash<std::string_view>()(param->getLexeme()),
+                        *arg);
     }
   }
+  // Save caller's environ so we can restore it later
+  auto environToRestore = environManager.getCurrEnv();
+  environManager.setCurrEnv(std::move(fnEnviron));
 
 #ifdef EVAL_DEBUG
   ErrorsAndDebug::debugPrint("FnBodyStmts:");
@@ -276,7 +453,12 @@ auto Evaluator::evaluateCallExpr(const CallExprPtr& expr) -> LoxObject {
 #endif  // EVAL_DEBUG
 
   // Evaluate the function
-  std::optional<LoxObject> fnRet = evaluateStmts(funcObj->getFnBodyStmts());
+  const std::shared_ptr<const FlatProgram>& flat = funcObj->getFlatProgram();
+  std::optional<LoxObject> fnRet
+      = flat != nullptr
+            ? evaluateFlatStmts(
+                *flat, flat->ast.functionBody(funcObj->getFlatFunction()))
+            : evaluateStmts(funcObj->getFnBodyStmts());
 
   // Teardown any environments created by the function.
   if (!funcObj->getIsMethod())
@@ -290,13 +472,32 @@ auto Evaluator::evaluateCallExpr(const CallExprPtr& expr) -> LoxObject {
   if (fnRet.has_value()) {
     if (EXPECT_FALSE(funcObj->getIsInitializer()))
       throw ErrorsAndDebug::reportRuntimeError(
-          eReporter, expr->paren,
+          eReporter, paren,
           "Initializer can't return a value other than 'this'");
     return fnRet.value();
   }
   return instanceOrNull;
 }
 
+auto Evaluator::call(const FuncShrdPtr& function,
+                     const std::vector<LoxObject>& args) -> LoxObject {
+  // Errors are reported against the function's name.
+  const Token name(TokenType::IDENTIFIER, function->getFnName(), 0);
+  const auto environToRestore = environManager.getCurrEnv();
+  numRunTimeErr = 0;
+  const Heap::Scope heapScope(*heap);
+  try {
+    return callFunction(function, args, LoxObject(nullptr), name);
+  } catch (const OutOfMemory& e) {
+    environManager.setCurrEnv(environToRestore);
+    throw reportRuntimeError(eReporter, name, e.what());
+  } catch (...) {
+    // The call is abandoned part way, so put back what it changed.
+    environManager.setCurrEnv(environToRestore);
+    throw;
+  }
+}
+
 auto Evaluator::evaluateFuncExpr(const FuncExprPtr& expr) -> LoxObject {
   // The current Environment becomes the closure for the function.
   auto closure = environManager.getCurrEnv();
@@ -307,18 +508,57 @@ auto Evaluator::evaluateFuncExpr(const FuncExprPtr& expr) -> LoxObject {
   // discarded when exiting wrapping scope this function is defined in (and the
   // FuncObj goes out of scope.)
   environManager.createNewEnviron();
-  return std::make_shared<FuncObj>(expr, "LoxAnonFuncDoNotUseThisNameAADWAED",
-                                   std::move(closure));
+  return makeObject<FuncObj>(expr->share(), ANONYMOUS_FUNCTION_NAME,
+                             std::move(closure));
+}
+
+template <typename EvaluateArg>
+auto Evaluator::evaluateMapCall(LoxMap& map, const Token& name,
+                                const Token& paren, size_t numArgs,
+                                const EvaluateArg& evaluateArg) -> LoxObject {
+  const std::optional<MapMethodKind> kind = findMapMethod(name.getLexeme());
+  if (EXPECT_FALSE(!kind.has_value()))
+    throw reportRuntimeError(
+        eReporter, name,
+        "Attempted to access undefined Map method: "
+            + std::string(name.getLexeme()));
+  if (size_t arity = mapMethodArity(kind.value());
+      EXPECT_FALSE(arity != numArgs))
+    throw reportRuntimeError(
+        eReporter, paren,
+        "Expected " + std::to_string(arity) + " arguments. Got "
+            + std::to_string(numArgs) + " arguments. ");
+  // No Map method takes more than two.
+  std::array<LoxObject, 2> evaldArgs{LoxObject(nullptr), LoxObject(nullptr)};
+  for (size_t i = 0; i < numArgs; ++i) evaldArgs[i] = evaluateArg(i);
+  try {
+    return callMapMethod(map, kind.value(), evaldArgs.data());
+  } catch (const std::runtime_error& e) {
+    throw reportRuntimeError(eReporter, paren, e.what());
+  }
 }
 
 auto Evaluator::evaluateGetExpr(const GetExprPtr& expr) -> LoxObject {
-  LoxObject instObj = evaluateExpr(expr->expr);
+  return getProperty(expr->name, evaluateExpr(expr->expr));
+}
+
+auto Evaluator::getProperty(const Token& name, LoxObject instObj)
+    -> LoxObject {
+  if (std::holds_alternative<LoxMapShrdPtr>(instObj)) {
+    const std::optional<MapMethodKind> kind = findMapMethod(name.getLexeme());
+    if (EXPECT_FALSE(!kind.has_value()))
+      throw reportRuntimeError(
+          eReporter, name,
+          "Attempted to access undefined Map method: "
+              + std::string(name.getLexeme()));
+    return bindMapMethod(std::get<LoxMapShrdPtr>(instObj), kind.value());
+  }
   if (EXPECT_FALSE(!std::holds_alternative<LoxInstanceShrdPtr>(instObj)))
-    throw reportRuntimeError(eReporter, expr->name,
+    throw reportRuntimeError(eReporter, name,
                              "Only instances have properties");
+  const std::string nameString(name.getLexeme());
   try {
-    LoxObject property
-        = std::get<LoxInstanceShrdPtr>(instObj)->get(expr->name.getLexeme());
+    LoxObject property = std::get<LoxInstanceShrdPtr>(instObj)->get(nameString);
     if (std::holds_alternative<FuncShrdPtr>(property)) {
       // if it's a method that we just looked up, then we need to create a
       // binding for 'this'
@@ -328,35 +568,46 @@ auto Evaluator::evaluateGetExpr(const GetExprPtr& expr) -> LoxObject {
     return property;
   } catch (const ErrorsAndDebug::RuntimeError& e) {
     throw ErrorsAndDebug::reportRuntimeError(
-        eReporter, expr->name,
-        "Attempted to access undefined property: " + expr->name.getLexeme()
-            + " on " + std::get<LoxInstanceShrdPtr>(instObj)->toString());
+        eReporter, name,
+        "Attempted to access undefined property: " + nameString + " on "
+            + std::get<LoxInstanceShrdPtr>(instObj)->toString());
   }
 }
 
 auto Evaluator::evaluateSetExpr(const AST::SetExprPtr& expr) -> LoxObject {
   LoxObject object = evaluateExpr(expr->expr);
-  if (EXPECT_FALSE(!std::holds_alternative<LoxInstanceShrdPtr>(object)))
-    throw ErrorsAndDebug::reportRuntimeError(eReporter, expr->name,
-                                             "Only instances have fields.");
+  LoxInstance& instance = instanceToSet(expr->name, object);
   LoxObject value = evaluateExpr(expr->value);
-  std::get<LoxInstanceShrdPtr>(object)->set(expr->name.getLexeme(), value);
+  instance.set(std::string(expr->name.getLexeme()), value);
   return value;
 }
 
+auto Evaluator::instanceToSet(const Token& name, const LoxObject& object)
+    -> LoxInstance& {
+  if (EXPECT_FALSE(!std::holds_alternative<LoxInstanceShrdPtr>(object)))
+    throw ErrorsAndDebug::reportRuntimeError(eReporter, name,
+                                             "Only instances have fields.");
+  return *std::get<LoxInstanceShrdPtr>(object);
+}
+
 auto Evaluator::evaluateThisExpr(const ThisExprPtr& expr) -> LoxObject {
   return environManager.get(expr->keyword);
 }
 
 auto Evaluator::evaluateSuperExpr(const SuperExprPtr& expr) -> LoxObject {
+  return superMethod(expr->keyword, expr->method);
+}
+
+auto Evaluator::superMethod(const Token& keyword, const Token& method)
+    -> LoxObject {
   LoxClassShrdPtr superClass
-      = std::get<LoxClassShrdPtr>(environManager.get(expr->keyword));
-  auto optionalMethod = superClass->findMethod(expr->method.getLexeme());
+      = std::get<LoxClassShrdPtr>(environManager.get(keyword));
+  auto optionalMethod = superClass->findMethod(std::string(method.getLexeme()));
   if (!optionalMethod.has_value())
     throw ErrorsAndDebug::reportRuntimeError(
-        eReporter, expr->keyword,
-        "Attempted to access undefined property " + expr->keyword.getLexeme()
-            + " on super.");
+        eReporter, keyword,
+        "Attempted to access undefined property "
+            + std::string(keyword.getLexeme()) + " on super.");
 
   return bindInstance(std::get<FuncShrdPtr>(optionalMethod.value()),
                       std::get<LoxInstanceShrdPtr>(
@@ -399,7 +650,7 @@ auto Evaluator::evaluateExpr(const ExprPtrVariant& expr) -> LoxObject {
       static_assert(std::variant_size_v<ExprPtrVariant> == 15,
                     "Looks like you forgot to update the cases in "
                     "Evaluator::Evaluate(const ExptrVariant&)!");
-      return "";
+      return LoxObject(nullptr);
   }
 }
 
@@ -428,7 +679,7 @@ auto Evaluator::evaluatePrintStmt(const PrintStmtPtr& stmt)
 #endif  // EVAL_DEBUG
 
   LoxObject objectToPrint = evaluateExpr(stmt->expression);
-  std::cout << ">" << getObjectString(objectToPrint) << std::endl;
+  printObject(objectToPrint);
 
 #ifdef EVAL_DEBUG
   ErrorsAndDebug::debugPrint("evaluatePrintStmt should have printed."
@@ -437,6 +688,13 @@ auto Evaluator::evaluatePrintStmt(const PrintStmtPtr& stmt)
   return std::nullopt;
 }
 
+void Evaluator::printObject(const LoxObject& object) {
+  Output::OutputBuffer& out = Output::stdOut();
+  out.write('>');
+  writeObject(out, object);
+  out.endLine();
+}
+
 auto Evaluator::evaluateBlockStmt(const BlockStmtPtr& stmt)
     -> std::optional<LoxObject> {
   auto currEnviron = environManager.getCurrEnv();
@@ -470,6 +728,7 @@ auto Evaluator::evaluateWhileStmt(const WhileStmtPtr& stmt)
     -> std::optional<LoxObject> {
   std::optional<LoxObject> result = std::nullopt;
   while (isTrue(evaluateExpr(stmt->condition)) && !result.has_value()) {
+    safepoint();
     result = evaluateStmt(stmt->loopBody);
   }
   return result;
@@ -483,6 +742,7 @@ auto Evaluator::evaluateForStmt(const ForStmtPtr& stmt)
     if (stmt->condition.has_value()
         && !isTrue(evaluateExpr(stmt->condition.value())))
       break;
+    safepoint();
     result = evaluateStmt(stmt->loopBody);
     if (result.has_value()) break;
     if (stmt->increment.has_value()) evaluateExpr(stmt->increment.value());
@@ -497,8 +757,9 @@ auto Evaluator::evaluateFuncStmt(const FuncStmtPtr& stmt)
   // Create a FuncObj for the function, and hand it off to environment to store
   environManager.define(
       stmt->funcName,
-      std::make_shared<FuncObj>(stmt->funcExpr, stmt->funcName.getLexeme(),
-                                std::move(closure)));
+      makeObject<FuncObj>(stmt->funcExpr->share(),
+                          std::string(stmt->funcName.getLexeme()),
+                          std::move(closure)));
   // We also create a new environment because we don't want any redefinitions of
   // variables that are later in the program lexical order to be visible to this
   // function (in case it's stored and passed around). This environment creation
@@ -518,54 +779,63 @@ auto Evaluator::evaluateRetStmt(const RetStmtPtr& stmt)
 
 auto Evaluator::evaluateClassStmt(const ClassStmtPtr& stmt)
     -> std::optional<LoxObject> {
+  std::optional<LoxObject> superClass;
+  if (stmt->superClass.has_value())
+    superClass = evaluateExpr(stmt->superClass.value());
+  defineClass(stmt->className, std::move(superClass),
+              [&](const std::shared_ptr<Environment>& closure) {
+                std::vector<std::pair<std::string, LoxObject>> methods;
+                for (const auto& methodStmt : stmt->methods) {
+                  const auto& functionStmt = std::get<FuncStmtPtr>(methodStmt);
+                  std::string methodName(functionStmt->funcName.getLexeme());
+                  bool isInitializer = methodName == "init";
+                  LoxObject method = makeObject<FuncObj>(
+                      functionStmt->funcExpr->share(), methodName, closure,
+                      true, isInitializer);
+                  methods.emplace_back(std::move(methodName), method);
+                }
+                return methods;
+              });
+  return std::nullopt;
+}
+
+template <typename MakeMethods>
+void Evaluator::defineClass(const Token& name,
+                            std::optional<LoxObject> superClassObj,
+                            const MakeMethods& makeMethods) {
   // Determine if this class has a super class or not;
-  auto superClass = [&]() -> std::optional<LoxClassShrdPtr> {
-    if (stmt->superClass.has_value()) {
-      auto superClassObj = evaluateExpr(stmt->superClass.value());
-      if (!std::holds_alternative<LoxClassShrdPtr>(superClassObj))
-        throw ErrorsAndDebug::reportRuntimeError(
-            eReporter, stmt->className,
-            "Superclass must be a class; Can't inherit from non-class");
-      return std::get<LoxClassShrdPtr>(superClassObj);
-    }
-    return std::nullopt;
-  }();
+  std::optional<LoxClassShrdPtr> superClass;
+  if (superClassObj.has_value()) {
+    if (!std::holds_alternative<LoxClassShrdPtr>(superClassObj.value()))
+      throw ErrorsAndDebug::reportRuntimeError(
+          eReporter, name,
+          "Superclass must be a class; Can't inherit from non-class");
+    superClass = std::get<LoxClassShrdPtr>(superClassObj.value());
+  }
 
   // Define the class name in the current environment
-  environManager.define(stmt->className, LoxObject(nullptr));
-
-  // If there is a super class, create a new environ and define 'super' there
-  if (superClass.has_value()) {
-    environManager.createNewEnviron();
-    environManager.define("super", superClass.value());
-  }
+  environManager.define(name, LoxObject(nullptr));
 
-  std::vector<std::pair<std::string, LoxObject>> methods;
+  // If there is a super class, the methods' closure is a new environ inside
+  // this one with 'super' defined there.
   std::shared_ptr<Environment> closure = environManager.getCurrEnv();
-  for (const auto& stmt : stmt->methods) {
-    const auto& functionStmt = std::get<FuncStmtPtr>(stmt);
-    bool isInitializer = functionStmt->funcName.getLexeme() == "init";
-    LoxObject method = std::make_shared<FuncObj>(
-        functionStmt->funcExpr, functionStmt->funcName.getLexeme(),
-        closure, true, isInitializer);
-    methods.emplace_back(functionStmt->funcName.getLexeme(), method);
-  }
-
-  // Discard the environment created for defining 'super'
   if (superClass.has_value()) {
-    environManager.setCurrEnv(environManager.getCurrEnv()->getParentEnv());
+    closure = makeObject<Environment>(std::move(closure));
+    closure->define(std::hash<std::string_view>()("super"),
+                    superClass.value());
   }
 
+  const std::vector<std::pair<std::string, LoxObject>> methods
+      = makeMethods(closure);
+
   // Declare the class
-  environManager.assign(stmt->className,
-                        std::make_shared<LoxClass>(stmt->className.getLexeme(),
-                                                   superClass, methods));
+  environManager.assign(
+      name, makeObject<LoxClass>(std::string(name.getLexeme()), superClass,
+                                 methods));
 
   // Create a new environment so changes that occur afterwards in lexical order
   // aren't visible to the class defn.
   environManager.createNewEnviron();
-
-  return std::nullopt;
 }
 
 auto Evaluator::evaluateStmt(const AST::StmtPtrVariant& stmt)
@@ -602,6 +872,7 @@ auto Evaluator::evaluateStmt(const AST::StmtPtrVariant& stmt)
 
 auto Evaluator::evaluateStmts(const std::vector<AST::StmtPtrVariant>& stmts)
     -> std::optional<LoxObject> {
+  const Heap::Scope heapScope(*heap);
   std::optional<LoxObject> result = std::nullopt;
   for (const AST::StmtPtrVariant& stmt : stmts) {
     try {
@@ -609,36 +880,285 @@ auto Evaluator::evaluateStmts(const std::vector<AST::StmtPtrVariant>& stmts)
       if (result.has_value()) break;
     } catch (const ErrorsAndDebug::RuntimeError& e) {
       ErrorsAndDebug::debugPrint("Caught unhandled exception.");
-      if (EXPECT_FALSE(++numRunTimeErr > MAX_RUNTIME_ERR)) {
-        std::cerr << "Too many errors occurred. Exiting evaluation."
-                  << std::endl;
-        throw e;
+      countRuntimeError();
+    } catch (const OutOfMemory& e) {
+      reportOutOfMemory(e, tokenOf(stmt));
+    }
+  }
+  return result;
+}
+
+void Evaluator::reportOutOfMemory(const OutOfMemory& e, const Token* token) {
+  // Caught by the statement loops rather than where it's thrown, so that the
+  // hot paths stay free of handlers; the innermost statement still has the
+  // line.
+  if (token != nullptr)
+    reportRuntimeError(eReporter, *token, e.what());
+  else
+    eReporter.setError(e.what());
+  countRuntimeError();
+}
+
+//===================================//
+// Flattened Node Evaluation Methods //
+//===================================//
+// These mirror the methods above for the nodes of a FlatProgram; see them for
+// the why of what each does.
+auto Evaluator::evaluateFlat(const FlatProgram& program)
+    -> std::optional<LoxObject> {
+  return evaluateFlatStmts(program, program.topLevel());
+}
+
+auto Evaluator::evaluateFlatExpr(const FlatProgram& program, AST::Index expr)
+    -> LoxObject {
+  const AST::FlatAST& ast = program.ast;
+  const AST::FlatAST::ExprPool& e = ast.exprs;
+  switch (e.kind[expr]) {
+    case AST::ExprKind::BINARY: {
+      LoxObject left = evaluateFlatExpr(program, e.a[expr]);
+      LoxObject right = evaluateFlatExpr(program, e.b[expr]);
+      return binaryOp(e.op[expr], ast.tokens[e.token[expr]], left, right);
+    }
+    case AST::ExprKind::GROUPING: return evaluateFlatExpr(program, e.a[expr]);
+    case AST::ExprKind::LITERAL:
+      return e.a[expr] != AST::NO_INDEX
+                 ? getLoxObjectfromLiteral(ast.literals[e.a[expr]])
+                 : LoxObject(nullptr);
+    case AST::ExprKind::UNARY:
+      return unaryOp(e.op[expr], ast.tokens[e.token[expr]],
+                     evaluateFlatExpr(program, e.a[expr]));
+    case AST::ExprKind::CONDITIONAL:
+      if (isTrue(evaluateFlatExpr(program, e.a[expr])))
+        return evaluateFlatExpr(program, e.b[expr]);
+      return evaluateFlatExpr(program, e.c[expr]);
+    case AST::ExprKind::POSTFIX: {
+      const AST::Index operand = e.a[expr];
+      LoxObject value = evaluateFlatExpr(program, operand);
+      if (EXPECT_TRUE(e.kind[operand] == AST::ExprKind::VARIABLE))
+        environManager.assign(ast.tokens[e.token[operand]],
+                              doPostfixOp(ast.tokens[e.token[expr]], value));
+      return value;
+    }
+    case AST::ExprKind::VARIABLE:
+      return environManager.get(ast.tokens[e.token[expr]]);
+    case AST::ExprKind::ASSIGNMENT: {
+      const Token& name = ast.tokens[e.token[expr]];
+      environManager.assign(name, evaluateFlatExpr(program, e.a[expr]));
+      return environManager.get(name);
+    }
+    case AST::ExprKind::LOGICAL: {
+      LoxObject left = evaluateFlatExpr(program, e.a[expr]);
+      if (e.op[expr] == AST::Op::OR)
+        return isTrue(left) ? left : evaluateFlatExpr(program, e.b[expr]);
+      if (e.op[expr] == AST::Op::AND)
+        return !isTrue(left) ? left : evaluateFlatExpr(program, e.b[expr]);
+      const Token& op = ast.tokens[e.token[expr]];
+      throw reportRuntimeError(
+          eReporter, op,
+          "Illegal logical operator: " + std::string(op.getLexeme()));
+    }
+    case AST::ExprKind::CALL: return evaluateFlatCallExpr(program, expr);
+    case AST::ExprKind::FUNC: {
+      auto closure = environManager.getCurrEnv();
+      environManager.createNewEnviron();
+      return makeObject<FuncObj>(program.shared_from_this(), e.a[expr],
+                                 ANONYMOUS_FUNCTION_NAME, std::move(closure));
+    }
+    case AST::ExprKind::GET:
+      return getProperty(ast.tokens[e.token[expr]],
+                         evaluateFlatExpr(program, e.a[expr]));
+    case AST::ExprKind::SET: {
+      const Token& name = ast.tokens[e.token[expr]];
+      LoxObject object = evaluateFlatExpr(program, e.a[expr]);
+      LoxInstance& instance = instanceToSet(name, object);
+      LoxObject value = evaluateFlatExpr(program, e.b[expr]);
+      instance.set(std::string(name.getLexeme()), value);
+      return value;
+    }
+    case AST::ExprKind::THIS:
+      return environManager.get(ast.tokens[e.token[expr]]);
+    case AST::ExprKind::SUPER:
+      return superMethod(ast.tokens[e.token[expr]], ast.tokens[e.a[expr]]);
+  }
+  return LoxObject(nullptr);
+}
+
+auto Evaluator::evaluateFlatCallExpr(const FlatProgram& program,
+                                     AST::Index expr) -> LoxObject {
+  const AST::FlatAST& ast = program.ast;
+  const AST::IndexRange arguments = ast.callArguments(expr);
+  const auto evaluateArg = [&](size_t i) {
+    return evaluateFlatExpr(program, arguments.first[i]);
+  };
+  const Token& paren = ast.tokens[ast.exprs.token[expr]];
+  const AST::Index callee = ast.exprs.a[expr];
+  if (ast.exprs.kind[callee] == AST::ExprKind::GET) {
+    const Token& name = ast.tokens[ast.exprs.token[callee]];
+    LoxObject object = evaluateFlatExpr(program, ast.exprs.a[callee]);
+    if (EXPECT_FALSE(std::holds_alternative<LoxMapShrdPtr>(object)))
+      return evaluateMapCall(*std::get<LoxMapShrdPtr>(object), name, paren,
+                             arguments.size(), evaluateArg);
+    return callObject(getProperty(name, std::move(object)), paren,
+                      arguments.size(), evaluateArg);
+  }
+  return callObject(evaluateFlatExpr(program, callee), paren, arguments.size(),
+                    evaluateArg);
+}
+
+auto Evaluator::evaluateFlatStmt(const FlatProgram& program, AST::Index stmt)
+    -> std::optional<LoxObject> {
+  const AST::FlatAST& ast = program.ast;
+  const AST::FlatAST::StmtPool& s = ast.stmts;
+  switch (s.kind[stmt]) {
+    case AST::StmtKind::EXPR:
+      evaluateFlatExpr(program, s.a[stmt]);
+      return std::nullopt;
+    case AST::StmtKind::PRINT:
+      printObject(evaluateFlatExpr(program, s.a[stmt]));
+      return std::nullopt;
+    case AST::StmtKind::BLOCK: {
+      auto currEnviron = environManager.getCurrEnv();
+      environManager.createNewEnviron();
+      std::optional<LoxObject> result
+          = evaluateFlatStmts(program, ast.blockStatements(stmt));
+      environManager.discardEnvironsTill(currEnviron);
+      return result;
+    }
+    case AST::StmtKind::VAR:
+      environManager.define(ast.tokens[s.token[stmt]],
+                            s.a[stmt] != AST::NO_INDEX
+                                ? evaluateFlatExpr(program, s.a[stmt])
+                                : LoxObject(nullptr));
+      return std::nullopt;
+    case AST::StmtKind::IF:
+      if (isTrue(evaluateFlatExpr(program, s.a[stmt])))
+        return evaluateFlatStmt(program, s.b[stmt]);
+      if (s.c[stmt] != AST::NO_INDEX)
+        return evaluateFlatStmt(program, s.c[stmt]);
+      return std::nullopt;
+    case AST::StmtKind::WHILE: {
+      std::optional<LoxObject> result = std::nullopt;
+      while (isTrue(evaluateFlatExpr(program, s.a[stmt]))
+             && !result.has_value()) {
+        safepoint();
+        result = evaluateFlatStmt(program, s.b[stmt]);
       }
+      return result;
+    }
+    case AST::StmtKind::FOR: {
+      std::optional<LoxObject> result = std::nullopt;
+      if (s.a[stmt] != AST::NO_INDEX) evaluateFlatStmt(program, s.a[stmt]);
+      while (true) {
+        if (s.b[stmt] != AST::NO_INDEX
+            && !isTrue(evaluateFlatExpr(program, s.b[stmt])))
+          break;
+        safepoint();
+        result = evaluateFlatStmt(program, s.d[stmt]);
+        if (result.has_value()) break;
+        if (s.c[stmt] != AST::NO_INDEX) evaluateFlatExpr(program, s.c[stmt]);
+      }
+      return result;
+    }
+    case AST::StmtKind::FUNC: {
+      std::shared_ptr<Environment> closure = environManager.getCurrEnv();
+      const Token& name = ast.tokens[s.token[stmt]];
+      environManager.define(
+          name, makeObject<FuncObj>(program.shared_from_this(), s.a[stmt],
+                                    std::string(name.getLexeme()),
+                                    std::move(closure)));
+      environManager.createNewEnviron();
+      return std::nullopt;
+    }
+    case AST::StmtKind::RETURN:
+      return s.a[stmt] != AST::NO_INDEX
+                 ? std::make_optional(evaluateFlatExpr(program, s.a[stmt]))
+                 : std::nullopt;
+    case AST::StmtKind::CLASS: return evaluateFlatClassStmt(program, stmt);
+  }
+  return std::nullopt;
+}
+
+auto Evaluator::evaluateFlatClassStmt(const FlatProgram& program,
+                                      AST::Index stmt)
+    -> std::optional<LoxObject> {
+  const AST::FlatAST& ast = program.ast;
+  std::optional<LoxObject> superClass;
+  if (ast.stmts.a[stmt] != AST::NO_INDEX)
+    superClass = evaluateFlatExpr(program, ast.stmts.a[stmt]);
+  defineClass(
+      ast.tokens[ast.stmts.token[stmt]], std::move(superClass),
+      [&](const std::shared_ptr<Environment>& closure) {
+        std::vector<std::pair<std::string, LoxObject>> methods;
+        for (const AST::Index method : ast.classMethods(stmt)) {
+          const Token& name = ast.tokens[ast.stmts.token[method]];
+          std::string methodName(name.getLexeme());
+          bool isInitializer = methodName == "init";
+          LoxObject object = makeObject<FuncObj>(
+              program.shared_from_this(), ast.stmts.a[method], methodName,
+              closure, true, isInitializer);
+          methods.emplace_back(std::move(methodName), std::move(object));
+        }
+        return methods;
+      });
+  return std::nullopt;
+}
+
+auto Evaluator::evaluateFlatStmts(const FlatProgram& program,
+                                  AST::IndexRange stmts)
+    -> std::optional<LoxObject> {
+  const Heap::Scope heapScope(*heap);
+  std::optional<LoxObject> result = std::nullopt;
+  for (const AST::Index stmt : stmts) {
+    try {
+      result = evaluateFlatStmt(program, stmt);
+      if (result.has_value()) break;
+    } catch (const ErrorsAndDebug::RuntimeError& e) {
+      ErrorsAndDebug::debugPrint("Caught unhandled exception.");
+      countRuntimeError();
+    } catch (const OutOfMemory& e) {
+      reportOutOfMemory(e, tokenOf(program.ast, stmt));
     }
   }
   return result;
 }
 
-class clockBuiltin : public BuiltinFunc {
- public:
-  explicit clockBuiltin(Environment::EnvironmentPtr closure)
-      : BuiltinFunc("clock", std::move(closure)) {}
-  auto arity() -> size_t override { return 0; }
-  auto run() -> LoxObject override {
-    return static_cast<double>(
-        std::chrono::duration_cast<std::chrono::milliseconds>(
-            std::chrono::high_resolution_clock::now().time_since_epoch())
-            .count());
+void Evaluator::countRuntimeError() {
+  if (EXPECT_FALSE(++numRunTimeErr > MAX_RUNTIME_ERR)) {
+    Output::stdOut().flush();
+    Output::stdErr().write("Too many errors occurred. Exiting evaluation.");
+    Output::stdErr().endLine();
+    throw ErrorsAndDebug::RuntimeError();
   }
-  auto getFnName() -> std::string override { return "< builtin-fn_clock >"; }
-};
+}
+
+auto Evaluator::getCurrEnv() -> Environment::EnvironmentPtr {
+  return environManager.getCurrEnv();
+}
+
+void Evaluator::setCurrEnv(Environment::EnvironmentPtr environ) {
+  environManager.setCurrEnv(std::move(environ));
+}
+
+auto Evaluator::getHeap() const -> Heap& { return *heap; }
 
 Evaluator::Evaluator(ErrorReporter& eReporter)
-    : eReporter(eReporter), environManager(eReporter) {
+    : Evaluator(eReporter, new Heap()) {}
+
+Evaluator::Evaluator(ErrorReporter& eReporter, Heap* heap)
+    : eReporter(eReporter), heap(heap), environManager(eReporter, *heap) {
+  const Heap::Scope heapScope(*heap);
   environManager.define(
       Types::Token(TokenType::FUN, "clock"),
       static_cast<BuiltinFuncShrdPtr>(
-          std::make_shared<clockBuiltin>(environManager.getCurrEnv())));
+          makeObject<clockBuiltin>(environManager.getCurrEnv())));
+  environManager.define(
+      Types::Token(TokenType::FUN, "Map"),
+      static_cast<BuiltinFuncShrdPtr>(
+          makeObject<mapBuiltin>(environManager.getCurrEnv())));
 }
 
+// Objects made here can outlive the evaluator, so the heap they're charged
+// to stays until they're gone.
+Evaluator::~Evaluator() { heap->release(); }
+
 }  // namespace cpplox::Evaluator
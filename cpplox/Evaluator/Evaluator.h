@@ -2,14 +2,19 @@
 #define CPPLOX_EVALUATOR_EVALUATOR__H
 #pragma once
 
+#include <cstdint>
 #include <exception>
 #include <memory>
 #include <string>
 #include <vector>
 
+#include "cpplox/AST/FlatAST.h"
 #include "cpplox/AST/NodeTypes.h"
 #include "cpplox/ErrorsAndDebug/ErrorReporter.h"
+#include "cpplox/Evaluator/Budget.h"
 #include "cpplox/Evaluator/Environment.h"
+#include "cpplox/Evaluator/FlatProgram.h"
+#include "cpplox/Evaluator/Heap.h"
 #include "cpplox/Evaluator/Objects.h"
 #include "cpplox/Types/Token.h"
 #include "cpplox/Types/Uncopyable.h"
@@ -55,11 +60,40 @@ using ErrorsAndDebug::ErrorReporter;
 class Evaluator {
  public:
   explicit Evaluator(ErrorReporter& eReporter);
+  // Takes over heap, which must have been made with new; e.g. to run on a
+  // Heap that doesn't pool.
+  Evaluator(ErrorReporter& eReporter, Heap* heap);
+  ~Evaluator();
   auto evaluateExpr(const ExprPtrVariant& expr) -> LoxObject;
   auto evaluateStmt(const AST::StmtPtrVariant& stmt)
       -> std::optional<LoxObject>;
   auto evaluateStmts(const std::vector<AST::StmtPtrVariant>& stmts)
       -> std::optional<LoxObject>;
+  // Runs program's top-level statements as evaluateStmts would, walking its
+  // FlatAST rather than the tree; the functions it declares run from it too.
+  // program has to be owned by a shared_ptr, as flattenProgram's are.
+  auto evaluateFlat(const FlatProgram& program) -> std::optional<LoxObject>;
+
+  // Limits everything evaluated from now on to budget; evaluation that goes
+  // over it throws BudgetExceeded, leaving the evaluator mid-run. Fuel counts
+  // from here.
+  void setBudget(const Budget& budget);
+
+  // Where the objects made by evaluation are accounted for; set a limit on
+  // it to have allocations past the limit fail with a runtime error.
+  [[nodiscard]] auto getHeap() const -> Heap&;
+
+  // Calls function with args, which must be as many as it has parameters,
+  // like a call expression in the top-level environment would; for programs
+  // that embed the interpreter. Each call gets its own MAX_RUNTIME_ERR.
+  auto call(const FuncShrdPtr& function, const std::vector<LoxObject>& args)
+      -> LoxObject;
+
+  // The environment top-level statements run in. Each function declaration
+  // opens a new one, so this is the innermost of a chain that ends in the
+  // globals (builtins included).
+  auto getCurrEnv() -> Environment::EnvironmentPtr;
+  void setCurrEnv(Environment::EnvironmentPtr environ);
 
  private:
   // evaluation functions for Expr types
@@ -91,16 +125,80 @@ class Evaluator {
   auto evaluateRetStmt(const RetStmtPtr& stmt) -> std::optional<LoxObject>;
   auto evaluateClassStmt(const ClassStmtPtr& stmt) -> std::optional<LoxObject>;
 
+  // evaluation functions for the nodes of a FlatProgram
+  auto evaluateFlatExpr(const FlatProgram& program, AST::Index expr)
+      -> LoxObject;
+  auto evaluateFlatCallExpr(const FlatProgram& program, AST::Index expr)
+      -> LoxObject;
+  auto evaluateFlatStmt(const FlatProgram& program, AST::Index stmt)
+      -> std::optional<LoxObject>;
+  auto evaluateFlatClassStmt(const FlatProgram& program, AST::Index stmt)
+      -> std::optional<LoxObject>;
+  auto evaluateFlatStmts(const FlatProgram& program, AST::IndexRange stmts)
+      -> std::optional<LoxObject>;
+
   // throws RuntimeError if right isn't a double
   auto getDouble(const Token& token, const LoxObject& right) -> double;
+  // Binary and unary operators; token is the operator's, for errors.
+  auto binaryOp(AST::Op op, const Token& token, const LoxObject& left,
+                const LoxObject& right) -> LoxObject;
+  auto unaryOp(AST::Op op, const Token& token, const LoxObject& right)
+      -> LoxObject;
   auto bindInstance(const FuncShrdPtr& method, LoxInstanceShrdPtr instance)
       -> FuncShrdPtr;
+  // What name names on instObj.
+  auto getProperty(const Token& name, LoxObject instObj) -> LoxObject;
+  // The instance whose field name is being set, if object is one.
+  auto instanceToSet(const Token& name, const LoxObject& object)
+      -> LoxInstance&;
+  // The superclass's method named method, bound to 'this'.
+  auto superMethod(const Token& keyword, const Token& method) -> LoxObject;
+  // Calls callee, with the numArgs arguments evaluateArg(i) evaluates once
+  // callee is known to take that many.
+  template <typename EvaluateArg>
+  auto callObject(const LoxObject& callee, const Token& paren, size_t numArgs,
+                  const EvaluateArg& evaluateArg) -> LoxObject;
+  // Calls the Map method 'name' on map, the same way.
+  template <typename EvaluateArg>
+  auto evaluateMapCall(LoxMap& map, const Token& name, const Token& paren,
+                       size_t numArgs, const EvaluateArg& evaluateArg)
+      -> LoxObject;
+  // Defines the class name, subclassing superClass if it has a value (an
+  // error if it isn't a class), with the methods makeMethods(closure) makes.
+  template <typename MakeMethods>
+  void defineClass(const Token& name, std::optional<LoxObject> superClass,
+                   const MakeMethods& makeMethods);
+  void printObject(const LoxObject& object);
+  // Reports running out of memory in a statement, against token if it has
+  // one.
+  void reportOutOfMemory(const OutOfMemory& e, const Token* token);
+  // Every loop iteration and call passes one; see Budget.
+  void safepoint();
+  // Called every CHECK_INTERVAL safepoints or less, to check the budget.
+  void checkBudget();
+  // Throws RuntimeError once there have been too many.
+  void countRuntimeError();
+  // Runs funcObj's body with its parameters bound to evaldArgs, and returns
+  // what it returns, or else instanceOrNull.
+  auto callFunction(const FuncShrdPtr& funcObj,
+                    const std::vector<LoxObject>& evaldArgs,
+                    LoxObject instanceOrNull, const Token& paren)
+      -> LoxObject;
 
   ErrorReporter& eReporter;
+  // Released, rather than deleted, when the evaluator goes; see Heap.
+  Heap* heap;
   EnvironmentManager environManager;
 
   static const int MAX_RUNTIME_ERR = 20;
   int numRunTimeErr = 0;
+
+  // Checking the clock at every safepoint would cost more than the loop.
+  static const int64_t CHECK_INTERVAL = 1024;
+  Budget budget;
+  // Fuel left after the safepoints until the next check.
+  uint64_t fuelLeft = 0;
+  int64_t safepointsUntilCheck = CHECK_INTERVAL;
 };
 
 }  // namespace cpplox::Evaluator
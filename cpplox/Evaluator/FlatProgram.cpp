@@ -0,0 +1,25 @@
+#include "cpplox/Evaluator/FlatProgram.h"
+
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+namespace cpplox::Evaluator {
+
+auto FlatProgram::topLevel() const -> AST::IndexRange {
+  return AST::IndexRange{ast.program.data(),
+                         ast.program.data() + ast.program.size()};
+}
+
+auto flattenProgram(const std::vector<AST::StmtPtrVariant>& statements)
+    -> std::shared_ptr<const FlatProgram> {
+  auto program = std::make_shared<FlatProgram>();
+  std::unordered_map<const AST::FuncExpr*, AST::Index> functionIndices;
+  program->ast = AST::flatten(statements, functionIndices);
+  program->declarations.resize(program->ast.functions.size());
+  for (const auto& [declaration, index] : functionIndices)
+    program->declarations[index] = declaration->share();
+  return program;
+}
+
+}  // namespace cpplox::Evaluator
@@ -0,0 +1,34 @@
+#ifndef CPPLOX_EVALUATOR_FLATPROGRAM_H
+#define CPPLOX_EVALUATOR_FLATPROGRAM_H
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "cpplox/AST/FlatAST.h"
+#include "cpplox/AST/NodeTypes.h"
+#include "cpplox/Types/Uncopyable.h"
+
+namespace cpplox::Evaluator {
+
+// A program run from its FlatAST rather than its tree; see
+// Evaluator::evaluateFlat. The functions it declares run their bodies from
+// here too, but keep the FuncExpr they were flattened from as their
+// declaration, for what works with the tree (snapshots, parameters).
+struct FlatProgram : public Types::Uncopyable,
+                     public std::enable_shared_from_this<FlatProgram> {
+  AST::FlatAST ast;
+  // The FuncExpr each of ast's functions was flattened from.
+  std::vector<std::shared_ptr<const AST::FuncExpr>> declarations;
+
+  [[nodiscard]] auto topLevel() const -> AST::IndexRange;
+};
+
+// Flattens statements for evaluateFlat. Every function body is flattened, so
+// any whose parsing was put off are parsed now.
+auto flattenProgram(const std::vector<AST::StmtPtrVariant>& statements)
+    -> std::shared_ptr<const FlatProgram>;
+
+}  // namespace cpplox::Evaluator
+
+#endif  // CPPLOX_EVALUATOR_FLATPROGRAM_H
@@ -0,0 +1,124 @@
+// How evaluating a large program from its FlatProgram compares with walking
+// its tree: a generated program of long straight-line functions, each called
+// a few times, so every run goes over all of its nodes and they don't fit in
+// the caches. Also prints how much memory the nodes of each take. Run with:
+//   bazel run -c opt //cpplox/Evaluator:flat_program_benchmark -- [KB] [rounds]
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "cpplox/AST/Arena.h"
+#include "cpplox/AST/NodeTypes.h"
+#include "cpplox/ErrorsAndDebug/ErrorReporter.h"
+#include "cpplox/Evaluator/Evaluator.h"
+#include "cpplox/Evaluator/FlatProgram.h"
+#include "cpplox/Output/OutputBuffer.h"
+#include "cpplox/Parser/Parser.h"
+#include "cpplox/Scanner/Scanner.h"
+
+namespace {
+
+// Statements per function. Fewer, longer functions keep the chain of
+// environments the calls look them up through short.
+const int FUNCTION_LENGTH = 400;
+// How many times the program calls each function.
+const int CALLS = 3;
+
+// Functions of arithmetic and branches on locals, with different constants
+// throughout, adding up to about bytes, and a loop calling each of them.
+auto generateProgram(size_t bytes) -> std::string {
+  std::string source;
+  int functions = 0;
+  for (; source.size() < bytes; ++functions) {
+    source += "fun f" + std::to_string(functions) + "(a) {\n"
+              + "  var x = a;\n  var y = 1;\n";
+    for (int line = 0; line < FUNCTION_LENGTH; ++line) {
+      const std::string j = std::to_string(line);
+      const std::string k = std::to_string((functions * 31 + line) % 97);
+      switch (line % 4) {
+        case 0: source += "  x = x + a * " + k + " - " + j + ";\n"; break;
+        case 1:
+          source += "  if (x > " + k + ") x = x / 2; else x = x + " + j
+                    + ";\n";
+          break;
+        case 2: source += "  y = (y + x) * 0.5 - " + k + ";\n"; break;
+        default: source += "  if (y < x and a >= 0) y = y + 1;\n"; break;
+      }
+    }
+    source += "  return x + y;\n}\n";
+  }
+  source += "var total = 0;\nfor (var i = 0; i < " + std::to_string(CALLS)
+            + "; i = i + 1) {\n";
+  for (int f = 0; f < functions; ++f)
+    source += "  total = total + f" + std::to_string(f) + "(i);\n";
+  return source + "}\nprint total;\n";
+}
+
+auto secondsSince(std::chrono::steady_clock::time_point start) -> double {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now()
+                                       - start)
+      .count();
+}
+
+// Seconds to run program in a fresh evaluator, from flat if it's set.
+auto timeRun(const std::vector<cpplox::AST::StmtPtrVariant>& program,
+             const cpplox::Evaluator::FlatProgram* flat, std::string& printed)
+    -> double {
+  cpplox::ErrorsAndDebug::ErrorReporter eReporter;
+  cpplox::Evaluator::Evaluator evaluator(eReporter);
+  printed.clear();
+  cpplox::Output::OutputBuffer out(printed);
+  cpplox::Output::Redirect redirect(out, out);
+  const auto start = std::chrono::steady_clock::now();
+  if (flat != nullptr)
+    evaluator.evaluateFlat(*flat);
+  else
+    evaluator.evaluateStmts(program);
+  return secondsSince(start);
+}
+
+}  // namespace
+
+auto main(int argc, char const* argv[]) -> int {
+  const size_t kilobytes = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 8192;
+  const int rounds = argc > 2 ? std::atoi(argv[2]) : 5;
+  const std::string source = generateProgram(kilobytes * 1024);
+
+  cpplox::ErrorsAndDebug::ErrorReporter eReporter;
+  const cpplox::Types::TokenList tokens
+      = cpplox::Scanner(source, eReporter).tokenize();
+  auto arena = std::make_shared<cpplox::AST::Arena>();
+  std::vector<cpplox::AST::StmtPtrVariant> program;
+  {
+    cpplox::AST::Arena::Scope scope(*arena);
+    program = cpplox::Parser::RDParser(tokens, eReporter).parse();
+  }
+  const auto flattenStart = std::chrono::steady_clock::now();
+  const std::shared_ptr<const cpplox::Evaluator::FlatProgram> flat
+      = cpplox::Evaluator::flattenProgram(program);
+  const double flattenSeconds = secondsSince(flattenStart);
+
+  // Alternate, so drift in the machine's speed hits both alike.
+  double bestTree = 1e9;
+  double bestFlat = 1e9;
+  std::string treePrinted;
+  std::string flatPrinted;
+  for (int round = 0; round < rounds; ++round) {
+    bestTree = std::min(bestTree, timeRun(program, nullptr, treePrinted));
+    bestFlat = std::min(bestFlat, timeRun(program, flat.get(), flatPrinted));
+  }
+  if (treePrinted != flatPrinted) std::cerr << "results disagree" << std::endl;
+
+  std::cout << source.size() / 1024 << " KB of source: "
+            << arena->bytesAllocated() / 1024 << " KB of tree nodes, "
+            << flat->ast.bytesUsed() / 1024 << " KB flat (flattened in "
+            << flattenSeconds * 1e3 << " ms)\n"
+            << "evaluation: " << bestTree * 1e3 << " ms tree, "
+            << bestFlat * 1e3 << " ms flat ("
+            << (bestFlat / bestTree - 1) * 100 << "%)" << std::endl;
+  return 0;
+}
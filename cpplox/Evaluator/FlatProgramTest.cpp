@@ -0,0 +1,152 @@
+#include "gtest/gtest.h"
+
+#include <memory>
+#include <string>
+#include <string_view>
+#include <variant>
+#include <vector>
+
+#include "cpplox/AST/NodeTypes.h"
+#include "cpplox/ErrorsAndDebug/ErrorReporter.h"
+#include "cpplox/Evaluator/Evaluator.h"
+#include "cpplox/Evaluator/FlatProgram.h"
+#include "cpplox/Evaluator/Snapshot.h"
+#include "cpplox/Output/OutputBuffer.h"
+#include "cpplox/TestUtil/TestUtil.h"
+
+namespace cpplox::Evaluator {
+
+namespace {
+
+auto lookup(Evaluator& evaluator, std::string_view name) -> LoxObject {
+  return evaluator.getCurrEnv()->get(std::hash<std::string_view>()(name));
+}
+
+// What running source prints, followed by the errors it reports, walking
+// either its tree or its FlatProgram.
+auto run(const std::string& source, bool flat) -> std::string {
+  std::string printed;
+  ErrorsAndDebug::ErrorReporter eReporter;
+  {
+    Output::OutputBuffer out(printed);
+    Output::OutputBuffer err(printed);
+    const Output::Redirect redirect(out, err);
+    const std::vector<AST::StmtPtrVariant> program = TestUtil::parse(source);
+    Evaluator evaluator(eReporter);
+    if (flat)
+      evaluator.evaluateFlat(*flattenProgram(program));
+    else
+      evaluator.evaluateStmts(program);
+  }
+  for (const std::string& message : eReporter.getMessages())
+    printed += message + "\n";
+  return printed;
+}
+
+}  // namespace
+
+TEST(FlatProgramTest, runs_like_the_tree) {
+  const std::string source = R"(
+    var a = 1;
+    print -a * (2 + 3) >= 4 == !true or a and nil;
+    print a > 0 ? "yes" : "no";
+    a++;
+    print (a, a + 1);
+    var s = "";
+    for (var i = 0; i < 5; i = i + 1) s = s + i;
+    print s;
+    fun makeCounter() {
+      var count = 0;
+      return fun () { count = count + 1; return count; };
+    }
+    var counter = makeCounter();
+    counter();
+    print counter();
+    fun find(limit) {
+      var i = 0;
+      while (true) { if (i * i > limit) return i; i = i + 1; }
+    }
+    print find(50);
+    class Base {
+      init(name) { this.name = name; }
+      greet() { return "hi " + this.name; }
+    }
+    class Derived < Base {
+      greet() { return super.greet() + "!"; }
+    }
+    var d = Derived("lox");
+    print d.greet();
+    var greet = d.greet;
+    d.name = "flat";
+    print greet();
+    var m = Map();
+    m.set("k", 1);
+    var get = m.get;
+    print m.get("k") + get("k");
+    print m.has("x");
+  )";
+  const std::string tree = run(source, false);
+  EXPECT_EQ(tree, run(source, true));
+  EXPECT_NE(std::string::npos, tree.find(">hi flat!"));
+}
+
+TEST(FlatProgramTest, reports_runtime_errors_like_the_tree) {
+  const std::string source = R"(
+    var a = 1;
+    a();
+    print a.field;
+    a.field = 2;
+    print 1 / 0;
+    print "s" - 1;
+    class C < a {}
+    fun f(x) { return x; }
+    f(1, 2);
+    var m = Map();
+    m.nope();
+    print "still running";
+  )";
+  const std::string tree = run(source, false);
+  EXPECT_EQ(tree, run(source, true));
+  EXPECT_NE(std::string::npos, tree.find("Division by zero"));
+  EXPECT_NE(std::string::npos, tree.find("still running"));
+}
+
+TEST(FlatProgramTest, functions_keep_running_from_it) {
+  // Tokens point into the source, so it has to outlive them.
+  const std::string source
+      = "fun add(x, y) { return x + y; }\n"
+        "class Box { init(v) { this.v = v; } get() { return this.v; } }\n";
+  const std::vector<AST::StmtPtrVariant> program = TestUtil::parse(source);
+  ErrorsAndDebug::ErrorReporter eReporter;
+  Evaluator evaluator(eReporter);
+  evaluator.evaluateFlat(*flattenProgram(program));
+
+  const auto add = std::get<FuncShrdPtr>(lookup(evaluator, "add"));
+  EXPECT_NE(nullptr, add->getFlatProgram());
+  // The program was only kept alive by the functions it declared.
+  EXPECT_EQ(5.0, std::get<double>(evaluator.call(add, {2.0, 3.0})));
+
+  const auto box = std::get<LoxClassShrdPtr>(lookup(evaluator, "Box"));
+  const auto get = std::get<FuncShrdPtr>(box->findMethod("get").value());
+  EXPECT_NE(nullptr, get->getFlatProgram());
+}
+
+TEST(FlatProgramTest, its_functions_can_be_snapshotted) {
+  const std::string source
+      = "var base = 10;\n"
+        "fun addBase(x) { return base + x; }\n";
+  const std::vector<AST::StmtPtrVariant> program = TestUtil::parse(source);
+  ErrorsAndDebug::ErrorReporter originalErrors;
+  Evaluator original(originalErrors);
+  original.evaluateFlat(*flattenProgram(program));
+  const std::string snapshot
+      = writeSnapshot(original, {ScriptUnit{source, &program}});
+
+  ErrorsAndDebug::ErrorReporter restoredErrors;
+  Evaluator restored(restoredErrors);
+  const std::vector<RestoredScript> scripts = readSnapshot(snapshot, restored);
+  const auto addBase = std::get<FuncShrdPtr>(lookup(restored, "addBase"));
+  EXPECT_EQ(15.0, std::get<double>(restored.call(addBase, {5.0})));
+}
+
+}  // namespace cpplox::Evaluator
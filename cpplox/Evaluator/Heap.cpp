@@ -0,0 +1,380 @@
+#include "cpplox/Evaluator/Heap.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <iomanip>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace cpplox::Evaluator {
+
+namespace {
+
+auto describeLimit(size_t limit) -> std::string {
+  return "Out of memory: the script is limited to " + std::to_string(limit)
+         + " bytes.";
+}
+
+}  // namespace
+
+auto getKindName(ObjectKind kind) -> const char* {
+  switch (kind) {
+    case ObjectKind::STRING: return "strings";
+    case ObjectKind::ENVIRONMENT: return "environments";
+    case ObjectKind::FUNCTION: return "functions";
+    case ObjectKind::CLASS: return "classes";
+    case ObjectKind::INSTANCE: return "instances";
+    case ObjectKind::MAP: return "maps";
+  }
+  return "other";
+}
+
+void PauseStats::record(std::chrono::nanoseconds pause, size_t freed) {
+  ++steps;
+  objects += freed;
+  total += pause;
+  max = std::max(max, pause);
+  size_t bucket = 0;
+  for (auto ns = static_cast<uint64_t>(pause.count()); ns != 0; ns >>= 1)
+    ++bucket;
+  ++histogram[std::min(bucket, histogram.size() - 1)];
+}
+
+auto PauseStats::percentile(double fraction) const
+    -> std::chrono::nanoseconds {
+  size_t seen = 0;
+  for (size_t bucket = 0; bucket < histogram.size(); ++bucket) {
+    seen += histogram[bucket];
+    if (seen != 0 && seen >= fraction * steps)
+      return std::min(max, std::chrono::nanoseconds(int64_t{1} << bucket));
+  }
+  return max;
+}
+
+auto MemoryStats::operator[](ObjectKind kind) const -> const MemoryUsage& {
+  return kinds[static_cast<size_t>(kind)];
+}
+
+auto MemoryStats::toString() const -> std::string {
+  std::ostringstream table;
+  auto row = [&](const std::string& name, const MemoryUsage& usage) {
+    table << std::left << std::setw(14) << name << std::right << std::setw(14)
+          << usage.liveBytes << std::setw(14) << usage.peakBytes << '\n';
+  };
+  table << std::left << std::setw(14) << "bytes" << std::right
+        << std::setw(14) << "live" << std::setw(14) << "peak" << '\n';
+  for (size_t i = 0; i < OBJECT_KINDS; ++i)
+    row(getKindName(static_cast<ObjectKind>(i)), kinds[i]);
+  row("total", total);
+  if (limit != 0) table << "limit " << limit << '\n';
+  if (slabBytes != 0) table << "slabs " << slabBytes << '\n';
+  if (pauses.steps != 0) {
+    auto micros = [](std::chrono::nanoseconds ns) { return ns.count() / 1e3; };
+    table << "reclaimed " << pauses.objects << " objects in " << pauses.steps
+          << " steps: max " << micros(pauses.max) << " us, p99 "
+          << micros(pauses.percentile(0.99)) << " us, " << pendingObjects
+          << " pending\n";
+  }
+  if (reclaimThreadTime.count() != 0)
+    table << "reclaim thread busy " << reclaimThreadTime.count() / 1e6
+          << " ms\n";
+  return table.str();
+}
+
+OutOfMemory::OutOfMemory(size_t limit)
+    : std::runtime_error(describeLimit(limit)) {}
+
+// Frees what its Heap hands it, a batch at a time, on a thread of its own.
+// The blocks the objects took are sent back in batches too, already linked
+// into a list per size class, so the Heap puts a batch back into its pools
+// (and credits it) on its own thread without going through its blocks. Only
+// this class' members are shared between the two threads.
+class Heap::ReclaimThread : public Types::Uncopyable {
+ public:
+  explicit ReclaimThread(Heap& heap) : heap(heap), thread([this] { run(); }) {}
+  // Finishes what it's been handed first.
+  ~ReclaimThread() override {
+    {
+      const std::lock_guard<std::mutex> lock(mutex);
+      stopping = true;
+    }
+    wake.notify_one();
+    thread.join();
+  }
+
+  // Takes every object out of objects.
+  void handOff(std::vector<std::shared_ptr<void>>& objects) {
+    if (objects.empty()) return;
+    {
+      const std::lock_guard<std::mutex> lock(mutex);
+      if (inbox.empty()) {
+        inbox.swap(objects);
+      } else {
+        std::move(objects.begin(), objects.end(), std::back_inserter(inbox));
+        objects.clear();
+      }
+    }
+    wake.notify_one();
+  }
+
+  // Until it has freed all it's been handed, and sent back their blocks.
+  void waitUntilIdle() {
+    std::unique_lock<std::mutex> lock(mutex);
+    idle.wait(lock, [this] { return inbox.empty() && !busy; });
+  }
+
+  struct FreedBlocks {
+    // Each size class' blocks, linked through FreeBlock::next.
+    std::array<FreeBlock*, MAX_POOLED_BYTES / SIZE_CLASS_BYTES + 1> heads{};
+    std::array<FreeBlock*, MAX_POOLED_BYTES / SIZE_CLASS_BYTES + 1> tails{};
+    std::array<size_t, OBJECT_KINDS> bytes{};
+    size_t allocations = 0;
+
+    void push(size_t sizeClass, void* pointer) {
+      FreeBlock* block = new (pointer) FreeBlock{heads[sizeClass]};
+      if (heads[sizeClass] == nullptr) tails[sizeClass] = block;
+      heads[sizeClass] = block;
+    }
+    void moveTo(FreedBlocks& other) {
+      for (size_t c = 0; c < heads.size(); ++c) {
+        if (heads[c] == nullptr) continue;
+        tails[c]->next = other.heads[c];
+        if (other.heads[c] == nullptr) other.tails[c] = tails[c];
+        other.heads[c] = heads[c];
+      }
+      for (size_t k = 0; k < OBJECT_KINDS; ++k) other.bytes[k] += bytes[k];
+      other.allocations += allocations;
+      *this = FreedBlocks();
+    }
+  };
+  [[nodiscard]] auto hasFreedBlocks() const -> bool {
+    return hasSentBack.load(std::memory_order_relaxed);
+  }
+  void takeFreedBlocks(FreedBlocks& blocks) {
+    const std::lock_guard<std::mutex> lock(sentBackMutex);
+    sentBack.moveTo(blocks);
+    hasSentBack.store(false, std::memory_order_relaxed);
+  }
+
+  // On the reclaim thread: the block goes back with the next batch; one too
+  // large to pool can be deleted here, as operator delete is thread safe.
+  void freeLater(void* pointer, ObjectKind kind, size_t bytes) {
+    if (heap.pooled && bytes <= MAX_POOLED_BYTES)
+      freed.push(sizeClassOf(bytes), pointer);
+    else
+      ::operator delete(pointer);
+    freed.bytes[static_cast<size_t>(kind)] += bytes;
+    if (++freed.allocations >= SEND_BACK_BATCH) sendBack();
+  }
+
+  [[nodiscard]] auto busyTime() const -> std::chrono::nanoseconds {
+    return std::chrono::nanoseconds(busyNanoseconds.load());
+  }
+
+ private:
+  static const size_t SEND_BACK_BATCH = 4096;
+
+  void run() {
+    std::vector<std::shared_ptr<void>> batch;
+    reclaimingFor = &heap;
+    reclaimQueue = &batch;
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+      wake.wait(lock, [this] { return !inbox.empty() || stopping; });
+      if (inbox.empty()) return;
+      batch.swap(inbox);
+      busy = true;
+      lock.unlock();
+      const auto start = std::chrono::steady_clock::now();
+      // What the objects held the last reference to joins the batch; one at
+      // a time, so a long list doesn't recurse all the way down.
+      while (!batch.empty()) {
+        const std::shared_ptr<void> object = std::move(batch.back());
+        batch.pop_back();
+      }
+      sendBack();
+      busyNanoseconds += (std::chrono::steady_clock::now() - start).count();
+      lock.lock();
+      busy = false;
+      idle.notify_all();
+    }
+  }
+
+  void sendBack() {
+    if (freed.allocations == 0) return;
+    const std::lock_guard<std::mutex> lock(sentBackMutex);
+    freed.moveTo(sentBack);
+    hasSentBack.store(true, std::memory_order_relaxed);
+  }
+
+  Heap& heap;
+  std::mutex mutex;
+  std::condition_variable wake;
+  std::condition_variable idle;
+  std::vector<std::shared_ptr<void>> inbox;
+  bool busy = false;
+  bool stopping = false;
+  // Only touched on the reclaim thread.
+  FreedBlocks freed;
+  std::mutex sentBackMutex;
+  FreedBlocks sentBack;
+  std::atomic<bool> hasSentBack{false};
+  std::atomic<int64_t> busyNanoseconds{0};
+  // Last, so it starts once the rest is made.
+  std::thread thread;
+};
+
+Heap::Heap(bool pooled) : pooled(pooled) {}
+
+Heap::~Heap() = default;
+
+void Heap::release() {
+  setReclaimThread(false);
+  // Nothing is left to free what's deferred once the Heap is let go of, so
+  // free it now, along with what that defers in turn; one at a time, so a
+  // long list doesn't recurse all the way down.
+  if (!pending.empty()) {
+    const Scope scope(*this);
+    while (!pending.empty()) {
+      const std::shared_ptr<void> object = std::move(pending.back());
+      pending.pop_back();
+    }
+  }
+  released = true;
+  if (liveAllocations == 0) destroy();
+}
+
+void Heap::destroy() { delete this; }
+
+void Heap::setLimit(size_t limit) { stats.limit = limit; }
+
+auto Heap::getStats() const -> MemoryStats {
+  MemoryStats current = stats;
+  current.pendingObjects = pending.size();
+  if (reclaimThread != nullptr)
+    current.reclaimThreadTime += reclaimThread->busyTime();
+  return current;
+}
+
+void Heap::setReclaimStep(size_t objects) { reclaimStep = objects; }
+
+void Heap::setReclaimThread(bool on) {
+  if (on == (reclaimThread != nullptr)) return;
+  if (on) {
+    reclaimThread = std::make_unique<ReclaimThread>(*this);
+    return;
+  }
+  finishReclaiming();
+  stats.reclaimThreadTime += reclaimThread->busyTime();
+  reclaimThread.reset();
+}
+
+void Heap::finishReclaiming() {
+  if (reclaimThread == nullptr) {
+    while (!pending.empty()) reclaim(pending.size());
+    return;
+  }
+  const auto start = std::chrono::steady_clock::now();
+  const size_t handedOff = pending.size();
+  reclaimThread->handOff(pending);
+  reclaimThread->waitUntilIdle();
+  putBackFreedBlocks();
+  allocationsSinceHandOff = 0;
+  stats.pauses.record(std::chrono::steady_clock::now() - start, handedOff);
+}
+
+void Heap::reclaim(size_t objects) {
+  const auto start = std::chrono::steady_clock::now();
+  const Scope scope(*this);
+  size_t freed = 0;
+  // What the freed objects held the last reference to is deferred in turn.
+  while (freed < objects && !pending.empty()) {
+    const std::shared_ptr<void> object = std::move(pending.back());
+    pending.pop_back();
+    ++freed;
+  }
+  stats.pauses.record(std::chrono::steady_clock::now() - start, freed);
+}
+
+void Heap::collect() {
+  if (reclaimThread == nullptr) {
+    reclaim(reclaimStep);
+    return;
+  }
+  // Handing off takes a lock, so it waits for a batch's worth, or a while.
+  if (!reclaimThread->hasFreedBlocks() && pending.size() < HAND_OFF_BATCH
+      && ++allocationsSinceHandOff < HAND_OFF_BATCH)
+    return;
+  const auto start = std::chrono::steady_clock::now();
+  const size_t handedOff = pending.size();
+  reclaimThread->handOff(pending);
+  allocationsSinceHandOff = 0;
+  putBackFreedBlocks();
+  stats.pauses.record(std::chrono::steady_clock::now() - start, handedOff);
+}
+
+void Heap::freeOnReclaimThread(void* pointer, ObjectKind kind,
+                               size_t bytes) noexcept {
+  reclaimThread->freeLater(pointer, kind, bytes);
+}
+
+void Heap::putBackFreedBlocks() {
+  ReclaimThread::FreedBlocks blocks;
+  reclaimThread->takeFreedBlocks(blocks);
+  for (size_t c = 0; c < freeLists.size(); ++c) {
+    if (blocks.heads[c] == nullptr) continue;
+    blocks.tails[c]->next = freeLists[c];
+    freeLists[c] = blocks.heads[c];
+  }
+  for (size_t k = 0; k < OBJECT_KINDS; ++k) {
+    stats.kinds[k].liveBytes -= blocks.bytes[k];
+    stats.total.liveBytes -= blocks.bytes[k];
+  }
+  // The Heap isn't released while it has a reclaim thread, so this isn't
+  // its last allocation.
+  liveAllocations -= blocks.allocations;
+}
+
+void Heap::reclaimOrThrow(size_t bytes) {
+  finishReclaiming();
+  if (stats.total.liveBytes + bytes > stats.limit)
+    throw OutOfMemory(stats.limit);
+}
+
+auto Heap::carve(size_t sizeClass) -> void* {
+  const size_t blockBytes = sizeClass * SIZE_CLASS_BYTES;
+  if (static_cast<size_t>(slabEnd - slabNext) < blockBytes) {
+    // What's left of the old slab is too small for this class; file it
+    // under the largest class it fits, rather than waste it.
+    const size_t leftoverClass
+        = static_cast<size_t>(slabEnd - slabNext) / SIZE_CLASS_BYTES;
+    if (leftoverClass != 0)
+      freeLists[leftoverClass]
+          = new (slabNext) FreeBlock{freeLists[leftoverClass]};
+    slabNext = slabEnd;
+    slabs.push_back(std::unique_ptr<std::byte[]>(new std::byte[SLAB_BYTES]));
+    slabNext = slabs.back().get();
+    slabEnd = slabNext + SLAB_BYTES;
+    stats.slabBytes += SLAB_BYTES;
+  }
+  void* block = slabNext;
+  slabNext += blockBytes;
+  return block;
+}
+
+Heap::Scope::Scope(Heap& heap) : previous(currentHeap) { currentHeap = &heap; }
+
+Heap::Scope::~Scope() { currentHeap = previous; }
+
+}  // namespace cpplox::Evaluator
@@ -0,0 +1,321 @@
+#ifndef CPPLOX_EVALUATOR_HEAP__H
+#define CPPLOX_EVALUATOR_HEAP__H
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "cpplox/Types/Uncopyable.h"
+
+namespace cpplox::Evaluator {
+
+// What the memory a Heap accounts for holds.
+enum class ObjectKind { STRING, ENVIRONMENT, FUNCTION, CLASS, INSTANCE, MAP };
+const size_t OBJECT_KINDS = 6;
+
+auto getKindName(ObjectKind kind) -> const char*;
+
+struct MemoryUsage {
+  size_t liveBytes = 0;
+  size_t peakBytes = 0;
+};
+
+// How long the steps that freed deferred objects took; see
+// Heap::setReclaimStep.
+struct PauseStats {
+  size_t steps = 0;
+  size_t objects = 0;  // freed by the steps
+  std::chrono::nanoseconds total{0};
+  std::chrono::nanoseconds max{0};
+  // Steps by how long they took: bucket b counts those under 2^b ns, and at
+  // least 2^(b - 1) ns.
+  std::array<size_t, 64> histogram{};
+
+  void record(std::chrono::nanoseconds pause, size_t freed);
+  // Under which fraction (e.g. 0.99) of the steps took; it's to within a
+  // factor of two, being a bucket's bound.
+  [[nodiscard]] auto percentile(double fraction) const
+      -> std::chrono::nanoseconds;
+};
+
+struct MemoryStats {
+  std::array<MemoryUsage, OBJECT_KINDS> kinds;
+  // The peak is of all kinds together, not the sum of their peaks.
+  MemoryUsage total;
+  size_t limit = 0;
+  // Bytes of pool slabs the Heap holds: the live small objects, the free
+  // blocks they left behind, and what's yet to be handed out.
+  size_t slabBytes = 0;
+  PauseStats pauses;
+  // Objects waiting to be freed by a step, and still counted as live.
+  size_t pendingObjects = 0;
+  // How long a reclaim thread spent freeing, off the Heap's own thread.
+  std::chrono::nanoseconds reclaimThreadTime{0};
+
+  [[nodiscard]] auto operator[](ObjectKind kind) const -> const MemoryUsage&;
+  // A table of the above, one kind per line.
+  [[nodiscard]] auto toString() const -> std::string;
+};
+
+// Thrown by an allocation that would take a Heap over its limit. It's a
+// runtime_error so that builtins report it like their other failures; the
+// Evaluator reports it as a runtime error against the nearest token.
+class OutOfMemory : public std::runtime_error {
+ public:
+  explicit OutOfMemory(size_t limit);
+};
+
+// Accounts for the memory one Evaluator's runtime objects (strings,
+// environments, functions, classes, instances and maps) take: the bytes they
+// asked for, by kind, live and at their peak. Objects are allocated with an
+// Allocator, which charges whichever Heap was current when it was made, so
+// an object keeps charging the Heap it was made in as it grows. The Heap
+// lives until both its owner has let it go and every allocation charged to
+// it has been freed, so objects can outlive their Evaluator.
+// Small objects (the bulk of them: environments, their members, functions
+// and instances) come from pools: a free list of blocks per 16-byte size
+// class, refilled by carving up 64 KB slabs, so allocating and freeing one
+// is a few instructions and no lock. Slabs are only given back when the
+// Heap goes, so an interpreter's churn doesn't fragment the process' heap.
+// A Heap and its objects are only used by one thread at a time, so the
+// pools need no locks and, with a Heap per interpreter, interpreters
+// running in parallel never contend over them.
+// Letting go of the last reference to an object normally frees everything
+// only it reached there and then, which for a large tree or a long list is
+// a long pause. With a reclaim step set, objects made while the Heap is
+// current instead hand what they held the last reference to over to the
+// Heap as they go, to be freed a few at a time by each allocation after.
+// With a reclaim thread, the Heap instead hands them over in batches to a
+// thread of its own that frees them, and takes the blocks they leave behind
+// back into its pools (and off its live bytes) on its own thread. What's
+// deferred is no longer reachable from the script, so the two threads never
+// share an object and no write barriers are needed; a Heap with a reclaim
+// thread mustn't share objects with other Heaps, though.
+class Heap : public Types::Uncopyable {
+ public:
+  // Made with new; let go of with release() rather than deleted. A Heap
+  // made with pooled false passes every allocation on to operator new.
+  explicit Heap(bool pooled = true);
+  void release();
+
+  // Blocks of at least bytes, aligned for any type no more aligned than
+  // std::max_align_t, charged to kind.
+  auto allocate(ObjectKind kind, size_t bytes) -> void* {
+    if (__builtin_expect(static_cast<int64_t>(!pending.empty()), 0))
+      collect();
+    charge(kind, bytes);
+    const bool small = pooled && bytes <= MAX_POOLED_BYTES;
+    if (small) {
+      FreeBlock*& freeList = freeLists[sizeClassOf(bytes)];
+      if (freeList != nullptr) {
+        FreeBlock* block = freeList;
+        freeList = block->next;
+        return block;
+      }
+    }
+    try {
+      return small ? carve(sizeClassOf(bytes)) : ::operator new(bytes);
+    } catch (...) {
+      credit(kind, bytes);
+      throw;
+    }
+  }
+  // May delete the Heap, if it's been released and this was its last block.
+  void deallocate(void* pointer, ObjectKind kind, size_t bytes) noexcept {
+    if (__builtin_expect(
+            static_cast<int64_t>(reclaimThread != nullptr
+                                 && reclaimQueue != nullptr),
+            0)) {
+      freeOnReclaimThread(pointer, kind, bytes);
+      return;
+    }
+    if (pooled && bytes <= MAX_POOLED_BYTES) {
+      FreeBlock*& freeList = freeLists[sizeClassOf(bytes)];
+      freeList = new (pointer) FreeBlock{freeList};
+    } else {
+      ::operator delete(pointer);
+    }
+    credit(kind, bytes);
+  }
+
+  // Allocations that would take the live total over limit bytes throw
+  // OutOfMemory; 0 for no limit.
+  void setLimit(size_t limit);
+  [[nodiscard]] auto getStats() const -> MemoryStats;
+
+  // Each allocation frees up to objects of those deferred, by the time it
+  // takes to free each on its own (not what it reached, which is deferred
+  // in turn); 0, the default, to free everything as it's let go of.
+  void setReclaimStep(size_t objects);
+  // Frees what's deferred on a thread of its own instead of in steps, which
+  // takes the Heap's thread no more than handing it over and putting the
+  // freed blocks back. Turning it off waits for the thread to finish.
+  void setReclaimThread(bool on);
+  // Frees everything deferred now, waiting for the reclaim thread to, if
+  // there is one.
+  void finishReclaiming();
+  // The current Heap if it defers freeing (or, on a reclaim thread, the
+  // Heap it frees for), or else nullptr.
+  static auto deferring() -> Heap* {
+    Heap* heap = currentHeap;
+    if (heap == nullptr) return reclaimingFor;
+    return heap->reclaimStep != 0 || heap->reclaimThread != nullptr ? heap
+                                                                     : nullptr;
+  }
+  // Takes the reference to object, to be let go of in a later step (or, on
+  // a reclaim thread, later in its batch).
+  void defer(std::shared_ptr<void> object) {
+    (reclaimQueue != nullptr ? *reclaimQueue : pending)
+        .push_back(std::move(object));
+  }
+  // Frees up to objects of those deferred, as one step; what they held the
+  // last reference to is deferred in turn.
+  void reclaim(size_t objects);
+
+  // Inline, as they're on the path of every allocation.
+  void charge(ObjectKind kind, size_t bytes) {
+    if (stats.limit != 0 && stats.total.liveBytes + bytes > stats.limit)
+      reclaimOrThrow(bytes);
+    MemoryUsage& usage = stats.kinds[static_cast<size_t>(kind)];
+    usage.liveBytes += bytes;
+    if (usage.liveBytes > usage.peakBytes) usage.peakBytes = usage.liveBytes;
+    stats.total.liveBytes += bytes;
+    if (stats.total.liveBytes > stats.total.peakBytes)
+      stats.total.peakBytes = stats.total.liveBytes;
+    ++liveAllocations;
+  }
+  void credit(ObjectKind kind, size_t bytes) {
+    stats.kinds[static_cast<size_t>(kind)].liveBytes -= bytes;
+    stats.total.liveBytes -= bytes;
+    if (--liveAllocations == 0 && released) destroy();
+  }
+
+  // The heap allocations are charged to: the one made current by the
+  // innermost live Scope on this thread, or else none.
+  static auto current() -> Heap* { return currentHeap; }
+
+  // Makes a heap current for as long as the Scope lives.
+  class Scope : public Types::Uncopyable {
+   public:
+    explicit Scope(Heap& heap);
+    ~Scope() override;
+
+   private:
+    Heap* previous;
+  };
+
+ private:
+  static const size_t SIZE_CLASS_BYTES = 16;
+  static const size_t MAX_POOLED_BYTES = 256;
+  static const size_t SLAB_BYTES = 64 * 1024;
+
+  // Deferred objects are handed to the reclaim thread this many at a time,
+  // or after this many allocations with fewer pending.
+  static const size_t HAND_OFF_BATCH = 1024;
+
+  struct FreeBlock {
+    FreeBlock* next;
+  };
+  class ReclaimThread;
+
+  ~Heap() override;
+
+  // Size class c holds blocks of c * SIZE_CLASS_BYTES; 0 bytes get 1 class.
+  static auto sizeClassOf(size_t bytes) -> size_t {
+    return (bytes + (bytes == 0) + SIZE_CLASS_BYTES - 1) / SIZE_CLASS_BYTES;
+  }
+  // A fresh block of sizeClass from the current slab, or a new one.
+  auto carve(size_t sizeClass) -> void*;
+  void destroy();
+  // Frees a step's worth of what's deferred, or trades with the reclaim
+  // thread: hands it what's deferred, and puts back what it's freed so far.
+  // Either way it's only called with something deferred, so the script's
+  // allocations pay for no more than that check otherwise.
+  void collect();
+  void freeOnReclaimThread(void* pointer, ObjectKind kind,
+                           size_t bytes) noexcept;
+  void putBackFreedBlocks();
+  // Frees everything deferred, and throws OutOfMemory if bytes still don't
+  // fit under the limit.
+  void reclaimOrThrow(size_t bytes);
+
+  const bool pooled;
+  std::array<FreeBlock*, MAX_POOLED_BYTES / SIZE_CLASS_BYTES + 1> freeLists{};
+  std::vector<std::unique_ptr<std::byte[]>> slabs;
+  std::byte* slabNext = nullptr;
+  std::byte* slabEnd = nullptr;
+  size_t reclaimStep = 0;
+  std::vector<std::shared_ptr<void>> pending;
+  std::unique_ptr<ReclaimThread> reclaimThread;
+  size_t allocationsSinceHandOff = 0;
+
+  inline static thread_local Heap* currentHeap = nullptr;
+  // Set on a reclaim thread: the Heap it frees for, and its batch.
+  inline static thread_local Heap* reclaimingFor = nullptr;
+  inline static thread_local std::vector<std::shared_ptr<void>>* reclaimQueue
+      = nullptr;
+
+  MemoryStats stats;
+  size_t liveAllocations = 0;
+  bool released = false;
+};
+
+// A standard allocator that charges each allocation to the Heap that was
+// current when it (or the allocator it was copied from) was made, as Kind.
+// Without a current Heap it's a plain std::allocator.
+template <typename T, ObjectKind Kind>
+class Allocator {
+ public:
+  using value_type = T;
+  using propagate_on_container_copy_assignment = std::true_type;
+  using propagate_on_container_move_assignment = std::true_type;
+  using propagate_on_container_swap = std::true_type;
+  template <typename U>
+  struct rebind {
+    using other = Allocator<U, Kind>;
+  };
+
+  Allocator() noexcept : heap(Heap::current()) {}
+  template <typename U>
+  Allocator(const Allocator<U, Kind>& other) noexcept  // NOLINT
+      : heap(other.heap) {}
+
+  auto allocate(size_t n) -> T* {
+    static_assert(alignof(T) <= alignof(std::max_align_t),
+                  "over-aligned types need an allocator of their own");
+    if (heap == nullptr) return std::allocator<T>().allocate(n);
+    return static_cast<T*>(heap->allocate(Kind, n * sizeof(T)));
+  }
+
+  void deallocate(T* pointer, size_t n) noexcept {
+    if (heap == nullptr) return std::allocator<T>().deallocate(pointer, n);
+    heap->deallocate(pointer, Kind, n * sizeof(T));
+  }
+
+  template <typename U>
+  auto operator==(const Allocator<U, Kind>& other) const noexcept -> bool {
+    return heap == other.heap;
+  }
+  template <typename U>
+  auto operator!=(const Allocator<U, Kind>& other) const noexcept -> bool {
+    return heap != other.heap;
+  }
+
+ private:
+  template <typename U, ObjectKind>
+  friend class Allocator;
+
+  Heap* heap;
+};
+
+}  // namespace cpplox::Evaluator
+#endif  // CPPLOX_EVALUATOR_HEAP__H
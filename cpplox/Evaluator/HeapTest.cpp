@@ -0,0 +1,354 @@
+#include "gtest/gtest.h"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <deque>
+#include <memory>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "cpplox/AST/NodeTypes.h"
+#include "cpplox/ErrorsAndDebug/ErrorReporter.h"
+#include "cpplox/Evaluator/Evaluator.h"
+#include "cpplox/Evaluator/Heap.h"
+#include "cpplox/Evaluator/Objects.h"
+#include "cpplox/Parser/Parser.h"
+#include "cpplox/Scanner/Scanner.h"
+
+namespace cpplox::Evaluator {
+
+namespace {
+
+// Runs sources, one after another, in an evaluator and reports on its heap.
+class HeapTest : public ::testing::Test {
+ protected:
+  void run(const std::string& sourceText) {
+    sources.push_back(sourceText);
+    Types::TokenList tokens
+        = Scanner(sources.back(), eReporter).tokenize();
+    programs.push_back(Parser::RDParser(tokens, eReporter).parse());
+    evaluator.evaluateStmts(programs.back());
+  }
+
+  auto stats() -> MemoryStats { return evaluator.getHeap().getStats(); }
+
+  ErrorsAndDebug::ErrorReporter eReporter;
+  Evaluator evaluator{eReporter};
+  // Deques, so that earlier sources and trees stay where functions and
+  // classes declared in them point.
+  std::deque<std::string> sources;
+  std::deque<std::vector<AST::StmtPtrVariant>> programs;
+};
+
+// Notes which thread it was freed on.
+struct Probe {
+  explicit Probe(std::thread::id* freedOn) : freedOn(freedOn) {}
+  ~Probe() { *freedOn = std::this_thread::get_id(); }
+  std::thread::id* freedOn;
+};
+
+}  // namespace
+
+TEST(HeapAccountingTest, charges_the_current_heap_by_kind) {
+  auto* heap = new Heap();
+  {
+    Heap::Scope scope(*heap);
+    auto map = makeObject<LoxMap>();
+    EXPECT_GE(heap->getStats()[ObjectKind::MAP].liveBytes, sizeof(LoxMap));
+    EXPECT_EQ(0, heap->getStats()[ObjectKind::INSTANCE].liveBytes);
+    map->set(LoxObject(1.0), LoxObject(2.0));
+    const MemoryStats grown = heap->getStats();
+    EXPECT_GT(grown[ObjectKind::MAP].liveBytes, sizeof(LoxMap));
+    EXPECT_GE(grown.total.liveBytes, grown[ObjectKind::MAP].liveBytes);
+    map.reset();
+    EXPECT_EQ(0, heap->getStats().total.liveBytes);
+    EXPECT_GE(heap->getStats().total.peakBytes, grown.total.liveBytes);
+  }
+  heap->release();
+}
+
+TEST(HeapAccountingTest, objects_can_outlive_the_heap_s_owner) {
+  auto* heap = new Heap();
+  std::shared_ptr<LoxMap> map;
+  {
+    Heap::Scope scope(*heap);
+    map = makeObject<LoxMap>();
+  }
+  heap->release();
+  // The heap is still there for the map to be credited back to.
+  map->set(LoxObject(1.0), LoxObject(2.0));
+  map.reset();
+}
+
+TEST(HeapAccountingTest, allocations_past_the_limit_throw) {
+  auto* heap = new Heap();
+  heap->setLimit(1000);
+  {
+    Heap::Scope scope(*heap);
+    EXPECT_THROW(heap->charge(ObjectKind::STRING, 1001), OutOfMemory);
+    heap->charge(ObjectKind::STRING, 600);
+    EXPECT_THROW(LoxString(std::string(500, 'x')), OutOfMemory);
+    EXPECT_EQ(600, heap->getStats().total.liveBytes);
+    heap->credit(ObjectKind::STRING, 600);
+  }
+  heap->release();
+}
+
+TEST(HeapPoolTest, reuses_freed_blocks_of_the_same_size_class) {
+  auto* heap = new Heap();
+  void* first = heap->allocate(ObjectKind::ENVIRONMENT, 48);
+  void* second = heap->allocate(ObjectKind::ENVIRONMENT, 48);
+  EXPECT_NE(first, second);
+  heap->deallocate(first, ObjectKind::ENVIRONMENT, 48);
+  EXPECT_EQ(first, heap->allocate(ObjectKind::INSTANCE, 40));
+  EXPECT_NE(first, heap->allocate(ObjectKind::INSTANCE, 24));
+  EXPECT_EQ(64 * 1024, heap->getStats().slabBytes);
+  EXPECT_EQ(48 + 48 + 40 + 24 - 48, heap->getStats().total.liveBytes);
+  heap->release();
+}
+
+TEST(HeapPoolTest, blocks_do_not_overlap) {
+  auto* heap = new Heap();
+  std::vector<std::pair<unsigned char*, size_t>> blocks;
+  for (size_t i = 0; i < 20000; ++i) {
+    const size_t bytes = i % 300;
+    auto* block = static_cast<unsigned char*>(
+        heap->allocate(ObjectKind::MAP, bytes));
+    std::fill(block, block + bytes, static_cast<unsigned char>(i));
+    blocks.emplace_back(block, bytes);
+    // Free every third block as we go, so later ones reuse them.
+    if (i % 3 == 0) {
+      auto& [freed, freedBytes] = blocks[i / 3];
+      heap->deallocate(freed, ObjectKind::MAP, freedBytes);
+      freed = nullptr;
+    }
+  }
+  for (size_t i = 0; i < blocks.size(); ++i) {
+    const auto [block, bytes] = blocks[i];
+    if (block == nullptr) continue;
+    EXPECT_EQ(bytes, std::count(block, block + bytes,
+                                static_cast<unsigned char>(i)));
+    heap->deallocate(block, ObjectKind::MAP, bytes);
+  }
+  EXPECT_EQ(0, heap->getStats().total.liveBytes);
+  heap->release();
+}
+
+TEST(HeapPoolTest, an_unpooled_heap_still_accounts) {
+  auto* heap = new Heap(false);
+  void* block = heap->allocate(ObjectKind::STRING, 100);
+  EXPECT_EQ(100, heap->getStats()[ObjectKind::STRING].liveBytes);
+  EXPECT_EQ(0, heap->getStats().slabBytes);
+  heap->deallocate(block, ObjectKind::STRING, 100);
+  heap->release();
+}
+
+TEST(HeapReclaimTest, going_over_the_limit_frees_what_is_deferred_first) {
+  using Block = std::array<char, 400>;
+  auto* heap = new Heap();
+  heap->setLimit(1000);
+  heap->setReclaimStep(1);
+  {
+    Heap::Scope scope(*heap);
+    // Made before either is deferred, as allocations free deferred objects.
+    auto first = std::allocate_shared<Block>(
+        Allocator<Block, ObjectKind::STRING>());
+    auto second = std::allocate_shared<Block>(
+        Allocator<Block, ObjectKind::STRING>());
+    heap->defer(std::move(first));
+    heap->defer(std::move(second));
+    EXPECT_EQ(2, heap->getStats().pendingObjects);
+    // The step frees one block, which isn't enough room; the rest go too
+    // rather than the allocation failing.
+    void* block = heap->allocate(ObjectKind::STRING, 600);
+    EXPECT_EQ(0, heap->getStats().pendingObjects);
+    EXPECT_EQ(600, heap->getStats().total.liveBytes);
+    EXPECT_THROW(heap->allocate(ObjectKind::STRING, 600), OutOfMemory);
+    heap->deallocate(block, ObjectKind::STRING, 600);
+  }
+  heap->release();
+}
+
+TEST(HeapReclaimTest, a_reclaim_thread_frees_off_the_heap_s_thread) {
+  auto* heap = new Heap();
+  heap->setReclaimThread(true);
+  std::thread::id freedOn;
+  {
+    Heap::Scope scope(*heap);
+    heap->defer(std::allocate_shared<Probe>(
+        Allocator<Probe, ObjectKind::INSTANCE>(), &freedOn));
+  }
+  EXPECT_GT(heap->getStats()[ObjectKind::INSTANCE].liveBytes, 0);
+  heap->finishReclaiming();
+  EXPECT_NE(std::thread::id(), freedOn);
+  EXPECT_NE(std::this_thread::get_id(), freedOn);
+  // Its block came back to be put back on this thread.
+  EXPECT_EQ(0, heap->getStats()[ObjectKind::INSTANCE].liveBytes);
+  EXPECT_EQ(1, heap->getStats().pauses.objects);
+  heap->release();
+}
+
+TEST(HeapReclaimTest, going_over_the_limit_waits_for_the_reclaim_thread) {
+  using Block = std::array<char, 400>;
+  auto* heap = new Heap();
+  heap->setLimit(1000);
+  heap->setReclaimThread(true);
+  {
+    Heap::Scope scope(*heap);
+    auto first = std::allocate_shared<Block>(
+        Allocator<Block, ObjectKind::STRING>());
+    auto second = std::allocate_shared<Block>(
+        Allocator<Block, ObjectKind::STRING>());
+    heap->defer(std::move(first));
+    heap->defer(std::move(second));
+    // Too few to be handed over yet, but they're needed for room now.
+    void* block = heap->allocate(ObjectKind::STRING, 600);
+    EXPECT_EQ(0, heap->getStats().pendingObjects);
+    EXPECT_EQ(600, heap->getStats().total.liveBytes);
+    EXPECT_THROW(heap->allocate(ObjectKind::STRING, 600), OutOfMemory);
+    heap->deallocate(block, ObjectKind::STRING, 600);
+  }
+  heap->release();
+}
+
+TEST(HeapReclaimTest, reports_the_pauses_by_percentile) {
+  PauseStats pauses;
+  for (int i = 0; i < 99; ++i) pauses.record(std::chrono::nanoseconds(900), 1);
+  pauses.record(std::chrono::microseconds(50), 10);
+  EXPECT_EQ(100, pauses.steps);
+  EXPECT_EQ(109, pauses.objects);
+  EXPECT_EQ(std::chrono::microseconds(50), pauses.max);
+  EXPECT_EQ(std::chrono::nanoseconds(1024), pauses.percentile(0.99));
+  EXPECT_EQ(std::chrono::microseconds(50), pauses.percentile(1));
+}
+
+TEST_F(HeapTest, accounts_for_what_a_script_makes) {
+  run("class Point { init(x) { this.x = x; } }\n");
+  const MemoryStats before = stats();
+  EXPECT_GT(before[ObjectKind::CLASS].liveBytes, 0);
+  EXPECT_GT(before[ObjectKind::FUNCTION].liveBytes, 0);
+
+  run("var points = Map();\n"
+      "for (var i = 0; i < 100; i = i + 1) points.set(i, Point(i));\n");
+  const MemoryStats grown = stats();
+  EXPECT_GT(grown[ObjectKind::INSTANCE].liveBytes, 100 * sizeof(LoxInstance));
+  EXPECT_GT(grown[ObjectKind::MAP].liveBytes, 100 * sizeof(LoxObject));
+  EXPECT_GT(grown[ObjectKind::ENVIRONMENT].peakBytes,
+            grown[ObjectKind::ENVIRONMENT].liveBytes);
+
+  run("points = nil;\n");
+  EXPECT_EQ(0, stats()[ObjectKind::INSTANCE].liveBytes);
+  EXPECT_EQ(grown[ObjectKind::INSTANCE].liveBytes,
+            stats()[ObjectKind::INSTANCE].peakBytes);
+  EXPECT_EQ(before[ObjectKind::MAP].liveBytes,
+            stats()[ObjectKind::MAP].liveBytes);
+}
+
+TEST_F(HeapTest, going_over_the_limit_is_a_runtime_error) {
+  evaluator.getHeap().setLimit(1 << 20);
+  run("var s = \"0123456789abcdef\";\n");
+  run("var i = 0;\n"
+      "while (i < 20) {\n"
+      "  s = s + s;\n"
+      "  i = i + 1;\n"
+      "}\n");
+  // Once s is over half the limit, each iteration fails to double it.
+  ASSERT_EQ(5, eReporter.getMessages().size());
+  EXPECT_EQ("[Line 3] Error: s: Out of memory: the script is limited to "
+            "1048576 bytes.",
+            eReporter.getMessages()[0]);
+  EXPECT_LE(stats().total.peakBytes, 1 << 20);
+
+  // The script carries on with what it had.
+  eReporter.clearErrors();
+  run("var n = Map();\nn.set(1, s);\n");
+  EXPECT_EQ(0, eReporter.getMessages().size());
+}
+
+TEST_F(HeapTest, frees_what_is_let_go_of_a_step_at_a_time) {
+  evaluator.getHeap().setReclaimStep(16);
+  run("class Tree {\n"
+      "  init(depth) {\n"
+      "    if (depth > 0) {\n"
+      "      this.left = Tree(depth - 1);\n"
+      "      this.right = Tree(depth - 1);\n"
+      "    }\n"
+      "  }\n"
+      "}\n");
+  run("var tree = Tree(10);\n");
+  run("tree = false;\n");
+  // Only the root has gone: its children (and perhaps the environments of
+  // methods bound while building it) wait for a step.
+  EXPECT_GE(stats().pendingObjects, 2);
+  EXPECT_GT(stats()[ObjectKind::INSTANCE].liveBytes, 0);
+
+  // Each call allocates, and so frees up to 16 more.
+  run("fun f() {}\n");
+  run("for (var i = 0; i < 200; i = i + 1) f();\n");
+  EXPECT_EQ(0, eReporter.getMessages().size());
+  const MemoryStats after = stats();
+  EXPECT_EQ(0, after.pendingObjects);
+  EXPECT_EQ(0, after[ObjectKind::INSTANCE].liveBytes);
+  EXPECT_GE(after.pauses.objects, 2046);
+  EXPECT_GE(after.pauses.steps, 2046 / 16);
+  EXPECT_LE(after.pauses.percentile(0.99), after.pauses.max);
+}
+
+TEST_F(HeapTest, a_long_list_is_freed_without_recursing_down_it) {
+  evaluator.getHeap().setReclaimStep(64);
+  run("class Node { init(next) { this.next = next; } }\n");
+  run("var list = false;\n");
+  run("for (var i = 0; i < 200000; i = i + 1) list = Node(list);\n");
+  run("list = false;\n");
+  EXPECT_EQ(0, eReporter.getMessages().size());
+  EXPECT_GE(stats().pendingObjects, 1);
+  // What's still pending when the evaluator goes is freed then.
+}
+
+TEST_F(HeapTest, frees_what_is_let_go_of_on_a_reclaim_thread) {
+  evaluator.getHeap().setReclaimThread(true);
+  run("class Tree {\n"
+      "  init(depth) {\n"
+      "    if (depth > 0) {\n"
+      "      this.left = Tree(depth - 1);\n"
+      "      this.right = Tree(depth - 1);\n"
+      "    }\n"
+      "  }\n"
+      "}\n");
+  run("var tree = Tree(10);\n");
+  run("tree = false;\n");
+  EXPECT_GT(stats()[ObjectKind::INSTANCE].liveBytes, 0);
+
+  // Calls hand what's pending over, and put back what's been freed.
+  run("fun f() {}\n");
+  run("for (var i = 0; i < 2000; i = i + 1) f();\n");
+  evaluator.getHeap().finishReclaiming();
+  EXPECT_EQ(0, eReporter.getMessages().size());
+  const MemoryStats after = stats();
+  EXPECT_EQ(0, after.pendingObjects);
+  EXPECT_EQ(0, after[ObjectKind::INSTANCE].liveBytes);
+  EXPECT_GE(after.pauses.objects, 2);
+  EXPECT_GT(after.reclaimThreadTime.count(), 0);
+}
+
+TEST_F(HeapTest, a_long_list_is_freed_on_the_reclaim_thread) {
+  evaluator.getHeap().setReclaimThread(true);
+  run("class Node { init(next) { this.next = next; } }\n");
+  run("var list = false;\n");
+  run("for (var i = 0; i < 200000; i = i + 1) list = Node(list);\n");
+  run("list = false;\n");
+  evaluator.getHeap().finishReclaiming();
+  EXPECT_EQ(0, eReporter.getMessages().size());
+  EXPECT_EQ(0, stats()[ObjectKind::INSTANCE].liveBytes);
+  // Turning it off, and back on, leaves it as it was.
+  evaluator.getHeap().setReclaimThread(false);
+  evaluator.getHeap().setReclaimThread(true);
+  run("for (var i = 0; i < 1000; i = i + 1) list = Node(list);\n");
+  run("list = false;\n");
+  EXPECT_EQ(0, eReporter.getMessages().size());
+}
+
+}  // namespace cpplox::Evaluator
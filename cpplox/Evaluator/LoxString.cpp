@@ -0,0 +1,79 @@
+#include "cpplox/Evaluator/LoxString.h"
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+
+namespace cpplox::Evaluator {
+
+LoxString::LoxString() : buffer(makeBuffer()) {}
+
+LoxString::LoxString(std::string str) : buffer(makeBuffer()) {
+  buffer->bytes.assign(str.data(), str.size());
+  length = buffer->bytes.size();
+}
+
+LoxString::LoxString(std::shared_ptr<Storage> buffer, size_t length)
+    : buffer(std::move(buffer)), length(length) {}
+
+auto LoxString::makeBuffer() -> std::shared_ptr<Storage> {
+  return std::allocate_shared<Storage>(
+      Allocator<Storage, ObjectKind::STRING>());
+}
+
+auto LoxString::view() const -> std::string_view {
+  return std::string_view(buffer->bytes.data(), length);
+}
+
+auto LoxString::str() const -> std::string { return std::string(view()); }
+
+auto LoxString::size() const -> size_t { return length; }
+
+auto LoxString::hash() const -> size_t {
+  if (buffer->hashedLength != length) {
+    buffer->hash = std::hash<std::string_view>()(view());
+    buffer->hashedLength = length;
+  }
+  return buffer->hash;
+}
+
+auto LoxString::concat(const LoxString& left, std::string_view right)
+    -> LoxString {
+  // Only the holder whose view ends at the end of the buffer may extend it;
+  // everyone else gets a fresh buffer. So does s + s, as growing the buffer
+  // would invalidate 'right', and a buffer charged to some other heap (or
+  // none, as for strings from the host), so the growth is charged here.
+  const Buffer& buf = left.buffer->bytes;
+  const bool rightAliasesBuffer
+      = std::less_equal<>()(buf.data(), right.data())
+        && std::less<>()(right.data(), buf.data() + buf.capacity());
+  if (buf.size() == left.length && !rightAliasesBuffer
+      && buf.get_allocator() == Buffer::allocator_type()) {
+    left.buffer->bytes.append(right);
+    return LoxString(left.buffer, left.buffer->bytes.size());
+  }
+  std::shared_ptr<Storage> result = makeBuffer();
+  result->bytes.reserve(left.length + right.size());
+  result->bytes.append(left.view());
+  result->bytes.append(right);
+  const size_t length = result->bytes.size();
+  return LoxString(std::move(result), length);
+}
+
+auto LoxString::concat(std::string_view left, const LoxString& right)
+    -> LoxString {
+  std::shared_ptr<Storage> result = makeBuffer();
+  result->bytes.reserve(left.size() + right.length);
+  result->bytes.append(left);
+  result->bytes.append(right.view());
+  const size_t length = result->bytes.size();
+  return LoxString(std::move(result), length);
+}
+
+auto operator==(const LoxString& left, const LoxString& right) -> bool {
+  return left.view() == right.view();
+}
+
+}  // namespace cpplox::Evaluator
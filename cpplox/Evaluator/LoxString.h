@@ -0,0 +1,63 @@
+#ifndef CPPLOX_EVALUATOR_LOXSTRING__H
+#define CPPLOX_EVALUATOR_LOXSTRING__H
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <string_view>
+
+#include "cpplox/Evaluator/Heap.h"
+
+namespace cpplox::Evaluator {
+
+// The runtime representation of a Lox string. Lox strings are immutable, so
+// copies share one buffer and only ever read its first 'length' bytes. That
+// lets concat() append in place whenever the left operand ends where its
+// buffer ends (which is always the case for s = s + piece), making repeated
+// appends amortized O(1) instead of a full copy each time. Other holders of
+// the buffer never see the appended bytes. Flatten with str() or view() when
+// the contents are needed (printing, comparing). Buffers are charged to the
+// current Heap.
+class LoxString {
+ public:
+  LoxString();
+  LoxString(std::string str);  // NOLINT(google-explicit-constructor)
+
+  [[nodiscard]] auto view() const -> std::string_view;
+  [[nodiscard]] auto str() const -> std::string;
+  [[nodiscard]] auto size() const -> size_t;
+  // std::hash of view(). The buffer keeps the last one worked out, so a key
+  // looked up over and over (or by every copy of it) is only hashed once.
+  [[nodiscard]] auto hash() const -> size_t;
+
+  static auto concat(const LoxString& left, std::string_view right)
+      -> LoxString;
+  static auto concat(std::string_view left, const LoxString& right)
+      -> LoxString;
+
+  friend auto operator==(const LoxString& left, const LoxString& right)
+      -> bool;
+
+ private:
+  using Buffer = std::basic_string<char, std::char_traits<char>,
+                                   Allocator<char, ObjectKind::STRING>>;
+
+  // The bytes, and the hash of the first hashedLength of them. Appends never
+  // change bytes a holder can see, so the hash holds until a holder of some
+  // other length asks for one.
+  struct Storage {
+    Buffer bytes;
+    size_t hashedLength = std::string::npos;
+    size_t hash = 0;
+  };
+
+  LoxString(std::shared_ptr<Storage> buffer, size_t length);
+  static auto makeBuffer() -> std::shared_ptr<Storage>;
+
+  std::shared_ptr<Storage> buffer;
+  size_t length = 0;
+};
+
+}  // namespace cpplox::Evaluator
+#endif  // CPPLOX_EVALUATOR_LOXSTRING__H
@@ -1,25 +1,48 @@
 #include "cpplox/Evaluator/Objects.h"
 
+#include <algorithm>
+#include <cmath>
 #include <cstddef>
+#include <functional>
 #include <optional>
+#include <stdexcept>
+#include <string_view>
 #include <type_traits>
 #include <utility>
 #include <variant>
 
 #include "cpplox/ErrorsAndDebug/RuntimeError.h"
+#include "cpplox/Types/Number.h"
 
 namespace cpplox::Evaluator {
 
 // FuncObj
-FuncObj::FuncObj(const AST::FuncExprPtr& declaration, std::string funcName,
+FuncObj::FuncObj(std::shared_ptr<const AST::FuncExpr> declaration,
+                 std::string funcName,
                  std::shared_ptr<Environment> closure, bool isMethod,
                  bool isInitializer)
-    : declaration(declaration),
+    : declaration(std::move(declaration)),
       funcName(std::move(funcName)),
       closure(std::move(closure)),
       isMethod(isMethod),
       isInitializer(isInitializer) {}
 
+FuncObj::FuncObj(std::shared_ptr<const FlatProgram> flatProgram,
+                 AST::Index flatFunction, std::string funcName,
+                 std::shared_ptr<Environment> closure, bool isMethod,
+                 bool isInitializer)
+    : declaration(flatProgram->declarations[flatFunction]),
+      flatProgram(std::move(flatProgram)),
+      flatFunction(flatFunction),
+      funcName(std::move(funcName)),
+      closure(std::move(closure)),
+      isMethod(isMethod),
+      isInitializer(isInitializer) {}
+
+FuncObj::~FuncObj() {
+  if (Heap* heap = Heap::deferring()) deferRelease(*heap, closure);
+}
+
 auto FuncObj::arity() const -> size_t { return declaration->parameters.size(); }
 
 auto FuncObj::getParams() const -> const std::vector<Types::Token>& {
@@ -30,13 +53,22 @@ auto FuncObj::getClosure() const -> std::shared_ptr<Environment> {
   return closure;
 }
 
-auto FuncObj::getDecl() const -> const AST::FuncExprPtr& { return declaration; }
+auto FuncObj::getDecl() const -> const std::shared_ptr<const AST::FuncExpr>& {
+  return declaration;
+}
 
 auto FuncObj::getFnBodyStmts() const
     -> const std::vector<AST::StmtPtrVariant>& {
-  return declaration->body;
+  return declaration->getBody();
 }
 
+auto FuncObj::getFlatProgram() const
+    -> const std::shared_ptr<const FlatProgram>& {
+  return flatProgram;
+}
+
+auto FuncObj::getFlatFunction() const -> AST::Index { return flatFunction; }
+
 auto FuncObj::getFnName() const -> const std::string& { return funcName; }
 
 auto FuncObj::getIsMethod() const -> bool { return isMethod; }
@@ -57,12 +89,29 @@ LoxClass::LoxClass(
     methods.insert_or_assign(hasher(mPair.first), mPair.second);
 }
 
+LoxClass::LoxClass(std::string name, std::optional<LoxClassShrdPtr> superClass,
+                   Members<ObjectKind::CLASS> methods)
+    : className(std::move(name)),
+      superClass(std::move(superClass)),
+      methods(std::move(methods)) {}
+
+LoxClass::~LoxClass() {
+  if (Heap* heap = Heap::deferring()) {
+    if (superClass.has_value()) deferRelease(*heap, superClass.value());
+    for (auto& method : methods) deferRelease(*heap, method.second);
+  }
+}
+
 auto LoxClass::getClassName() -> std::string { return className; }
 
 auto LoxClass::getSuperClass() -> std::optional<LoxClassShrdPtr> {
   return superClass;
 }
 
+auto LoxClass::getMethods() const -> const Members<ObjectKind::CLASS>& {
+  return methods;
+}
+
 auto LoxClass::findMethod(const std::string& methodName)
     -> std::optional<LoxObject> {
   auto iter = methods.find(hasher(methodName));
@@ -78,6 +127,12 @@ auto LoxClass::findMethod(const std::string& methodName)
 // LoxInstance
 LoxInstance::LoxInstance(LoxClassShrdPtr klass) : klass(std::move(klass)) {}
 
+// The class is all but always shared, so it isn't worth deferring.
+LoxInstance::~LoxInstance() {
+  if (Heap* heap = Heap::deferring())
+    for (auto& field : fields) deferRelease(*heap, field.second);
+}
+
 auto LoxInstance::toString() -> std::string {
   return "Instance of " + klass->getClassName();
 }
@@ -97,12 +152,201 @@ void LoxInstance::set(const std::string& propName, LoxObject value) {
   fields[hasher(propName)] = std::move(value);
 }
 
+auto LoxInstance::getClass() const -> const LoxClassShrdPtr& { return klass; }
+
+auto LoxInstance::getFields() const -> const Members<ObjectKind::INSTANCE>& {
+  return fields;
+}
+
+void LoxInstance::setField(size_t hashedName, LoxObject value) {
+  fields[hashedName] = std::move(value);
+}
+
+// LoxMap
+namespace {
+constexpr uint64_t EMPTY_SLOT = 0;
+constexpr uint64_t TOMBSTONE = 1;
+constexpr size_t MIN_CAPACITY = 8;
+
+// splitmix64's finalizer; std::hash is the identity for pointers and integral
+// doubles hash poorly into a power-of-two table without it.
+auto mix(uint64_t h) -> uint64_t {
+  h ^= h >> 30U;
+  h *= 0xbf58476d1ce4e5b9ULL;
+  h ^= h >> 27U;
+  h *= 0x94d049bb133111ebULL;
+  h ^= h >> 31U;
+  return h;
+}
+}  // namespace
+
+LoxMap::~LoxMap() {
+  if (Heap* heap = Heap::deferring()) {
+    for (Entry& entry : entries) {
+      deferRelease(*heap, entry.key);
+      deferRelease(*heap, entry.value);
+    }
+  }
+}
+
+auto LoxMap::hashKey(const LoxObject& key) -> uint64_t {
+  uint64_t h = 0;
+  switch (key.index()) {
+    case 0:  // string
+      h = std::get<LoxString>(key).hash();
+      break;
+    case 1: {  // double
+      double d = std::get<double>(key);
+      if (std::isnan(d)) throw std::runtime_error("NaN can't be a Map key.");
+      h = std::hash<double>{}(d == 0.0 ? 0.0 : d);  // -0 and 0 are one key
+      break;
+    }
+    case 2:  // bool
+      h = std::get<bool>(key) ? 0x9e3779b97f4a7c15ULL : 0x7f4a7c159e3779b9ULL;
+      break;
+    case 3:  // std::nullptr_t
+      throw std::runtime_error("nil can't be a Map key.");
+    default:  // everything else is a reference; hash the identity.
+      h = std::visit(
+          [](const auto& obj) -> uint64_t {
+            using T = std::decay_t<decltype(obj)>;
+            if constexpr (std::is_same_v<T, LoxString>
+                          || std::is_same_v<T, double>
+                          || std::is_same_v<T, bool>
+                          || std::is_same_v<T, std::nullptr_t>)
+              return 0;
+            else
+              return std::hash<const void*>{}(obj.get());
+          },
+          key);
+  }
+  // Reserve 0 for empty slots and 1 for tombstones.
+  h = mix(h);
+  return h > TOMBSTONE ? h : h + 2;
+}
+
+auto LoxMap::keysEqual(const LoxObject& left, const LoxObject& right) -> bool {
+  if (left.index() != right.index()) return false;
+  switch (left.index()) {
+    case 0: return std::get<LoxString>(left) == std::get<LoxString>(right);
+    case 1: return std::get<double>(left) == std::get<double>(right);
+    case 2: return std::get<bool>(left) == std::get<bool>(right);
+    default:
+      return std::visit(
+          [&](const auto& obj) -> bool {
+            using T = std::decay_t<decltype(obj)>;
+            if constexpr (std::is_same_v<T, LoxString>
+                          || std::is_same_v<T, double>
+                          || std::is_same_v<T, bool>
+                          || std::is_same_v<T, std::nullptr_t>)
+              return false;
+            else
+              return obj.get() == std::get<T>(right).get();
+          },
+          left);
+  }
+}
+
+// Returns the index of the live slot holding key, or meta.size() if absent.
+auto LoxMap::findLive(const LoxObject& key, uint64_t tag) const -> size_t {
+  if (meta.empty()) return 0;
+  const size_t mask = meta.size() - 1;
+  for (size_t i = tag & mask;; i = (i + 1) & mask) {
+    if (meta[i] == EMPTY_SLOT) return meta.size();
+    if (meta[i] == tag && keysEqual(entries[i].key, key)) return i;
+  }
+}
+
+void LoxMap::rehash(size_t newCapacity) {
+  // The new arrays are charged to the Heap the map was made in.
+  decltype(meta) oldMeta(newCapacity, EMPTY_SLOT, meta.get_allocator());
+  decltype(entries) oldEntries(newCapacity, entries.get_allocator());
+  oldMeta.swap(meta);
+  oldEntries.swap(entries);
+  const size_t mask = newCapacity - 1;
+  for (size_t j = 0; j < oldMeta.size(); ++j) {
+    if (oldMeta[j] == EMPTY_SLOT || oldMeta[j] == TOMBSTONE) continue;
+    size_t i = oldMeta[j] & mask;
+    while (meta[i] != EMPTY_SLOT) i = (i + 1) & mask;
+    meta[i] = oldMeta[j];
+    entries[i] = std::move(oldEntries[j]);
+  }
+  usedCount = liveCount;
+}
+
+auto LoxMap::get(const LoxObject& key) -> LoxObject {
+  size_t i = findLive(key, hashKey(key));
+  return i < meta.size() ? entries[i].value : LoxObject(nullptr);
+}
+
+auto LoxMap::contains(const LoxObject& key) -> bool {
+  return findLive(key, hashKey(key)) < meta.size();
+}
+
+void LoxMap::set(const LoxObject& key, LoxObject value) {
+  const uint64_t tag = hashKey(key);
+  if (size_t i = findLive(key, tag); i < meta.size()) {
+    entries[i].value = std::move(value);
+    return;
+  }
+  // Keep the load factor (tombstones included) at or below 3/4.
+  if ((usedCount + 1) * 4 > meta.size() * 3) {
+    size_t capacity = std::max(meta.size(), MIN_CAPACITY);
+    while ((liveCount + 1) * 2 > capacity) capacity *= 2;
+    rehash(capacity);
+  }
+  const size_t mask = meta.size() - 1;
+  size_t i = tag & mask;
+  while (meta[i] != EMPTY_SLOT && meta[i] != TOMBSTONE) i = (i + 1) & mask;
+  if (meta[i] == EMPTY_SLOT) ++usedCount;
+  meta[i] = tag;
+  entries[i] = Entry{key, std::move(value)};
+  ++liveCount;
+}
+
+auto LoxMap::remove(const LoxObject& key) -> bool {
+  size_t i = findLive(key, hashKey(key));
+  if (i == meta.size()) return false;
+  meta[i] = TOMBSTONE;
+  entries[i] = Entry{nullptr, nullptr};
+  --liveCount;
+  return true;
+}
+
+auto LoxMap::isLive(size_t slot) const -> bool {
+  return slot >= 1 && slot <= meta.size() && meta[slot - 1] != EMPTY_SLOT
+         && meta[slot - 1] != TOMBSTONE;
+}
+
+auto LoxMap::nextSlot(size_t slot) const -> size_t {
+  for (size_t i = slot + 1; i <= meta.size(); ++i) {
+    if (isLive(i)) return i;
+  }
+  return 0;
+}
+
+auto LoxMap::keyAt(size_t slot) const -> const LoxObject& {
+  if (!isLive(slot)) throw std::runtime_error("No Map entry at that slot.");
+  return entries[slot - 1].key;
+}
+
+auto LoxMap::valueAt(size_t slot) const -> const LoxObject& {
+  if (!isLive(slot)) throw std::runtime_error("No Map entry at that slot.");
+  return entries[slot - 1].value;
+}
+
+auto LoxMap::size() const -> size_t { return liveCount; }
+
+auto LoxMap::toString() -> std::string {
+  return "Map of " + std::to_string(liveCount) + " entries";
+}
+
 // LoxObject Functions
 auto areEqual(const LoxObject& left, const LoxObject& right) -> bool {
   if (left.index() == right.index()) {
     switch (left.index()) {
       case 0:  // string
-        return std::get<std::string>(left) == std::get<std::string>(right);
+        return std::get<LoxString>(left) == std::get<LoxString>(right);
       case 1:  // double
         return std::get<double>(left) == std::get<double>(right);
       case 2:  // bool
@@ -123,8 +367,11 @@ auto areEqual(const LoxObject& left, const LoxObject& right) -> bool {
       case 7:  // LoxInstanceShrdPtr
         return std::get<LoxInstanceShrdPtr>(left).get()
                == std::get<LoxInstanceShrdPtr>(right).get();
+      case 8:  // LoxMapShrdPtr
+        return std::get<LoxMapShrdPtr>(left).get()
+               == std::get<LoxMapShrdPtr>(right).get();
       default:
-        static_assert(std::variant_size_v<LoxObject> == 8,
+        static_assert(std::variant_size_v<LoxObject> == 9,
                       "Looks like you forgot to update the cases in "
                       "ExprEvaluator::areEqual(const LoxObject&, const "
                       "LoxObject&)!");
@@ -136,16 +383,9 @@ auto areEqual(const LoxObject& left, const LoxObject& right) -> bool {
 auto getObjectString(const LoxObject& object) -> std::string {
   switch (object.index()) {
     case 0:  // string
-      return std::get<0>(object);
-    case 1: {  // double
-      std::string result = std::to_string(std::get<1>(object));
-      auto pos = result.find(".000000");
-      if (pos != std::string::npos)
-        result.erase(pos, std::string::npos);
-      else
-        result.erase(result.find_last_not_of('0') + 1, std::string::npos);
-      return result;
-    }
+      return std::get<0>(object).str();
+    case 1:  // double
+      return Types::formatNumber(std::get<1>(object));
     case 2:  // bool
       return std::get<2>(object) == true ? "true" : "false";
     case 3:  // nullptr
@@ -158,14 +398,45 @@ auto getObjectString(const LoxObject& object) -> std::string {
       return std::get<LoxClassShrdPtr>(object)->getClassName();
     case 7:  // LoxInstanceShrdPtr
       return std::get<LoxInstanceShrdPtr>(object)->toString();
+    case 8:  // LoxMapShrdPtr
+      return std::get<LoxMapShrdPtr>(object)->toString();
     default:
-      static_assert(std::variant_size_v<LoxObject> == 8,
+      static_assert(std::variant_size_v<LoxObject> == 9,
                     "Looks like you forgot to update the cases in "
                     "getLiteralString()!");
       return "";
   }
 }
 
+void writeObject(Output::OutputBuffer& out, const LoxObject& object) {
+  switch (object.index()) {
+    case 0:  // string
+      out.write(std::get<0>(object).view());
+      return;
+    case 1:  // double
+      out.writeNumber(std::get<1>(object));
+      return;
+    default:
+      out.write(getObjectString(object));
+      return;
+  }
+}
+
+void deferRelease(Heap& heap, LoxObject& object) {
+  std::visit(
+      [&](auto& value) {
+        using Value = std::decay_t<decltype(value)>;
+        // Strings hold nothing else, so they're as quick to free now.
+        if constexpr (std::is_same_v<Value, FuncShrdPtr>
+                      || std::is_same_v<Value, BuiltinFuncShrdPtr>
+                      || std::is_same_v<Value, LoxClassShrdPtr>
+                      || std::is_same_v<Value, LoxInstanceShrdPtr>
+                      || std::is_same_v<Value, LoxMapShrdPtr>)
+          deferRelease(heap, value);
+      },
+      object);
+}
+
 auto isTrue(const LoxObject& object) -> bool {
   if (std::holds_alternative<std::nullptr_t>(object)) return false;
   if (std::holds_alternative<bool>(object)) return std::get<bool>(object);
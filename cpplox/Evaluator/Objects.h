@@ -3,12 +3,21 @@
 #include <optional>
 #pragma once
 
+#include <cstdint>
+#include <functional>
 #include <map>
 #include <memory>
 #include <string>
+#include <type_traits>
+#include <utility>
 #include <variant>
+#include <vector>
 
 #include "cpplox/AST/NodeTypes.h"
+#include "cpplox/Evaluator/FlatProgram.h"
+#include "cpplox/Evaluator/Heap.h"
+#include "cpplox/Evaluator/LoxString.h"
+#include "cpplox/Output/OutputBuffer.h"
 #include "cpplox/Types/Token.h"
 #include "cpplox/Types/Uncopyable.h"
 
@@ -25,35 +34,72 @@ using LoxClassShrdPtr = std::shared_ptr<LoxClass>;
 class LoxInstance;
 using LoxInstanceShrdPtr = std::shared_ptr<LoxInstance>;
 
+class LoxMap;
+using LoxMapShrdPtr = std::shared_ptr<LoxMap>;
+
 using LoxObject
-    = std::variant<std::string, double, bool, std::nullptr_t, FuncShrdPtr,
-                   BuiltinFuncShrdPtr, LoxClassShrdPtr, LoxInstanceShrdPtr>;
+    = std::variant<LoxString, double, bool, std::nullptr_t, FuncShrdPtr,
+                   BuiltinFuncShrdPtr, LoxClassShrdPtr, LoxInstanceShrdPtr,
+                   LoxMapShrdPtr>;
+
+// Variables, fields or methods keyed by their hashed names, charged to the
+// current Heap as Kind.
+template <ObjectKind Kind>
+using Members = std::map<size_t, LoxObject, std::less<size_t>,
+                         Allocator<std::pair<const size_t, LoxObject>, Kind>>;
 
 auto areEqual(const LoxObject& left, const LoxObject& right) -> bool;
 
 auto getObjectString(const LoxObject& object) -> std::string;
+// Same as getObjectString, but formats strings and numbers straight into out.
+void writeObject(Output::OutputBuffer& out, const LoxObject& object);
 
 auto isTrue(const LoxObject& object) -> bool;
 
+// For the destructors of objects that hold others: hands object over to
+// heap if this is the last reference to it, so it's freed in a later step
+// rather than along with its holder. See Heap::setReclaimStep.
+template <typename T>
+void deferRelease(Heap& heap, std::shared_ptr<T>& object) {
+  if (object != nullptr && object.use_count() == 1)
+    heap.defer(std::move(object));
+}
+void deferRelease(Heap& heap, LoxObject& object);
+
 class Environment;
 
 class FuncObj : public Types::Uncopyable {
-  const AST::FuncExprPtr& declaration;
+  // Keeps the tree the function was declared in alive; see FuncExpr::share.
+  std::shared_ptr<const AST::FuncExpr> declaration;
+  // Set for a function declared in a FlatProgram, whose body is its function
+  // flatFunction.
+  std::shared_ptr<const FlatProgram> flatProgram;
+  AST::Index flatFunction = AST::NO_INDEX;
   const std::string funcName;
   std::shared_ptr<Environment> closure;
   bool isMethod;
   bool isInitializer;
 
  public:
-  explicit FuncObj(const AST::FuncExprPtr& declaration, std::string funcName,
-                   std::shared_ptr<Environment> closure, bool isMethod = false,
-                   bool isInitializer = false);
+  explicit FuncObj(std::shared_ptr<const AST::FuncExpr> declaration,
+                   std::string funcName, std::shared_ptr<Environment> closure,
+                   bool isMethod = false, bool isInitializer = false);
+  // The function flatProgram's function flatFunction was flattened from.
+  FuncObj(std::shared_ptr<const FlatProgram> flatProgram,
+          AST::Index flatFunction, std::string funcName,
+          std::shared_ptr<Environment> closure, bool isMethod = false,
+          bool isInitializer = false);
+  ~FuncObj() override;
 
   [[nodiscard]] auto arity() const -> size_t;
   [[nodiscard]] auto getClosure() const -> std::shared_ptr<Environment>;
-  [[nodiscard]] auto getDecl() const -> const AST::FuncExprPtr&;
+  [[nodiscard]] auto getDecl() const
+      -> const std::shared_ptr<const AST::FuncExpr>&;
   [[nodiscard]] auto getFnBodyStmts() const
       -> const std::vector<AST::StmtPtrVariant>&;
+  [[nodiscard]] auto getFlatProgram() const
+      -> const std::shared_ptr<const FlatProgram>&;
+  [[nodiscard]] auto getFlatFunction() const -> AST::Index;
   [[nodiscard]] auto getFnName() const -> const std::string&;
   [[nodiscard]] auto getIsMethod() const -> bool;
   [[nodiscard]] auto getIsInitializer() const -> bool;
@@ -69,7 +115,9 @@ class BuiltinFunc : public Types::Uncopyable {
                        std::shared_ptr<Environment> closure);
 
   virtual auto arity() -> size_t = 0;
-  virtual auto run() -> LoxObject = 0;
+  // Builtins signal bad arguments by throwing std::runtime_error; the
+  // Evaluator reports the message against the call site.
+  virtual auto run(const std::vector<LoxObject>& args) -> LoxObject = 0;
   virtual auto getFnName() -> std::string = 0;
 };
 
@@ -77,31 +125,113 @@ class LoxClass : public Types::Uncopyable {
   const std::string className;
   std::optional<LoxClassShrdPtr> superClass;
   std::hash<std::string> hasher;
-  std::map<size_t, LoxObject> methods;
+  Members<ObjectKind::CLASS> methods;
 
  public:
   explicit LoxClass(
       std::string name, std::optional<LoxClassShrdPtr> superClass,
       const std::vector<std::pair<std::string, LoxObject>>& methodPairs);
+  // With the methods keyed by their hashed names, as getMethods() has them.
+  LoxClass(std::string name, std::optional<LoxClassShrdPtr> superClass,
+           Members<ObjectKind::CLASS> methods);
+  ~LoxClass() override;
 
   auto getClassName() -> std::string;
   auto getSuperClass() -> std::optional<LoxClassShrdPtr>;
+  [[nodiscard]] auto getMethods() const -> const Members<ObjectKind::CLASS>&;
   auto findMethod(const std::string& methodName) -> std::optional<LoxObject>;
 };
 
 class LoxInstance : public Types::Uncopyable {
   const LoxClassShrdPtr klass;
   std::hash<std::string> hasher;
-  std::map<size_t, LoxObject> fields;
+  Members<ObjectKind::INSTANCE> fields;
 
  public:
   explicit LoxInstance(LoxClassShrdPtr klass);
+  ~LoxInstance() override;
 
   auto toString() -> std::string;
   auto get(const std::string& propName) -> LoxObject;
   void set(const std::string& propName, LoxObject value);
+
+  // Fields keyed by their hashed names.
+  [[nodiscard]] auto getClass() const -> const LoxClassShrdPtr&;
+  [[nodiscard]] auto getFields() const
+      -> const Members<ObjectKind::INSTANCE>&;
+  void setField(size_t hashedName, LoxObject value);
+};
+
+// An open-addressing hash table keyed by strings, numbers, booleans and object
+// identities. Probing only touches the dense 'meta' array of cached hashes;
+// keys are compared only when the hashes match.
+// Iteration walks slot positions: slots don't move until a set() grows or
+// purges the table, so deleting entries mid-iteration is fine.
+class LoxMap : public Types::Uncopyable {
+ public:
+  LoxMap() = default;
+  ~LoxMap() override;
+
+  // All of these throw std::runtime_error if the key is nil or NaN.
+  auto get(const LoxObject& key) -> LoxObject;  // nil if key isn't present
+  void set(const LoxObject& key, LoxObject value);
+  auto remove(const LoxObject& key) -> bool;
+  auto contains(const LoxObject& key) -> bool;
+
+  // Slots are numbered from 1. Returns the first live slot after 'slot' (pass
+  // 0 to start), or 0 once there are no more. keyAt/valueAt throw
+  // std::runtime_error for any slot that isn't live.
+  [[nodiscard]] auto nextSlot(size_t slot) const -> size_t;
+  [[nodiscard]] auto keyAt(size_t slot) const -> const LoxObject&;
+  [[nodiscard]] auto valueAt(size_t slot) const -> const LoxObject&;
+  [[nodiscard]] auto size() const -> size_t;
+  auto toString() -> std::string;
+
+ private:
+  struct Entry {
+    LoxObject key;
+    LoxObject value;
+  };
+
+  static auto hashKey(const LoxObject& key) -> uint64_t;
+  static auto keysEqual(const LoxObject& left, const LoxObject& right) -> bool;
+  auto findLive(const LoxObject& key, uint64_t tag) const -> size_t;
+  [[nodiscard]] auto isLive(size_t slot) const -> bool;
+  void rehash(size_t newCapacity);
+
+  // 0: empty, 1: deleted, else the key hash
+  std::vector<uint64_t, Allocator<uint64_t, ObjectKind::MAP>> meta;
+  std::vector<Entry, Allocator<Entry, ObjectKind::MAP>> entries;
+  size_t liveCount = 0;
+  size_t usedCount = 0;  // live + tombstones
 };
 
+template <typename T>
+constexpr auto kindOf() -> ObjectKind {
+  if constexpr (std::is_same_v<T, Environment>) {
+    return ObjectKind::ENVIRONMENT;
+  } else if constexpr (std::is_same_v<T, LoxClass>) {
+    return ObjectKind::CLASS;
+  } else if constexpr (std::is_same_v<T, LoxInstance>) {
+    return ObjectKind::INSTANCE;
+  } else if constexpr (std::is_same_v<T, LoxMap>) {
+    return ObjectKind::MAP;
+  } else {
+    static_assert(
+        std::is_same_v<T, FuncObj> || std::is_base_of_v<BuiltinFunc, T>,
+        "not a runtime object");
+    return ObjectKind::FUNCTION;
+  }
+}
+
+// Makes a runtime object, charged to the current Heap. Every object the
+// Evaluator makes is made with this.
+template <typename T, typename... Args>
+auto makeObject(Args&&... args) -> std::shared_ptr<T> {
+  return std::allocate_shared<T>(Allocator<T, kindOf<T>()>(),
+                                 std::forward<Args>(args)...);
+}
+
 }  // namespace cpplox::Evaluator
 
 #endif  // CPPLOX_EVALUATOR_FUNCTION__H
\ No newline at end of file
@@ -0,0 +1,124 @@
+#include "gtest/gtest.h"
+
+#include <cmath>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <variant>
+
+#include "cpplox/Evaluator/Objects.h"
+
+namespace cpplox::Evaluator {
+
+TEST(LoxStringTest, appends_dont_leak_into_other_copies) {
+  LoxString base("abc");
+  LoxString copy = base;
+  LoxString first = LoxString::concat(base, "def");
+  LoxString second = LoxString::concat(base, "xyz");
+  LoxString third = LoxString::concat(first, "!");
+  EXPECT_EQ("abc", base.str());
+  EXPECT_EQ("abc", copy.str());
+  EXPECT_EQ("abcdef", first.str());
+  EXPECT_EQ("abcxyz", second.str());
+  EXPECT_EQ("abcdef!", third.str());
+  EXPECT_EQ("--abc", LoxString::concat("--", base).str());
+}
+
+TEST(LoxStringTest, self_concatenation) {
+  LoxString str("ab");
+  for (int i = 0; i < 10; ++i) str = LoxString::concat(str, str.view());
+  EXPECT_EQ(2048, str.size());
+  EXPECT_EQ(std::string(1024, 'a'), [&] {
+    std::string evens;
+    for (size_t i = 0; i < str.size(); i += 2) evens += str.view()[i];
+    return evens;
+  }());
+}
+
+TEST(LoxStringTest, equality_compares_contents) {
+  LoxString left = LoxString::concat(LoxString("foo"), "bar");
+  EXPECT_TRUE(left == LoxString("foobar"));
+  EXPECT_FALSE(left == LoxString("foo"));
+}
+
+TEST(LoxStringTest, hash_follows_each_holders_length) {
+  LoxString base("abc");
+  LoxString longer = LoxString::concat(base, "def");
+  const std::hash<std::string_view> hasher;
+  for (int i = 0; i < 2; ++i) {
+    EXPECT_EQ(hasher("abc"), base.hash());
+    EXPECT_EQ(hasher("abcdef"), longer.hash());
+  }
+  EXPECT_EQ(LoxString("abcdef").hash(), longer.hash());
+}
+
+TEST(LoxMapTest, set_get_overwrite) {
+  LoxMap map;
+  map.set(LoxObject(std::string("apple")), LoxObject(1.0));
+  map.set(LoxObject(2.0), LoxObject(std::string("two")));
+  map.set(LoxObject(true), LoxObject(3.0));
+  map.set(LoxObject(std::string("apple")), LoxObject(4.0));
+  EXPECT_EQ(3, map.size());
+  EXPECT_EQ(4.0, std::get<double>(map.get(LoxObject(std::string("apple")))));
+  EXPECT_EQ("two", std::get<LoxString>(map.get(LoxObject(2.0))).str());
+  EXPECT_EQ(3.0, std::get<double>(map.get(LoxObject(true))));
+  EXPECT_TRUE(
+      std::holds_alternative<std::nullptr_t>(map.get(LoxObject(false))));
+}
+
+TEST(LoxMapTest, numbers_and_strings_are_distinct_keys) {
+  LoxMap map;
+  map.set(LoxObject(1.0), LoxObject(1.0));
+  map.set(LoxObject(std::string("1")), LoxObject(2.0));
+  map.set(LoxObject(-0.0), LoxObject(3.0));
+  EXPECT_EQ(1.0, std::get<double>(map.get(LoxObject(1.0))));
+  EXPECT_EQ(2.0, std::get<double>(map.get(LoxObject(std::string("1")))));
+  EXPECT_EQ(3.0, std::get<double>(map.get(LoxObject(0.0))));
+}
+
+TEST(LoxMapTest, object_keys_use_identity) {
+  LoxMap map;
+  auto first = std::make_shared<LoxMap>();
+  auto second = std::make_shared<LoxMap>();
+  map.set(LoxObject(first), LoxObject(1.0));
+  EXPECT_TRUE(map.contains(LoxObject(first)));
+  EXPECT_FALSE(map.contains(LoxObject(second)));
+}
+
+TEST(LoxMapTest, remove_and_grow) {
+  LoxMap map;
+  for (int i = 0; i < 1000; ++i) map.set(LoxObject(double(i)), LoxObject(1.0));
+  for (int i = 0; i < 1000; i += 2)
+    EXPECT_TRUE(map.remove(LoxObject(double(i))));
+  EXPECT_FALSE(map.remove(LoxObject(0.0)));
+  EXPECT_EQ(500, map.size());
+  for (int i = 0; i < 1000; ++i)
+    EXPECT_EQ(i % 2 == 1, map.contains(LoxObject(double(i))));
+}
+
+TEST(LoxMapTest, slots_visit_every_key_once_even_when_deleting) {
+  LoxMap map;
+  for (int i = 0; i < 100; ++i) map.set(LoxObject(double(i)), LoxObject(1.0));
+  double sum = 0;
+  int visited = 0;
+  for (size_t slot = map.nextSlot(0); slot != 0; slot = map.nextSlot(slot)) {
+    sum += std::get<double>(map.keyAt(slot));
+    ++visited;
+    map.remove(map.keyAt(slot));
+  }
+  EXPECT_EQ(100, visited);
+  EXPECT_EQ(4950.0, sum);
+  EXPECT_EQ(0, map.size());
+}
+
+TEST(LoxMapTest, invalid_keys_throw) {
+  LoxMap map;
+  EXPECT_THROW(map.set(LoxObject(nullptr), LoxObject(1.0)),
+               std::runtime_error);
+  EXPECT_THROW(map.get(LoxObject(std::nan(""))), std::runtime_error);
+  EXPECT_THROW(static_cast<void>(map.keyAt(1)), std::runtime_error);
+}
+
+}  // namespace cpplox::Evaluator
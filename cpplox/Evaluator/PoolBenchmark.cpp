@@ -0,0 +1,77 @@
+// How the Heap's pools compare with going to malloc for every object:
+// binary_trees.lox, which makes and drops millions of instances, methods
+// bound to them and environments for their calls, run on a pooled Heap and
+// then on one that isn't. Run with:
+//   bazel run -c opt //cpplox/Evaluator:pool_benchmark -- [rounds]
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "cpplox/AST/NodeTypes.h"
+#include "cpplox/ErrorsAndDebug/ErrorReporter.h"
+#include "cpplox/Evaluator/Evaluator.h"
+#include "cpplox/Evaluator/Heap.h"
+#include "cpplox/Output/OutputBuffer.h"
+#include "cpplox/Parser/Parser.h"
+#include "cpplox/Scanner/Scanner.h"
+
+namespace {
+
+const char* const SCRIPT = "sample-lox-programs/benchmark/binary_trees.lox";
+
+struct Run {
+  double seconds;
+  cpplox::Evaluator::MemoryStats stats;
+};
+
+auto timeRun(const std::string& source, bool pooled) -> Run {
+  cpplox::ErrorsAndDebug::ErrorReporter eReporter;
+  const cpplox::Types::TokenList tokens
+      = cpplox::Scanner(source, eReporter).tokenize();
+  const std::vector<cpplox::AST::StmtPtrVariant> program
+      = cpplox::Parser::RDParser(tokens, eReporter).parse();
+  cpplox::Evaluator::Evaluator evaluator(
+      eReporter, new cpplox::Evaluator::Heap(pooled));
+  std::string printed;
+  cpplox::Output::OutputBuffer out(printed);
+  cpplox::Output::Redirect redirect(out, out);
+  const auto start = std::chrono::steady_clock::now();
+  evaluator.evaluateStmts(program);
+  return {std::chrono::duration<double>(std::chrono::steady_clock::now()
+                                        - start)
+              .count(),
+          evaluator.getHeap().getStats()};
+}
+
+}  // namespace
+
+auto main(int argc, char const* argv[]) -> int {
+  const int rounds = argc > 1 ? std::atoi(argv[1]) : 3;
+  std::ifstream file(SCRIPT);
+  if (!file) {
+    std::cerr << "Can't read " << SCRIPT << '\n';
+    return 1;
+  }
+  std::ostringstream source;
+  source << file.rdbuf();
+
+  // Alternate, so drift in the machine's speed hits both alike.
+  Run pooled{1e9, {}};
+  Run unpooled{1e9, {}};
+  for (int round = 0; round < rounds; ++round) {
+    const Run withPools = timeRun(source.str(), true);
+    if (withPools.seconds < pooled.seconds) pooled = withPools;
+    const Run withMalloc = timeRun(source.str(), false);
+    if (withMalloc.seconds < unpooled.seconds) unpooled = withMalloc;
+  }
+  std::cout << "binary_trees.lox: " << pooled.seconds * 1e3
+            << " ms pooled, " << unpooled.seconds * 1e3 << " ms with malloc ("
+            << (pooled.seconds / unpooled.seconds - 1) * 100 << "%)\n"
+            << "peak live " << pooled.stats.total.peakBytes << " bytes, in "
+            << pooled.stats.slabBytes << " bytes of slabs\n";
+  return 0;
+}
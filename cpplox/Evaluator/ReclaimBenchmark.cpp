@@ -0,0 +1,134 @@
+// How long letting go of a large structure pauses a script, freeing it all
+// at once, a step at a time and on a reclaim thread: a tree of 2^17
+// instances dropped by one statement, then binary_trees.lox as a whole.
+// Run with:
+//   bazel run -c opt //cpplox/Evaluator:reclaim_benchmark -- [step]
+#include <chrono>
+#include <cstdlib>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "cpplox/AST/NodeTypes.h"
+#include "cpplox/ErrorsAndDebug/ErrorReporter.h"
+#include "cpplox/Evaluator/Evaluator.h"
+#include "cpplox/Evaluator/Heap.h"
+#include "cpplox/Output/OutputBuffer.h"
+#include "cpplox/Parser/Parser.h"
+#include "cpplox/Scanner/Scanner.h"
+
+namespace {
+
+const char* const SCRIPT = "sample-lox-programs/benchmark/binary_trees.lox";
+
+const char* const TREE
+    = "class Tree {\n"
+      "  init(depth) {\n"
+      "    if (depth > 0) {\n"
+      "      this.left = Tree(depth - 1);\n"
+      "      this.right = Tree(depth - 1);\n"
+      "    }\n"
+      "  }\n"
+      "}\n"
+      "var tree = Tree(16);\n";
+
+// How a Heap frees what's let go of: all at once (step 0 and no thread), at
+// most step objects at a time, or on a reclaim thread.
+struct Mode {
+  size_t step;
+  bool thread;
+};
+
+// Runs sources one after another in an evaluator, with the Heap freeing as
+// mode has it.
+class Runner {
+ public:
+  explicit Runner(Mode mode) {
+    evaluator.getHeap().setReclaimStep(mode.step);
+    evaluator.getHeap().setReclaimThread(mode.thread);
+  }
+
+  // Seconds source took to run.
+  auto run(const std::string& source) -> double {
+    sources.push_back(source);
+    const cpplox::Types::TokenList tokens
+        = cpplox::Scanner(sources.back(), eReporter).tokenize();
+    programs.push_back(cpplox::Parser::RDParser(tokens, eReporter).parse());
+    const auto start = std::chrono::steady_clock::now();
+    evaluator.evaluateStmts(programs.back());
+    return std::chrono::duration<double>(std::chrono::steady_clock::now()
+                                         - start)
+        .count();
+  }
+
+  auto stats() -> cpplox::Evaluator::MemoryStats {
+    return evaluator.getHeap().getStats();
+  }
+
+ private:
+  std::string printed;
+  cpplox::Output::OutputBuffer out{printed};
+  cpplox::Output::Redirect redirect{out, out};
+  // Deques, so that earlier sources and trees stay where functions and
+  // classes declared in them point; the evaluator goes first.
+  std::deque<std::string> sources;
+  std::deque<std::vector<cpplox::AST::StmtPtrVariant>> programs;
+  cpplox::ErrorsAndDebug::ErrorReporter eReporter;
+  cpplox::Evaluator::Evaluator evaluator{eReporter};
+};
+
+void report(const char* what, Mode mode, double seconds,
+            const cpplox::Evaluator::MemoryStats& stats) {
+  std::cout << "  " << what << ", ";
+  if (mode.thread) {
+    std::cout << "on a reclaim thread: ";
+  } else if (mode.step != 0) {
+    std::cout << mode.step << " at a time: ";
+  } else {
+    std::cout << "all at once: " << seconds * 1e3 << " ms\n";
+    return;
+  }
+  const cpplox::Evaluator::PauseStats& pauses = stats.pauses;
+  std::cout << seconds * 1e3 << " ms, " << pauses.steps << " pauses taking "
+            << pauses.total.count() / 1e6 << " ms, max "
+            << pauses.max.count() / 1e3 << " us, p99 "
+            << pauses.percentile(0.99).count() / 1e3 << " us";
+  if (mode.thread)
+    std::cout << ", thread busy " << stats.reclaimThreadTime.count() / 1e6
+              << " ms";
+  std::cout << '\n';
+}
+
+}  // namespace
+
+auto main(int argc, char const* argv[]) -> int {
+  const size_t step = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 256;
+  std::ifstream file(SCRIPT);
+  if (!file) {
+    std::cerr << "Can't read " << SCRIPT << '\n';
+    return 1;
+  }
+  std::ostringstream binaryTrees;
+  binaryTrees << file.rdbuf();
+
+  const Mode modes[] = {{0, false}, {step, false}, {0, true}};
+  std::cout << "Dropping a tree of 2^17 instances\n";
+  for (const Mode mode : modes) {
+    Runner runner(mode);
+    runner.run(TREE);
+    const double drop = runner.run("tree = false;\n");
+    // Enough allocation for the steps to free the rest.
+    runner.run("fun f() {}\nfor (var i = 0; i < 300000; i = i + 1) f();\n");
+    report("the statement", mode, drop, runner.stats());
+  }
+  std::cout << "binary_trees.lox\n";
+  for (const Mode mode : modes) {
+    Runner runner(mode);
+    const double seconds = runner.run(binaryTrees.str());
+    report("the script", mode, seconds, runner.stats());
+  }
+  return 0;
+}
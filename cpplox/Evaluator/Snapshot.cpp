@@ -0,0 +1,633 @@
+#include "cpplox/Evaluator/Snapshot.h"
+
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <type_traits>
+#include <typeinfo>
+#include <unordered_map>
+#include <utility>
+#include <variant>
+
+#include "cpplox/AST/FlatAST.h"
+#include "cpplox/AST/FlatASTImage.h"
+#include "cpplox/ErrorsAndDebug/ErrorReporter.h"
+#include "cpplox/Evaluator/Environment.h"
+#include "cpplox/Evaluator/Heap.h"
+#include "cpplox/Evaluator/Objects.h"
+
+namespace cpplox::Evaluator {
+
+namespace {
+
+constexpr char MAGIC[8] = {'c', 'p', 'p', 'l', 'o', 'x', 'S', 'N'};
+constexpr uint32_t NO_ID = UINT32_MAX;
+
+struct Header {
+  char magic[8];
+  uint32_t version;
+  uint32_t scriptCount;
+  // The hash of a fixed string, to tell whether names were hashed the way
+  // this build hashes them.
+  uint64_t nameHashCheck;
+  // The images of the scripts are only good for the build that wrote them.
+  uint64_t build;
+  uint64_t payloadSize;
+  uint64_t payloadHash;
+};
+
+auto nameHashCheck() -> uint64_t {
+  return std::hash<std::string_view>()("cpplox snapshot");
+}
+
+enum class Kind : uint8_t { ENVIRONMENT, FUNCTION, CLASS, INSTANCE, MAP };
+
+enum class Tag : uint8_t { NIL, BOOL, NUMBER, STRING, OBJECT, BUILTIN };
+
+class Writer {
+ public:
+  template <typename T>
+  void put(const T& value) {
+    static_assert(std::is_trivially_copyable_v<T>);
+    bytes.append(reinterpret_cast<const char*>(&value), sizeof(T));
+  }
+
+  void putString(std::string_view string) {
+    put(static_cast<uint64_t>(string.size()));
+    bytes += string;
+  }
+
+  std::string bytes;
+};
+
+class Reader {
+ public:
+  explicit Reader(std::string_view bytes) : bytes(bytes) {}
+
+  template <typename T>
+  auto get() -> T {
+    static_assert(std::is_trivially_copyable_v<T>);
+    if (bytes.size() - position < sizeof(T)) throw damaged();
+    T value;
+    std::memcpy(&value, bytes.data() + position, sizeof(T));
+    position += sizeof(T);
+    return value;
+  }
+
+  auto getString() -> std::string_view {
+    const auto size = get<uint64_t>();
+    if (size > bytes.size() - position) throw damaged();
+    std::string_view string = bytes.substr(position, size);
+    position += size;
+    return string;
+  }
+
+  // A count of items at least minBytes each.
+  auto getCount(size_t minBytes) -> uint64_t {
+    const auto count = get<uint64_t>();
+    if (count > (bytes.size() - position) / minBytes) throw damaged();
+    return count;
+  }
+
+  [[nodiscard]] auto atEnd() const -> bool { return position == bytes.size(); }
+  [[nodiscard]] auto rest() const -> std::string_view {
+    return bytes.substr(position);
+  }
+
+  static auto damaged() -> SnapshotError {
+    return SnapshotError("The snapshot is damaged.");
+  }
+
+ private:
+  std::string_view bytes;
+  size_t position = 0;
+};
+
+auto rootOf(Environment::EnvironmentPtr environ)
+    -> Environment::EnvironmentPtr {
+  while (!environ->isGlobal()) environ = environ->getParentEnv();
+  return environ;
+}
+
+// Writes each object reachable from the current environment once, numbering
+// them in the order they're found. An object's record refers to others by
+// number, so objects found while writing it are queued to be written after.
+class SnapshotWriter {
+ public:
+  SnapshotWriter(Evaluator& evaluator, const std::vector<ScriptUnit>& scripts)
+      : evaluator(evaluator), scripts(scripts) {}
+
+  auto write() -> std::string {
+    Writer payload;
+    for (uint32_t unit = 0; unit < scripts.size(); ++unit) {
+      std::unordered_map<const AST::FuncExpr*, AST::Index> indices;
+      std::optional<std::string> image = AST::writeImage(
+          AST::flatten(*scripts[unit].program, indices), scripts[unit].source);
+      if (!image.has_value())
+        throw SnapshotError("A script's tree doesn't match its source.");
+      for (const auto& [func, index] : indices)
+        functions.emplace(func, std::make_pair(unit, index));
+      payload.putString(scripts[unit].source);
+      payload.putString(image.value());
+    }
+
+    // Scripts can keep other builtins (bound Map methods) in globals too, so
+    // only the ones a fresh Evaluator defines, under the same name, count.
+    ErrorsAndDebug::ErrorReporter freshErrors;
+    Evaluator fresh(freshErrors);
+    const auto& freshGlobals = fresh.getCurrEnv()->getObjects();
+    const Environment::EnvironmentPtr current = evaluator.getCurrEnv();
+    for (const auto& [name, object] : rootOf(current)->getObjects()) {
+      auto iter = freshGlobals.find(name);
+      if (!std::holds_alternative<BuiltinFuncShrdPtr>(object)
+          || iter == freshGlobals.end()
+          || !std::holds_alternative<BuiltinFuncShrdPtr>(iter->second))
+        continue;
+      const BuiltinFunc& builtin = *std::get<BuiltinFuncShrdPtr>(object);
+      const BuiltinFunc& original = *std::get<BuiltinFuncShrdPtr>(iter->second);
+      if (typeid(builtin) == typeid(original)) builtins.emplace(&builtin, name);
+    }
+    const uint32_t currentId = idOf(current.get(), Kind::ENVIRONMENT);
+    for (size_t i = 0; i < queue.size(); ++i) writeRecord(i);
+
+    payload.put(static_cast<uint64_t>(queue.size()));
+    payload.put(currentId);
+    payload.bytes += records.bytes;
+
+    Header header{};
+    std::memcpy(header.magic, MAGIC, sizeof MAGIC);
+    header.version = SNAPSHOT_VERSION;
+    header.scriptCount = static_cast<uint32_t>(scripts.size());
+    header.nameHashCheck = nameHashCheck();
+    header.build = AST::buildIdentity();
+    header.payloadSize = payload.bytes.size();
+    header.payloadHash = AST::hashBytes(payload.bytes);
+    Writer snapshot;
+    snapshot.put(header);
+    snapshot.bytes += payload.bytes;
+    return std::move(snapshot.bytes);
+  }
+
+ private:
+  auto idOf(void* object, Kind kind) -> uint32_t {
+    auto [iter, added]
+        = ids.emplace(object, static_cast<uint32_t>(queue.size()));
+    if (added) queue.emplace_back(object, kind);
+    return iter->second;
+  }
+
+  void writeRecord(size_t id) {
+    const auto [object, kind] = queue[id];
+    records.put(kind);
+    switch (kind) {
+      case Kind::ENVIRONMENT: {
+        auto* environ = static_cast<Environment*>(object);
+        const Environment::EnvironmentPtr parent = environ->getParentEnv();
+        records.put(parent == nullptr ? NO_ID
+                                      : idOf(parent.get(), Kind::ENVIRONMENT));
+        writeMembers(environ->getObjects());
+        break;
+      }
+      case Kind::FUNCTION: {
+        const auto* func = static_cast<const FuncObj*>(object);
+        auto iter = functions.find(func->getDecl().get());
+        if (iter == functions.end())
+          throw SnapshotError("The function " + func->getFnName()
+                              + " wasn't declared in a snapshotted script.");
+        records.put(iter->second.first);
+        records.put(iter->second.second);
+        records.putString(func->getFnName());
+        records.put(idOf(func->getClosure().get(), Kind::ENVIRONMENT));
+        records.put(static_cast<uint8_t>(func->getIsMethod()));
+        records.put(static_cast<uint8_t>(func->getIsInitializer()));
+        break;
+      }
+      case Kind::CLASS: {
+        auto* klass = static_cast<LoxClass*>(object);
+        std::optional<LoxClassShrdPtr> superClass = klass->getSuperClass();
+        records.putString(klass->getClassName());
+        records.put(superClass.has_value()
+                        ? idOf(superClass.value().get(), Kind::CLASS)
+                        : NO_ID);
+        writeMembers(klass->getMethods());
+        break;
+      }
+      case Kind::INSTANCE: {
+        const auto* instance = static_cast<const LoxInstance*>(object);
+        records.put(idOf(instance->getClass().get(), Kind::CLASS));
+        writeMembers(instance->getFields());
+        break;
+      }
+      case Kind::MAP: {
+        const auto* map = static_cast<const LoxMap*>(object);
+        records.put(static_cast<uint64_t>(map->size()));
+        for (size_t slot = map->nextSlot(0); slot != 0;
+             slot = map->nextSlot(slot)) {
+          writeValue(map->keyAt(slot));
+          writeValue(map->valueAt(slot));
+        }
+        break;
+      }
+    }
+  }
+
+  template <ObjectKind Kind>
+  void writeMembers(const Members<Kind>& members) {
+    records.put(static_cast<uint64_t>(members.size()));
+    for (const auto& [name, value] : members) {
+      records.put(static_cast<uint64_t>(name));
+      writeValue(value);
+    }
+  }
+
+  void writeValue(const LoxObject& value) {
+    switch (value.index()) {
+      case 0:  // LoxString
+        records.put(Tag::STRING);
+        records.putString(std::get<LoxString>(value).view());
+        break;
+      case 1:  // double
+        records.put(Tag::NUMBER);
+        records.put(std::get<double>(value));
+        break;
+      case 2:  // bool
+        records.put(Tag::BOOL);
+        records.put(static_cast<uint8_t>(std::get<bool>(value)));
+        break;
+      case 3:  // nullptr_t
+        records.put(Tag::NIL);
+        break;
+      case 4:  // FuncShrdPtr
+        writeObject(std::get<FuncShrdPtr>(value).get(), Kind::FUNCTION);
+        break;
+      case 5: {  // BuiltinFuncShrdPtr
+        auto iter = builtins.find(std::get<BuiltinFuncShrdPtr>(value).get());
+        if (iter == builtins.end())
+          throw SnapshotError(
+              "Map methods bound to a map can't be snapshotted.");
+        records.put(Tag::BUILTIN);
+        records.put(static_cast<uint64_t>(iter->second));
+        break;
+      }
+      case 6:  // LoxClassShrdPtr
+        writeObject(std::get<LoxClassShrdPtr>(value).get(), Kind::CLASS);
+        break;
+      case 7:  // LoxInstanceShrdPtr
+        writeObject(std::get<LoxInstanceShrdPtr>(value).get(),
+                    Kind::INSTANCE);
+        break;
+      case 8:  // LoxMapShrdPtr
+        writeObject(std::get<LoxMapShrdPtr>(value).get(), Kind::MAP);
+        break;
+      default:
+        static_assert(std::variant_size_v<LoxObject> == 9,
+                      "Looks like you forgot to update the cases in "
+                      "SnapshotWriter::writeValue(const LoxObject&)!");
+    }
+  }
+
+  void writeObject(void* object, Kind kind) {
+    records.put(Tag::OBJECT);
+    records.put(idOf(object, kind));
+  }
+
+  Evaluator& evaluator;
+  const std::vector<ScriptUnit>& scripts;
+  // Where each function was declared: which script, and which of its
+  // FlatAST's functions.
+  std::unordered_map<const AST::FuncExpr*, std::pair<uint32_t, AST::Index>>
+      functions;
+  // The builtins defined in the globals, and their (hashed) names there.
+  std::unordered_map<const BuiltinFunc*, size_t> builtins;
+  std::unordered_map<void*, uint32_t> ids;
+  std::vector<std::pair<void*, Kind>> queue;
+  Writer records;
+};
+
+struct Value {
+  Tag tag = Tag::NIL;
+  bool boolean = false;
+  double number = 0;
+  std::string_view string;
+  uint64_t name = 0;  // of a builtin
+  uint32_t id = NO_ID;
+};
+
+struct Record {
+  Kind kind = Kind::ENVIRONMENT;
+  // The parent environment, superclass, instance's class or closure.
+  uint32_t link = NO_ID;
+  uint32_t script = 0;
+  AST::Index function = 0;
+  std::string_view name;
+  bool isMethod = false;
+  bool isInitializer = false;
+  // Environment variables, class methods or instance fields.
+  std::vector<std::pair<uint64_t, Value>> members;
+  std::vector<std::pair<Value, Value>> entries;  // of a map
+};
+
+// Reads the records, then makes the objects in an order that has everything
+// an object's constructor needs made before it: environments, functions,
+// classes, then maps and instances. Environment variables, map entries and
+// instance fields can refer to anything, cycles included, so they're filled
+// in last.
+class SnapshotReader {
+ public:
+  using Functions = std::vector<std::vector<const AST::FuncExpr*>>;
+
+  SnapshotReader(Evaluator& evaluator, const Functions& functions)
+      : evaluator(evaluator), functions(functions) {}
+
+  void restore(Reader& reader) {
+    const uint64_t count = reader.getCount(sizeof(Kind));
+    const auto currentId = reader.get<uint32_t>();
+    records.reserve(count);
+    for (uint64_t i = 0; i < count; ++i) records.push_back(readRecord(reader));
+    if (!reader.atEnd()) throw Reader::damaged();
+
+    const Heap::Scope heapScope(evaluator.getHeap());
+    root = rootOf(evaluator.getCurrEnv());
+    environs.resize(count);
+    objects.resize(count);
+    for (uint32_t id = 0; id < count; ++id) {
+      if (records[id].kind == Kind::ENVIRONMENT) makeEnviron(id);
+    }
+    for (uint32_t id = 0; id < count; ++id) {
+      if (records[id].kind == Kind::FUNCTION) makeFunction(id);
+    }
+    for (uint32_t id = 0; id < count; ++id) {
+      if (records[id].kind == Kind::CLASS) makeClass(id);
+    }
+    for (uint32_t id = 0; id < count; ++id) {
+      if (records[id].kind == Kind::MAP)
+        objects[id] = makeObject<LoxMap>();
+      if (records[id].kind == Kind::INSTANCE)
+        objects[id] = makeObject<LoxInstance>(classAt(records[id].link));
+    }
+    for (uint32_t id = 0; id < count; ++id) fill(id);
+
+    evaluator.setCurrEnv(environAt(currentId));
+  }
+
+ private:
+  static auto readRecord(Reader& reader) -> Record {
+    Record record;
+    record.kind = reader.get<Kind>();
+    switch (record.kind) {
+      case Kind::ENVIRONMENT:
+        record.link = reader.get<uint32_t>();
+        readMembers(reader, record);
+        break;
+      case Kind::FUNCTION:
+        record.script = reader.get<uint32_t>();
+        record.function = reader.get<AST::Index>();
+        record.name = reader.getString();
+        record.link = reader.get<uint32_t>();
+        record.isMethod = reader.get<uint8_t>() != 0;
+        record.isInitializer = reader.get<uint8_t>() != 0;
+        break;
+      case Kind::CLASS:
+        record.name = reader.getString();
+        record.link = reader.get<uint32_t>();
+        readMembers(reader, record);
+        break;
+      case Kind::INSTANCE:
+        record.link = reader.get<uint32_t>();
+        readMembers(reader, record);
+        break;
+      case Kind::MAP: {
+        const uint64_t count = reader.getCount(2 * sizeof(Tag));
+        record.entries.reserve(count);
+        for (uint64_t i = 0; i < count; ++i) {
+          Value key = readValue(reader);
+          record.entries.emplace_back(key, readValue(reader));
+        }
+        break;
+      }
+      default: throw Reader::damaged();
+    }
+    return record;
+  }
+
+  static void readMembers(Reader& reader, Record& record) {
+    const uint64_t count = reader.getCount(sizeof(uint64_t) + sizeof(Tag));
+    record.members.reserve(count);
+    for (uint64_t i = 0; i < count; ++i) {
+      const auto name = reader.get<uint64_t>();
+      record.members.emplace_back(name, readValue(reader));
+    }
+  }
+
+  static auto readValue(Reader& reader) -> Value {
+    Value value;
+    value.tag = reader.get<Tag>();
+    switch (value.tag) {
+      case Tag::NIL: break;
+      case Tag::BOOL: value.boolean = reader.get<uint8_t>() != 0; break;
+      case Tag::NUMBER: value.number = reader.get<double>(); break;
+      case Tag::STRING: value.string = reader.getString(); break;
+      case Tag::OBJECT: value.id = reader.get<uint32_t>(); break;
+      case Tag::BUILTIN: value.name = reader.get<uint64_t>(); break;
+      default: throw Reader::damaged();
+    }
+    return value;
+  }
+
+  auto recordAt(uint32_t id, Kind kind) const -> const Record& {
+    if (id >= records.size() || records[id].kind != kind)
+      throw Reader::damaged();
+    return records[id];
+  }
+
+  // Parents first; the global environment is the evaluator's own.
+  void makeEnviron(uint32_t id) {
+    std::vector<uint32_t> chain;
+    for (uint32_t next = id; environs[next] == nullptr;) {
+      if (chain.size() > records.size()) throw Reader::damaged();
+      chain.push_back(next);
+      next = recordAt(next, Kind::ENVIRONMENT).link;
+      if (next == NO_ID) break;
+      recordAt(next, Kind::ENVIRONMENT);
+    }
+    for (auto iter = chain.rbegin(); iter != chain.rend(); ++iter) {
+      const uint32_t parent = records[*iter].link;
+      environs[*iter] = parent == NO_ID
+                            ? root
+                            : makeObject<Environment>(environs[parent]);
+    }
+  }
+
+  void makeFunction(uint32_t id) {
+    const Record& record = records[id];
+    if (record.script >= functions.size()
+        || record.function >= functions[record.script].size())
+      throw Reader::damaged();
+    objects[id] = makeObject<FuncObj>(
+        functions[record.script][record.function]->share(),
+        std::string(record.name), environAt(record.link), record.isMethod,
+        record.isInitializer);
+  }
+
+  // Superclasses first.
+  void makeClass(uint32_t id) {
+    std::vector<uint32_t> chain;
+    for (uint32_t next = id; next != NO_ID && !objects[next].has_value();
+         next = recordAt(next, Kind::CLASS).link) {
+      if (chain.size() > records.size()) throw Reader::damaged();
+      chain.push_back(next);
+    }
+    for (auto iter = chain.rbegin(); iter != chain.rend(); ++iter) {
+      const Record& record = records[*iter];
+      Members<ObjectKind::CLASS> methods;
+      for (const auto& [name, value] : record.members)
+        methods.emplace(name, resolve(value));
+      std::optional<LoxClassShrdPtr> superClass;
+      if (record.link != NO_ID) superClass = classAt(record.link);
+      objects[*iter] = makeObject<LoxClass>(
+          std::string(record.name), std::move(superClass), std::move(methods));
+    }
+  }
+
+  void fill(uint32_t id) {
+    const Record& record = records[id];
+    switch (record.kind) {
+      case Kind::ENVIRONMENT:
+        for (const auto& [name, value] : record.members)
+          environs[id]->define(name, resolve(value));
+        break;
+      case Kind::INSTANCE: {
+        auto& instance = std::get<LoxInstanceShrdPtr>(objects[id].value());
+        for (const auto& [name, value] : record.members)
+          instance->setField(name, resolve(value));
+        break;
+      }
+      case Kind::MAP: {
+        auto& map = std::get<LoxMapShrdPtr>(objects[id].value());
+        for (const auto& [key, value] : record.entries)
+          map->set(resolve(key), resolve(value));
+        break;
+      }
+      default: break;
+    }
+  }
+
+  auto resolve(const Value& value) -> LoxObject {
+    switch (value.tag) {
+      case Tag::NIL: return nullptr;
+      case Tag::BOOL: return value.boolean;
+      case Tag::NUMBER: return value.number;
+      case Tag::STRING: return LoxString(std::string(value.string));
+      case Tag::OBJECT:
+        if (value.id >= objects.size() || !objects[value.id].has_value())
+          throw Reader::damaged();
+        return objects[value.id].value();
+      case Tag::BUILTIN: {
+        const auto& globals = root->getObjects();
+        auto iter = globals.find(value.name);
+        if (iter == globals.end()
+            || !std::holds_alternative<BuiltinFuncShrdPtr>(iter->second))
+          throw Reader::damaged();
+        return iter->second;
+      }
+    }
+    throw Reader::damaged();
+  }
+
+  auto environAt(uint32_t id) const -> const Environment::EnvironmentPtr& {
+    recordAt(id, Kind::ENVIRONMENT);
+    return environs[id];
+  }
+
+  auto classAt(uint32_t id) const -> LoxClassShrdPtr {
+    recordAt(id, Kind::CLASS);
+    if (!objects[id].has_value()) throw Reader::damaged();
+    return std::get<LoxClassShrdPtr>(objects[id].value());
+  }
+
+  Evaluator& evaluator;
+  // Each script's functions, by FlatAST function index.
+  const Functions& functions;
+  std::vector<Record> records;
+  Environment::EnvironmentPtr root;
+  std::vector<Environment::EnvironmentPtr> environs;
+  std::vector<std::optional<LoxObject>> objects;
+};
+
+}  // namespace
+
+auto writeSnapshot(Evaluator& evaluator, const std::vector<ScriptUnit>& scripts)
+    -> std::string {
+  return SnapshotWriter(evaluator, scripts).write();
+}
+
+namespace {
+
+// Checks snapshot's header and decodes its scripts into the current arena,
+// returning the rest of it: the records of the objects.
+auto readScripts(std::string_view snapshot,
+                 std::vector<RestoredScript>& scripts,
+                 std::vector<std::vector<const AST::FuncExpr*>>& functions)
+    -> std::string_view {
+  Header header{};
+  if (snapshot.size() < sizeof header)
+    throw SnapshotError("That isn't a snapshot.");
+  std::memcpy(&header, snapshot.data(), sizeof header);
+  if (std::memcmp(header.magic, MAGIC, sizeof MAGIC) != 0)
+    throw SnapshotError("That isn't a snapshot.");
+  if (header.version != SNAPSHOT_VERSION
+      || header.nameHashCheck != nameHashCheck()
+      || header.build != AST::buildIdentity())
+    throw SnapshotError("The snapshot was made by another version of cpplox.");
+  const std::string_view payload = snapshot.substr(sizeof header);
+  if (header.payloadSize != payload.size()
+      || header.payloadHash != AST::hashBytes(payload))
+    throw Reader::damaged();
+
+  Reader reader(payload);
+  functions.resize(header.scriptCount);
+  for (uint32_t script = 0; script < header.scriptCount; ++script) {
+    const std::string_view source = reader.getString();
+    std::optional<AST::FlatAST> flat
+        = AST::readImage(reader.getString(), source);
+    if (!flat.has_value()) throw Reader::damaged();
+    scripts.push_back(RestoredScript{
+        source, AST::unflatten(flat.value(), functions[script])});
+  }
+  return reader.rest();
+}
+
+}  // namespace
+
+auto readSnapshot(std::string_view snapshot, Evaluator& evaluator)
+    -> std::vector<RestoredScript> {
+  std::vector<RestoredScript> scripts;
+  std::vector<std::vector<const AST::FuncExpr*>> functions;
+  Reader reader(readScripts(snapshot, scripts, functions));
+  SnapshotReader(evaluator, functions).restore(reader);
+  return scripts;
+}
+
+PreparedSnapshot::PreparedSnapshot(std::string snapshot)
+    : arena(std::make_shared<AST::Arena>()) {
+  // Functions restored from it keep the arena, and so the sources, alive.
+  const std::string_view text = arena->own(std::move(snapshot));
+  AST::Arena::Scope arenaScope(*arena);
+  objects = readScripts(text, scripts, functions);
+}
+
+void PreparedSnapshot::restore(Evaluator& evaluator) const {
+  Reader reader(objects);
+  SnapshotReader(evaluator, functions).restore(reader);
+}
+
+auto PreparedSnapshot::getScripts() const -> std::vector<ScriptUnit> {
+  std::vector<ScriptUnit> units;
+  units.reserve(scripts.size());
+  for (const RestoredScript& script : scripts)
+    units.push_back(ScriptUnit{script.source, &script.program});
+  return units;
+}
+
+}  // namespace cpplox::Evaluator
@@ -0,0 +1,87 @@
+#ifndef CPPLOX_EVALUATOR_SNAPSHOT__H
+#define CPPLOX_EVALUATOR_SNAPSHOT__H
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "cpplox/AST/Arena.h"
+#include "cpplox/AST/NodeTypes.h"
+#include "cpplox/Evaluator/Evaluator.h"
+#include "cpplox/Types/Uncopyable.h"
+
+// A snapshot is an Evaluator's state after some scripts have run: the chain of
+// environments top-level code runs in, and every function, class, instance
+// and map reachable from it. It also holds the scripts' sources and trees (as
+// FlatASTImages), since functions point into them. Restoring a snapshot into a
+// fresh Evaluator picks up where the scripts left off without running them
+// again, e.g. to skip a long initialization on every run.
+//
+// Objects are written once each, by identity, so sharing and cycles survive
+// the round trip. Names are kept hashed, the way environments, classes and
+// instances have them; a snapshot records which string hash, and which build,
+// it was written with and can only be read by the same build.
+
+namespace cpplox::Evaluator {
+
+constexpr uint32_t SNAPSHOT_VERSION = 2;
+
+class SnapshotError : public std::runtime_error {
+ public:
+  using std::runtime_error::runtime_error;
+};
+
+// A script the Evaluator has run, and the tree it ran.
+struct ScriptUnit {
+  std::string_view source;
+  const std::vector<AST::StmtPtrVariant>* program;
+};
+
+// A script restored from a snapshot.
+struct RestoredScript {
+  std::string_view source;
+  std::vector<AST::StmtPtrVariant> program;
+};
+
+// Every function reachable from evaluator must have been declared in one of
+// scripts. Throws SnapshotError for state that can't be saved: functions
+// declared elsewhere, and Map methods bound to a map (var get = map.get;).
+auto writeSnapshot(Evaluator& evaluator, const std::vector<ScriptUnit>& scripts)
+    -> std::string;
+
+// Restores snapshot into evaluator, which mustn't have run anything yet, and
+// returns the scripts, with their nodes in the current arena. Their sources
+// (and so their tokens) point into snapshot, so it has to outlive them.
+// Throws SnapshotError if snapshot isn't a complete snapshot this build can
+// read.
+auto readSnapshot(std::string_view snapshot, Evaluator& evaluator)
+    -> std::vector<RestoredScript>;
+
+// A snapshot read once, to restore into any number of Evaluators (on any
+// threads) without decoding its scripts every time; they all share its trees,
+// which are only ever read.
+class PreparedSnapshot : public Types::Uncopyable {
+ public:
+  // Throws SnapshotError, as readSnapshot does.
+  explicit PreparedSnapshot(std::string snapshot);
+
+  // Restores the state into evaluator, which mustn't have run anything yet.
+  void restore(Evaluator& evaluator) const;
+  // The scripts, to write a snapshot of an Evaluator restored from this one.
+  [[nodiscard]] auto getScripts() const -> std::vector<ScriptUnit>;
+
+ private:
+  // Owns the snapshot's text and its scripts' nodes.
+  std::shared_ptr<AST::Arena> arena;
+  std::vector<RestoredScript> scripts;
+  std::vector<std::vector<const AST::FuncExpr*>> functions;
+  // The records of the objects, after the scripts.
+  std::string_view objects;
+};
+
+}  // namespace cpplox::Evaluator
+#endif  // CPPLOX_EVALUATOR_SNAPSHOT__H
@@ -0,0 +1,180 @@
+#include "gtest/gtest.h"
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <variant>
+#include <vector>
+
+#include "cpplox/AST/NodeTypes.h"
+#include "cpplox/ErrorsAndDebug/ErrorReporter.h"
+#include "cpplox/Evaluator/Evaluator.h"
+#include "cpplox/Evaluator/Snapshot.h"
+#include "cpplox/TestUtil/TestUtil.h"
+
+namespace cpplox::Evaluator {
+
+namespace {
+
+auto lookup(Evaluator& evaluator, std::string_view name) -> LoxObject {
+  return evaluator.getCurrEnv()->get(std::hash<std::string_view>()(name));
+}
+
+// Runs setup, snapshots the state it left and restores it into another
+// evaluator, then runs check there.
+class SnapshotTest : public ::testing::Test {
+ protected:
+  void roundTrip(const std::string& setupSource,
+                 const std::string& checkSource) {
+    setup = setupSource;
+    setupProgram = TestUtil::parse(setup);
+    Evaluator original(originalErrors);
+    original.evaluateStmts(setupProgram);
+    snapshot = writeSnapshot(original, {ScriptUnit{setup, &setupProgram}});
+
+    restoredScripts = readSnapshot(snapshot, restored);
+    check = checkSource;
+    checkProgram = TestUtil::parse(check);
+    restored.evaluateStmts(checkProgram);
+  }
+
+  ErrorsAndDebug::ErrorReporter originalErrors;
+  ErrorsAndDebug::ErrorReporter restoredErrors;
+  Evaluator restored{restoredErrors};
+  std::string setup;
+  std::vector<AST::StmtPtrVariant> setupProgram;
+  std::string snapshot;
+  std::vector<RestoredScript> restoredScripts;
+  std::string check;
+  std::vector<AST::StmtPtrVariant> checkProgram;
+};
+
+}  // namespace
+
+TEST_F(SnapshotTest, globals_and_closures_survive) {
+  roundTrip(
+      "var greeting = \"hi\";\n"
+      "var flag = true;\n"
+      "fun makeCounter() {\n"
+      "  var count = 0;\n"
+      "  fun increment() { count = count + 1; return count; }\n"
+      "  return increment;\n"
+      "}\n"
+      "var counter = makeCounter();\n"
+      "counter();\n"
+      "var alias = counter;\n",
+      "alias();\n"
+      "var result = counter();\n"
+      "var started = clock() > 0;\n");
+  EXPECT_EQ("hi", std::get<LoxString>(lookup(restored, "greeting")).str());
+  EXPECT_TRUE(std::get<bool>(lookup(restored, "flag")));
+  // Both names share the one closure, which had counted once already.
+  EXPECT_EQ(3.0, std::get<double>(lookup(restored, "result")));
+  EXPECT_TRUE(std::get<bool>(lookup(restored, "started")));
+  ASSERT_EQ(1, restoredScripts.size());
+  EXPECT_EQ(setup, restoredScripts[0].source);
+}
+
+TEST_F(SnapshotTest, classes_and_instances_survive) {
+  roundTrip(
+      "class Base { name() { return \"base\"; } }\n"
+      "class Derived < Base {\n"
+      "  init(n) { this.n = n; this.self = this; }\n"
+      "  name() { return super.name() + \"+\" + this.n; }\n"
+      "}\n"
+      "var d = Derived(\"d\");\n",
+      "var name = d.self.self.name();\n"
+      "var other = Derived(\"e\").name();\n");
+  EXPECT_EQ("base+d", std::get<LoxString>(lookup(restored, "name")).str());
+  EXPECT_EQ("base+e", std::get<LoxString>(lookup(restored, "other")).str());
+  const auto instance = std::get<LoxInstanceShrdPtr>(lookup(restored, "d"));
+  const size_t self = std::hash<std::string_view>()("self");
+  EXPECT_EQ(instance,
+            std::get<LoxInstanceShrdPtr>(instance->getFields().at(self)));
+}
+
+TEST_F(SnapshotTest, maps_survive) {
+  roundTrip(
+      "var m = Map();\n"
+      "m.set(\"apple\", 1);\n"
+      "m.set(2, \"two\");\n"
+      "m.set(\"self\", m);\n",
+      "var size = m.size();\n"
+      "var apple = m.get(\"apple\");\n"
+      "var same = m.get(\"self\") == m;\n");
+  EXPECT_EQ(3.0, std::get<double>(lookup(restored, "size")));
+  EXPECT_EQ(1.0, std::get<double>(lookup(restored, "apple")));
+  EXPECT_TRUE(std::get<bool>(lookup(restored, "same")));
+}
+
+TEST(PreparedSnapshotTest, restores_independent_copies) {
+  const std::string source
+      = "var count = 0;\n"
+        "fun next() { count = count + 1; return count; }\n";
+  const std::vector<AST::StmtPtrVariant> program = TestUtil::parse(source);
+  ErrorsAndDebug::ErrorReporter eReporter;
+  Evaluator original(eReporter);
+  original.evaluateStmts(program);
+  auto prepared = std::make_unique<PreparedSnapshot>(
+      writeSnapshot(original, {ScriptUnit{source, &program}}));
+
+  Evaluator first(eReporter);
+  Evaluator second(eReporter);
+  prepared->restore(first);
+  prepared->restore(second);
+  const std::vector<ScriptUnit> scripts = prepared->getScripts();
+  ASSERT_EQ(1, scripts.size());
+  EXPECT_EQ(source, scripts[0].source);
+  // The functions keep the shared trees alive without it.
+  prepared.reset();
+
+  const std::string calls = "next(); var last = next();\n";
+  const std::vector<AST::StmtPtrVariant> callProgram = TestUtil::parse(calls);
+  first.evaluateStmts(callProgram);
+  EXPECT_EQ(2.0, std::get<double>(lookup(first, "last")));
+  EXPECT_EQ(0.0, std::get<double>(lookup(second, "count")));
+  second.evaluateStmts(callProgram);
+  EXPECT_EQ(2.0, std::get<double>(lookup(second, "last")));
+  EXPECT_EQ(ErrorsAndDebug::LoxStatus::OK, eReporter.getStatus());
+}
+
+TEST(SnapshotErrorTest, bound_map_methods_cannot_be_saved) {
+  // Even under the name of a real builtin.
+  const std::string source = "var m = Map(); var clock = m.get;\n";
+  const std::vector<AST::StmtPtrVariant> program = TestUtil::parse(source);
+  ErrorsAndDebug::ErrorReporter eReporter;
+  Evaluator evaluator(eReporter);
+  evaluator.evaluateStmts(program);
+  EXPECT_THROW(writeSnapshot(evaluator, {ScriptUnit{source, &program}}),
+               SnapshotError);
+}
+
+TEST(SnapshotErrorTest, functions_from_other_scripts_cannot_be_saved) {
+  const std::string source = "fun f() {}\n";
+  const std::vector<AST::StmtPtrVariant> program = TestUtil::parse(source);
+  ErrorsAndDebug::ErrorReporter eReporter;
+  Evaluator evaluator(eReporter);
+  evaluator.evaluateStmts(program);
+  EXPECT_THROW(writeSnapshot(evaluator, {}), SnapshotError);
+}
+
+TEST(SnapshotErrorTest, damaged_snapshots_are_rejected) {
+  const std::string source = "var x = 1;\n";
+  const std::vector<AST::StmtPtrVariant> program = TestUtil::parse(source);
+  ErrorsAndDebug::ErrorReporter eReporter;
+  Evaluator original(eReporter);
+  original.evaluateStmts(program);
+  const std::string snapshot
+      = writeSnapshot(original, {ScriptUnit{source, &program}});
+
+  std::string damaged = snapshot;
+  damaged[damaged.size() - 1] ^= 1;
+  Evaluator fresh(eReporter);
+  EXPECT_THROW(readSnapshot(damaged, fresh), SnapshotError);
+  EXPECT_THROW(readSnapshot(snapshot.substr(0, 12), fresh), SnapshotError);
+  EXPECT_THROW(readSnapshot("not a snapshot at all, not even close", fresh),
+               SnapshotError);
+}
+
+}  // namespace cpplox::Evaluator
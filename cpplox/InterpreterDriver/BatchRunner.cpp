@@ -0,0 +1,96 @@
+#include "cpplox/InterpreterDriver/BatchRunner.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <fstream>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+#include "cpplox/Output/OutputBuffer.h"
+
+namespace cpplox {
+
+namespace {
+
+const int EXIT_SOFTWARE = 70;
+
+auto runOne(const std::string& script, const ScriptOptions& options)
+    -> ScriptResult {
+  ScriptResult result;
+  result.script = script;
+  {
+    Output::OutputBuffer out(result.out);
+    Output::OutputBuffer err(result.err, Output::BufferMode::LINE);
+    Output::Redirect redirect(out, err);
+    try {
+      InterpreterDriver driver;
+      result.exitCode = driver.runScript(script.c_str(), options);
+    } catch (const std::exception& e) {
+      // Running out of memory, say; the other scripts carry on.
+      err.write("Couldn't run the script: ");
+      err.write(e.what());
+      err.endLine();
+      result.exitCode = EXIT_SOFTWARE;
+    }
+  }  // Flushes the rest of the output into result.
+  return result;
+}
+
+}  // namespace
+
+BatchRunner::BatchRunner(unsigned jobs, ScriptOptions options)
+    : jobs(jobs != 0 ? jobs
+                     : std::max(1U, std::thread::hardware_concurrency())),
+      options(std::move(options)) {}
+
+void BatchRunner::run(const std::vector<std::string>& scripts,
+                      const std::function<void(ScriptResult)>& onResult) {
+  // Results that are done but still waiting for one before them.
+  std::vector<std::optional<ScriptResult>> results(scripts.size());
+  std::mutex mutex;
+  std::condition_variable finished;
+  std::atomic<size_t> next = 0;
+  auto work = [&]() {
+    for (size_t i = next++; i < scripts.size(); i = next++) {
+      ScriptResult result = runOne(scripts[i], options);
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        results[i] = std::move(result);
+      }
+      finished.notify_one();
+    }
+  };
+
+  std::vector<std::thread> workers;
+  const size_t workerCount = std::min<size_t>(jobs, scripts.size());
+  for (size_t i = 0; i < workerCount; ++i) workers.emplace_back(work);
+  for (size_t i = 0; i < scripts.size(); ++i) {
+    std::unique_lock<std::mutex> lock(mutex);
+    finished.wait(lock, [&]() { return results[i].has_value(); });
+    ScriptResult result = std::move(results[i].value());
+    results[i].reset();
+    lock.unlock();
+    onResult(std::move(result));
+  }
+  for (auto& worker : workers) worker.join();
+}
+
+auto BatchRunner::readManifest(const char* const path)
+    -> std::optional<std::vector<std::string>> {
+  std::ifstream manifest(path);
+  if (!manifest) return std::nullopt;
+  std::vector<std::string> scripts;
+  std::string line;
+  while (std::getline(manifest, line)) {
+    if (!line.empty() && line.back() == '\r') line.pop_back();
+    if (line.empty() || line[0] == '#') continue;
+    scripts.push_back(std::move(line));
+  }
+  if (manifest.bad()) return std::nullopt;
+  return scripts;
+}
+
+}  // namespace cpplox
@@ -0,0 +1,49 @@
+#ifndef CPPLOX_INTERPRETERDRIVER_BATCHRUNNER_H
+#define CPPLOX_INTERPRETERDRIVER_BATCHRUNNER_H
+#pragma once
+
+#include <functional>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "cpplox/InterpreterDriver/InterpreterDriver.h"
+#include "cpplox/Types/Uncopyable.h"
+
+namespace cpplox {
+
+// What running one script of a batch produced.
+struct ScriptResult {
+  std::string script;
+  int exitCode = 0;
+  std::string out;  // What it printed.
+  std::string err;  // The errors it reported.
+};
+
+// Runs many independent scripts in one process, each in an InterpreterDriver
+// of its own, on a fixed pool of worker threads. Nothing is shared between
+// the scripts: each one's output and errors are captured (see
+// Output::Redirect) instead of going to stdout and stderr.
+class BatchRunner : public Types::Uncopyable {
+ public:
+  // jobs == 0 means one per hardware thread.
+  explicit BatchRunner(unsigned jobs = 0, ScriptOptions options = {});
+
+  // Runs every script, and hands each result to onResult on the calling
+  // thread, in the order of scripts, once it and those before it are done.
+  void run(const std::vector<std::string>& scripts,
+           const std::function<void(ScriptResult)>& onResult);
+
+  // The script paths in a manifest file, one per line; blank lines and lines
+  // starting with # are skipped. std::nullopt if it can't be read.
+  static auto readManifest(const char* path)
+      -> std::optional<std::vector<std::string>>;
+
+ private:
+  unsigned jobs;
+  ScriptOptions options;
+};
+
+}  // namespace cpplox
+
+#endif  // CPPLOX_INTERPRETERDRIVER_BATCHRUNNER_H
@@ -0,0 +1,105 @@
+#include "gtest/gtest.h"
+
+#include <unistd.h>
+
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "cpplox/InterpreterDriver/BatchRunner.h"
+
+namespace cpplox {
+
+namespace {
+
+class BatchRunnerTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    const char* dir = std::getenv("TEST_TMPDIR");
+    directory = std::string(dir != nullptr ? dir : "/tmp")
+                + "/batch_runner_test_" + std::to_string(::getpid());
+    std::filesystem::create_directories(directory);
+  }
+  void TearDown() override { std::filesystem::remove_all(directory); }
+
+  auto write(const std::string& name, const std::string& source)
+      -> std::string {
+    const std::string path = directory + "/" + name;
+    std::ofstream(path) << source;
+    return path;
+  }
+
+  auto runAll(const std::vector<std::string>& scripts, unsigned jobs)
+      -> std::vector<ScriptResult> {
+    std::vector<ScriptResult> results;
+    BatchRunner(jobs).run(scripts, [&](ScriptResult result) {
+      results.push_back(std::move(result));
+    });
+    return results;
+  }
+
+  std::string directory;
+};
+
+}  // namespace
+
+TEST_F(BatchRunnerTest, runs_each_script_on_its_own) {
+  std::vector<std::string> scripts;
+  for (int i = 0; i < 40; ++i) {
+    // Every script defines the same names, and the later ones finish first.
+    scripts.push_back(write(
+        "script" + std::to_string(i) + ".lox",
+        "var n = " + std::to_string(i) + ";\n"
+        "fun spin(k) { var s = 0; for (var j = 0; j < k; j = j + 1) s = s + j;"
+        " return s; }\n"
+        "spin(" + std::to_string((40 - i) * 200) + ");\n"
+        "print n;\n"));
+  }
+  const std::vector<ScriptResult> results = runAll(scripts, 4);
+  ASSERT_EQ(scripts.size(), results.size());
+  for (size_t i = 0; i < results.size(); ++i) {
+    EXPECT_EQ(scripts[i], results[i].script);
+    EXPECT_EQ(0, results[i].exitCode);
+    EXPECT_EQ(">" + std::to_string(i) + "\n", results[i].out);
+    EXPECT_EQ("", results[i].err);
+  }
+}
+
+TEST_F(BatchRunnerTest, captures_errors_and_exit_codes) {
+  // Top-level statements carry on after a runtime error, up to a limit.
+  std::string tooManyErrors;
+  for (int i = 0; i < 25; ++i) tooManyErrors += "print -\"x\";\n";
+  const std::vector<ScriptResult> results
+      = runAll({write("syntax.lox", "print 1;\nvar = 2;\n"),
+                write("runtime.lox", "print -\"x\";\nprint \"after\";\n"),
+                write("too_many.lox", tooManyErrors),
+                write("fine.lox", "print 3;\n"), directory + "/missing.lox"},
+               2);
+  ASSERT_EQ(5, results.size());
+  EXPECT_EQ(65, results[0].exitCode);
+  EXPECT_EQ("", results[0].out);
+  EXPECT_NE(std::string::npos, results[0].err.find("[Line 2] Error"));
+  EXPECT_EQ(0, results[1].exitCode);
+  EXPECT_EQ(">after\n", results[1].out);
+  EXPECT_NE(std::string::npos, results[1].err.find("[Line 1] Error"));
+  EXPECT_EQ(70, results[2].exitCode);
+  EXPECT_NE(std::string::npos, results[2].err.find("Too many errors"));
+  EXPECT_EQ(0, results[3].exitCode);
+  EXPECT_EQ(">3\n", results[3].out);
+  EXPECT_EQ("", results[3].err);
+  EXPECT_EQ(65, results[4].exitCode);
+}
+
+TEST_F(BatchRunnerTest, reads_manifests) {
+  const std::string manifest
+      = write("manifest.txt", "# a comment\na.lox\n\nb/c.lox\r\n");
+  EXPECT_EQ((std::vector<std::string>{"a.lox", "b/c.lox"}),
+            BatchRunner::readManifest(manifest.c_str()));
+  EXPECT_FALSE(
+      BatchRunner::readManifest((directory + "/missing.txt").c_str()));
+}
+
+}  // namespace cpplox
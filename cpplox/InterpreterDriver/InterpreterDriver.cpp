@@ -4,15 +4,22 @@
 #include <exception>
 #include <fstream>
 #include <iostream>
-#include <iterator>
+#include <memory>
 #include <optional>
-#include <sstream>
 #include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
 
 #include "cpplox/AST/PrettyPrinter.h"
 #include "cpplox/ErrorsAndDebug/DebugPrint.h"
 #include "cpplox/ErrorsAndDebug/RuntimeError.h"
+#include "cpplox/Evaluator/FlatProgram.h"
+#include "cpplox/Evaluator/Snapshot.h"
+#include "cpplox/InterpreterDriver/ProgramCache.h"
+#include "cpplox/Output/OutputBuffer.h"
 #include "cpplox/Parser/Parser.h"
+#include "cpplox/Scanner/ParallelScanner.h"
 #include "cpplox/Scanner/Scanner.h"
 #include "cpplox/Types/Token.h"
 
@@ -27,30 +34,200 @@ using Types::Token;
 using Types::TokenType;
 
 const int EXIT_DATAERR = 65;
+const int EXIT_NOINPUT = 66;
 const int EXIT_SOFTWARE = 70;
+const int EXIT_IOERR = 74;
 
-auto InterpreterDriver::runScript(const char* const scriptFile) -> int {
-  const auto source = ([&]() -> std::string {
-    try {
-      std::ifstream in(scriptFile, std::ios::in);
-      in.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-      return std::string{std::istreambuf_iterator<char>{in},
-                         std::istreambuf_iterator<char>{}};
-    } catch (std::exception& e) {
-      debugPrint("Couldn't open Input source file.");
-      return "";
-    }
-  })();
+namespace {
+
+void reportError(const std::string& message) {
+  Output::stdOut().flush();
+  Output::stdErr().write(message);
+  Output::stdErr().endLine();
+}
+
+}  // namespace
+
+auto InterpreterDriver::runScript(const char* const scriptFile,
+                                  const ScriptOptions& options) -> int {
+  std::unique_ptr<SourceFile> source = SourceFile::open(scriptFile);
+  if (source == nullptr) {
+    debugPrint("Couldn't open Input source file.");
+    return EXIT_DATAERR;
+  }
+  if (source->view().empty()) return EXIT_DATAERR;
 
+  // The scanner reads straight out of the file's pages, so keep them around.
+  sources.emplace_back(std::move(source));
+  return runWholeScript(sources.back()->view(),
+                        std::make_shared<AST::Arena>(), options);
+}
+
+auto InterpreterDriver::runSource(std::string source,
+                                  const ScriptOptions& options) -> int {
   if (source.empty()) return EXIT_DATAERR;
+  auto arena = std::make_shared<AST::Arena>();
+  const std::string_view view = arena->own(std::move(source));
+  return runWholeScript(view, std::move(arena), options);
+}
 
-  this->interpret(source);
+auto InterpreterDriver::runWholeScript(std::string_view source,
+                                       std::shared_ptr<AST::Arena> arena,
+                                       const ScriptOptions& options) -> int {
+  applyLimits(options);
+  const size_t line = lines.size();
+  this->interpret(source, std::move(arena), options);
+  if (lines.size() > line) scripts.emplace_back(source, line);
+  Output::stdOut().flush();
 
   if (hadError) return EXIT_DATAERR;
   if (hadRunTimeError) return EXIT_SOFTWARE;
   return 0;
 }
 
+void InterpreterDriver::applyLimits(const ScriptOptions& options) {
+  Evaluator::Budget budget{options.fuel, std::nullopt, options.interrupt};
+  if (options.timeLimit.has_value())
+    budget.deadline = std::chrono::steady_clock::now() + *options.timeLimit;
+  evaluator.setBudget(budget);
+  evaluator.getHeap().setLimit(options.memoryLimit);
+  evaluator.getHeap().setReclaimStep(options.reclaimStep);
+  evaluator.getHeap().setReclaimThread(options.reclaimThread);
+}
+
+auto InterpreterDriver::getMemoryStats() -> Evaluator::MemoryStats {
+  return evaluator.getHeap().getStats();
+}
+
+void InterpreterDriver::setArguments(const std::vector<std::string>& args) {
+  const Evaluator::Heap::Scope heapScope(evaluator.getHeap());
+  auto map = Evaluator::makeObject<Evaluator::LoxMap>();
+  for (size_t i = 0; i < args.size(); ++i)
+    map->set(static_cast<double>(i), Evaluator::LoxString(args[i]));
+  evaluator.getCurrEnv()->define(std::hash<std::string_view>()("args"),
+                                 std::move(map));
+}
+
+auto InterpreterDriver::runScriptStreaming(const char* const scriptFile,
+                                           const ScriptOptions& options)
+    -> int {
+  std::unique_ptr<SourceStream> stream = SourceStream::open(scriptFile);
+  if (stream == nullptr) {
+    debugPrint("Couldn't open Input source file.");
+    return EXIT_DATAERR;
+  }
+  // Tokens, and so the AST, point into the stream's chunks.
+  streams.emplace_back(std::move(stream));
+
+  ErrorReporter syntaxErrors;
+  Scanner scanner(*streams.back(), syntaxErrors);
+  RDParser parser(scanner, syntaxErrors);
+  arenas.emplace_back(std::make_shared<AST::Arena>());
+  AST::Arena::Scope arenaScope(*arenas.back());
+  eReporter.clearErrors();
+  applyLimits(options);
+  const auto globals = evaluator.getCurrEnv();
+  while (std::optional<AST::StmtPtrVariant> stmt = parser.parseNext()) {
+    // After a syntax error keep parsing, to report any further errors, but
+    // stop running the script.
+    if (syntaxErrors.getStatus() != LoxStatus::OK) {
+      syntaxErrors.printToStdErr();
+      syntaxErrors.clearErrors();
+      hadError = true;
+    }
+    if (hadError || hadRunTimeError) continue;
+
+    lines.emplace_back();
+    lines.back().emplace_back(std::move(stmt.value()));
+    try {
+      evaluator.evaluateStmts(lines.back());
+    } catch (const RuntimeError& e) {
+      hadRunTimeError = true;
+    } catch (const Evaluator::BudgetExceeded& e) {
+      hadRunTimeError = true;
+      evaluator.setCurrEnv(globals);
+      if (eReporter.getStatus() != LoxStatus::OK) {
+        eReporter.printToStdErr();
+        eReporter.clearErrors();
+      }
+      reportError(std::string("Script stopped: ") + e.what());
+    }
+    if (eReporter.getStatus() != LoxStatus::OK) {
+      eReporter.printToStdErr();
+      eReporter.clearErrors();
+    }
+  }
+  if (syntaxErrors.getStatus() != LoxStatus::OK) {
+    syntaxErrors.printToStdErr();
+    hadError = true;
+  }
+  Output::stdOut().flush();
+
+  // An empty script is an error, as in runScript.
+  if (hadError || streams.back()->bytesRead() == 0) return EXIT_DATAERR;
+  if (hadRunTimeError) return EXIT_SOFTWARE;
+  return 0;
+}
+
+void InterpreterDriver::restoreSnapshot(
+    std::shared_ptr<const Evaluator::PreparedSnapshot> snapshot) {
+  snapshot->restore(evaluator);
+  prepared = std::move(snapshot);
+}
+
+auto InterpreterDriver::snapshot() -> std::optional<std::string> {
+  std::vector<Evaluator::ScriptUnit> units;
+  if (prepared != nullptr) units = prepared->getScripts();
+  units.reserve(units.size() + scripts.size());
+  for (const auto& [source, line] : scripts)
+    units.push_back(Evaluator::ScriptUnit{source, &lines[line]});
+  try {
+    return Evaluator::writeSnapshot(evaluator, units);
+  } catch (const Evaluator::SnapshotError& e) {
+    reportError(std::string("Couldn't snapshot: ") + e.what());
+  } catch (const Parser::DeferredSyntaxError& e) {
+    // Saving the scripts parses any bodies left to parse, which had errors.
+  }
+  return std::nullopt;
+}
+
+auto InterpreterDriver::writeSnapshot(const char* const path) -> int {
+  const std::optional<std::string> snapshot = this->snapshot();
+  if (!snapshot.has_value()) return EXIT_DATAERR;
+
+  std::ofstream out(path, std::ios::binary | std::ios::trunc);
+  out.write(snapshot->data(), static_cast<std::streamsize>(snapshot->size()));
+  if (!out.flush()) {
+    reportError(std::string("Couldn't write the snapshot to ") + path);
+    return EXIT_IOERR;
+  }
+  return 0;
+}
+
+auto InterpreterDriver::loadSnapshot(const char* const path) -> int {
+  std::unique_ptr<SourceFile> snapshot = SourceFile::open(path);
+  if (snapshot == nullptr) {
+    reportError(std::string("Couldn't open the snapshot ") + path);
+    return EXIT_NOINPUT;
+  }
+  // The restored scripts' sources are in the snapshot's pages.
+  sources.emplace_back(std::move(snapshot));
+  arenas.emplace_back(std::make_shared<AST::Arena>());
+  AST::Arena::Scope arenaScope(*arenas.back());
+  std::vector<Evaluator::RestoredScript> restored;
+  try {
+    restored = Evaluator::readSnapshot(sources.back()->view(), evaluator);
+  } catch (const Evaluator::SnapshotError& e) {
+    reportError(std::string("Couldn't restore ") + path + ": " + e.what());
+    return EXIT_DATAERR;
+  }
+  for (auto& script : restored) {
+    scripts.emplace_back(script.source, lines.size());
+    lines.emplace_back(std::move(script.program));
+  }
+  return 0;
+}
+
 void InterpreterDriver::runREPL() {
   std::string line;
   std::cout
@@ -60,10 +237,22 @@ void InterpreterDriver::runREPL() {
          "http://www.craftinginterpreters.com/"
       << std::endl;
   while (std::cout << "> " && std::getline(std::cin, line)) {
-    this->interpret(line);
+    auto arena = std::make_shared<AST::Arena>();
+    // Tokens (and so the AST) refer into the line, so it must outlive them.
+    const std::string_view source = arena->own(std::move(line));
+    const size_t keptLines = lines.size();
+    const size_t keptArenas = arenas.size();
+    this->interpret(source, std::move(arena));
+    // Functions and classes the line defined keep its tree alive as long as
+    // they need it; nothing else does, so a session only grows with what it
+    // defines.
+    lines.resize(keptLines);
+    arenas.resize(keptArenas);
+    Output::stdOut().flush();
     hadError = false;
     hadRunTimeError = false;
   }
+  Output::stdOut().flush();
   std::cout << std::endl << "# Goodbye!" << std::endl;
 }
 
@@ -71,11 +260,10 @@ namespace {
 
 class InterpreterError : std::exception {};
 
-auto scan(const std::string& source) -> std::vector<Token> {
+auto scan(std::string_view source) -> Types::TokenList {
   ErrorReporter eReporter;
-  Scanner scanner(source, eReporter);
-
-  std::vector<Token> tokensVec = scanner.tokenize();
+  // Only splits up sources big enough to be worth it.
+  Types::TokenList tokenList = tokenizeParallel(source, eReporter);
 
   if (eReporter.getStatus() != LoxStatus::OK) {
     eReporter.printToStdErr();
@@ -83,18 +271,25 @@ auto scan(const std::string& source) -> std::vector<Token> {
   }
 #ifdef SCANNER_DEBUG
   debugPrint("Here are the tokens the scanner recognized:");
-  for (auto& token : tokensVec) debugPrint(token.toString());
+  for (auto& token : tokenList.tokens) debugPrint(token.toString());
 #endif  // SCANNER_DEBUG
 
-  return tokensVec;
+  return tokenList;
 }
 
-auto parse(const std::vector<Token>& tokenVec)
+auto parse(Types::TokenList tokenList, bool lazyFunctions)
     -> std::vector<AST::StmtPtrVariant> {
   ErrorReporter eReporter;
-  RDParser parser(tokenVec, eReporter);
-
-  std::vector<AST::StmtPtrVariant> statements = parser.parse();
+  std::vector<AST::StmtPtrVariant> statements;
+  if (lazyFunctions) {
+    // The function bodies left to parse later share the tokens.
+    statements = RDParser(std::make_shared<const Types::TokenList>(
+                              std::move(tokenList)),
+                          eReporter)
+                     .parse();
+  } else {
+    statements = RDParser(tokenList, eReporter).parse();
+  }
 
   if (eReporter.getStatus() != LoxStatus::OK) {
     eReporter.printToStdErr();
@@ -114,22 +309,43 @@ auto parse(const std::vector<Token>& tokenVec)
   return statements;
 }
 
+// From the cache if it's there, else scanned and parsed (and cached).
+auto load(std::string_view source, const ScriptOptions& options)
+    -> std::vector<AST::StmtPtrVariant> {
+  if (!options.cacheDirectory.has_value())
+    return parse(scan(source), options.lazyFunctions && !options.flat);
+
+  const ProgramCache cache(options.cacheDirectory.value());
+  if (auto program = cache.load(source); program.has_value())
+    return std::move(program.value());
+  std::vector<AST::StmtPtrVariant> program = parse(scan(source), false);
+  cache.store(source, program);
+  return program;
+}
+
 }  // namespace
 
-void InterpreterDriver::interpret(const std::string& source) {
+void InterpreterDriver::interpret(std::string_view source,
+                                  std::shared_ptr<AST::Arena> arena,
+                                  const ScriptOptions& options) {
+  arenas.emplace_back(std::move(arena));
+  const auto globals = evaluator.getCurrEnv();
   try {
     eReporter.clearErrors();
+    AST::Arena::Scope arenaScope(*arenas.back());
     // Store all syntactically correct statements so we can ensure that
     // references held by the Evaluator (functions, classes) are live.
     // Also permits us reconstruct evaluator state if need be.
 #ifdef PERF_DEBUG
+    // Times scanning and parsing separately, so doesn't use the cache.
     auto scanStartTime = std::chrono::high_resolution_clock::now();
     auto tokens = scan(source);
     auto parseStartTime = std::chrono::high_resolution_clock::now();
-    lines.emplace_back(parse(tokens));
+    lines.emplace_back(parse(std::move(tokens), options.lazyFunctions));
     auto evalStartTime = std::chrono::high_resolution_clock::now();
     evaluator.evaluateStmts(lines.back());
     auto evalEndTime = std::chrono::high_resolution_clock::now();
+    Output::stdOut().flush();
 
     std::cout << "Scanning took: "
               << static_cast<double>(
@@ -150,8 +366,11 @@ void InterpreterDriver::interpret(const std::string& source) {
                          .count())
               << " us" << std::endl;
 #else
-    lines.emplace_back(parse(scan(source)));
-    evaluator.evaluateStmts(lines.back());
+    lines.emplace_back(load(source, options));
+    if (options.flat)
+      evaluator.evaluateFlat(*Evaluator::flattenProgram(lines.back()));
+    else
+      evaluator.evaluateStmts(lines.back());
 #endif  // PERF_DEBUG
     if (eReporter.getStatus() != LoxStatus::OK) {
       eReporter.printToStdErr();
@@ -159,6 +378,15 @@ void InterpreterDriver::interpret(const std::string& source) {
 
   } catch (const InterpreterError& e) {
     hadError = true;
+    // Nothing was run, so nothing refers to the nodes that were parsed.
+    arenas.pop_back();
+    return;
+  } catch (const Parser::DeferredSyntaxError& e) {
+    // A function body parsed on its first call had errors, which it printed.
+    hadError = true;
+    if (eReporter.getStatus() != LoxStatus::OK) {
+      eReporter.printToStdErr();
+    }
     return;
   } catch (const ErrorsAndDebug::RuntimeError& e) {
     hadRunTimeError = true;
@@ -166,6 +394,15 @@ void InterpreterDriver::interpret(const std::string& source) {
       eReporter.printToStdErr();
     }
     return;
+  } catch (const Evaluator::BudgetExceeded& e) {
+    hadRunTimeError = true;
+    // It was thrown from wherever the script had got to.
+    evaluator.setCurrEnv(globals);
+    if (eReporter.getStatus() != LoxStatus::OK) {
+      eReporter.printToStdErr();
+    }
+    reportError(std::string("Script stopped: ") + e.what());
+    return;
   }
 }
 
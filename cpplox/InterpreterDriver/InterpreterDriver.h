@@ -2,28 +2,123 @@
 #define CPPLOX_INTERPRETERDRIVER_INTERPRETERDRIVER_H
 #pragma once
 
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
 #include <string>
+#include <string_view>
+#include <utility>
 #include <vector>
 
+#include "cpplox/AST/Arena.h"
 #include "cpplox/AST/NodeTypes.h"
 #include "cpplox/ErrorsAndDebug/ErrorReporter.h"
 #include "cpplox/Evaluator/Evaluator.h"
+#include "cpplox/Evaluator/Snapshot.h"
+#include "cpplox/InterpreterDriver/SourceFile.h"
+#include "cpplox/Scanner/SourceStream.h"
 
 namespace cpplox {
 
+struct ScriptOptions {
+  // Parse each function body when the function is first called, rather than
+  // up front; syntax errors in a body are reported then, and only if it's
+  // called.
+  bool lazyFunctions = false;
+  // Load the parsed script from a ProgramCache in this directory if it's
+  // there, and save it there if not. Takes precedence over lazyFunctions, as
+  // every body has to be parsed to save the script.
+  std::optional<std::string> cacheDirectory;
+  // Run the script from a flattened copy of its AST (an
+  // Evaluator::FlatProgram) rather than from the tree. Takes precedence over
+  // lazyFunctions, as every body has to be parsed to flatten the script.
+  bool flat = false;
+  // Stop the script, as a runtime error, after this many loop iterations and
+  // calls; 0 for no limit.
+  uint64_t fuel = 0;
+  // Stop the script, as a runtime error, once it has run for this long.
+  std::optional<std::chrono::milliseconds> timeLimit;
+  // Stop the script, as a runtime error, once this is set.
+  const std::atomic<bool>* interrupt = nullptr;
+  // Fail allocations, as runtime errors, that would take the interpreter's
+  // objects over this many bytes; 0 for no limit.
+  size_t memoryLimit = 0;
+  // Free objects no longer used at most this many at a time, so that
+  // letting go of a large structure doesn't pause the script for long; 0 to
+  // free each one as soon as it's let go of.
+  size_t reclaimStep = 0;
+  // Free objects no longer used on a thread of their own instead, so the
+  // script only pauses to hand them over.
+  bool reclaimThread = false;
+};
+
 struct InterpreterDriver {
  public:
   InterpreterDriver();
-  auto runScript(const char* script) -> int;
+  auto runScript(const char* script, const ScriptOptions& options = {})
+      -> int;
+  // Like runScript, but with the script's source rather than its path.
+  auto runSource(std::string source, const ScriptOptions& options = {})
+      -> int;
+  // Like runScript, but reads, parses and runs the script one top-level
+  // statement at a time, so output starts before the whole script has been
+  // read. Statements before a syntax error still run. Only the limits in
+  // options (fuel, timeLimit, interrupt, memoryLimit, reclaimStep and
+  // reclaimThread) apply.
+  auto runScriptStreaming(const char* script,
+                          const ScriptOptions& options = {}) -> int;
   void runREPL();
 
+  // Defines the global args, a Map from 0, 1, ... to the strings in args, for
+  // scripts run after it.
+  void setArguments(const std::vector<std::string>& args);
+
+  // How much memory the objects made by the scripts run so far take.
+  auto getMemoryStats() -> Evaluator::MemoryStats;
+
+  // Saves the state left by the scripts run so far (including any restored
+  // from a snapshot) to a snapshot at path.
+  auto writeSnapshot(const char* path) -> int;
+  // The same snapshot, in memory; std::nullopt (with the error reported) if
+  // the state can't be saved.
+  auto snapshot() -> std::optional<std::string>;
+  // Restores the state saved in the snapshot at path; has to come before
+  // anything else is run.
+  auto loadSnapshot(const char* path) -> int;
+  // The same, from a snapshot that's already been read, e.g. one that every
+  // request to a Server starts from.
+  void restoreSnapshot(
+      std::shared_ptr<const Evaluator::PreparedSnapshot> snapshot);
+
  private:
-  void interpret(const std::string& source);
+  // Starts the evaluator's budget, and sets its memory limit, for a script
+  // run with options.
+  void applyLimits(const ScriptOptions& options);
+  // interpret()s a whole script, keeping it around to be snapshotted, and
+  // returns its exit code.
+  auto runWholeScript(std::string_view source,
+                      std::shared_ptr<AST::Arena> arena,
+                      const ScriptOptions& options) -> int;
+  // Parses source into arena, runs it, and keeps both around.
+  void interpret(std::string_view source, std::shared_ptr<AST::Arena> arena,
+                 const ScriptOptions& options = {});
 
   ErrorsAndDebug::ErrorReporter eReporter;
+  // The nodes of each script. Functions share ownership of the arena they
+  // were declared in too, so a REPL line's is let go once the line has run.
+  std::vector<std::shared_ptr<AST::Arena>> arenas;
   Evaluator::Evaluator evaluator;
 
+  std::vector<std::unique_ptr<SourceFile>> sources;
+  std::vector<std::unique_ptr<SourceStream>> streams;
   std::vector<std::vector<AST::StmtPtrVariant>> lines;
+  // What restoreSnapshot restored, whose scripts are shared with others.
+  std::shared_ptr<const Evaluator::PreparedSnapshot> prepared;
+  // Each whole script's source and its index in lines, to snapshot them.
+  std::vector<std::pair<std::string_view, size_t>> scripts;
 
   bool hadError = false;
   bool hadRunTimeError = false;
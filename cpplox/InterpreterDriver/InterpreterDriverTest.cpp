@@ -19,4 +19,18 @@ TEST(DriverFileTest, correctInputFile) {
   cpplox::InterpreterDriver interpreter;
   EXPECT_EQ(
       0, interpreter.runScript("sample-lox-programs/expressions/evaluate.lox"));
-}
\ No newline at end of file
+}
+
+TEST(DriverTest, stopsScriptsThatGoOverBudget) {
+  cpplox::InterpreterDriver interpreter;
+  cpplox::ScriptOptions options;
+  options.fuel = 1000;
+  EXPECT_EQ(70, interpreter.runSource("var n = 0;\n"
+                                      "fun spin() { while (true) n = n + 1; }\n"
+                                      "spin();\n",
+                                      options));
+
+  cpplox::InterpreterDriver enoughFuel;
+  EXPECT_EQ(0, enoughFuel.runSource("for (var i = 0; i < 999; i = i + 1) {}\n",
+                                    options));
+}
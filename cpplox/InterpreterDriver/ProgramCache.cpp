@@ -0,0 +1,78 @@
+#include "cpplox/InterpreterDriver/ProgramCache.h"
+
+#include <unistd.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <system_error>
+#include <thread>
+#include <utility>
+
+#include "cpplox/AST/FlatAST.h"
+#include "cpplox/AST/FlatASTImage.h"
+#include "cpplox/InterpreterDriver/SourceFile.h"
+
+namespace cpplox {
+
+ProgramCache::ProgramCache(std::string directory)
+    : directory(std::move(directory)) {}
+
+auto ProgramCache::defaultDirectory() -> std::string {
+  if (const char* xdg = std::getenv("XDG_CACHE_HOME"); xdg && *xdg)
+    return std::string(xdg) + "/cpplox";
+  if (const char* home = std::getenv("HOME"); home && *home)
+    return std::string(home) + "/.cache/cpplox";
+  return ".cpplox-cache";
+}
+
+auto ProgramCache::load(std::string_view source) const
+    -> std::optional<std::vector<AST::StmtPtrVariant>> {
+  std::unique_ptr<SourceFile> entry = SourceFile::open(pathFor(source).c_str());
+  if (entry == nullptr) return std::nullopt;
+  std::optional<AST::FlatAST> flat = AST::readImage(entry->view(), source);
+  if (!flat.has_value()) return std::nullopt;
+  // The tree points into the source, not the entry, so it can be unmapped.
+  return AST::unflatten(flat.value());
+}
+
+void ProgramCache::store(
+    std::string_view source,
+    const std::vector<AST::StmtPtrVariant>& program) const {
+  std::optional<std::string> image
+      = AST::writeImage(AST::flatten(program), source);
+  if (!image.has_value()) return;
+
+  std::error_code error;
+  std::filesystem::create_directories(directory, error);
+  if (error) return;
+  const std::string path = pathFor(source);
+  // Unique to the thread, as a batch runs scripts on several at once.
+  const size_t thread
+      = std::hash<std::thread::id>()(std::this_thread::get_id());
+  const std::string temporary = path + "." + std::to_string(::getpid()) + "."
+                                + std::to_string(thread);
+  {
+    std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+    out.write(image->data(), static_cast<std::streamsize>(image->size()));
+    if (!out.flush()) {
+      out.close();
+      std::remove(temporary.c_str());
+      return;
+    }
+  }
+  std::filesystem::rename(temporary, path, error);
+  if (error) std::remove(temporary.c_str());
+}
+
+auto ProgramCache::pathFor(std::string_view source) const -> std::string {
+  char name[32];
+  std::snprintf(name, sizeof name, "/%016llx.loxc",
+                static_cast<unsigned long long>(AST::hashBytes(source)));
+  return directory + name;
+}
+
+}  // namespace cpplox
@@ -0,0 +1,45 @@
+#ifndef CPPLOX_INTERPRETERDRIVER_PROGRAMCACHE_H
+#define CPPLOX_INTERPRETERDRIVER_PROGRAMCACHE_H
+#pragma once
+
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "cpplox/AST/NodeTypes.h"
+
+namespace cpplox {
+
+// A directory of parsed scripts, so running an unchanged script again can
+// skip scanning and parsing. Each entry is a FlatASTImage, named after the
+// hash of the script's contents; the image checks the contents and the
+// interpreter's IMAGE_VERSION before it's used, so stale entries are just
+// misses. Entries are memory mapped to load them.
+class ProgramCache {
+ public:
+  explicit ProgramCache(std::string directory);
+
+  // $XDG_CACHE_HOME/cpplox, or else ~/.cache/cpplox.
+  static auto defaultDirectory() -> std::string;
+
+  // The program parsed from source, with its nodes in the current arena, if
+  // the cache has it.
+  auto load(std::string_view source) const
+      -> std::optional<std::vector<AST::StmtPtrVariant>>;
+
+  // Best effort: the program just doesn't get cached if it can't be written.
+  // The file is written under a temporary name and renamed into place, so
+  // concurrent runs never see part of an entry.
+  void store(std::string_view source,
+             const std::vector<AST::StmtPtrVariant>& program) const;
+
+ private:
+  [[nodiscard]] auto pathFor(std::string_view source) const -> std::string;
+
+  std::string directory;
+};
+
+}  // namespace cpplox
+
+#endif  // CPPLOX_INTERPRETERDRIVER_PROGRAMCACHE_H
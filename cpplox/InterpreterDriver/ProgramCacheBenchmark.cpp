@@ -0,0 +1,94 @@
+// Cold versus warm start: how long a script takes to get from source to a
+// runnable tree by scanning and parsing it (and storing it in a ProgramCache)
+// against loading it back from the cache, for a small script like the ones
+// we run many of and for a large one. Run with:
+//   bazel run -c opt //cpplox/InterpreterDriver:program_cache_benchmark
+#include <unistd.h>
+
+#include <chrono>
+#include <filesystem>
+#include <iostream>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "cpplox/AST/Arena.h"
+#include "cpplox/AST/NodeTypes.h"
+#include "cpplox/ErrorsAndDebug/ErrorReporter.h"
+#include "cpplox/InterpreterDriver/ProgramCache.h"
+#include "cpplox/Parser/Parser.h"
+#include "cpplox/Scanner/Scanner.h"
+#include "cpplox/TestUtil/GeneratedSource.h"
+
+namespace {
+
+auto parse(const std::string& source)
+    -> std::vector<cpplox::AST::StmtPtrVariant> {
+  cpplox::ErrorsAndDebug::ErrorReporter eReporter;
+  cpplox::Types::TokenList tokens
+      = cpplox::Scanner(source, eReporter).tokenize();
+  return cpplox::Parser::RDParser(tokens, eReporter).parse();
+}
+
+auto secondsSince(std::chrono::steady_clock::time_point start) -> double {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now()
+                                       - start)
+      .count();
+}
+
+// Best of runs, in ms, of getting source's tree each way.
+void compare(size_t kilobytes, int runs) {
+  const std::string source
+      = cpplox::TestUtil::generateSource(kilobytes * 1024);
+  const std::string directory = std::filesystem::temp_directory_path()
+                                / ("program_cache_benchmark_"
+                                   + std::to_string(::getpid()));
+  const cpplox::ProgramCache cache(directory);
+
+  double bestParse = 1e9;
+  double bestCold = 1e9;
+  double bestWarm = 1e9;
+  for (int run = 0; run < runs; ++run) {
+    std::filesystem::remove_all(directory);
+    auto arena = std::make_unique<cpplox::AST::Arena>();
+    cpplox::AST::Arena::Scope scope(*arena);
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<cpplox::AST::StmtPtrVariant> program = parse(source);
+    bestParse = std::min(bestParse, secondsSince(start));
+    program.clear();
+
+    start = std::chrono::steady_clock::now();
+    if (!cache.load(source).has_value()) {
+      program = parse(source);
+      cache.store(source, program);
+    }
+    bestCold = std::min(bestCold, secondsSince(start));
+    program.clear();
+
+    start = std::chrono::steady_clock::now();
+    std::optional<std::vector<cpplox::AST::StmtPtrVariant>> loaded
+        = cache.load(source);
+    bestWarm = std::min(bestWarm, secondsSince(start));
+    if (!loaded.has_value()) std::cerr << "cache missed" << std::endl;
+  }
+  size_t imageBytes = 0;
+  for (const auto& entry : std::filesystem::directory_iterator(directory))
+    imageBytes += entry.file_size();
+  std::filesystem::remove_all(directory);
+
+  std::cout << source.size() / 1024 << " KB source, " << imageBytes / 1024
+            << " KB image: scan + parse " << bestParse * 1000
+            << " ms, cold (miss, scan + parse + store) " << bestCold * 1000
+            << " ms, warm (load) " << bestWarm * 1000 << " ms" << std::endl;
+}
+
+}  // namespace
+
+auto main() -> int {
+  compare(4, 200);
+  compare(256, 20);
+  compare(16 * 1024, 3);
+  return 0;
+}
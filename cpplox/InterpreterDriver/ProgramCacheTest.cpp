@@ -0,0 +1,51 @@
+#include "gtest/gtest.h"
+
+#include <filesystem>
+#include <fstream>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "cpplox/AST/NodeTypes.h"
+#include "cpplox/AST/PrettyPrinter.h"
+#include "cpplox/InterpreterDriver/ProgramCache.h"
+#include "cpplox/TestUtil/TestUtil.h"
+
+namespace cpplox {
+
+namespace {
+
+const std::string SOURCE
+    = "fun f(n) { return n < 2 ? n : f(n - 1) + f(n - 2); }\n"
+      "class A { m() { print this; } }\n"
+      "print f(10) + \"!\";\n";
+
+}  // namespace
+
+TEST(ProgramCacheTest, loads_what_was_stored) {
+  const std::string directory = TestUtil::tempPath("program_cache_test_");
+  const ProgramCache cache(directory);
+  EXPECT_FALSE(cache.load(SOURCE).has_value());
+
+  const std::vector<AST::StmtPtrVariant> program = TestUtil::parse(SOURCE);
+  cache.store(SOURCE, program);
+  std::optional<std::vector<AST::StmtPtrVariant>> loaded = cache.load(SOURCE);
+  ASSERT_TRUE(loaded.has_value());
+  EXPECT_EQ(AST::PrettyPrinter::toString(program),
+            AST::PrettyPrinter::toString(*loaded));
+
+  EXPECT_FALSE(cache.load(SOURCE + "print 1;").has_value());
+  std::filesystem::remove_all(directory);
+}
+
+TEST(ProgramCacheTest, failing_to_store_is_not_an_error) {
+  // A file where the directory should be.
+  const std::string path = TestUtil::tempPath("program_cache_file_");
+  std::ofstream(path) << "not a directory";
+  const ProgramCache cache(path);
+  cache.store(SOURCE, TestUtil::parse(SOURCE));
+  EXPECT_FALSE(cache.load(SOURCE).has_value());
+  std::filesystem::remove(path);
+}
+
+}  // namespace cpplox
@@ -0,0 +1,248 @@
+#include "cpplox/InterpreterDriver/Server.h"
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <exception>
+#include <mutex>
+#include <optional>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "cpplox/InterpreterDriver/ServerProtocol.h"
+#include "cpplox/Output/OutputBuffer.h"
+
+namespace cpplox {
+
+namespace {
+
+const int EXIT_USAGE = 64;
+const int EXIT_SOFTWARE = 70;
+
+}  // namespace
+
+Server::Server(std::string prelude, unsigned jobs, ScriptOptions options)
+    : prelude(prelude.empty() ? nullptr
+                              : std::make_shared<Evaluator::PreparedSnapshot>(
+                                  std::move(prelude))),
+      jobs(jobs != 0 ? jobs
+                     : std::max(1U, std::thread::hardware_concurrency())),
+      options(std::move(options)) {
+  if (!this->options.timeLimit.has_value())
+    this->options.timeLimit = DEFAULT_TIME_LIMIT;
+}
+
+Server::~Server() {
+  if (listener >= 0) {
+    ::close(listener);
+    ::unlink(socketPath.c_str());
+  }
+  for (const int fd : wakeUp) {
+    if (fd >= 0) ::close(fd);
+  }
+  for (const int fd : runningChanged) {
+    if (fd >= 0) ::close(fd);
+  }
+}
+
+void Server::setRequestTimeout(std::chrono::milliseconds timeout) {
+  requestTimeout = timeout;
+}
+
+auto Server::listen(const std::string& path) -> bool {
+  if (::pipe(wakeUp) != 0 || ::pipe(runningChanged) != 0) return false;
+  // Neither end may block: the watcher drains it, and handle() only needs
+  // there to be something in it.
+  for (const int fd : runningChanged)
+    ::fcntl(fd, F_SETFL, ::fcntl(fd, F_GETFL) | O_NONBLOCK);
+  listener = ServerProtocol::listenAt(path);
+  if (listener < 0) return false;
+  socketPath = path;
+  // Every thread polls the socket, and those that lose the race to accept a
+  // connection mustn't block.
+  ::fcntl(listener, F_SETFL, ::fcntl(listener, F_GETFL) | O_NONBLOCK);
+  return true;
+}
+
+void Server::serve() {
+  std::thread watcher([this]() { watchRequests(); });
+  std::vector<std::thread> workers;
+  for (unsigned i = 0; i < jobs; ++i)
+    workers.emplace_back([this]() { acceptRequests(); });
+  for (auto& worker : workers) worker.join();
+  watcher.join();
+}
+
+// The watcher, woken up along with everyone else, interrupts the requests in
+// progress: taking a lock isn't safe in a signal handler.
+void Server::stop() {
+  stopping = true;
+  if (wakeUp[1] >= 0) {
+    const char byte = 0;
+    // Never read, so it wakes every thread up, and stays written.
+    [[maybe_unused]] const ssize_t written = ::write(wakeUp[1], &byte, 1);
+  }
+}
+
+void Server::acceptRequests() {
+  pollfd waitFor[2] = {{listener, POLLIN, 0}, {wakeUp[0], POLLIN, 0}};
+  while (!stopping) {
+    if (::poll(waitFor, 2, -1) < 0) {
+      if (errno == EINTR) continue;
+      return;
+    }
+    if (waitFor[1].revents != 0) return;
+    const int connection = ::accept(listener, nullptr, nullptr);
+    if (connection < 0) continue;  // Another thread got it first.
+    // Accepted sockets can inherit O_NONBLOCK.
+    ::fcntl(connection, F_SETFL,
+            ::fcntl(connection, F_GETFL) & ~O_NONBLOCK);
+    handle(connection);
+    ::close(connection);
+  }
+}
+
+void Server::handle(int connection) {
+  ServerProtocol::RecordReader reader(connection);
+  reader.setDeadline(std::chrono::steady_clock::now() + requestTimeout);
+  const std::optional<ServerProtocol::Request> request
+      = ServerProtocol::readRequest(reader);
+  // A client that's gone quiet isn't waiting for an answer.
+  if (reader.hasTimedOut()) return;
+  if (!request.has_value()) {
+    ServerProtocol::writeRecord(connection, "err", "Bad request\n");
+    ServerProtocol::writeRecord(connection, "exit",
+                                std::to_string(EXIT_USAGE));
+    return;
+  }
+
+  int exitCode = 0;
+  // Output goes back as it's flushed; if the client has gone, there's no one
+  // to run the rest of the script for. The watcher notices that even while the
+  // script is quiet.
+  std::atomic<bool> clientGone = false;
+  const uint64_t id = startWatching(connection, &clientGone);
+  {
+    ScriptOptions requestOptions = options;
+    requestOptions.interrupt = &clientGone;
+    Output::OutputBuffer out([connection, &clientGone](std::string_view text) {
+      if (!ServerProtocol::writeRecord(connection, "out", text))
+        clientGone.store(true, std::memory_order_relaxed);
+    });
+    Output::OutputBuffer err(
+        [connection, &clientGone](std::string_view text) {
+          if (!ServerProtocol::writeRecord(connection, "err", text))
+            clientGone.store(true, std::memory_order_relaxed);
+        },
+        Output::BufferMode::LINE);
+    Output::Redirect redirect(out, err);
+    try {
+      InterpreterDriver driver;
+      if (prelude != nullptr) driver.restoreSnapshot(prelude);
+      if (!request->arguments.empty()) driver.setArguments(request->arguments);
+      exitCode = request->isPath
+                     ? driver.runScript(request->script.c_str(),
+                                        requestOptions)
+                     : driver.runSource(request->script, requestOptions);
+    } catch (const std::exception& e) {
+      // Running out of memory, say; other requests carry on.
+      err.write("Couldn't run the script: ");
+      err.write(e.what());
+      err.endLine();
+      exitCode = EXIT_SOFTWARE;
+    }
+  }  // Sends the rest of the output.
+  stopWatching(id);
+  ServerProtocol::writeRecord(connection, "exit", std::to_string(exitCode));
+}
+
+auto Server::startWatching(int connection, std::atomic<bool>* interrupt)
+    -> uint64_t {
+  uint64_t id = 0;
+  {
+    const std::lock_guard<std::mutex> lock(runningMutex);
+    id = ++lastId;
+    running.push_back(Running{id, connection, interrupt});
+  }
+  // Either the watcher sees this request when it stops everything, or this
+  // sees that it has.
+  if (stopping) interrupt->store(true, std::memory_order_relaxed);
+  wakeWatcher();
+  return id;
+}
+
+void Server::stopWatching(uint64_t id) {
+  {
+    const std::lock_guard<std::mutex> lock(runningMutex);
+    running.erase(std::remove_if(running.begin(), running.end(),
+                                 [id](const Running& request) {
+                                   return request.id == id;
+                                 }),
+                  running.end());
+  }
+  // So it stops polling the connection before it's closed and reused.
+  wakeWatcher();
+}
+
+void Server::wakeWatcher() {
+  const char byte = 0;
+  // If the pipe is full, the watcher is about to look anyway.
+  [[maybe_unused]] const ssize_t written = ::write(runningChanged[1], &byte, 1);
+}
+
+void Server::watchRequests() {
+  std::vector<pollfd> waitFor;
+  std::vector<uint64_t> ids;
+  while (true) {
+    waitFor = {{wakeUp[0], POLLIN, 0}, {runningChanged[0], POLLIN, 0}};
+    ids.clear();
+    {
+      const std::lock_guard<std::mutex> lock(runningMutex);
+      for (const Running& request : running) {
+        // POLLHUP comes whether asked for or not, once the client has closed
+        // its end; one that only shuts down its sending side still gets its
+        // answer.
+        waitFor.push_back({request.connection, 0, 0});
+        ids.push_back(request.id);
+      }
+    }
+    if (::poll(waitFor.data(), waitFor.size(), -1) < 0) {
+      if (errno == EINTR) continue;
+      return;
+    }
+
+    const std::lock_guard<std::mutex> lock(runningMutex);
+    if (waitFor[0].revents != 0) {
+      for (const Running& request : running)
+        request.interrupt->store(true, std::memory_order_relaxed);
+      return;
+    }
+    if (waitFor[1].revents != 0) {
+      char bytes[64];
+      while (::read(runningChanged[0], bytes, sizeof bytes) > 0) {
+      }
+    }
+    // By id rather than connection, as a request may have finished since the
+    // poll and its descriptor been reused for the next.
+    for (size_t i = 2; i < waitFor.size(); ++i) {
+      if ((waitFor[i].revents & (POLLHUP | POLLERR)) == 0) continue;
+      const auto gone = std::find_if(
+          running.begin(), running.end(),
+          [&](const Running& request) { return request.id == ids[i - 2]; });
+      if (gone == running.end()) continue;
+      gone->interrupt->store(true, std::memory_order_relaxed);
+      // Stays interrupted; there's no need to keep polling it.
+      running.erase(gone);
+    }
+  }
+}
+
+}  // namespace cpplox
@@ -0,0 +1,90 @@
+#ifndef CPPLOX_INTERPRETERDRIVER_SERVER_H
+#define CPPLOX_INTERPRETERDRIVER_SERVER_H
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "cpplox/Evaluator/Snapshot.h"
+#include "cpplox/InterpreterDriver/InterpreterDriver.h"
+#include "cpplox/Types/Uncopyable.h"
+
+namespace cpplox {
+
+// Runs scripts for clients that connect to a Unix domain socket (see
+// ServerProtocol.h), so they don't pay for starting a process and loading a
+// prelude every time. Each request runs in an InterpreterDriver of its own,
+// restored from the prelude snapshot (sharing its trees, which are only
+// decoded once), so nothing one request does is seen by another. Requests are
+// served on a fixed pool of threads, as many at a time as there are threads.
+class Server : public Types::Uncopyable {
+ public:
+  // How long a request may run if options don't set a time limit.
+  static constexpr std::chrono::seconds DEFAULT_TIME_LIMIT{30};
+
+  // prelude is a snapshot (see InterpreterDriver::snapshot) that every
+  // request starts from, if it isn't empty; it's read once, here, and throws
+  // Evaluator::SnapshotError if it can't be. jobs == 0 means one thread per
+  // hardware thread. options' budget applies to each request, with a time
+  // limit of DEFAULT_TIME_LIMIT if it has none; its interrupt is replaced by
+  // one that's set when the request's client hangs up or the server stops.
+  explicit Server(std::string prelude, unsigned jobs = 0,
+                  ScriptOptions options = {});
+  // Closes the socket and removes its file.
+  ~Server() override;
+
+  // Connections that haven't sent their whole request within timeout of
+  // being accepted are dropped, so idle clients can't hold on to the
+  // threads; 10 seconds unless set, before serve().
+  void setRequestTimeout(std::chrono::milliseconds timeout);
+  // Listens at socketPath; false (with errno set) if it can't.
+  auto listen(const std::string& socketPath) -> bool;
+  // Serves requests until stop() is called, then interrupts the ones in
+  // progress and waits for them to finish.
+  void serve();
+  // Safe to call from any thread, and from a signal handler.
+  void stop();
+
+ private:
+  // A request being run, on connection, which interrupt stops.
+  struct Running {
+    uint64_t id;
+    int connection;
+    std::atomic<bool>* interrupt;
+  };
+
+  void acceptRequests();
+  void handle(int connection);
+  // Interrupts the requests whose clients hang up while they run, and all of
+  // them once the server stops.
+  void watchRequests();
+  auto startWatching(int connection, std::atomic<bool>* interrupt) -> uint64_t;
+  void stopWatching(uint64_t id);
+  void wakeWatcher();
+
+  std::shared_ptr<const Evaluator::PreparedSnapshot> prelude;
+  unsigned jobs;
+  ScriptOptions options;
+  std::chrono::milliseconds requestTimeout = std::chrono::seconds(10);
+  std::string socketPath;
+  int listener = -1;
+  // stop() writes to the write end to wake up the threads waiting in poll().
+  int wakeUp[2] = {-1, -1};
+  std::atomic<bool> stopping = false;
+
+  std::mutex runningMutex;
+  std::vector<Running> running;
+  uint64_t lastId = 0;
+  // wakeWatcher() writes to the write end to have the watcher poll the
+  // connections running now.
+  int runningChanged[2] = {-1, -1};
+};
+
+}  // namespace cpplox
+
+#endif  // CPPLOX_INTERPRETERDRIVER_SERVER_H
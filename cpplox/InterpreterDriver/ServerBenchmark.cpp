@@ -0,0 +1,133 @@
+// Latency of running a small script that uses a large prelude on a Server,
+// next to starting a process for it, with the prelude in the script or
+// restored from a snapshot. Run with:
+//   bazel run -c opt //cpplox/InterpreterDriver:server_benchmark --
+//       [requests] [path/to/cpplox [path/to/cpplox-client]]
+// The process timings are only run if given the binaries (built with
+// bazel build -c opt //cpplox:all) to run.
+#include <fcntl.h>
+#include <spawn.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "cpplox/InterpreterDriver/InterpreterDriver.h"
+#include "cpplox/InterpreterDriver/Server.h"
+#include "cpplox/InterpreterDriver/ServerProtocol.h"
+
+extern char** environ;
+
+namespace {
+
+// Library functions full of arithmetic, calls, conditionals and loops.
+auto generatePrelude(int functions) -> std::string {
+  std::string source;
+  for (int i = 0; i < functions; ++i) {
+    const std::string n = std::to_string(i);
+    source += "fun lib" + n + "(a, b) {\n"
+              + "  var x = (a + b) * 2 - a / (b + 1);\n"
+              + "  if (a < b and b >= " + n + " or a != 0) {\n"
+              + "    for (var i = 0; i < 3; i = i + 1) x = x + i;\n"
+              + "  } else {\n"
+              + "    while (b > 0) b = b - 1;\n"
+              + "  }\n"
+              + "  return x;\n"
+              + "}\n";
+  }
+  return source;
+}
+
+auto secondsSince(std::chrono::steady_clock::time_point start) -> double {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now()
+                                       - start)
+      .count();
+}
+
+// Runs argv with its output thrown away, and waits for it.
+auto spawn(const std::vector<std::string>& args) -> bool {
+  std::vector<char*> argv;
+  for (const std::string& arg : args)
+    argv.push_back(const_cast<char*>(arg.c_str()));
+  argv.push_back(nullptr);
+  posix_spawn_file_actions_t actions;
+  posix_spawn_file_actions_init(&actions);
+  posix_spawn_file_actions_addopen(&actions, 1, "/dev/null", O_WRONLY, 0);
+  pid_t pid;
+  const int error
+      = posix_spawn(&pid, argv[0], &actions, nullptr, argv.data(), environ);
+  posix_spawn_file_actions_destroy(&actions);
+  int status = 0;
+  return error == 0 && waitpid(pid, &status, 0) == pid && WIFEXITED(status)
+         && WEXITSTATUS(status) == 0;
+}
+
+void report(std::string_view what, double seconds, int requests) {
+  std::cout << "  " << what << ": " << seconds * 1e6 / requests
+            << " us/request\n";
+}
+
+}  // namespace
+
+auto main(int argc, char const* argv[]) -> int {
+  const int requests = argc > 1 ? std::atoi(argv[1]) : 200;
+  const std::string cpplox = argc > 2 ? argv[2] : "";
+  const std::string client = argc > 3 ? argv[3] : "";
+
+  const std::string base = "/tmp/cpplox_server_benchmark_"
+                           + std::to_string(::getpid());
+  const std::string prelude = generatePrelude(1000);
+  const std::string script = "print lib7(3, 4) + lib999(1, 2);\n";
+  std::ofstream(base + ".lox") << script;
+  std::ofstream(base + "_whole.lox") << prelude << script;
+  std::ofstream(base + "_prelude.lox") << prelude;
+
+  cpplox::InterpreterDriver preludeDriver;
+  if (preludeDriver.runSource(prelude) != 0) return 1;
+  cpplox::Server server(preludeDriver.snapshot().value(), 1);
+  if (!server.listen(base + ".sock")) return 1;
+  std::thread serving([&]() { server.serve(); });
+
+  std::cout << requests << " requests for a one-line script using a "
+            << prelude.size() / 1024 << " KB prelude\n";
+  const cpplox::ServerProtocol::Request request{{}, base + ".lox", true};
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < requests; ++i) {
+    cpplox::ServerProtocol::runOnServer(base + ".sock", request,
+                                        [](bool, std::string_view) {});
+  }
+  report("server, from this process", secondsSince(start), requests);
+
+  if (!client.empty()) {
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < requests; ++i)
+      spawn({client, base + ".sock", base + ".lox"});
+    report("server, via cpplox-client", secondsSince(start), requests);
+  }
+  if (!cpplox.empty()) {
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < requests; ++i) spawn({cpplox, base + "_whole.lox"});
+    report("fork/exec, prelude in the script", secondsSince(start), requests);
+
+    spawn({cpplox, "--snapshot=" + base + ".snap", base + "_prelude.lox"});
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < requests; ++i)
+      spawn({cpplox, "--from-snapshot=" + base + ".snap", base + ".lox"});
+    report("fork/exec, prelude from a snapshot", secondsSince(start),
+           requests);
+  }
+
+  server.stop();
+  serving.join();
+  for (const char* suffix : {".lox", "_whole.lox", "_prelude.lox", ".snap"})
+    std::remove((base + suffix).c_str());
+  return 0;
+}
@@ -0,0 +1,223 @@
+#include "cpplox/InterpreterDriver/ServerProtocol.h"
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+
+namespace cpplox::ServerProtocol {
+
+namespace {
+
+// Longer headers, or bigger payloads, mean it isn't one of our records.
+const size_t MAX_HEADER = 32;
+const size_t MAX_PAYLOAD = size_t{1} << 30;
+
+#ifdef MSG_NOSIGNAL
+const int SEND_FLAGS = MSG_NOSIGNAL;  // EPIPE instead of SIGPIPE.
+#else
+const int SEND_FLAGS = 0;
+#endif
+
+auto sendAll(int fd, std::string_view data) -> bool {
+  while (!data.empty()) {
+    const ssize_t sent = ::send(fd, data.data(), data.size(), SEND_FLAGS);
+    if (sent < 0) {
+      if (errno == EINTR) continue;
+      return false;
+    }
+    data.remove_prefix(static_cast<size_t>(sent));
+  }
+  return true;
+}
+
+auto makeAddress(const std::string& path, sockaddr_un& address) -> bool {
+  std::memset(&address, 0, sizeof(address));
+  address.sun_family = AF_UNIX;
+  if (path.size() >= sizeof(address.sun_path)) {
+    errno = ENAMETOOLONG;
+    return false;
+  }
+  std::memcpy(address.sun_path, path.data(), path.size());
+  return true;
+}
+
+auto newSocket() -> int {
+  const int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+#ifdef SO_NOSIGPIPE
+  if (fd >= 0) {
+    const int on = 1;
+    ::setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+  }
+#endif
+  return fd;
+}
+
+}  // namespace
+
+auto writeRecord(int fd, std::string_view tag, std::string_view payload)
+    -> bool {
+  std::string record;
+  record.reserve(tag.size() + payload.size() + 24);
+  record.append(tag).append(" ").append(std::to_string(payload.size()));
+  record += '\n';
+  record.append(payload);
+  return sendAll(fd, record);
+}
+
+RecordReader::RecordReader(int fd) : fd(fd) {}
+
+auto RecordReader::fill() -> bool {
+  // Drop what's been consumed before reading more.
+  buffer.erase(0, start);
+  start = 0;
+  char chunk[64 * 1024];
+  for (;;) {
+    if (deadline.has_value()) {
+      const auto left = std::chrono::ceil<std::chrono::milliseconds>(
+          *deadline - std::chrono::steady_clock::now());
+      pollfd readable{fd, POLLIN, 0};
+      const int ready
+          = left.count() > 0
+                ? ::poll(&readable, 1, static_cast<int>(left.count()))
+                : 0;
+      if (ready < 0 && errno == EINTR) continue;
+      if (ready == 0) timedOut = true;
+      if (ready <= 0) return false;
+    }
+    const ssize_t got = ::read(fd, chunk, sizeof(chunk));
+    if (got > 0) {
+      buffer.append(chunk, static_cast<size_t>(got));
+      return true;
+    }
+    if (got < 0 && errno == EINTR) continue;
+    return false;
+  }
+}
+
+auto RecordReader::next() -> std::optional<Record> {
+  size_t newline;
+  while ((newline = buffer.find('\n', start)) == std::string::npos) {
+    if (buffer.size() - start > MAX_HEADER || !fill()) return std::nullopt;
+  }
+  const std::string_view header(buffer.data() + start, newline - start);
+  const size_t space = header.find(' ');
+  if (space == std::string_view::npos || space == 0
+      || header.size() > MAX_HEADER)
+    return std::nullopt;
+  const std::string length(header.substr(space + 1));
+  char* end = nullptr;
+  const unsigned long long size = std::strtoull(length.c_str(), &end, 10);
+  if (length.empty() || *end != 0 || size > MAX_PAYLOAD) return std::nullopt;
+
+  Record record{std::string(header.substr(0, space)), ""};
+  start = newline + 1;
+  while (buffer.size() - start < size) {
+    if (!fill()) return std::nullopt;
+  }
+  record.payload = buffer.substr(start, size);
+  start += size;
+  return record;
+}
+
+void RecordReader::setDeadline(
+    std::chrono::steady_clock::time_point deadline) {
+  this->deadline = deadline;
+}
+
+auto RecordReader::hasTimedOut() const -> bool { return timedOut; }
+
+auto writeRequest(int fd, const Request& request) -> bool {
+  for (const std::string& argument : request.arguments) {
+    if (!writeRecord(fd, "arg", argument)) return false;
+  }
+  return writeRecord(fd, request.isPath ? "path" : "source", request.script);
+}
+
+auto readRequest(RecordReader& reader) -> std::optional<Request> {
+  Request request;
+  while (std::optional<Record> record = reader.next()) {
+    if (record->tag == "arg") {
+      if (request.arguments.size() == MAX_ARGUMENTS) break;
+      request.arguments.push_back(std::move(record->payload));
+    } else if (record->tag == "path" || record->tag == "source") {
+      request.isPath = record->tag == "path";
+      request.script = std::move(record->payload);
+      return request;
+    } else {
+      break;
+    }
+  }
+  return std::nullopt;
+}
+
+auto listenAt(const std::string& path) -> int {
+  sockaddr_un address;
+  if (!makeAddress(path, address)) return -1;
+  // A server that didn't shut down cleanly leaves its socket file behind,
+  // but anything else at path (say, a mistyped script) is left alone.
+  struct stat existing;
+  if (::lstat(path.c_str(), &existing) == 0) {
+    if (!S_ISSOCK(existing.st_mode)) {
+      errno = EEXIST;
+      return -1;
+    }
+    ::unlink(path.c_str());
+  }
+  const int fd = newSocket();
+  if (fd < 0) return -1;
+  if (::bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0
+      || ::listen(fd, SOMAXCONN) != 0) {
+    const int error = errno;
+    ::close(fd);
+    errno = error;
+    return -1;
+  }
+  return fd;
+}
+
+auto connectTo(const std::string& path) -> int {
+  sockaddr_un address;
+  if (!makeAddress(path, address)) return -1;
+  const int fd = newSocket();
+  if (fd < 0) return -1;
+  if (::connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address))
+      != 0) {
+    const int error = errno;
+    ::close(fd);
+    errno = error;
+    return -1;
+  }
+  return fd;
+}
+
+auto runOnServer(
+    const std::string& socketPath, const Request& request,
+    const std::function<void(bool isError, std::string_view text)>& onOutput)
+    -> std::optional<int> {
+  const int fd = connectTo(socketPath);
+  if (fd < 0) return std::nullopt;
+  std::optional<int> exitCode;
+  // The server may turn a request down before reading all of it and hang up,
+  // so an answer can be waiting even if the write failed.
+  writeRequest(fd, request);
+  RecordReader reader(fd);
+  while (std::optional<Record> record = reader.next()) {
+    if (record->tag == "out" || record->tag == "err") {
+      onOutput(record->tag == "err", record->payload);
+    } else {
+      if (record->tag == "exit") exitCode = std::atoi(record->payload.c_str());
+      break;
+    }
+  }
+  ::close(fd);
+  return exitCode;
+}
+
+}  // namespace cpplox::ServerProtocol
@@ -0,0 +1,90 @@
+#ifndef CPPLOX_INTERPRETERDRIVER_SERVERPROTOCOL_H
+#define CPPLOX_INTERPRETERDRIVER_SERVERPROTOCOL_H
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// How `cpplox --serve` and its clients talk over a Unix domain socket. Both
+// directions are a sequence of records: a tag, a space, the payload's length
+// in decimal, a newline, and then the payload.
+//   request:  an "arg" record for each of the script's arguments, in order,
+//             then either a "path" record naming a script file (which the
+//             server opens) or a "source" record with the script itself.
+//   response: "out" and "err" records with the script's output and errors as
+//             they're flushed, then an "exit" record with its exit code.
+// The server handles one request per connection.
+namespace cpplox::ServerProtocol {
+
+// Requests with more "arg" records than this are bad requests.
+constexpr size_t MAX_ARGUMENTS = 4096;
+
+struct Record {
+  std::string tag;
+  std::string payload;
+};
+
+// Sends one record; false if the other end has gone away.
+auto writeRecord(int fd, std::string_view tag, std::string_view payload)
+    -> bool;
+
+// Reads records off a socket, buffering what it reads ahead.
+class RecordReader {
+ public:
+  explicit RecordReader(int fd);
+
+  // The next record; std::nullopt at the end of the stream, or if what's
+  // there isn't a record.
+  auto next() -> std::optional<Record>;
+
+  // Reads past deadline fail, as if the stream had ended there.
+  void setDeadline(std::chrono::steady_clock::time_point deadline);
+  // Whether a read failed because the deadline passed.
+  [[nodiscard]] auto hasTimedOut() const -> bool;
+
+ private:
+  // Reads more into buffer; false if there's nothing more.
+  auto fill() -> bool;
+
+  int fd;
+  std::string buffer;
+  size_t start = 0;
+  std::optional<std::chrono::steady_clock::time_point> deadline;
+  bool timedOut = false;
+};
+
+struct Request {
+  std::vector<std::string> arguments;
+  // A path to a script file if isPath, else the script's source.
+  std::string script;
+  bool isPath = false;
+};
+
+auto writeRequest(int fd, const Request& request) -> bool;
+// std::nullopt if the records read don't make up a request, or it has more
+// than MAX_ARGUMENTS arguments.
+auto readRequest(RecordReader& reader) -> std::optional<Request>;
+
+// A socket listening at path, replacing whatever stale socket is there; -1
+// (with errno set) if it can't be made, or if something other than a socket
+// is at path (EEXIST).
+auto listenAt(const std::string& path) -> int;
+// A socket connected to the server listening at path, or -1.
+auto connectTo(const std::string& path) -> int;
+
+// Has the server listening at socketPath run request, passing what the script
+// prints to onOutput as it arrives (isError for errors). Returns the script's
+// exit code, or std::nullopt if the server couldn't be reached or hung up.
+auto runOnServer(
+    const std::string& socketPath, const Request& request,
+    const std::function<void(bool isError, std::string_view text)>& onOutput)
+    -> std::optional<int>;
+
+}  // namespace cpplox::ServerProtocol
+
+#endif  // CPPLOX_INTERPRETERDRIVER_SERVERPROTOCOL_H
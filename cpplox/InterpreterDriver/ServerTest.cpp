@@ -0,0 +1,269 @@
+#include "gtest/gtest.h"
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <chrono>
+#include <fstream>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "cpplox/InterpreterDriver/InterpreterDriver.h"
+#include "cpplox/InterpreterDriver/Server.h"
+#include "cpplox/InterpreterDriver/ServerProtocol.h"
+
+namespace cpplox {
+
+namespace {
+
+using ServerProtocol::Request;
+
+struct Response {
+  std::optional<int> exitCode;
+  std::string out;
+  std::string err;
+};
+
+class ServerTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    // Socket paths have to be short, so not under TEST_TMPDIR.
+    socketPath = "/tmp/cpplox_server_test_" + std::to_string(::getpid());
+    InterpreterDriver prelude;
+    ASSERT_EQ(0, prelude.runSource(
+                     "var greeting = \"hello\";\n"
+                     "var counter = 0;\n"
+                     "fun greet(name) {\n"
+                     "  counter = counter + 1;\n"
+                     "  return greeting + \", \" + name;\n"
+                     "}\n"));
+    server = std::make_unique<Server>(prelude.snapshot().value(), 4);
+    ASSERT_TRUE(server->listen(socketPath));
+    serving = std::thread([this]() { server->serve(); });
+  }
+
+  void TearDown() override {
+    if (server == nullptr) return;
+    server->stop();
+    if (serving.joinable()) serving.join();
+    server.reset();
+    EXPECT_NE(0, ::access(socketPath.c_str(), F_OK));
+  }
+
+  auto run(const Request& request) -> Response {
+    Response response;
+    response.exitCode = ServerProtocol::runOnServer(
+        socketPath, request, [&](bool isError, std::string_view text) {
+          (isError ? response.err : response.out).append(text);
+        });
+    return response;
+  }
+
+  std::string socketPath;
+  std::unique_ptr<Server> server;
+  std::thread serving;
+};
+
+}  // namespace
+
+TEST_F(ServerTest, runs_each_request_on_a_fresh_copy_of_the_prelude) {
+  const Request greet{{"world"},
+                      "print greet(args.get(0));\n"
+                      "print counter;\n"
+                      "var leaked = true;\n"};
+  for (int i = 0; i < 2; ++i) {
+    const Response response = run(greet);
+    EXPECT_EQ(0, response.exitCode);
+    EXPECT_EQ(">hello, world\n>1\n", response.out);
+    EXPECT_EQ("", response.err);
+  }
+  const Response leaked = run({{}, "print leaked;\n"});
+  EXPECT_EQ(0, leaked.exitCode);
+  EXPECT_NE(std::string::npos, leaked.err.find("undefined variable"));
+}
+
+TEST_F(ServerTest, reports_errors_and_exit_codes) {
+  const Response syntax = run({{}, "print 1;\nvar = 2;\n"});
+  EXPECT_EQ(65, syntax.exitCode);
+  EXPECT_EQ("", syntax.out);
+  EXPECT_NE(std::string::npos, syntax.err.find("[Line 2] Error"));
+
+  const std::string script = socketPath + ".lox";
+  std::ofstream(script) << "print args.get(1);\n";
+  const Response fromPath = run({{"a", "b"}, script, true});
+  ::unlink(script.c_str());
+  EXPECT_EQ(0, fromPath.exitCode);
+  EXPECT_EQ(">b\n", fromPath.out);
+
+  const int connection = ServerProtocol::connectTo(socketPath);
+  ASSERT_GE(connection, 0);
+  ASSERT_TRUE(ServerProtocol::writeRecord(connection, "bogus", "abc"));
+  ServerProtocol::RecordReader reader(connection);
+  std::optional<ServerProtocol::Record> record;
+  while ((record = reader.next()) && record->tag != "exit") {
+  }
+  ::close(connection);
+  ASSERT_TRUE(record.has_value());
+  EXPECT_EQ("64", record->payload);
+}
+
+TEST_F(ServerTest, rejects_requests_with_too_many_arguments) {
+  const Request request{
+      std::vector<std::string>(ServerProtocol::MAX_ARGUMENTS + 1, "x"),
+      "print 1;\n"};
+  const Response response = run(request);
+  EXPECT_EQ(64, response.exitCode);
+  EXPECT_EQ("", response.out);
+}
+
+TEST(ServerTimeoutTest, drops_clients_that_never_send_a_request) {
+  const std::string path
+      = "/tmp/cpplox_timeout_test_" + std::to_string(::getpid());
+  // One thread, so a client holding on to it would stall the rest.
+  Server server("", 1);
+  server.setRequestTimeout(std::chrono::milliseconds(100));
+  ASSERT_TRUE(server.listen(path));
+  std::thread serving([&]() { server.serve(); });
+
+  const int idle = ServerProtocol::connectTo(path);
+  ASSERT_GE(idle, 0);
+  Response response;
+  response.exitCode = ServerProtocol::runOnServer(
+      path, {{}, "print 1;\n"}, [&](bool isError, std::string_view text) {
+        (isError ? response.err : response.out).append(text);
+      });
+  EXPECT_EQ(0, response.exitCode);
+  EXPECT_EQ(">1\n", response.out);
+  // The idle connection was closed without an answer.
+  char byte;
+  EXPECT_EQ(0, ::read(idle, &byte, 1));
+  ::close(idle);
+
+  server.stop();
+  serving.join();
+}
+
+TEST(ServerHangUpTest, stops_the_script_of_a_client_that_hangs_up) {
+  const std::string path
+      = "/tmp/cpplox_hang_up_test_" + std::to_string(::getpid());
+  // One thread, so a script left running would stall the rest.
+  Server server("", 1);
+  ASSERT_TRUE(server.listen(path));
+  std::thread serving([&]() { server.serve(); });
+
+  // The loop prints nothing, so there's no failed write to give it away.
+  const int leaving = ServerProtocol::connectTo(path);
+  ASSERT_GE(leaving, 0);
+  ASSERT_TRUE(ServerProtocol::writeRequest(leaving, {{}, "while (true) {}\n"}));
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  ::close(leaving);
+
+  const auto start = std::chrono::steady_clock::now();
+  Response response;
+  response.exitCode = ServerProtocol::runOnServer(
+      path, {{}, "print 1;\n"}, [&](bool isError, std::string_view text) {
+        (isError ? response.err : response.out).append(text);
+      });
+  EXPECT_EQ(0, response.exitCode);
+  EXPECT_EQ(">1\n", response.out);
+  EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::seconds(5));
+
+  server.stop();
+  serving.join();
+}
+
+TEST(ServerHangUpTest, stopping_interrupts_running_scripts) {
+  const std::string path
+      = "/tmp/cpplox_stop_test_" + std::to_string(::getpid());
+  Server server("", 1);
+  ASSERT_TRUE(server.listen(path));
+  std::thread serving([&]() { server.serve(); });
+
+  std::optional<int> exitCode;
+  std::thread client([&]() {
+    exitCode = ServerProtocol::runOnServer(
+        path, {{}, "while (true) {}\n"}, [](bool, std::string_view) {});
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  const auto start = std::chrono::steady_clock::now();
+  server.stop();
+  serving.join();
+  client.join();
+  EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::seconds(5));
+  // Stopped as a runtime error.
+  EXPECT_EQ(70, exitCode);
+}
+
+TEST_F(ServerTest, serves_clients_concurrently) {
+  std::vector<std::thread> clients;
+  std::vector<int> failures(16);
+  for (int i = 0; i < 16; ++i) {
+    clients.emplace_back([&, i]() {
+      const std::string name = "client" + std::to_string(i);
+      const Request request{{name}, "print greet(args.get(0));\n"};
+      for (int j = 0; j < 10; ++j) {
+        const Response response = run(request);
+        if (response.exitCode != 0 || response.out != ">hello, " + name + "\n")
+          ++failures[i];
+      }
+    });
+  }
+  for (auto& client : clients) client.join();
+  EXPECT_EQ(std::vector<int>(16), failures);
+}
+
+TEST(ServerProtocolTest, listening_only_replaces_a_stale_socket) {
+  const std::string path
+      = "/tmp/cpplox_listen_test_" + std::to_string(::getpid());
+  std::ofstream(path) << "not a socket\n";
+  errno = 0;
+  EXPECT_EQ(-1, ServerProtocol::listenAt(path));
+  EXPECT_EQ(EEXIST, errno);
+  std::string contents;
+  std::getline(std::ifstream(path), contents);
+  EXPECT_EQ("not a socket", contents);
+  ::unlink(path.c_str());
+
+  // A socket left behind is replaced.
+  int fd = ServerProtocol::listenAt(path);
+  ASSERT_GE(fd, 0);
+  ::close(fd);
+  fd = ServerProtocol::listenAt(path);
+  EXPECT_GE(fd, 0);
+  ::close(fd);
+  ::unlink(path.c_str());
+}
+
+TEST(ServerProtocolTest, records_round_trip) {
+  int ends[2];
+  ASSERT_EQ(0, ::socketpair(AF_UNIX, SOCK_STREAM, 0, ends));
+  const std::string big(100000, 'x');
+  std::thread writer([&]() {
+    ServerProtocol::writeRecord(ends[1], "out", "a\nb");
+    ServerProtocol::writeRecord(ends[1], "err", "");
+    ServerProtocol::writeRecord(ends[1], "out", big);
+    ::close(ends[1]);
+  });
+  ServerProtocol::RecordReader reader(ends[0]);
+  std::optional<ServerProtocol::Record> record = reader.next();
+  ASSERT_TRUE(record);
+  EXPECT_EQ("out", record->tag);
+  EXPECT_EQ("a\nb", record->payload);
+  record = reader.next();
+  ASSERT_TRUE(record);
+  EXPECT_EQ("err", record->tag);
+  EXPECT_EQ("", record->payload);
+  record = reader.next();
+  ASSERT_TRUE(record);
+  EXPECT_EQ(big, record->payload);
+  EXPECT_FALSE(reader.next());
+  writer.join();
+  ::close(ends[0]);
+}
+
+}  // namespace cpplox
@@ -0,0 +1,68 @@
+#include "cpplox/InterpreterDriver/SourceFile.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+
+namespace cpplox {
+
+namespace {
+
+// Reads fd until EOF. Returns false on a read error.
+auto readAll(int fd, std::string& out) -> bool {
+  char chunk[64 * 1024];
+  while (true) {
+    ssize_t n = ::read(fd, chunk, sizeof chunk);
+    if (n == 0) return true;
+    if (n < 0) {
+      if (errno == EINTR) continue;
+      return false;
+    }
+    out.append(chunk, static_cast<size_t>(n));
+  }
+}
+
+}  // namespace
+
+auto SourceFile::open(const char* const path) -> std::unique_ptr<SourceFile> {
+  const bool isStdin = std::strcmp(path, "-") == 0;
+  const int fd = isStdin ? STDIN_FILENO : ::open(path, O_RDONLY | O_CLOEXEC);
+  if (fd < 0) return nullptr;
+
+  std::unique_ptr<SourceFile> source(new SourceFile());
+  bool ok = true;
+  struct stat info {};
+  if (::fstat(fd, &info) == 0 && S_ISREG(info.st_mode) && info.st_size > 0) {
+    const auto size = static_cast<size_t>(info.st_size);
+    void* addr = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (addr != MAP_FAILED) {
+      ::madvise(addr, size, MADV_SEQUENTIAL);
+      source->mapping = addr;
+      source->mappingSize = size;
+    } else {
+      ok = readAll(fd, source->contents);
+    }
+  } else {
+    ok = readAll(fd, source->contents);
+  }
+
+  if (!isStdin) ::close(fd);  // an established mapping outlives the fd
+  if (!ok) return nullptr;
+  return source;
+}
+
+SourceFile::~SourceFile() {
+  if (mapping != nullptr) ::munmap(mapping, mappingSize);
+}
+
+auto SourceFile::view() const -> std::string_view {
+  if (mapping != nullptr)
+    return std::string_view(static_cast<const char*>(mapping), mappingSize);
+  return contents;
+}
+
+}  // namespace cpplox
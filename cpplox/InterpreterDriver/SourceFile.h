@@ -0,0 +1,37 @@
+#ifndef CPPLOX_INTERPRETERDRIVER_SOURCEFILE_H
+#define CPPLOX_INTERPRETERDRIVER_SOURCEFILE_H
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <string_view>
+
+#include "cpplox/Types/Uncopyable.h"
+
+namespace cpplox {
+
+// The bytes of a script. Regular files are mmap'd read-only, so loading a
+// script costs no copy and no per-character reads; the scanner walks the
+// mapped pages directly. Pipes, stdin ("-") and anything else that can't be
+// mapped are read into a string instead. Either way view() stays valid for
+// the lifetime of the SourceFile.
+class SourceFile : public Types::Uncopyable {
+ public:
+  // Returns nullptr if the file can't be opened or read.
+  static auto open(const char* path) -> std::unique_ptr<SourceFile>;
+  ~SourceFile() override;
+
+  [[nodiscard]] auto view() const -> std::string_view;
+
+ private:
+  SourceFile() = default;
+
+  void* mapping = nullptr;
+  size_t mappingSize = 0;
+  std::string contents;  // used when the input isn't mapped
+};
+
+}  // namespace cpplox
+
+#endif  // CPPLOX_INTERPRETERDRIVER_SOURCEFILE_H
@@ -0,0 +1,85 @@
+// Startup benchmark: generates a large lox script and times loading it the
+// old way (istreambuf_iterator into a std::string) against SourceFile, with
+// and without scanning. Run with:
+//   bazel run -c opt //cpplox/InterpreterDriver:source_file_benchmark -- [MB]
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <string_view>
+
+#include "cpplox/ErrorsAndDebug/ErrorReporter.h"
+#include "cpplox/InterpreterDriver/SourceFile.h"
+#include "cpplox/Scanner/Scanner.h"
+
+namespace {
+
+void generateScript(const std::string& path, size_t megabytes) {
+  std::ofstream out(path);
+  size_t written = 0;
+  for (size_t i = 0; written < megabytes * 1024 * 1024; ++i) {
+    std::string line = "var v" + std::to_string(i) + " = " + std::to_string(i)
+                       + " * 2 + 0.5; // generated\n"
+                       + "print \"line \" + v" + std::to_string(i) + ";\n";
+    out << line;
+    written += line.size();
+  }
+}
+
+// Sums the bytes so the compiler can't skip reading them.
+auto checksum(std::string_view bytes) -> size_t {
+  size_t sum = 0;
+  for (char c : bytes) sum += static_cast<unsigned char>(c);
+  return sum;
+}
+
+template <typename Fn>
+void bench(const std::string& name, Fn fn) {
+  auto start = std::chrono::steady_clock::now();
+  size_t result = fn();
+  auto end = std::chrono::steady_clock::now();
+  std::cout << name << ": "
+            << std::chrono::duration<double, std::milli>(end - start).count()
+            << " ms (" << result << ")" << std::endl;
+}
+
+}  // namespace
+
+auto main(int argc, char const* argv[]) -> int {
+  const size_t megabytes = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 16;
+  const char* dir = std::getenv("TMPDIR");
+  const std::string path = std::string(dir != nullptr ? dir : "/tmp")
+                           + "/cpplox_source_file_benchmark.lox";
+  generateScript(path, megabytes);
+  std::cout << "Generated " << megabytes << " MB script" << std::endl;
+
+  bench("load: istreambuf_iterator", [&]() {
+    std::ifstream in(path, std::ios::in);
+    std::string source{std::istreambuf_iterator<char>{in},
+                       std::istreambuf_iterator<char>{}};
+    return checksum(source);
+  });
+  bench("load: SourceFile", [&]() {
+    return checksum(cpplox::SourceFile::open(path.c_str())->view());
+  });
+  bench("load + scan: istreambuf_iterator", [&]() {
+    std::ifstream in(path, std::ios::in);
+    std::string source{std::istreambuf_iterator<char>{in},
+                       std::istreambuf_iterator<char>{}};
+    cpplox::ErrorsAndDebug::ErrorReporter eReporter;
+    return cpplox::Scanner(source, eReporter).tokenize().tokens.size();
+  });
+  bench("load + scan: SourceFile", [&]() {
+    auto source = cpplox::SourceFile::open(path.c_str());
+    cpplox::ErrorsAndDebug::ErrorReporter eReporter;
+    return cpplox::Scanner(source->view(), eReporter)
+        .tokenize()
+        .tokens.size();
+  });
+
+  std::remove(path.c_str());
+  return 0;
+}
@@ -0,0 +1,54 @@
+#include "gtest/gtest.h"
+
+#include <sys/stat.h>
+
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <thread>
+
+#include "cpplox/InterpreterDriver/SourceFile.h"
+#include "cpplox/TestUtil/TestUtil.h"
+
+namespace cpplox {
+
+TEST(SourceFileTest, maps_regular_files) {
+  const std::string path = TestUtil::tempPath("source_file_test_");
+  const std::string contents = "print \"hello\";\nprint 1 + 2;\n";
+  std::ofstream(path) << contents;
+
+  auto source = SourceFile::open(path.c_str());
+  ASSERT_NE(nullptr, source);
+  EXPECT_EQ(contents, source->view());
+  std::remove(path.c_str());
+  // The mapping stays readable after the file is unlinked.
+  EXPECT_EQ(contents, source->view());
+}
+
+TEST(SourceFileTest, empty_file_is_empty) {
+  const std::string path = TestUtil::tempPath("source_file_empty_");
+  std::ofstream{path};
+  auto source = SourceFile::open(path.c_str());
+  ASSERT_NE(nullptr, source);
+  EXPECT_TRUE(source->view().empty());
+  std::remove(path.c_str());
+}
+
+TEST(SourceFileTest, reads_pipes) {
+  const std::string path = TestUtil::tempPath("source_file_fifo_");
+  ASSERT_EQ(0, ::mkfifo(path.c_str(), 0600));
+  const std::string contents(200 * 1024, 'x');
+  std::thread writer([&]() { std::ofstream(path) << contents; });
+
+  auto source = SourceFile::open(path.c_str());
+  writer.join();
+  ASSERT_NE(nullptr, source);
+  EXPECT_EQ(contents, source->view());
+  std::remove(path.c_str());
+}
+
+TEST(SourceFileTest, missing_file_is_null) {
+  EXPECT_EQ(nullptr, SourceFile::open("no/such/file.lox"));
+}
+
+}  // namespace cpplox
@@ -0,0 +1,118 @@
+#include "cpplox/Output/OutputBuffer.h"
+
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
+#include "cpplox/Types/Number.h"
+
+namespace cpplox::Output {
+
+namespace {
+
+thread_local OutputBuffer* currentOut = nullptr;
+thread_local OutputBuffer* currentErr = nullptr;
+
+}  // namespace
+
+OutputBuffer::OutputBuffer(std::FILE* stream, BufferMode mode,
+                           size_t capacity)
+    : stream(stream),
+      mode(mode),
+      capacity(std::max(capacity, Types::MAX_NUMBER_CHARS)),
+      buffer(new char[this->capacity]) {}
+
+OutputBuffer::OutputBuffer(std::string& sink, BufferMode mode,
+                           size_t capacity)
+    : OutputBuffer([&sink](std::string_view str) { sink.append(str); }, mode,
+                   capacity) {}
+
+OutputBuffer::OutputBuffer(std::function<void(std::string_view)> sink,
+                           BufferMode mode, size_t capacity)
+    : sink(std::move(sink)),
+      mode(mode),
+      capacity(std::max(capacity, Types::MAX_NUMBER_CHARS)),
+      buffer(new char[this->capacity]) {}
+
+OutputBuffer::~OutputBuffer() { flush(); }
+
+void OutputBuffer::reserve(size_t n) {
+  if (capacity - used < n) flush();
+}
+
+void OutputBuffer::write(std::string_view str) {
+  // Strings larger than the whole buffer go straight to the stream.
+  if (str.size() > capacity) {
+    flush();
+    emit(str.data(), str.size());
+    return;
+  }
+  reserve(str.size());
+  std::memcpy(buffer.get() + used, str.data(), str.size());
+  used += str.size();
+}
+
+void OutputBuffer::write(char c) {
+  reserve(1);
+  buffer[used++] = c;
+}
+
+void OutputBuffer::writeNumber(double value) {
+  reserve(Types::MAX_NUMBER_CHARS);
+  char* const start = buffer.get() + used;
+  used += Types::formatNumber(value, start, start + Types::MAX_NUMBER_CHARS)
+          - start;
+}
+
+void OutputBuffer::endLine() {
+  write('\n');
+  if (mode == BufferMode::LINE) flush();
+}
+
+void OutputBuffer::flush() {
+  if (used != 0) {
+    emit(buffer.get(), used);
+    used = 0;
+  }
+  if (stream != nullptr) std::fflush(stream);
+}
+
+void OutputBuffer::emit(const char* data, size_t size) {
+  if (sink)
+    sink(std::string_view(data, size));
+  else
+    std::fwrite(data, 1, size, stream);
+}
+
+void OutputBuffer::setMode(BufferMode newMode) {
+  mode = newMode;
+  if (mode == BufferMode::LINE) flush();
+}
+
+auto OutputBuffer::getMode() const -> BufferMode { return mode; }
+
+auto stdOut() -> OutputBuffer& {
+  if (currentOut != nullptr) return *currentOut;
+  // Destroyed (and so flushed) by exit() and on return from main.
+  static OutputBuffer out(stdout);
+  return out;
+}
+
+auto stdErr() -> OutputBuffer& {
+  if (currentErr != nullptr) return *currentErr;
+  static OutputBuffer err(stderr, BufferMode::LINE);
+  return err;
+}
+
+Redirect::Redirect(OutputBuffer& out, OutputBuffer& err)
+    : previousOut(currentOut), previousErr(currentErr) {
+  currentOut = &out;
+  currentErr = &err;
+}
+
+Redirect::~Redirect() {
+  currentOut = previousOut;
+  currentErr = previousErr;
+}
+
+}  // namespace cpplox::Output
@@ -0,0 +1,87 @@
+#ifndef CPPLOX_OUTPUT_OUTPUTBUFFER__H
+#define CPPLOX_OUTPUT_OUTPUTBUFFER__H
+#pragma once
+
+#include <cstddef>
+#include <cstdio>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+
+#include "cpplox/Types/Uncopyable.h"
+
+namespace cpplox::Output {
+
+enum class BufferMode {
+  LINE,  // flush after every line; for interactive use.
+  FULL,  // flush only when the buffer fills up, or on flush().
+};
+
+// A user-space buffer in front of a FILE*. print writes every line through
+// here, so a script that prints a million lines makes a handful of write
+// syscalls instead of a million. Values are formatted straight into the
+// buffer; nothing is flushed until the buffer is full, endLine() is called in
+// LINE mode, flush() is called, or the buffer is destroyed.
+// Anything that writes to the same terminal through another path (error
+// reporting, the REPL prompt) must flush() first to keep output in order.
+class OutputBuffer : public Types::Uncopyable {
+ public:
+  static const size_t DEFAULT_CAPACITY = 64 * 1024;
+
+  explicit OutputBuffer(std::FILE* stream, BufferMode mode = BufferMode::FULL,
+                        size_t capacity = DEFAULT_CAPACITY);
+  // Flushes by appending to sink instead, e.g. to capture a script's output.
+  explicit OutputBuffer(std::string& sink, BufferMode mode = BufferMode::FULL,
+                        size_t capacity = DEFAULT_CAPACITY);
+  // Flushes by passing what's buffered to sink, e.g. to send it elsewhere.
+  explicit OutputBuffer(std::function<void(std::string_view)> sink,
+                        BufferMode mode = BufferMode::FULL,
+                        size_t capacity = DEFAULT_CAPACITY);
+  ~OutputBuffer() override;
+
+  void write(std::string_view str);
+  void write(char c);
+  void writeNumber(double value);
+  // Terminates the current line, flushing if in LINE mode.
+  void endLine();
+  void flush();
+
+  void setMode(BufferMode newMode);
+  [[nodiscard]] auto getMode() const -> BufferMode;
+
+ private:
+  // Makes room for at least n more bytes, flushing if necessary.
+  void reserve(size_t n);
+  void emit(const char* data, size_t size);
+
+  std::FILE* stream = nullptr;
+  std::function<void(std::string_view)> sink;
+  BufferMode mode;
+  size_t capacity;
+  std::unique_ptr<char[]> buffer;
+  size_t used = 0;
+};
+
+// Where print writes: the buffer made current on this thread by the
+// innermost live Redirect, or else the process wide buffer in front of
+// stdout, which is flushed at exit.
+auto stdOut() -> OutputBuffer&;
+// Where errors are reported; the same, but in front of stderr and line
+// buffered.
+auto stdErr() -> OutputBuffer&;
+
+// Makes stdOut() and stdErr() on this thread out and err for as long as it
+// lives, so interpreters on different threads can each have their own.
+class Redirect : public Types::Uncopyable {
+ public:
+  Redirect(OutputBuffer& out, OutputBuffer& err);
+  ~Redirect() override;
+
+ private:
+  OutputBuffer* previousOut;
+  OutputBuffer* previousErr;
+};
+
+}  // namespace cpplox::Output
+#endif  // CPPLOX_OUTPUT_OUTPUTBUFFER__H
@@ -0,0 +1,107 @@
+#include "gtest/gtest.h"
+
+#include <cstdio>
+#include <string>
+#include <thread>
+
+#include "cpplox/Output/OutputBuffer.h"
+
+namespace cpplox::Output {
+
+namespace {
+
+auto contents(std::FILE* file) -> std::string {
+  std::fflush(file);
+  std::rewind(file);
+  std::string result;
+  int c;
+  while ((c = std::fgetc(file)) != EOF) result += static_cast<char>(c);
+  std::fseek(file, 0, SEEK_END);
+  return result;
+}
+
+}  // namespace
+
+TEST(OutputBufferTest, full_mode_holds_output_until_flushed) {
+  std::FILE* file = std::tmpfile();
+  OutputBuffer out(file, BufferMode::FULL);
+  out.write(">");
+  out.writeNumber(1.5);
+  out.endLine();
+  EXPECT_EQ("", contents(file));
+  out.flush();
+  EXPECT_EQ(">1.5\n", contents(file));
+  std::fclose(file);
+}
+
+TEST(OutputBufferTest, line_mode_flushes_every_line) {
+  std::FILE* file = std::tmpfile();
+  OutputBuffer out(file, BufferMode::LINE);
+  out.write("abc");
+  EXPECT_EQ("", contents(file));
+  out.endLine();
+  EXPECT_EQ("abc\n", contents(file));
+  std::fclose(file);
+}
+
+TEST(OutputBufferTest, flushes_when_full_and_on_destruction) {
+  std::FILE* file = std::tmpfile();
+  {
+    OutputBuffer out(file, BufferMode::FULL, 64);
+    for (int i = 0; i < 100; ++i) {
+      out.writeNumber(i);
+      out.endLine();
+    }
+    EXPECT_FALSE(contents(file).empty());
+    out.write(std::string(1000, 'x'));
+  }
+  std::string expected;
+  for (int i = 0; i < 100; ++i) expected += std::to_string(i) + "\n";
+  expected += std::string(1000, 'x');
+  EXPECT_EQ(expected, contents(file));
+  std::fclose(file);
+}
+
+TEST(OutputBufferTest, appends_to_a_string_sink) {
+  std::string sink = "old ";
+  {
+    OutputBuffer out(sink, BufferMode::FULL, 64);
+    out.write("new");
+    out.endLine();
+    EXPECT_EQ("old ", sink);
+    // Doesn't fit after what's buffered, so that goes out first.
+    out.write(std::string(62, 'x'));
+    EXPECT_EQ("old new\n", sink);
+  }
+  EXPECT_EQ("old new\n" + std::string(62, 'x'), sink);
+}
+
+TEST(OutputBufferTest, redirects_are_per_thread) {
+  std::string mainOut, mainErr, otherOut, otherErr;
+  OutputBuffer mainOutBuffer(mainOut, BufferMode::LINE);
+  OutputBuffer mainErrBuffer(mainErr, BufferMode::LINE);
+  {
+    Redirect redirect(mainOutBuffer, mainErrBuffer);
+    std::thread other([&]() {
+      OutputBuffer outBuffer(otherOut, BufferMode::LINE);
+      OutputBuffer errBuffer(otherErr, BufferMode::LINE);
+      Redirect redirect(outBuffer, errBuffer);
+      stdOut().write("other out");
+      stdOut().endLine();
+      stdErr().write("other err");
+      stdErr().endLine();
+    });
+    other.join();
+    stdOut().write("main out");
+    stdOut().endLine();
+    stdErr().write("main err");
+    stdErr().endLine();
+  }
+  EXPECT_NE(&mainOutBuffer, &stdOut());
+  EXPECT_EQ("main out\n", mainOut);
+  EXPECT_EQ("main err\n", mainErr);
+  EXPECT_EQ("other out\n", otherOut);
+  EXPECT_EQ("other err\n", otherErr);
+}
+
+}  // namespace cpplox::Output
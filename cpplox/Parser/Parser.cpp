@@ -1,40 +1,108 @@
 #include "cpplox/Parser/Parser.h"
 
+#include <array>
 #include <exception>
 #include <functional>
 #include <initializer_list>
 #include <memory>
 #include <optional>
+#include <string>
 #include <type_traits>
 #include <variant>
 #include <vector>
 
 #include "cpplox/ErrorsAndDebug/DebugPrint.h"
+#include "cpplox/Types/Uncopyable.h"
 
 namespace cpplox::Parser {
 
 using Types::Token;
 using Types::TokenType;
 
-RDParser::RDParser(const std::vector<Token>& p_tokens,
+namespace {
+
+constexpr size_t TOKEN_TYPES = static_cast<size_t>(TokenType::LOX_EOF) + 1;
+
+constexpr auto makeInfixPrecedences() -> std::array<Precedence, TOKEN_TYPES> {
+  std::array<Precedence, TOKEN_TYPES> table{};
+  auto set = [&table](TokenType type, Precedence precedence) {
+    table[static_cast<size_t>(type)] = precedence;
+  };
+  set(TokenType::COMMA, Precedence::COMMA);
+  set(TokenType::EQUAL, Precedence::ASSIGNMENT);
+  set(TokenType::QUESTION, Precedence::CONDITIONAL);
+  set(TokenType::OR, Precedence::OR);
+  set(TokenType::AND, Precedence::AND);
+  set(TokenType::BANG_EQUAL, Precedence::EQUALITY);
+  set(TokenType::EQUAL_EQUAL, Precedence::EQUALITY);
+  set(TokenType::GREATER, Precedence::COMPARISON);
+  set(TokenType::GREATER_EQUAL, Precedence::COMPARISON);
+  set(TokenType::LESS, Precedence::COMPARISON);
+  set(TokenType::LESS_EQUAL, Precedence::COMPARISON);
+  set(TokenType::MINUS, Precedence::TERM);
+  set(TokenType::PLUS, Precedence::TERM);
+  set(TokenType::SLASH, Precedence::FACTOR);
+  set(TokenType::STAR, Precedence::FACTOR);
+  return table;
+}
+
+constexpr std::array<Precedence, TOKEN_TYPES> infixPrecedences
+    = makeInfixPrecedences();
+
+constexpr auto infixPrecedence(TokenType type) -> Precedence {
+  return infixPrecedences[static_cast<size_t>(type)];
+}
+
+// The precedence one step tighter, for the right operand of a left
+// associative operator.
+constexpr auto tighter(Precedence precedence) -> Precedence {
+  return static_cast<Precedence>(static_cast<uint8_t>(precedence) + 1);
+}
+
+}  // namespace
+
+// Counts one level of nesting for as long as it lives. Going past MAX_NESTING
+// is reported and stops the parse: skipping to the next statement, as other
+// syntax errors do, would most likely land somewhere just as deep.
+class RDParser::NestingGuard : public Types::Uncopyable {
+ public:
+  explicit NestingGuard(RDParser& parser) : parser(parser) {
+    if (parser.nesting == MAX_NESTING) {
+      parser.reportError("Too deeply nested; the limit is "
+                         + std::to_string(MAX_NESTING) + " levels.");
+      throw RDNestingError();
+    }
+    ++parser.nesting;
+  }
+  ~NestingGuard() { --parser.nesting; }
+
+ private:
+  RDParser& parser;
+};
+
+RDParser::RDParser(const Types::TokenList& p_tokenList,
                    ErrorsAndDebug::ErrorReporter& eReporter)
-    : tokens(p_tokens), eReporter(eReporter) {
-  this->currentIter = this->tokens.begin();
-}
+    : tokens(p_tokenList), eReporter(eReporter) {}
+
+RDParser::RDParser(std::shared_ptr<const Types::TokenList> p_tokenList,
+                   ErrorsAndDebug::ErrorReporter& eReporter)
+    : tokens(*p_tokenList),
+      lazyTokens(std::move(p_tokenList)),
+      eReporter(eReporter) {}
+
+RDParser::RDParser(std::shared_ptr<const Types::TokenList> p_tokenList,
+                   size_t first, size_t last,
+                   ErrorsAndDebug::ErrorReporter& eReporter)
+    : tokens(*p_tokenList, first, last),
+      lazyTokens(std::move(p_tokenList)),
+      eReporter(eReporter) {}
+
+RDParser::RDParser(Scanner& scanner, ErrorsAndDebug::ErrorReporter& eReporter)
+    : tokens(scanner), eReporter(eReporter) {}
 
 // Helper functions; Sorted by name
 void RDParser::advance() {
-  if (!isAtEnd()) ++currentIter;
-}
-
-auto RDParser::consumeAnyBinaryExprs(
-    const std::initializer_list<TokenType>& types, ExprPtrVariant expr,
-    const parserFn& f) -> ExprPtrVariant {
-  while (match(types)) {
-    Token op = getTokenAndAdvance();
-    expr = AST::createBinaryEPV(std::move(expr), op, std::invoke(f, this));
-  }
-  return expr;
+  if (!isAtEnd()) tokens.advance();
 }
 
 void RDParser::consumeOrError(TokenType tType,
@@ -49,7 +117,9 @@ auto RDParser::consumeOneLiteral(const std::string& str) -> ExprPtrVariant {
 }
 
 auto RDParser::consumeOneLiteral() -> ExprPtrVariant {
-  return AST::createLiteralEPV(getTokenAndAdvance().getOptionalLiteral());
+  Types::OptionalLiteral literal = tokens.peekLiteral();
+  advance();
+  return AST::createLiteralEPV(std::move(literal));
 }
 
 auto RDParser::consumeSuper() -> ExprPtrVariant {
@@ -77,10 +147,6 @@ auto RDParser::consumePostfixExpr(ExprPtrVariant expr) -> ExprPtrVariant {
   return expr;
 }
 
-auto RDParser::consumeUnaryExpr() -> ExprPtrVariant {
-  return AST::createUnaryEPV(getTokenAndAdvance(), unary());
-}
-
 auto RDParser::consumeVarExpr() -> ExprPtrVariant {
   Token varName = getTokenAndAdvance();
   return AST::createVariableEPV(varName);
@@ -96,7 +162,7 @@ auto RDParser::error(const std::string& eMessage) -> RDParser::RDParseError {
 }
 
 auto RDParser::getCurrentTokenType() const -> TokenType {
-  return currentIter->getType();
+  return tokens.peek().getType();
 }
 
 auto RDParser::getTokenAndAdvance() -> Token {
@@ -122,13 +188,14 @@ auto RDParser::match(const std::initializer_list<Types::TokenType>& types) const
 }
 
 auto RDParser::matchNext(Types::TokenType type) -> bool {
-  advance();
-  bool result = match(type);
-  --currentIter;
-  return result;
+  if (isAtEnd()) return false;
+  const TokenType nextType = tokens.peek(1).getType();
+  return nextType != TokenType::LOX_EOF && nextType == type;
 }
 
-auto RDParser::peek() const -> Token { return *currentIter; }
+auto RDParser::peek() const -> const Token& {
+  return tokens.peek();
+}
 
 void RDParser::reportError(const std::string& message) {
   const Token& token = peek();
@@ -136,7 +203,7 @@ void RDParser::reportError(const std::string& message) {
   if (token.getType() == TokenType::LOX_EOF)
     error = " at end: " + error;
   else
-    error = " at '" + token.getLexeme() + "': " + error;
+    error = " at '" + std::string(token.getLexeme()) + "': " + error;
   eReporter.setError(token.getLine(), error);
 }
 
@@ -154,33 +221,34 @@ void RDParser::synchronize() {
       case TokenType::RETURN: return;
       default:
         ErrorsAndDebug::debugPrint("Discarding extranuous token:"
-                                   + peek().getLexeme());
+                                   + std::string(peek().getLexeme()));
         advance();
     }
   }
 }
 
 void RDParser::throwOnErrorProduction(
-    const std::initializer_list<Types::TokenType>& types, const parserFn& f) {
+    const std::initializer_list<Types::TokenType>& types,
+    Precedence precedence) {
   if (match(types)) {
     auto errObj = error("Missing left hand operand");
     advance();
-    ExprPtrVariant expr
-        = std::invoke(f, this);  // We check the rest of the expression anyways
-                                 // to see if there are any errors there
+    // We check the rest of the expression anyways to see if there are any
+    // errors there
+    ExprPtrVariant expr = parsePrecedence(precedence);
     throw errObj;
   }
 }
 
 void RDParser::throwOnErrorProductions() {
   throwOnErrorProduction({TokenType::BANG_EQUAL, TokenType::EQUAL_EQUAL},
-                         &RDParser::equality);
+                         Precedence::EQUALITY);
   throwOnErrorProduction({TokenType::GREATER, TokenType::GREATER_EQUAL,
                           TokenType::LESS, TokenType::LESS_EQUAL},
-                         &RDParser::comparison);
-  throwOnErrorProduction({TokenType::PLUS}, &RDParser::addition);
+                         Precedence::COMPARISON);
+  throwOnErrorProduction({TokenType::PLUS}, Precedence::TERM);
   throwOnErrorProduction({TokenType::STAR, TokenType::SLASH},
-                         &RDParser::multiplication);
+                         Precedence::FACTOR);
 }
 
 // ---------------- Grammar Production Rules -----------------------------------
@@ -190,20 +258,13 @@ void RDParser::throwOnErrorProductions() {
 
 // program     → declaration* LOX_EOF;
 void RDParser::program() {
-  try {
-    while (!isAtEnd()) {
-      std::optional<StmtPtrVariant> optStmt = declaration();
-      if (optStmt.has_value()) statements.push_back(std::move(optStmt.value()));
-    }
-  } catch (const std::exception& e) {
-    std::string errorMessage = "Caught unhandled exception: ";
-    errorMessage += e.what();
-    eReporter.setError(peek().getLine(), errorMessage);
-  }
+  while (std::optional<StmtPtrVariant> optStmt = parseNext())
+    statements.push_back(std::move(optStmt.value()));
 }
 // declaration → varDecl | funcDecl | classDecl | statement;
 auto RDParser::declaration() -> std::optional<StmtPtrVariant> {
   try {
+    NestingGuard guard(*this);
     if (match(TokenType::VAR)) {
       advance();
       return varDecl();
@@ -271,6 +332,7 @@ auto RDParser::funcBody(const std::string& kind) -> ExprPtrVariant {
                  "Expecte ')' after " + kind + " params.");
   consumeOrError(TokenType::LEFT_BRACE,
                  "Expecte '{' after " + kind + " params.");
+  if (lazyTokens != nullptr) return deferFuncBody(std::move(params), kind);
   std::vector<StmtPtrVariant> fnBody;
   while (!match(TokenType::RIGHT_BRACE) && !isAtEnd()) {
     if (auto optStmnt = declaration(); optStmnt.has_value())
@@ -281,6 +343,39 @@ auto RDParser::funcBody(const std::string& kind) -> ExprPtrVariant {
   return AST::createFuncEPV(std::move(params), std::move(fnBody));
 }
 
+// Skips to the brace that closes the body, and leaves parsing what's between
+// to the FuncExpr.
+auto RDParser::deferFuncBody(std::vector<Token> params, const std::string& kind)
+    -> ExprPtrVariant {
+  const size_t first = tokens.index();
+  int depth = 0;
+  while (!isAtEnd() && (depth != 0 || !match(TokenType::RIGHT_BRACE))) {
+    if (match(TokenType::LEFT_BRACE)) ++depth;
+    if (match(TokenType::RIGHT_BRACE)) --depth;
+    advance();
+  }
+  const size_t last = tokens.index();
+  consumeOrError(TokenType::RIGHT_BRACE,
+                 "Expecte '}' after " + kind + " body.");
+
+  AST::Arena& arena = AST::Arena::current();
+  return AST::createFuncEPV(
+      std::move(params),
+      [tokenList = lazyTokens, first, last,
+       &arena]() -> std::vector<StmtPtrVariant> {
+        ErrorsAndDebug::ErrorReporter bodyErrors;
+        // The body's nodes belong with the function's.
+        AST::Arena::Scope arenaScope(arena);
+        std::vector<StmtPtrVariant> body
+            = RDParser(tokenList, first, last, bodyErrors).parse();
+        if (bodyErrors.getStatus() != ErrorsAndDebug::LoxStatus::OK) {
+          bodyErrors.printToStdErr();
+          throw DeferredSyntaxError();
+        }
+        return body;
+      });
+}
+
 // funcDecl    → IDENTIFIER funcBody;
 auto RDParser::funcDecl(const std::string& kind) -> StmtPtrVariant {
   if (match(TokenType::IDENTIFIER)) {
@@ -329,6 +424,7 @@ auto RDParser::classDecl() -> StmtPtrVariant {
 // statement   → exprStmt | printStmt | blockStmt | ifStmt | whileStmt |
 // statement   → forStmt;
 auto RDParser::statement() -> StmtPtrVariant {
+  NestingGuard guard(*this);
   if (match(TokenType::PRINT)) return printStmt();
   if (match(TokenType::LEFT_BRACE)) return blockStmt();
   if (match(TokenType::IF)) return ifStmt();
@@ -404,15 +500,18 @@ auto RDParser::forStmt() -> StmtPtrVariant {
   advance();
   consumeOrError(TokenType::LEFT_PAREN, "Expected '(' after for.");
 
-  std::optional<StmtPtrVariant> initializer = std::nullopt;
-  if (match(TokenType::SEMICOLON)) {
-    advance();
-  } else if (match(TokenType::VAR)) {
-    advance();
-    initializer = std::make_optional(varDecl());
-  } else {
-    initializer = std::make_optional(exprStmt());
-  }
+  std::optional<StmtPtrVariant> initializer
+      = ([&]() -> std::optional<StmtPtrVariant> {
+          if (match(TokenType::SEMICOLON)) {
+            advance();
+            return std::nullopt;
+          }
+          if (match(TokenType::VAR)) {
+            advance();
+            return varDecl();
+          }
+          return exprStmt();
+        })();
 
   std::optional<ExprPtrVariant> condition = std::nullopt;
   if (!match(TokenType::SEMICOLON))
@@ -447,110 +546,91 @@ auto RDParser::returnStmt() -> StmtPtrVariant {
 // Expressions //
 //=============//
 // expression → comma;
-auto RDParser::expression() -> ExprPtrVariant { return comma(); }
-
-// !This is going to cause some grief when we are looking at function
-// arguments; !fun(1,2) will be treated as fun((1,2)) <- a single argument
-// instead of two. !Needs to make sure we set function arguments to have
-// higher precedence than !the comma operator
-// comma → assignment ("," assignment)*;
-auto RDParser::comma() -> ExprPtrVariant {
-  return consumeAnyBinaryExprs({TokenType::COMMA}, assignment(),
-                               &RDParser::assignment);
-}
-
-// assignment  → (call ".")? IDENTIFIER "=" assignment | condititional;
-auto RDParser::assignment() -> ExprPtrVariant {
-  ExprPtrVariant expr = conditional();
-
-  if (match(TokenType::EQUAL)) {
-    advance();
-    if (std::holds_alternative<AST::VariableExprPtr>(expr)) {
-      Token varName = std::get<AST::VariableExprPtr>(expr)->varName;
-      return AST::createAssignmentEPV(varName, assignment());
-    }
-    if (std::holds_alternative<AST::GetExprPtr>(expr)) {
-      // Discard the last GetExpr. The property won't be found in the object as
-      // we haven't set it yet (this operation). Instead replace it with a
-      // SetExpr
-      auto& getExpr = std::get<AST::GetExprPtr>(expr);
-      return AST::createSetEPV(std::move(getExpr->expr),
-                               std::move(getExpr->name), assignment());
-    }
-    throw error("Invalid assignment target");
-  }
-
-  return expr;
-}
-
-// conditional → logical_or ("?" expression ":" conditional)?;
-// conditional → equality ("?" expression ":" conditional)?
-auto RDParser::conditional() -> ExprPtrVariant {
-  ExprPtrVariant expr = logical_or();
-  if (match(TokenType::QUESTION)) {
-    Token op = getTokenAndAdvance();
-    ExprPtrVariant thenBranch = expression();
-    consumeOrError(TokenType::COLON, "Expected a colon after ternary operator");
-    return AST::createConditionalEPV(std::move(expr), std::move(thenBranch),
-                                     conditional());
+auto RDParser::expression() -> ExprPtrVariant {
+  return parsePrecedence(Precedence::COMMA);
+}
+
+// Parses the operand, then folds in operators for as long as they bind at
+// least as tightly as minPrecedence. A left associative operator's right
+// operand is parsed one precedence tighter, so that it stops at the next
+// operator of its own precedence; a right associative operator's at its own.
+auto RDParser::parsePrecedence(Precedence minPrecedence) -> ExprPtrVariant {
+  NestingGuard guard(*this);
+  ExprPtrVariant expr = unary();
+  Precedence precedence = infixPrecedence(getCurrentTokenType());
+  while (precedence >= minPrecedence) {
+    expr = infix(std::move(expr), precedence);
+    precedence = infixPrecedence(getCurrentTokenType());
   }
   return expr;
 }
 
+// comma       → assignment ("," assignment)*;
 // logical_or  → logical_and ("or" logical_and)*;
-auto RDParser::logical_or() -> ExprPtrVariant {
-  ExprPtrVariant expr = logical_and();
-  while (match(TokenType::OR)) {
-    Token op = getTokenAndAdvance();
-    expr = AST::createLogicalEPV(std::move(expr), op, logical_and());
-  }
-  return expr;
-}
-
 // logical_and → equality ("and" equality)*;
-auto RDParser::logical_and() -> ExprPtrVariant {
-  ExprPtrVariant expr = equality();
-  while (match(TokenType::AND)) {
-    Token op = getTokenAndAdvance();
-    expr = AST::createLogicalEPV(std::move(expr), op, equality());
+// equality    → comparison(("!=" | "==") comparison) *;
+// comparison  → addition((">" | ">=" | "<" | "<=") addition) *;
+// addition    → multiplication(("-" | "+") multiplication) *;
+// multi...    → unary(("/" | "*") unary) *;
+//
+// Function arguments are parsed at assignment precedence so that f(1, 2) is
+// two arguments rather than one comma expression.
+auto RDParser::infix(ExprPtrVariant left, Precedence precedence)
+    -> ExprPtrVariant {
+  Token op = getTokenAndAdvance();
+  switch (op.getType()) {
+    case TokenType::EQUAL: return assignment(std::move(left));
+    case TokenType::QUESTION: return conditional(std::move(left));
+    case TokenType::AND:
+    case TokenType::OR:
+      return AST::createLogicalEPV(std::move(left), op,
+                                   parsePrecedence(tighter(precedence)));
+    default:
+      return AST::createBinaryEPV(std::move(left), op,
+                                  parsePrecedence(tighter(precedence)));
   }
-  return expr;
-}
-
-// equality   → comparison(("!=" | "==") comparison) *;
-auto RDParser::equality() -> ExprPtrVariant {
-  auto equalityTypes = {TokenType::BANG_EQUAL, TokenType::EQUAL_EQUAL};
-  return consumeAnyBinaryExprs(equalityTypes, comparison(),
-                               &RDParser::comparison);
 }
 
-// comparison → addition((">" | ">=" | "<" | "<=") addition) *;
-auto RDParser::comparison() -> ExprPtrVariant {
-  auto comparatorTypes = {TokenType::GREATER, TokenType::GREATER_EQUAL,
-                          TokenType::LESS, TokenType::LESS_EQUAL};
-  return consumeAnyBinaryExprs(comparatorTypes, addition(),
-                               &RDParser::addition);
-}
-
-// addition   → multiplication(("-" | "+") multiplication) *;
-auto RDParser::addition() -> ExprPtrVariant {
-  auto additionTypes = {TokenType::PLUS, TokenType::MINUS};
-  return consumeAnyBinaryExprs(additionTypes, multiplication(),
-                               &RDParser::multiplication);
+// assignment  → (call ".")? IDENTIFIER "=" assignment | condititional;
+auto RDParser::assignment(ExprPtrVariant target) -> ExprPtrVariant {
+  if (std::holds_alternative<AST::VariableExprPtr>(target)) {
+    Token varName = std::get<AST::VariableExprPtr>(target)->varName;
+    return AST::createAssignmentEPV(varName,
+                                    parsePrecedence(Precedence::ASSIGNMENT));
+  }
+  if (std::holds_alternative<AST::GetExprPtr>(target)) {
+    // Discard the last GetExpr. The property won't be found in the object as
+    // we haven't set it yet (this operation). Instead replace it with a
+    // SetExpr
+    auto& getExpr = std::get<AST::GetExprPtr>(target);
+    return AST::createSetEPV(std::move(getExpr->expr),
+                             std::move(getExpr->name),
+                             parsePrecedence(Precedence::ASSIGNMENT));
+  }
+  throw error("Invalid assignment target");
 }
 
-// multi...   → unary(("/" | "*") unary) *;
-auto RDParser::multiplication() -> ExprPtrVariant {
-  auto multTypes = {TokenType::SLASH, TokenType::STAR};
-  return consumeAnyBinaryExprs(multTypes, unary(), &RDParser::unary);
+// conditional → logical_or ("?" expression ":" conditional)?;
+auto RDParser::conditional(ExprPtrVariant condition) -> ExprPtrVariant {
+  ExprPtrVariant thenBranch = expression();
+  consumeOrError(TokenType::COLON, "Expected a colon after ternary operator");
+  return AST::createConditionalEPV(std::move(condition), std::move(thenBranch),
+                                   parsePrecedence(Precedence::CONDITIONAL));
 }
 
 // unary      → ("!" | "-" | "--" | "++") unary | postfix;
 auto RDParser::unary() -> ExprPtrVariant {
   auto unaryTypes = {TokenType::BANG, TokenType::MINUS, TokenType::PLUS_PLUS,
                      TokenType::MINUS_MINUS};
-  if (match(unaryTypes)) return consumeUnaryExpr();
-  return postfix();
+  if (!match(unaryTypes)) return postfix();
+  // Collect the operators in a loop, rather than recursing once for each, so
+  // that a long run of them can't exhaust the stack.
+  std::vector<Token> ops;
+  while (match(unaryTypes)) ops.push_back(getTokenAndAdvance());
+  ExprPtrVariant expr = postfix();
+  for (auto op = ops.rbegin(); op != ops.rend(); ++op)
+    expr = AST::createUnaryEPV(*op, std::move(expr));
+  return expr;
 }
 
 // postfix    → primary ("++" | "--")*;
@@ -587,12 +667,12 @@ auto RDParser::call() -> ExprPtrVariant {
 // arguments   → assignment  ( "," assignment )* ;
 auto RDParser::arguments() -> std::vector<ExprPtrVariant> {
   std::vector<ExprPtrVariant> args;
-  args.push_back(assignment());
+  args.push_back(parsePrecedence(Precedence::ASSIGNMENT));
   while (match(TokenType::COMMA)) {
     advance();
     if (args.size() >= MAX_ARGS)
       throw error("A function can't be invoked with more than 255 arguments");
-    args.push_back(assignment());
+    args.push_back(parsePrecedence(Precedence::ASSIGNMENT));
   }
   return args;
 }
@@ -615,7 +695,10 @@ auto RDParser::primary() -> ExprPtrVariant {
   if (match(TokenType::LEFT_PAREN)) return consumeGroupingExpr();
   if (match(TokenType::THIS)) return AST::createThisEPV(getTokenAndAdvance());
   if (match(TokenType::IDENTIFIER)) return consumeVarExpr();
-  if (match(TokenType::FUN)) return funcBody("Anon-Function");
+  if (match(TokenType::FUN)) {
+    advance();
+    return funcBody("Anon-Function");
+  }
   if (match(TokenType::SUPER)) return consumeSuper();
 
   // Check for known error productions. throws RDParseError;
@@ -633,4 +716,22 @@ auto RDParser::parse() -> std::vector<StmtPtrVariant> {
   return std::move(this->statements);
 }
 
+auto RDParser::parseNext() -> std::optional<StmtPtrVariant> {
+  if (stopped) return std::nullopt;
+  try {
+    while (!isAtEnd()) {
+      std::optional<StmtPtrVariant> optStmt = declaration();
+      if (optStmt.has_value()) return optStmt;
+    }
+  } catch (const RDNestingError&) {
+    stopped = true;
+  } catch (const std::exception& e) {
+    std::string errorMessage = "Caught unhandled exception: ";
+    errorMessage += e.what();
+    eReporter.setError(peek().getLine(), errorMessage);
+    stopped = true;
+  }
+  return std::nullopt;
+}
+
 }  // namespace cpplox::Parser
@@ -2,17 +2,26 @@
 #define CPPLOX_PARSER_PARSER_H
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
 #include <exception>
 #include <functional>
 #include <iterator>
+#include <memory>
+#include <optional>
 #include <vector>
 
 #include "cpplox/AST/NodeTypes.h"
 #include "cpplox/ErrorsAndDebug/ErrorReporter.h"
+#include "cpplox/Parser/TokenStream.h"
+#include "cpplox/Scanner/Scanner.h"
 #include "cpplox/Types/Token.h"
 
-// This is a recursive descent parser for the lox language.
-// Currently it only parses expressions.
+// This is a recursive descent parser for the lox language. Binary, ternary and
+// assignment operators are parsed by precedence climbing (a Pratt parser): an
+// operator's precedence is looked up in a table, so an operand doesn't pass
+// through a function per precedence level on its way to the top. The grammar
+// below is what it parses.
 
 // clang-format off
 // Grammar production rules:
@@ -63,12 +72,41 @@ namespace cpplox::Parser {
 using AST::ExprPtrVariant;
 using AST::StmtPtrVariant;
 
+// How tightly infix operators bind, loosest first.
+enum class Precedence : uint8_t {
+  NONE,  // not an infix operator
+  COMMA,
+  ASSIGNMENT,
+  CONDITIONAL,
+  OR,
+  AND,
+  EQUALITY,
+  COMPARISON,
+  TERM,
+  FACTOR,
+};
+
+// Thrown by a function body whose parsing was put off until its first call,
+// when it turns out to have syntax errors. The errors have been printed.
+class DeferredSyntaxError : std::exception {};
+
 class RDParser {
  public:
-  explicit RDParser(const std::vector<Types::Token>& tokens,
+  explicit RDParser(const Types::TokenList& tokenList,
                     ErrorsAndDebug::ErrorReporter& eReporter);
+  // Lazy mode: function bodies are only checked for balanced braces and
+  // skipped, and each is parsed the first time FuncExpr::getBody() is called
+  // (typically by the function's first call), so functions that are never
+  // called are never parsed. Syntax errors in a body are reported then. The
+  // unparsed bodies keep the tokens alive.
+  RDParser(std::shared_ptr<const Types::TokenList> tokenList,
+           ErrorsAndDebug::ErrorReporter& eReporter);
+  // Pulls tokens from scanner as it goes; for use with parseNext().
+  explicit RDParser(Scanner& scanner, ErrorsAndDebug::ErrorReporter& eReporter);
 
   class RDParseError : std::exception {};  // Exception types
+  // Input nested deeper than MAX_NESTING; parsing stops.
+  class RDNestingError : std::exception {};
 
   // The public method to kick off parsing.
   // Stands in for "program" in the grammar
@@ -76,7 +114,16 @@ class RDParser {
   // (e.g., RDParseError) and deal with them.
   auto parse() -> std::vector<StmtPtrVariant>;
 
+  // Parses just the next top-level declaration, so it can be run before the
+  // rest of the input is parsed (or even read). Declarations with syntax
+  // errors are reported and skipped. Returns nullopt at the end of input.
+  auto parseNext() -> std::optional<StmtPtrVariant>;
+
  private:
+  // A lazy mode parser for the tokens of one deferred function body.
+  RDParser(std::shared_ptr<const Types::TokenList> tokenList, size_t first,
+           size_t last, ErrorsAndDebug::ErrorReporter& eReporter);
+
   // Grammar parsing functions
   // Statment parsing
   void program();
@@ -85,6 +132,8 @@ class RDParser {
   auto classDecl() -> StmtPtrVariant;
   auto funcDecl(const std::string& kind) -> StmtPtrVariant;
   auto funcBody(const std::string& kind) -> ExprPtrVariant;
+  auto deferFuncBody(std::vector<Types::Token> params, const std::string& kind)
+      -> ExprPtrVariant;
   auto parameters() -> std::vector<Types::Token>;
   auto statement() -> StmtPtrVariant;
   auto exprStmt() -> StmtPtrVariant;
@@ -97,15 +146,12 @@ class RDParser {
 
   // Expression Parsing
   auto expression() -> ExprPtrVariant;
-  auto comma() -> ExprPtrVariant;
-  auto assignment() -> ExprPtrVariant;
-  auto conditional() -> ExprPtrVariant;
-  auto logical_or() -> ExprPtrVariant;
-  auto logical_and() -> ExprPtrVariant;
-  auto equality() -> ExprPtrVariant;
-  auto comparison() -> ExprPtrVariant;
-  auto addition() -> ExprPtrVariant;
-  auto multiplication() -> ExprPtrVariant;
+  // Parses an expression whose infix operators bind at least as tightly as
+  // minPrecedence.
+  auto parsePrecedence(Precedence minPrecedence) -> ExprPtrVariant;
+  auto infix(ExprPtrVariant left, Precedence precedence) -> ExprPtrVariant;
+  auto assignment(ExprPtrVariant target) -> ExprPtrVariant;
+  auto conditional(ExprPtrVariant condition) -> ExprPtrVariant;
   auto unary() -> ExprPtrVariant;
   auto postfix() -> ExprPtrVariant;
   auto call() -> ExprPtrVariant;
@@ -115,17 +161,12 @@ class RDParser {
   // Helper functions to implement the parser
   void advance();
   void consumeOrError(Types::TokenType tType, const std::string& errorMessage);
-  using parserFn = ExprPtrVariant (RDParser::*)();
-  auto consumeAnyBinaryExprs(
-      const std::initializer_list<Types::TokenType>& types, ExprPtrVariant expr,
-      const parserFn& f) -> ExprPtrVariant;
   auto consumeOneLiteral() -> ExprPtrVariant;
   auto consumeOneLiteral(const std::string& str) -> ExprPtrVariant;
   auto consumeGroupingExpr() -> ExprPtrVariant;
   auto consumePostfixExpr(ExprPtrVariant expr) -> ExprPtrVariant;
   void consumeSemicolonOrError();
   auto consumeSuper() -> ExprPtrVariant;
-  auto consumeUnaryExpr() -> ExprPtrVariant;
   auto consumeVarExpr() -> ExprPtrVariant;
   auto error(const std::string& eMessage) -> RDParseError;
   [[nodiscard]] auto getCurrentTokenType() const -> Types::TokenType;
@@ -135,22 +176,31 @@ class RDParser {
       const std::initializer_list<Types::TokenType>& types) const -> bool;
   [[nodiscard]] auto match(Types::TokenType type) const -> bool;
   [[nodiscard]] auto matchNext(Types::TokenType type) -> bool;
-  [[nodiscard]] auto peek() const -> Types::Token;
+  [[nodiscard]] auto peek() const -> const Types::Token&;
   void reportError(const std::string& message);
   void synchronize();
   void throwOnErrorProduction(
-      const std::initializer_list<Types::TokenType>& types, const parserFn& f);
+      const std::initializer_list<Types::TokenType>& types,
+      Precedence precedence);
   void throwOnErrorProductions();
 
   // The data the parser operates on.
-  const std::vector<Types::Token>& tokens;
-  std::vector<cpplox::Types::Token>::const_iterator currentIter;
-  // std::__wrap_iter<std::vector<cpplox::Types::Token>::const_pointer>
-  // currentIter;
+  // Mutable because looking at tokens may pull them from the scanner.
+  mutable TokenStream tokens;
+  // Set in lazy mode.
+  std::shared_ptr<const Types::TokenList> lazyTokens;
+  bool stopped = false;
+  // How many declarations, statements and expressions enclose the current
+  // one; see NestingGuard.
+  int nesting = 0;
+  class NestingGuard;
   ErrorsAndDebug::ErrorReporter& eReporter;
   std::vector<StmtPtrVariant> statements;
 
   static const int MAX_ARGS = 255;
+  // Bounds the parser's recursion, so deeply nested input can't overflow the
+  // stack.
+  static const int MAX_NESTING = 1000;
 
 };  // class RDParser
 
@@ -0,0 +1,105 @@
+// Parse and AST teardown times for a large generated Lox program, how the
+// flattened AST compares in size and print time, and how long parsing takes
+// when function bodies are left until they're called. Run with:
+//   bazel run -c opt //cpplox/Parser:parser_benchmark -- [MB]
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "cpplox/AST/Arena.h"
+#include "cpplox/AST/FlatAST.h"
+#include "cpplox/AST/NodeTypes.h"
+#include "cpplox/AST/PrettyPrinter.h"
+#include "cpplox/ErrorsAndDebug/ErrorReporter.h"
+#include "cpplox/Parser/Parser.h"
+#include "cpplox/Scanner/Scanner.h"
+#include "cpplox/TestUtil/GeneratedSource.h"
+
+namespace {
+
+auto secondsSince(std::chrono::steady_clock::time_point start) -> double {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now()
+                                       - start)
+      .count();
+}
+
+}  // namespace
+
+auto main(int argc, char const* argv[]) -> int {
+  const size_t megabytes = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 16;
+  const std::string source
+      = cpplox::TestUtil::generateSource(megabytes * 1024 * 1024);
+  const double sizeMB = static_cast<double>(source.size()) / (1024 * 1024);
+
+  cpplox::ErrorsAndDebug::ErrorReporter eReporter;
+  const cpplox::Types::TokenList tokens
+      = cpplox::Scanner(source, eReporter).tokenize();
+
+  double bestParse = 1e9;
+  double bestLazyParse = 1e9;
+  double bestTeardown = 1e9;
+  double bestFlatten = 1e9;
+  double bestTreePrint = 1e9;
+  double bestFlatPrint = 1e9;
+  size_t statements = 0;
+  size_t nodeBytes = 0;
+  size_t flatBytes = 0;
+  for (int run = 0; run < 3; ++run) {
+    auto arena = std::make_unique<cpplox::AST::Arena>();
+    auto start = std::chrono::steady_clock::now();
+    std::vector<cpplox::AST::StmtPtrVariant> program;
+    {
+      cpplox::AST::Arena::Scope scope(*arena);
+      cpplox::Parser::RDParser parser(tokens, eReporter);
+      program = parser.parse();
+    }
+    bestParse = std::min(bestParse, secondsSince(start));
+    statements = program.size();
+    nodeBytes = arena->bytesAllocated();
+
+    start = std::chrono::steady_clock::now();
+    const cpplox::AST::FlatAST flat = cpplox::AST::flatten(program);
+    bestFlatten = std::min(bestFlatten, secondsSince(start));
+    flatBytes = flat.bytesUsed();
+
+    start = std::chrono::steady_clock::now();
+    size_t treeLines = cpplox::AST::PrettyPrinter::toString(program).size();
+    bestTreePrint = std::min(bestTreePrint, secondsSince(start));
+    start = std::chrono::steady_clock::now();
+    size_t flatLines = cpplox::AST::PrettyPrinter::toString(flat).size();
+    bestFlatPrint = std::min(bestFlatPrint, secondsSince(start));
+    if (treeLines != flatLines) std::cerr << "printers disagree" << std::endl;
+
+    start = std::chrono::steady_clock::now();
+    program.clear();
+    arena.reset();
+    bestTeardown = std::min(bestTeardown, secondsSince(start));
+
+    // None of the functions are called, so none of their bodies get parsed.
+    auto lazyTokens = std::make_shared<const cpplox::Types::TokenList>(tokens);
+    arena = std::make_unique<cpplox::AST::Arena>();
+    start = std::chrono::steady_clock::now();
+    {
+      cpplox::AST::Arena::Scope scope(*arena);
+      cpplox::Parser::RDParser parser(lazyTokens, eReporter);
+      program = parser.parse();
+    }
+    bestLazyParse = std::min(bestLazyParse, secondsSince(start));
+    program.clear();
+  }
+  std::cout << sizeMB << " MB, " << tokens.tokens.size() << " tokens, "
+            << statements << " statements, " << nodeBytes / (1024 * 1024)
+            << " MB of nodes\n"
+            << "parse: " << bestParse * 1000 << " ms ("
+            << sizeMB / bestParse << " MB/s), " << bestLazyParse * 1000
+            << " ms lazily\n"
+            << "teardown: " << bestTeardown * 1000 << " ms\n"
+            << "flatten: " << bestFlatten * 1000 << " ms, "
+            << flatBytes / (1024 * 1024) << " MB flat\n"
+            << "print: " << bestTreePrint * 1000 << " ms tree, "
+            << bestFlatPrint * 1000 << " ms flat" << std::endl;
+  return 0;
+}
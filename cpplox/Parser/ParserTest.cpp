@@ -0,0 +1,160 @@
+#include "gtest/gtest.h"
+
+#include <memory>
+#include <string>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include "cpplox/AST/PrettyPrinter.h"
+#include "cpplox/ErrorsAndDebug/ErrorReporter.h"
+#include "cpplox/Parser/Parser.h"
+#include "cpplox/Scanner/Scanner.h"
+
+namespace cpplox::Parser {
+
+namespace {
+
+using ErrorsAndDebug::ErrorReporter;
+using ErrorsAndDebug::LoxStatus;
+
+// The printed tree of a one-statement program.
+auto print(const std::string& source, ErrorReporter& eReporter)
+    -> std::string {
+  Types::TokenList tokens = Scanner(source, eReporter).tokenize();
+  std::vector<StmtPtrVariant> program = RDParser(tokens, eReporter).parse();
+  std::string printed;
+  for (const std::string& line : AST::PrettyPrinter::toString(program))
+    printed += line;
+  return printed;
+}
+
+auto parseLazily(const std::string& source, ErrorReporter& eReporter)
+    -> std::vector<StmtPtrVariant> {
+  return RDParser(std::make_shared<const Types::TokenList>(
+                      Scanner(source, eReporter).tokenize()),
+                  eReporter)
+      .parse();
+}
+
+}  // namespace
+
+// What the recursive descent parser, one function per precedence level,
+// produced for each of these.
+TEST(ParserTest, precedence_and_associativity) {
+  const std::vector<std::pair<std::string, std::string>> cases = {
+      {"1 + 2 * 3 - 4 / 5;", "( (- (+ 1 (* 2 3)) (/ 4 5)));"},
+      {"a = b = c;", "( (= a (= b (c));););"},
+      {"a, b = c, d;", "( (, (, (a) (= b (c));) (d)));"},
+      {"a ? b : c ? d : e;", "( (: (? (a)) (b) (: (? (c)) (d) (e))));"},
+      {"a ? b, c : d;", "( (: (? (a)) (, (b) (c)) (d)));"},
+      {"a or b and c or d;", "( (or (or (a) (and (b) (c))) (d)));"},
+      {"a == b != c < d <= e > f >= g;",
+       "( (!= (== (a) (b)) (>= (> (<= (< (c) (d)) (e)) (f)) (g))));"},
+      {"-a * !b - --c + ++d;",
+       "( (+ (- (* (- (a)) (! (b))) (-- (c))) (++ (d))));"},
+      {"- - - a;", "( (- (- (- (a)))));"},
+      {"-a++;", "( (- (POSTFIX ++ (a))));"},
+      {"f(1, 2)(3).x.y(a = 1, b ? c : d);",
+       "( ((((= a 1);)((: (? (b)) (c) (d)))) (((3)) (((1)(2)) (f))) .( get x "
+       ") .( get y )));"},
+      {"a.b.c = d.e = f;",
+       "( (a) .( get b ) .( set c ) = (d) .( set e ) = (f));"},
+      {"x = a or b ? c : d;", "( (= x (: (? (or (a) (b))) (c) (d))););"},
+      {"a or b ? c : d or e;", "( (: (? (or (a) (b))) (c) (or (d) (e))));"},
+      {"!a == b and c;", "( (and (== (! (a)) (b)) (c)));"},
+      {"var y = 1, 2;", "( = ( var y ) (, 1 2) );"},
+  };
+  for (const auto& [source, expected] : cases) {
+    ErrorReporter eReporter;
+    EXPECT_EQ(expected, print(source, eReporter)) << source;
+    EXPECT_EQ(LoxStatus::OK, eReporter.getStatus()) << source;
+  }
+}
+
+TEST(ParserTest, syntax_errors) {
+  for (const std::string source :
+       {"a + b = c;", "a ? b : c = d;", "== a;", "> b + c;", "* 2;", "1 +;",
+        "f(1, 2;", "a.;"}) {
+    ErrorReporter eReporter;
+    EXPECT_EQ("", print(source, eReporter)) << source;
+    EXPECT_EQ(LoxStatus::ERROR, eReporter.getStatus()) << source;
+  }
+}
+
+TEST(ParserTest, anonymous_functions) {
+  ErrorReporter eReporter;
+  EXPECT_EQ("( (z) {\n(print (z));\n\n});",
+            print("fun (z) { print z; };", eReporter));
+  EXPECT_EQ(LoxStatus::OK, eReporter.getStatus());
+}
+
+TEST(ParserTest, long_runs_of_prefix_operators_do_not_recurse) {
+  ErrorReporter eReporter;
+  const std::string source = std::string(100000, '-') + "1;";
+  Types::TokenList tokens = Scanner(source, eReporter).tokenize();
+  EXPECT_EQ(1, RDParser(tokens, eReporter).parse().size());
+  EXPECT_EQ(LoxStatus::OK, eReporter.getStatus());
+}
+
+TEST(ParserTest, deep_nesting_is_an_error) {
+  for (const std::string& source :
+       {std::string(100000, '(') + "1" + std::string(100000, ')') + ";",
+        std::string(100000, '{') + std::string(100000, '}')}) {
+    ErrorReporter eReporter;
+    Types::TokenList tokens = Scanner(source, eReporter).tokenize();
+    EXPECT_TRUE(RDParser(tokens, eReporter).parse().empty());
+    EXPECT_EQ(LoxStatus::ERROR, eReporter.getStatus());
+  }
+}
+
+TEST(ParserTest, lazy_bodies_are_parsed_on_first_use) {
+  const std::string source = "fun f(a) { fun g() { return a; } return g; }";
+  ErrorReporter eReporter;
+  std::vector<StmtPtrVariant> program = parseLazily(source, eReporter);
+  ASSERT_EQ(1, program.size());
+  const AST::FuncExprPtr& f = std::get<AST::FuncStmtPtr>(program[0])->funcExpr;
+  EXPECT_FALSE(f->isBodyParsed());
+  ASSERT_EQ(2, f->getBody().size());
+  EXPECT_TRUE(f->isBodyParsed());
+  const AST::FuncExprPtr& g
+      = std::get<AST::FuncStmtPtr>(f->getBody()[0])->funcExpr;
+  EXPECT_FALSE(g->isBodyParsed());
+  EXPECT_EQ(1, g->getBody().size());
+  EXPECT_EQ(LoxStatus::OK, eReporter.getStatus());
+}
+
+TEST(ParserTest, lazy_and_eager_trees_print_the_same) {
+  const std::string source
+      = "class A < B { init(x) { this.x = x; } get() { return fun () { "
+        "return this.x; }; } }\n"
+        "fun f(a, b) { if (a) { while (b) { b = b - 1; } } return a + b; }\n"
+        "var x = f(1, 2);";
+  ErrorReporter eReporter;
+  std::string lazy;
+  for (const std::string& line :
+       AST::PrettyPrinter::toString(parseLazily(source, eReporter)))
+    lazy += line;
+  EXPECT_EQ(print(source, eReporter), lazy);
+  EXPECT_EQ(LoxStatus::OK, eReporter.getStatus());
+}
+
+TEST(ParserTest, lazy_body_syntax_errors_surface_on_first_use) {
+  // The tokens point into the source, so it has to outlive the program.
+  const std::string source = "fun f() { 1 +; } print 1;";
+  ErrorReporter eReporter;
+  std::vector<StmtPtrVariant> program = parseLazily(source, eReporter);
+  ASSERT_EQ(2, program.size());
+  EXPECT_EQ(LoxStatus::OK, eReporter.getStatus());
+  const AST::FuncExprPtr& f = std::get<AST::FuncStmtPtr>(program[0])->funcExpr;
+  EXPECT_THROW((void)f->getBody(), DeferredSyntaxError);
+  EXPECT_FALSE(f->isBodyParsed());
+}
+
+TEST(ParserTest, lazy_parsing_still_checks_braces) {
+  ErrorReporter eReporter;
+  EXPECT_TRUE(parseLazily("fun f() { { print 1; }", eReporter).empty());
+  EXPECT_EQ(LoxStatus::ERROR, eReporter.getStatus());
+}
+
+}  // namespace cpplox::Parser
@@ -0,0 +1,68 @@
+#include "cpplox/Parser/TokenStream.h"
+
+#include <utility>
+
+namespace cpplox::Parser {
+
+using Types::OptionalLiteral;
+using Types::Token;
+using Types::TokenType;
+
+TokenStream::TokenStream(const Types::TokenList& tokenList)
+    : tokenList(&tokenList),
+      end(tokenList.tokens.size() - 1),
+      endToken(tokenList.tokens.back()) {}
+
+TokenStream::TokenStream(const Types::TokenList& tokenList, size_t first,
+                         size_t last)
+    : tokenList(&tokenList),
+      position(first),
+      end(last),
+      endToken(TokenType::LOX_EOF, "", tokenList.tokens[last].getLine()) {}
+
+TokenStream::TokenStream(Scanner& scanner) : scanner(&scanner) {}
+
+void TokenStream::pull(size_t wanted) {
+  while (count < wanted) {
+    Slot& slot = ring[(head + count) % LOOKAHEAD];
+    // Once at the end, keep repeating the final EOF rather than rescanning.
+    if (count != 0
+        && ring[(head + count - 1) % LOOKAHEAD].token.getType()
+               == TokenType::LOX_EOF) {
+      slot = ring[(head + count - 1) % LOOKAHEAD];
+    } else {
+      slot.token = scanner->nextToken(slot.literal);
+    }
+    ++count;
+  }
+}
+
+auto TokenStream::peek(size_t ahead) -> const Token& {
+  if (tokenList != nullptr) {
+    if (position + ahead >= end) return endToken;
+    return tokenList->tokens[position + ahead];
+  }
+  pull(ahead + 1);
+  return ring[(head + ahead) % LOOKAHEAD].token;
+}
+
+auto TokenStream::peekLiteral() -> OptionalLiteral {
+  if (tokenList != nullptr) return tokenList->getLiteral(peek());
+  pull(1);
+  return ring[head].literal;
+}
+
+void TokenStream::advance() {
+  if (tokenList != nullptr) {
+    if (position < end) ++position;
+    return;
+  }
+  pull(1);
+  if (ring[head].token.getType() == TokenType::LOX_EOF) return;
+  head = (head + 1) % LOOKAHEAD;
+  --count;
+}
+
+auto TokenStream::index() const -> size_t { return position; }
+
+}  // namespace cpplox::Parser
@@ -0,0 +1,60 @@
+#ifndef CPPLOX_PARSER_TOKENSTREAM_H
+#define CPPLOX_PARSER_TOKENSTREAM_H
+#pragma once
+
+#include <array>
+#include <cstddef>
+
+#include "cpplox/Scanner/Scanner.h"
+#include "cpplox/Types/Literal.h"
+#include "cpplox/Types/Token.h"
+#include "cpplox/Types/Uncopyable.h"
+
+namespace cpplox::Parser {
+
+// Where the parser gets its tokens: either a TokenList scanned up front, or a
+// Scanner that is pulled on demand. Pulled tokens pass through a small ring
+// buffer, so streaming holds only a few tokens at a time no matter how large
+// the input is.
+class TokenStream : public Types::Uncopyable {
+ public:
+  explicit TokenStream(const Types::TokenList& tokenList);
+  // Just the tokens in [first, last), followed by LOX_EOF.
+  TokenStream(const Types::TokenList& tokenList, size_t first, size_t last);
+  explicit TokenStream(Scanner& scanner);
+
+  // The token 'ahead' tokens past the current one; LOX_EOF past the end.
+  // ahead must be less than LOOKAHEAD.
+  auto peek(size_t ahead = 0) -> const Types::Token&;
+  // The literal value of the current token.
+  auto peekLiteral() -> Types::OptionalLiteral;
+  void advance();
+  // The index of the current token in the TokenList; only when reading one.
+  [[nodiscard]] auto index() const -> size_t;
+
+  static const size_t LOOKAHEAD = 4;
+
+ private:
+  struct Slot {
+    Types::Token token{Types::TokenType::LOX_EOF, ""};
+    Types::OptionalLiteral literal;
+  };
+
+  // Scans tokens until the ring holds at least 'count'.
+  void pull(size_t count);
+
+  // When reading a TokenList.
+  const Types::TokenList* tokenList = nullptr;
+  size_t position = 0;
+  size_t end = 0;  // index of the token read as endToken
+  Types::Token endToken{Types::TokenType::LOX_EOF, ""};
+
+  // When streaming.
+  Scanner* scanner = nullptr;
+  std::array<Slot, LOOKAHEAD> ring;
+  size_t head = 0;   // index in ring of the current token
+  size_t count = 0;  // tokens in ring
+};
+
+}  // namespace cpplox::Parser
+#endif  // CPPLOX_PARSER_TOKENSTREAM_H
@@ -0,0 +1,165 @@
+#include "cpplox/Scanner/ParallelScanner.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "cpplox/ErrorsAndDebug/ErrorReporter.h"
+#include "cpplox/Scanner/ScanKernels.h"
+#include "cpplox/Scanner/Scanner.h"
+#include "cpplox/Types/Token.h"
+
+namespace cpplox {
+
+using ErrorsAndDebug::ErrorReporter;
+using Types::Token;
+using Types::TokenList;
+
+namespace {
+
+// p is just inside a "/*". Returns a pointer past the matching "*/", pairing
+// nested comments the way Scanner::skipBlockComment does.
+auto skipBlockComment(const char* p, const char* const end,
+                      const ScanKernels::Kernels& kernels) -> const char* {
+  int nesting = 1;
+  while (nesting > 0) {
+    p = kernels.findBlockCommentSpecial(p, end);
+    if (p == end) return end;
+    if (end - p >= 2 && p[0] == '/' && p[1] == '*') {
+      ++p;
+      ++nesting;
+    } else if (end - p >= 2 && p[0] == '*' && p[1] == '/') {
+      ++p;
+      --nesting;
+    }
+    ++p;
+  }
+  return p;
+}
+
+// Runs fn(0) ... fn(count - 1) concurrently, one on the calling thread.
+template <typename Fn>
+void runConcurrently(size_t count, const Fn& fn) {
+  std::vector<std::thread> workers;
+  workers.reserve(count - 1);
+  for (size_t i = 1; i < count; ++i) workers.emplace_back(fn, i);
+  fn(0);
+  for (auto& worker : workers) worker.join();
+}
+
+}  // namespace
+
+auto findSplitPoints(std::string_view source, size_t pieces,
+                     const ScanKernels::Kernels& kernels)
+    -> std::vector<size_t> {
+  std::vector<size_t> splits;
+  if (pieces < 2) return splits;
+  const char* const begin = source.data();
+  const char* const end = begin + source.size();
+  const size_t stride = source.size() / pieces;
+  size_t target = stride;  // where we'd like the next split
+  int newlines = 0;        // unused; the kernels count them regardless
+
+  const char* p = begin;
+  while (p != end && splits.size() + 1 < pieces) {
+    // p is outside any string or comment up to the next '"' or '/', so any
+    // newline in between is a place to split.
+    const char* const special = kernels.findStringOrCommentStart(p, end);
+    while (begin + target < special && splits.size() + 1 < pieces) {
+      const char* const newline
+          = kernels.findLineEnd(std::max(p, begin + target), special);
+      if (newline == special || newline + 1 == end) break;
+      splits.push_back(static_cast<size_t>(newline + 1 - begin));
+      target = splits.back() + stride;
+    }
+    if (special == end) break;
+
+    p = special + 1;
+    if (*special == '"') {
+      p = kernels.findStringEnd(p, end, &newlines);
+      if (p != end) ++p;
+    } else if (p != end && *p == '/') {
+      // The newline ending the comment is outside it.
+      p = kernels.findLineEnd(p, end);
+    } else if (p != end && *p == '*') {
+      p = skipBlockComment(p + 1, end, kernels);
+    }
+  }
+  return splits;
+}
+
+auto tokenizeParallel(std::string_view source, ErrorReporter& eReporter,
+                      unsigned threads, size_t minPieceSize) -> TokenList {
+  if (threads == 0) threads = std::max(1U, std::thread::hardware_concurrency());
+  const size_t pieces = std::min<size_t>(
+      threads, source.size() / std::max<size_t>(minPieceSize, 1));
+  const std::vector<size_t> splits = findSplitPoints(source, pieces);
+  if (splits.empty()) return Scanner(source, eReporter).tokenize();
+
+  std::vector<std::string_view> sources;
+  size_t from = 0;
+  for (size_t split : splits) {
+    sources.push_back(source.substr(from, split - from));
+    from = split;
+  }
+  sources.push_back(source.substr(from));
+  const size_t count = sources.size();
+
+  // Each piece starts on the line after the last newline before it.
+  std::vector<int> firstLines(count, 1);
+  runConcurrently(count - 1, [&](size_t i) {
+    firstLines[i + 1] = static_cast<int>(
+        std::count(sources[i].begin(), sources[i].end(), '\n'));
+  });
+  for (size_t i = 1; i < count; ++i) firstLines[i] += firstLines[i - 1];
+
+  std::vector<TokenList> lists(count);
+  std::vector<ErrorReporter> errors(count);
+  runConcurrently(count, [&](size_t i) {
+    Scanner scanner(sources[i], errors[i], ScanKernels::bestKernels(),
+                    firstLines[i]);
+    lists[i] = scanner.tokenize();
+  });
+
+  // Stitch the pieces together, dropping all but the last LOX_EOF and
+  // renumbering literals. This copy is the one serial step after the
+  // pre-pass.
+  size_t tokenCount = 0;
+  size_t literalCount = 0;
+  for (const TokenList& list : lists) {
+    tokenCount += list.tokens.size();
+    literalCount += list.literals.size();
+  }
+  TokenList result;
+  result.tokens.reserve(tokenCount - (count - 1));
+  result.literals.reserve(literalCount);
+  for (size_t i = 0; i < count; ++i) {
+    TokenList& list = lists[i];
+    const auto base = static_cast<uint32_t>(result.literals.size());
+    const size_t last = i + 1 < count ? list.tokens.size() - 1
+                                      : list.tokens.size();
+    for (size_t t = 0; t < last; ++t) {
+      const Token& token = list.tokens[t];
+      if (base == 0 || token.getLiteralIndex() == Token::NO_LITERAL) {
+        result.tokens.push_back(token);
+      } else {
+        result.tokens.emplace_back(token.getType(), token.getLexeme(),
+                                   token.getLine(),
+                                   token.getLiteralIndex() + base);
+      }
+    }
+    std::move(list.literals.begin(), list.literals.end(),
+              std::back_inserter(result.literals));
+    // Free each piece as soon as it's copied.
+    list = TokenList();
+    eReporter.append(errors[i]);
+  }
+  return result;
+}
+
+}  // namespace cpplox
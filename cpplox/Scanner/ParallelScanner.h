@@ -0,0 +1,43 @@
+#ifndef CPPLOX_SCANNER_PARALLELSCANNER_H
+#define CPPLOX_SCANNER_PARALLELSCANNER_H
+#pragma once
+
+#include <cstddef>
+#include <string_view>
+#include <vector>
+
+#include "cpplox/ErrorsAndDebug/ErrorReporter.h"
+#include "cpplox/Scanner/ScanKernels.h"
+#include "cpplox/Types/Token.h"
+
+// Tokenizes large sources on several threads.
+// A quick pre-pass over the source tracks just enough state (in a string, a
+// line comment or a block comment) to find newlines outside of them. No token
+// spans such a newline, so the source is split just after some of them,
+// roughly evenly, and each piece is scanned by its own Scanner. The pieces'
+// tokens, literals and errors are then stitched back together in order.
+
+namespace cpplox {
+
+// Sources smaller than this aren't worth splitting.
+constexpr size_t DEFAULT_MIN_PIECE_SIZE = 1024 * 1024;
+
+// Offsets just past newlines that are outside of strings and comments, about
+// source.size() / pieces apart. There are fewer than pieces of them.
+auto findSplitPoints(
+    std::string_view source, size_t pieces,
+    const ScanKernels::Kernels& kernels = ScanKernels::bestKernels())
+    -> std::vector<size_t>;
+
+// Returns exactly what Scanner(source, eReporter).tokenize() would, errors
+// included. threads = 0 uses every core. Pieces are at least minPieceSize
+// bytes, so small sources are scanned on the calling thread.
+auto tokenizeParallel(std::string_view source,
+                      ErrorsAndDebug::ErrorReporter& eReporter,
+                      unsigned threads = 0,
+                      size_t minPieceSize = DEFAULT_MIN_PIECE_SIZE)
+    -> Types::TokenList;
+
+}  // namespace cpplox
+
+#endif  // CPPLOX_SCANNER_PARALLELSCANNER_H
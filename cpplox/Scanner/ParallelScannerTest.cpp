@@ -0,0 +1,115 @@
+#include "gtest/gtest.h"
+
+#include <random>
+#include <string>
+#include <vector>
+
+#include "cpplox/ErrorsAndDebug/ErrorReporter.h"
+#include "cpplox/Scanner/ParallelScanner.h"
+#include "cpplox/Scanner/Scanner.h"
+#include "cpplox/Types/Literal.h"
+#include "cpplox/Types/Token.h"
+
+namespace cpplox {
+
+namespace {
+
+// Scans source sequentially and in parallel with tiny pieces, and checks the
+// results are identical.
+void expectSameAsTokenize(const std::string& source, unsigned threads) {
+  SCOPED_TRACE("'" + source + "' on " + std::to_string(threads) + " threads");
+  ErrorsAndDebug::ErrorReporter expectedErrors;
+  const Types::TokenList expected
+      = Scanner(source, expectedErrors).tokenize();
+  ErrorsAndDebug::ErrorReporter errors;
+  const Types::TokenList actual = tokenizeParallel(source, errors, threads, 1);
+
+  EXPECT_EQ(expectedErrors.getStatus(), errors.getStatus());
+  ASSERT_EQ(expected.tokens.size(), actual.tokens.size());
+  for (size_t i = 0; i < expected.tokens.size(); ++i) {
+    const Types::Token& want = expected.tokens[i];
+    const Types::Token& got = actual.tokens[i];
+    EXPECT_EQ(want.getType(), got.getType());
+    EXPECT_EQ(want.getLexeme().data(), got.getLexeme().data());
+    EXPECT_EQ(want.getLexeme().size(), got.getLexeme().size());
+    EXPECT_EQ(want.getLine(), got.getLine());
+    const Types::OptionalLiteral wantLiteral = expected.getLiteral(want);
+    const Types::OptionalLiteral literal = actual.getLiteral(got);
+    ASSERT_EQ(wantLiteral.has_value(), literal.has_value());
+    if (wantLiteral.has_value()) {
+      EXPECT_EQ(Types::getLiteralString(wantLiteral.value()),
+                Types::getLiteralString(literal.value()));
+    }
+  }
+  EXPECT_EQ(expected.literals.size(), actual.literals.size());
+}
+
+// Lines of Lox heavy in the constructs that make splitting hard: strings and
+// comments containing newlines, quotes and comment markers.
+auto randomSource(std::mt19937& rng, size_t lines) -> std::string {
+  static const std::vector<std::string> fragments = {
+      "var a = 1.5;",
+      "print \"two\nlines\";",
+      "print \"// not a comment\";",
+      "print \"/* nor this\";",
+      "// a \"quote in a comment\n",
+      "/* block\n comment with \" and // */",
+      "/* nested /* block \n */ comment */",
+      "a = b / c;",
+      "x = y/z;",
+      "fun f() { return !x != y; }",
+      "\n\n",
+      "  \t",
+      "a | b",
+  };
+  std::uniform_int_distribution<size_t> pick(0, fragments.size() - 1);
+  std::string source;
+  for (size_t i = 0; i < lines; ++i) source += fragments[pick(rng)] + "\n";
+  return source;
+}
+
+}  // namespace
+
+TEST(ParallelScannerTest, matches_tokenize_on_scanner_test_sources) {
+  const std::vector<std::string> sources = {
+      "( ) { } , . - + ; / * ! != = == > >= < <= arg1 \"string\" 1 and\n"
+      "class else false fun\nfor if nil or print return super this true var\n"
+      "while",
+      "",
+      "\"",
+      "foo(a | b);\nbar(c | d);\n",
+      "// foo(a | b);\n// bar\n",
+      "/* foo(a | b); */\n\n",
+      "/* foo(a /* | */\n b); */\nprint 1;\n",
+      "print 1;\n/* never closed\n\n",
+      "print 1;\nprint \"never closed\n\n",
+  };
+  for (const std::string& source : sources)
+    for (unsigned threads = 2; threads <= 8; ++threads)
+      expectSameAsTokenize(source, threads);
+}
+
+TEST(ParallelScannerTest, matches_tokenize_on_random_sources) {
+  std::mt19937 rng(7);
+  for (int round = 0; round < 100; ++round) {
+    const std::string source = randomSource(rng, round);
+    expectSameAsTokenize(source, 2 + round % 15);
+  }
+}
+
+TEST(ParallelScannerTest, splits_only_outside_strings_and_comments) {
+  const std::string source
+      = "a;\n\"b\nc\";\n// d\ne;\n/* f\n/* g\n*/ h\n*/ i;\nj;\n";
+  const std::vector<size_t> splits = findSplitPoints(source, source.size());
+  const std::vector<size_t> expected = {3, 10, 15, 18, 39};
+  EXPECT_EQ(expected, splits);
+}
+
+TEST(ParallelScannerTest, small_sources_are_not_split) {
+  const std::string source = "print 1;\nprint 2;\n";
+  EXPECT_TRUE(findSplitPoints(source, 1).empty());
+  ErrorsAndDebug::ErrorReporter eReporter;
+  EXPECT_EQ(7, tokenizeParallel(source, eReporter, 8).tokens.size());
+}
+
+}  // namespace cpplox
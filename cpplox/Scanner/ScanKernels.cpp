@@ -0,0 +1,356 @@
+#include "cpplox/Scanner/ScanKernels.h"
+
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+#if defined(__SSE2__)
+#define CPPLOX_SCAN_SSE2 1
+#endif
+
+// AVX2 code is compiled per function with a target attribute, so the rest of
+// the binary doesn't require AVX2 and we only call it after checking the CPU.
+#if defined(CPPLOX_SCAN_SSE2) && defined(__GNUC__)
+#define CPPLOX_SCAN_AVX2 1
+#define CPPLOX_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+namespace cpplox::ScanKernels {
+
+namespace {
+
+// Bits below bit i.
+inline auto below(uint32_t bits, int i) -> uint32_t {
+  return bits & ((1U << i) - 1);
+}
+
+inline auto popcount(uint32_t bits) -> int { return __builtin_popcount(bits); }
+
+inline auto firstSet(uint32_t bits) -> int { return __builtin_ctz(bits); }
+
+//
+// Scalar
+//
+inline auto isIdentifierChar(char c) -> bool {
+  return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z')
+         || (c >= '0' && c <= '9') || c == '_';
+}
+
+auto scalarSkipWhitespace(const char* p, const char* end, int* newlines)
+    -> const char* {
+  for (; p != end; ++p) {
+    if (*p == '\n')
+      ++*newlines;
+    else if (*p != ' ' && *p != '\t' && *p != '\r')
+      break;
+  }
+  return p;
+}
+
+auto scalarSkipIdentifier(const char* p, const char* end) -> const char* {
+  while (p != end && isIdentifierChar(*p)) ++p;
+  return p;
+}
+
+auto scalarFindStringEnd(const char* p, const char* end, int* newlines)
+    -> const char* {
+  for (; p != end && *p != '"'; ++p)
+    if (*p == '\n') ++*newlines;
+  return p;
+}
+
+auto scalarFindLineEnd(const char* p, const char* end) -> const char* {
+  while (p != end && *p != '\n') ++p;
+  return p;
+}
+
+auto scalarFindBlockCommentSpecial(const char* p, const char* end)
+    -> const char* {
+  while (p != end && *p != '*' && *p != '/' && *p != '\n') ++p;
+  return p;
+}
+
+auto scalarFindStringOrCommentStart(const char* p, const char* end)
+    -> const char* {
+  while (p != end && *p != '"' && *p != '/') ++p;
+  return p;
+}
+
+const Kernels scalarKernels{scalarSkipWhitespace, scalarSkipIdentifier,
+                            scalarFindStringEnd, scalarFindLineEnd,
+                            scalarFindBlockCommentSpecial,
+                            scalarFindStringOrCommentStart};
+
+#if defined(CPPLOX_SCAN_SSE2)
+//
+// SSE2: 16 bytes at a time. The vector loops hand the last partial block to
+// the scalar versions.
+//
+inline auto load16(const char* p) -> __m128i {
+  return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+}
+
+inline auto eq16(__m128i v, char c) -> __m128i {
+  return _mm_cmpeq_epi8(v, _mm_set1_epi8(c));
+}
+
+inline auto mask16(__m128i v) -> uint32_t {
+  return static_cast<uint32_t>(_mm_movemask_epi8(v));
+}
+
+// Bytes in [lo, hi]. Compares are signed, so non-ASCII bytes never match.
+inline auto inRange16(__m128i v, char lo, char hi) -> __m128i {
+  return _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8(lo - 1)),
+                       _mm_cmplt_epi8(v, _mm_set1_epi8(hi + 1)));
+}
+
+auto sse2SkipWhitespace(const char* p, const char* end, int* newlines)
+    -> const char* {
+  for (; end - p >= 16; p += 16) {
+    const __m128i v = load16(p);
+    const __m128i nl = eq16(v, '\n');
+    const __m128i ws = _mm_or_si128(_mm_or_si128(eq16(v, ' '), eq16(v, '\t')),
+                                    _mm_or_si128(eq16(v, '\r'), nl));
+    const uint32_t stop = ~mask16(ws) & 0xFFFFU;
+    const uint32_t nls = mask16(nl);
+    if (stop != 0) {
+      const int i = firstSet(stop);
+      *newlines += popcount(below(nls, i));
+      return p + i;
+    }
+    *newlines += popcount(nls);
+  }
+  return scalarSkipWhitespace(p, end, newlines);
+}
+
+auto sse2SkipIdentifier(const char* p, const char* end) -> const char* {
+  for (; end - p >= 16; p += 16) {
+    const __m128i v = load16(p);
+    const __m128i lower = _mm_or_si128(v, _mm_set1_epi8(0x20));
+    const __m128i ident
+        = _mm_or_si128(_mm_or_si128(inRange16(lower, 'a', 'z'),
+                                    inRange16(v, '0', '9')),
+                       eq16(v, '_'));
+    const uint32_t stop = ~mask16(ident) & 0xFFFFU;
+    if (stop != 0) return p + firstSet(stop);
+  }
+  return scalarSkipIdentifier(p, end);
+}
+
+auto sse2FindStringEnd(const char* p, const char* end, int* newlines)
+    -> const char* {
+  for (; end - p >= 16; p += 16) {
+    const __m128i v = load16(p);
+    const uint32_t quotes = mask16(eq16(v, '"'));
+    const uint32_t nls = mask16(eq16(v, '\n'));
+    if (quotes != 0) {
+      const int i = firstSet(quotes);
+      *newlines += popcount(below(nls, i));
+      return p + i;
+    }
+    *newlines += popcount(nls);
+  }
+  return scalarFindStringEnd(p, end, newlines);
+}
+
+auto sse2FindLineEnd(const char* p, const char* end) -> const char* {
+  for (; end - p >= 16; p += 16) {
+    const uint32_t stop = mask16(eq16(load16(p), '\n'));
+    if (stop != 0) return p + firstSet(stop);
+  }
+  return scalarFindLineEnd(p, end);
+}
+
+auto sse2FindBlockCommentSpecial(const char* p, const char* end)
+    -> const char* {
+  for (; end - p >= 16; p += 16) {
+    const __m128i v = load16(p);
+    const uint32_t stop = mask16(_mm_or_si128(
+        _mm_or_si128(eq16(v, '*'), eq16(v, '/')), eq16(v, '\n')));
+    if (stop != 0) return p + firstSet(stop);
+  }
+  return scalarFindBlockCommentSpecial(p, end);
+}
+
+auto sse2FindStringOrCommentStart(const char* p, const char* end)
+    -> const char* {
+  for (; end - p >= 16; p += 16) {
+    const __m128i v = load16(p);
+    const uint32_t stop = mask16(_mm_or_si128(eq16(v, '"'), eq16(v, '/')));
+    if (stop != 0) return p + firstSet(stop);
+  }
+  return scalarFindStringOrCommentStart(p, end);
+}
+
+const Kernels sse2Kernels{sse2SkipWhitespace, sse2SkipIdentifier,
+                          sse2FindStringEnd, sse2FindLineEnd,
+                          sse2FindBlockCommentSpecial,
+                          sse2FindStringOrCommentStart};
+#endif  // CPPLOX_SCAN_SSE2
+
+#if defined(CPPLOX_SCAN_AVX2)
+//
+// AVX2: the same algorithms as SSE2, 32 bytes at a time.
+//
+CPPLOX_TARGET_AVX2 inline auto load32(const char* p) -> __m256i {
+  return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+}
+
+CPPLOX_TARGET_AVX2 inline auto eq32(__m256i v, char c) -> __m256i {
+  return _mm256_cmpeq_epi8(v, _mm256_set1_epi8(c));
+}
+
+CPPLOX_TARGET_AVX2 inline auto mask32(__m256i v) -> uint32_t {
+  return static_cast<uint32_t>(_mm256_movemask_epi8(v));
+}
+
+CPPLOX_TARGET_AVX2 inline auto inRange32(__m256i v, char lo, char hi)
+    -> __m256i {
+  return _mm256_and_si256(_mm256_cmpgt_epi8(v, _mm256_set1_epi8(lo - 1)),
+                          _mm256_cmpgt_epi8(_mm256_set1_epi8(hi + 1), v));
+}
+
+CPPLOX_TARGET_AVX2 auto avx2SkipWhitespace(const char* p, const char* end,
+                                           int* newlines) -> const char* {
+  for (; end - p >= 32; p += 32) {
+    const __m256i v = load32(p);
+    const __m256i nl = eq32(v, '\n');
+    const __m256i ws
+        = _mm256_or_si256(_mm256_or_si256(eq32(v, ' '), eq32(v, '\t')),
+                          _mm256_or_si256(eq32(v, '\r'), nl));
+    const uint32_t stop = ~mask32(ws);
+    const uint32_t nls = mask32(nl);
+    if (stop != 0) {
+      const int i = firstSet(stop);
+      *newlines += popcount(below(nls, i));
+      return p + i;
+    }
+    *newlines += popcount(nls);
+  }
+  return sse2SkipWhitespace(p, end, newlines);
+}
+
+CPPLOX_TARGET_AVX2 auto avx2SkipIdentifier(const char* p, const char* end)
+    -> const char* {
+  for (; end - p >= 32; p += 32) {
+    const __m256i v = load32(p);
+    const __m256i lower = _mm256_or_si256(v, _mm256_set1_epi8(0x20));
+    const __m256i ident
+        = _mm256_or_si256(_mm256_or_si256(inRange32(lower, 'a', 'z'),
+                                          inRange32(v, '0', '9')),
+                          eq32(v, '_'));
+    const uint32_t stop = ~mask32(ident);
+    if (stop != 0) return p + firstSet(stop);
+  }
+  return sse2SkipIdentifier(p, end);
+}
+
+CPPLOX_TARGET_AVX2 auto avx2FindStringEnd(const char* p, const char* end,
+                                          int* newlines) -> const char* {
+  for (; end - p >= 32; p += 32) {
+    const __m256i v = load32(p);
+    const uint32_t quotes = mask32(eq32(v, '"'));
+    const uint32_t nls = mask32(eq32(v, '\n'));
+    if (quotes != 0) {
+      const int i = firstSet(quotes);
+      *newlines += popcount(below(nls, i));
+      return p + i;
+    }
+    *newlines += popcount(nls);
+  }
+  return sse2FindStringEnd(p, end, newlines);
+}
+
+CPPLOX_TARGET_AVX2 auto avx2FindLineEnd(const char* p, const char* end)
+    -> const char* {
+  for (; end - p >= 32; p += 32) {
+    const uint32_t stop = mask32(eq32(load32(p), '\n'));
+    if (stop != 0) return p + firstSet(stop);
+  }
+  return sse2FindLineEnd(p, end);
+}
+
+CPPLOX_TARGET_AVX2 auto avx2FindBlockCommentSpecial(const char* p,
+                                                    const char* end)
+    -> const char* {
+  for (; end - p >= 32; p += 32) {
+    const __m256i v = load32(p);
+    const uint32_t stop = mask32(_mm256_or_si256(
+        _mm256_or_si256(eq32(v, '*'), eq32(v, '/')), eq32(v, '\n')));
+    if (stop != 0) return p + firstSet(stop);
+  }
+  return sse2FindBlockCommentSpecial(p, end);
+}
+
+CPPLOX_TARGET_AVX2 auto avx2FindStringOrCommentStart(const char* p,
+                                                     const char* end)
+    -> const char* {
+  for (; end - p >= 32; p += 32) {
+    const __m256i v = load32(p);
+    const uint32_t stop
+        = mask32(_mm256_or_si256(eq32(v, '"'), eq32(v, '/')));
+    if (stop != 0) return p + firstSet(stop);
+  }
+  return sse2FindStringOrCommentStart(p, end);
+}
+
+const Kernels avx2Kernels{avx2SkipWhitespace, avx2SkipIdentifier,
+                          avx2FindStringEnd, avx2FindLineEnd,
+                          avx2FindBlockCommentSpecial,
+                          avx2FindStringOrCommentStart};
+
+auto cpuHasAvx2() -> bool {
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("avx2") != 0;
+}
+#endif  // CPPLOX_SCAN_AVX2
+
+}  // namespace
+
+auto availableKernelSets() -> std::vector<KernelSet> {
+  std::vector<KernelSet> sets{KernelSet::SCALAR};
+#if defined(CPPLOX_SCAN_SSE2)
+  sets.push_back(KernelSet::SSE2);
+#endif  // CPPLOX_SCAN_SSE2
+#if defined(CPPLOX_SCAN_AVX2)
+  if (cpuHasAvx2()) sets.push_back(KernelSet::AVX2);
+#endif  // CPPLOX_SCAN_AVX2
+  return sets;
+}
+
+auto getKernels(KernelSet set) -> const Kernels* {
+  switch (set) {
+    case KernelSet::SCALAR: return &scalarKernels;
+    case KernelSet::SSE2:
+#if defined(CPPLOX_SCAN_SSE2)
+      return &sse2Kernels;
+#else
+      return nullptr;
+#endif  // CPPLOX_SCAN_SSE2
+    case KernelSet::AVX2:
+#if defined(CPPLOX_SCAN_AVX2)
+      return cpuHasAvx2() ? &avx2Kernels : nullptr;
+#else
+      return nullptr;
+#endif  // CPPLOX_SCAN_AVX2
+  }
+  return nullptr;
+}
+
+auto getKernelSetName(KernelSet set) -> const char* {
+  switch (set) {
+    case KernelSet::SCALAR: return "scalar";
+    case KernelSet::SSE2: return "sse2";
+    case KernelSet::AVX2: return "avx2";
+  }
+  return "unknown";
+}
+
+auto bestKernels() -> const Kernels& {
+  static const Kernels& best = *getKernels(availableKernelSets().back());
+  return best;
+}
+
+}  // namespace cpplox::ScanKernels
@@ -0,0 +1,45 @@
+#ifndef CPPLOX_SCANNER_SCANKERNELS_H
+#define CPPLOX_SCANNER_SCANKERNELS_H
+#pragma once
+
+#include <vector>
+
+// Fast paths for the parts of scanning that eat long runs of bytes: whitespace,
+// comments, string bodies and identifiers. Each kernel takes [p, end) and
+// returns a pointer to the first byte it stops at (end if it runs off the
+// end). Kernels that can cross lines add the number of '\n's they skipped to
+// *newlines.
+// There's a scalar implementation everywhere, plus SSE2 (16 bytes at a time)
+// and AVX2 (32 bytes at a time) implementations on x86, picked at runtime.
+
+namespace cpplox::ScanKernels {
+
+struct Kernels {
+  // Stops at the first byte that isn't ' ', '\t', '\r' or '\n'.
+  const char* (*skipWhitespace)(const char* p, const char* end, int* newlines);
+  // Stops at the first byte that isn't [A-Za-z0-9_].
+  const char* (*skipIdentifier)(const char* p, const char* end);
+  // Stops at the first '"'.
+  const char* (*findStringEnd)(const char* p, const char* end, int* newlines);
+  // Stops at the first '\n'.
+  const char* (*findLineEnd)(const char* p, const char* end);
+  // Stops at the first '*', '/' or '\n'; everything a block comment cares
+  // about.
+  const char* (*findBlockCommentSpecial)(const char* p, const char* end);
+  // Stops at the first '"' or '/'; where a string or comment could start.
+  const char* (*findStringOrCommentStart)(const char* p, const char* end);
+};
+
+enum class KernelSet { SCALAR, SSE2, AVX2 };
+
+// The kernel sets this build and CPU support, slowest first.
+auto availableKernelSets() -> std::vector<KernelSet>;
+// Returns nullptr if set isn't available.
+auto getKernels(KernelSet set) -> const Kernels*;
+auto getKernelSetName(KernelSet set) -> const char*;
+// The fastest available kernel set, detected once.
+auto bestKernels() -> const Kernels&;
+
+}  // namespace cpplox::ScanKernels
+
+#endif  // CPPLOX_SCANNER_SCANKERNELS_H
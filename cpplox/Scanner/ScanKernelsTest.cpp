@@ -0,0 +1,80 @@
+#include "gtest/gtest.h"
+
+#include <random>
+#include <string>
+
+#include "cpplox/Scanner/ScanKernels.h"
+
+namespace cpplox::ScanKernels {
+
+namespace {
+
+// Random text biased towards the bytes the kernels care about, long enough
+// to exercise the vector loops and their scalar tails.
+auto randomText(std::mt19937& rng, size_t size) -> std::string {
+  static const std::string alphabet = "  \t\r\n\n\"*/_aZz09AM.;{(\x80\xff";
+  std::uniform_int_distribution<size_t> pick(0, alphabet.size() - 1);
+  std::string text;
+  for (size_t i = 0; i < size; ++i) text += alphabet[pick(rng)];
+  return text;
+}
+
+}  // namespace
+
+// Every kernel set must agree with the scalar kernels from every start offset.
+TEST(ScanKernelsTest, all_sets_match_scalar) {
+  const Kernels& scalar = *getKernels(KernelSet::SCALAR);
+  std::mt19937 rng(42);
+  for (KernelSet set : availableKernelSets()) {
+    const Kernels& kernels = *getKernels(set);
+    for (int round = 0; round < 200; ++round) {
+      const std::string text = randomText(rng, round);
+      const char* end = text.data() + text.size();
+      for (size_t start = 0; start <= text.size(); ++start) {
+        const char* p = text.data() + start;
+        SCOPED_TRACE(std::string(getKernelSetName(set)) + " on '" + text
+                     + "' from " + std::to_string(start));
+        int expectedLines = 0;
+        int lines = 0;
+        EXPECT_EQ(scalar.skipWhitespace(p, end, &expectedLines),
+                  kernels.skipWhitespace(p, end, &lines));
+        EXPECT_EQ(expectedLines, lines);
+        expectedLines = lines = 0;
+        EXPECT_EQ(scalar.findStringEnd(p, end, &expectedLines),
+                  kernels.findStringEnd(p, end, &lines));
+        EXPECT_EQ(expectedLines, lines);
+        EXPECT_EQ(scalar.skipIdentifier(p, end),
+                  kernels.skipIdentifier(p, end));
+        EXPECT_EQ(scalar.findLineEnd(p, end), kernels.findLineEnd(p, end));
+        EXPECT_EQ(scalar.findBlockCommentSpecial(p, end),
+                  kernels.findBlockCommentSpecial(p, end));
+        EXPECT_EQ(scalar.findStringOrCommentStart(p, end),
+                  kernels.findStringOrCommentStart(p, end));
+      }
+    }
+  }
+}
+
+TEST(ScanKernelsTest, long_runs) {
+  const std::string spaces
+      = std::string(100, ' ') + "\n\n" + std::string(50, '\t') + "x";
+  const std::string ident = std::string(70, 'a') + "_Z9" + "+";
+  for (KernelSet set : availableKernelSets()) {
+    const Kernels& kernels = *getKernels(set);
+    int lines = 0;
+    EXPECT_EQ(spaces.data() + spaces.size() - 1,
+              kernels.skipWhitespace(spaces.data(),
+                                     spaces.data() + spaces.size(), &lines));
+    EXPECT_EQ(2, lines);
+    EXPECT_EQ(ident.data() + ident.size() - 1,
+              kernels.skipIdentifier(ident.data(),
+                                     ident.data() + ident.size()));
+  }
+}
+
+TEST(ScanKernelsTest, scalar_is_always_available) {
+  EXPECT_EQ(KernelSet::SCALAR, availableKernelSets().front());
+  EXPECT_NE(nullptr, getKernels(KernelSet::SCALAR));
+}
+
+}  // namespace cpplox::ScanKernels
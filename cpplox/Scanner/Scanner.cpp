@@ -1,8 +1,17 @@
 #include "cpplox/Scanner/Scanner.h"
 
-#include <map>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
 
 #include "cpplox/ErrorsAndDebug/ErrorReporter.h"
+#include "cpplox/Scanner/ScanKernels.h"
+#include "cpplox/Types/Number.h"
 #include "cpplox/Types/Token.h"
 
 namespace cpplox {
@@ -15,56 +24,217 @@ using Types::TokenType;
 
 namespace {
 
-auto isAlpha(char c) -> bool {
-  return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c == '_');
+// What the main loop does with a byte. Together with CharInfo's token types
+// this is the scanner's state table: every byte is one lookup away from the
+// token (or token family) it starts.
+enum class CharClass : uint8_t {
+  INVALID,     // not valid outside strings and comments
+  SINGLE,      // always a one character token
+  MAYBE_PAIR,  // 'single', or 'paired' if followed by 'second'
+  SLASH,       // '/', "//" or "/*"
+  WHITESPACE,
+  NEWLINE,
+  QUOTE,
+  DIGIT,
+  ALPHA,  // [A-Za-z_]
+};
+
+struct CharInfo {
+  CharClass charClass = CharClass::INVALID;
+  TokenType single = TokenType::LOX_EOF;
+  TokenType paired = TokenType::LOX_EOF;
+  char second = '\0';
+};
+
+constexpr auto makeCharTable() -> std::array<CharInfo, 256> {
+  std::array<CharInfo, 256> table{};
+  auto set = [&](char c, CharClass charClass,
+                 TokenType single = TokenType::LOX_EOF, char second = '\0',
+                 TokenType paired = TokenType::LOX_EOF) {
+    table[static_cast<unsigned char>(c)] = {charClass, single, paired, second};
+  };
+  for (char c = 'a'; c <= 'z'; ++c) set(c, CharClass::ALPHA);
+  for (char c = 'A'; c <= 'Z'; ++c) set(c, CharClass::ALPHA);
+  set('_', CharClass::ALPHA);
+  for (char c = '0'; c <= '9'; ++c) set(c, CharClass::DIGIT);
+  set(' ', CharClass::WHITESPACE);
+  set('\t', CharClass::WHITESPACE);
+  set('\r', CharClass::WHITESPACE);
+  set('\n', CharClass::NEWLINE);
+  set('"', CharClass::QUOTE);
+  set('/', CharClass::SLASH, TokenType::SLASH);
+  set('(', CharClass::SINGLE, TokenType::LEFT_PAREN);
+  set(')', CharClass::SINGLE, TokenType::RIGHT_PAREN);
+  set('{', CharClass::SINGLE, TokenType::LEFT_BRACE);
+  set('}', CharClass::SINGLE, TokenType::RIGHT_BRACE);
+  set(',', CharClass::SINGLE, TokenType::COMMA);
+  set(':', CharClass::SINGLE, TokenType::COLON);
+  set('.', CharClass::SINGLE, TokenType::DOT);
+  set('?', CharClass::SINGLE, TokenType::QUESTION);
+  set(';', CharClass::SINGLE, TokenType::SEMICOLON);
+  set('*', CharClass::SINGLE, TokenType::STAR);
+  set('!', CharClass::MAYBE_PAIR, TokenType::BANG, '=', TokenType::BANG_EQUAL);
+  set('=', CharClass::MAYBE_PAIR, TokenType::EQUAL, '=',
+      TokenType::EQUAL_EQUAL);
+  set('>', CharClass::MAYBE_PAIR, TokenType::GREATER, '=',
+      TokenType::GREATER_EQUAL);
+  set('<', CharClass::MAYBE_PAIR, TokenType::LESS, '=', TokenType::LESS_EQUAL);
+  set('-', CharClass::MAYBE_PAIR, TokenType::MINUS, '-',
+      TokenType::MINUS_MINUS);
+  set('+', CharClass::MAYBE_PAIR, TokenType::PLUS, '+', TokenType::PLUS_PLUS);
+  return table;
 }
 
-auto isDigit(char c) -> bool { return c >= '0' && c <= '9'; }
+constexpr std::array<CharInfo, 256> charTable = makeCharTable();
 
-auto isAlphaNumeric(char c) -> bool { return isAlpha(c) || isDigit(c); }
+constexpr auto getCharInfo(char c) -> const CharInfo& {
+  return charTable[static_cast<unsigned char>(c)];
+}
 
-auto ReservedOrIdentifier(const std::string& str) -> TokenType {
-  static const std::map<std::string, TokenType> lookUpTable{
-      {"and", TokenType::AND},       {"class", TokenType::CLASS},
-      {"else", TokenType::ELSE},     {"false", TokenType::LOX_FALSE},
-      {"fun", TokenType::FUN},       {"for", TokenType::FOR},
-      {"if", TokenType::IF},         {"nil", TokenType::NIL},
-      {"or", TokenType::OR},         {"print", TokenType::PRINT},
-      {"return", TokenType::RETURN}, {"super", TokenType::SUPER},
-      {"this", TokenType::THIS},     {"true", TokenType::LOX_TRUE},
-      {"var", TokenType::VAR},       {"while", TokenType::WHILE}};
+auto isDigit(char c) -> bool {
+  return getCharInfo(c).charClass == CharClass::DIGIT;
+}
 
-  auto iter = lookUpTable.find(str);
-  if (iter == lookUpTable.end()) {
-    return TokenType::IDENTIFIER;
+// Keyword recognition with a perfect hash. The hash mixes the length and the
+// first and last characters with multipliers searched for at compile time, so
+// that the 16 keywords land in distinct buckets. An identifier is a keyword
+// iff the keyword in its bucket has the same length and bytes.
+struct Keyword {
+  std::string_view text;
+  TokenType type;
+};
+
+constexpr std::array<Keyword, 16> keywords{{{"and", TokenType::AND},
+                                            {"class", TokenType::CLASS},
+                                            {"else", TokenType::ELSE},
+                                            {"false", TokenType::LOX_FALSE},
+                                            {"fun", TokenType::FUN},
+                                            {"for", TokenType::FOR},
+                                            {"if", TokenType::IF},
+                                            {"nil", TokenType::NIL},
+                                            {"or", TokenType::OR},
+                                            {"print", TokenType::PRINT},
+                                            {"return", TokenType::RETURN},
+                                            {"super", TokenType::SUPER},
+                                            {"this", TokenType::THIS},
+                                            {"true", TokenType::LOX_TRUE},
+                                            {"var", TokenType::VAR},
+                                            {"while", TokenType::WHILE}}};
+
+constexpr size_t KEYWORD_BUCKETS = 32;
+
+struct KeywordHash {
+  uint32_t firstMultiplier;
+  uint32_t lastMultiplier;
+
+  [[nodiscard]] constexpr auto operator()(std::string_view word) const
+      -> size_t {
+    return (static_cast<unsigned char>(word.front()) * firstMultiplier
+            + static_cast<unsigned char>(word.back()) * lastMultiplier
+            + word.size())
+           % KEYWORD_BUCKETS;
   }
-  return iter->second;
+};
+
+constexpr auto isPerfect(KeywordHash hash) -> bool {
+  std::array<bool, KEYWORD_BUCKETS> used{};
+  for (const Keyword& keyword : keywords) {
+    size_t bucket = hash(keyword.text);
+    if (used[bucket]) return false;
+    used[bucket] = true;
+  }
+  return true;
+}
+
+constexpr auto findKeywordHash() -> KeywordHash {
+  for (uint32_t first = 1; first < 64; ++first)
+    for (uint32_t last = 1; last < 64; ++last)
+      if (isPerfect(KeywordHash{first, last})) return KeywordHash{first, last};
+  return KeywordHash{0, 0};
+}
+
+constexpr KeywordHash keywordHash = findKeywordHash();
+static_assert(keywordHash.firstMultiplier != 0,
+              "No perfect hash for the keywords; try more buckets.");
+
+// Bucket -> index into keywords, or -1 if the bucket is empty.
+constexpr auto makeKeywordBuckets() -> std::array<int8_t, KEYWORD_BUCKETS> {
+  std::array<int8_t, KEYWORD_BUCKETS> buckets{};
+  for (auto& bucket : buckets) bucket = -1;
+  for (size_t i = 0; i < keywords.size(); ++i)
+    buckets[keywordHash(keywords[i].text)] = static_cast<int8_t>(i);
+  return buckets;
 }
 
-auto getLexeme(const std::string& source, size_t start, size_t end)
-    -> std::string {
-  return source.substr(start, end);
+constexpr std::array<int8_t, KEYWORD_BUCKETS> keywordBuckets
+    = makeKeywordBuckets();
+
+auto ReservedOrIdentifier(std::string_view word) -> TokenType {
+  const int8_t index = keywordBuckets[keywordHash(word)];
+  if (index < 0) return TokenType::IDENTIFIER;
+  const Keyword& keyword = keywords[index];
+  if (keyword.text.size() != word.size()
+      || std::memcmp(keyword.text.data(), word.data(), word.size()) != 0)
+    return TokenType::IDENTIFIER;
+  return keyword.type;
 }
 
-auto makeOptionalLiteral(TokenType t, const std::string& lexeme)
+auto makeOptionalLiteral(TokenType t, std::string_view lexeme)
     -> OptionalLiteral {
   switch (t) {
-    case TokenType::NUMBER:
-      return Types::makeOptionalLiteral(std::stod(lexeme));
+    case TokenType::NUMBER: {
+      // Lexemes are always well formed numbers; this only fails if the value
+      // doesn't fit in a double.
+      std::optional<double> value = Types::parseNumber(lexeme);
+      return value.has_value() ? Types::makeOptionalLiteral(value.value())
+                               : std::nullopt;
+    }
     case TokenType::STRING:
-      return Types::makeOptionalLiteral(lexeme.substr(1, lexeme.size() - 2));
+      return Types::makeOptionalLiteral(
+          std::string(lexeme.substr(1, lexeme.size() - 2)));
     default: return std::nullopt;
   }
 }
 
 }  // namespace
 
-Scanner::Scanner(const std::string& p_source, ErrorReporter& p_eReporter)
-    : source(p_source), eReporter(p_eReporter) {}
+Scanner::Scanner(std::string_view p_source, ErrorReporter& p_eReporter,
+                 const ScanKernels::Kernels& p_kernels, int p_firstLine)
+    : source(p_source),
+      eReporter(p_eReporter),
+      kernels(p_kernels),
+      line(p_firstLine) {}
+
+Scanner::Scanner(SourceStream& p_stream, ErrorReporter& p_eReporter,
+                 const ScanKernels::Kernels& p_kernels)
+    : source(p_stream.window()),
+      stream(&p_stream),
+      eReporter(p_eReporter),
+      kernels(p_kernels) {}
+
+auto Scanner::at(size_t offset) const -> const char* {
+  return source.data() + offset;
+}
+
+auto Scanner::offsetOf(const char* p) const -> size_t {
+  return static_cast<size_t>(p - source.data());
+}
 
 void Scanner::addToken(TokenType t) {
-  const std::string lexeme = getLexeme(source, start, current - start);
-  tokens.emplace_back(t, lexeme, makeOptionalLiteral(t, lexeme), line);
+  const std::string_view lexeme = source.substr(start, current - start);
+  if (t != TokenType::NUMBER && t != TokenType::STRING) {
+    tokens.emplace_back(t, lexeme, line);
+    return;
+  }
+  OptionalLiteral literal = makeOptionalLiteral(t, lexeme);
+  if (!literal.has_value()) {
+    eReporter.setError(
+        line, "Number literal out of range: " + std::string(lexeme));
+    return;
+  }
+  tokens.emplace_back(t, lexeme, line,
+                      static_cast<uint32_t>(literals.size()));
+  literals.emplace_back(std::move(literal.value()));
 }
 
 void Scanner::advance() { ++current; }
@@ -72,6 +242,9 @@ void Scanner::advance() { ++current; }
 void Scanner::skipBlockComment() {
   int nesting = 1;
   while (nesting > 0) {
+    // Jump to the next byte that could open or close a comment, or end a line.
+    current = offsetOf(
+        kernels.findBlockCommentSpecial(at(current), at(source.size())));
     if (peek() == '\0') {
       eReporter.setError(line, "Block comment not closed?");
       return;
@@ -91,14 +264,27 @@ void Scanner::skipBlockComment() {
   }
 }
 
+// The kernels stop at the end of the buffered source; when streaming, the run
+// may continue in input that hasn't been read yet, hence the loops.
 void Scanner::skipComment() {
-  while (!isAtEnd() && peek() != '\n') {
-    advance();
-  }
+  do {
+    current = offsetOf(kernels.findLineEnd(at(current), at(source.size())));
+  } while (current >= source.size() && fill());
+}
+
+void Scanner::skipWhitespace() {
+  int newlines = 0;
+  do {
+    current = offsetOf(
+        kernels.skipWhitespace(at(current), at(source.size()), &newlines));
+  } while (current >= source.size() && fill());
+  line += newlines;
 }
 
 void Scanner::eatIdentifier() {
-  while (isAlphaNumeric(peek())) advance();
+  do {
+    current = offsetOf(kernels.skipIdentifier(at(current), at(source.size())));
+  } while (current >= source.size() && fill());
 }
 
 void Scanner::eatNumber() {
@@ -111,10 +297,12 @@ void Scanner::eatNumber() {
 }
 
 void Scanner::eatString() {
-  while (!isAtEnd() && peek() != '"') {
-    if (peek() == '\n') ++line;
-    advance();
-  }
+  int newlines = 0;
+  do {
+    current = offsetOf(
+        kernels.findStringEnd(at(current), at(source.size()), &newlines));
+  } while (current >= source.size() && fill());
+  line += newlines;
 
   if (isAtEnd()) {
     eReporter.setError(line, "Unterminated String!");
@@ -123,7 +311,22 @@ void Scanner::eatString() {
   }
 }
 
-auto Scanner::isAtEnd() -> bool { return current >= source.size(); }
+auto Scanner::fill() -> bool {
+  if (stream == nullptr) return false;
+  // Everything before the current token has been consumed.
+  std::optional<size_t> dropped = stream->fill(start);
+  if (!dropped.has_value()) return false;
+  start -= dropped.value();
+  current -= dropped.value();
+  source = stream->window();
+  return true;
+}
+
+auto Scanner::isAtEnd() -> bool {
+  while (current >= source.size())
+    if (!fill()) return true;
+  return false;
+}
 
 auto Scanner::matchNext(char expected) -> bool {
   bool nextMatches = (peek() == expected);
@@ -137,43 +340,21 @@ auto Scanner::peek() -> char {
 }
 
 auto Scanner::peekNext() -> char {
-  if ((current + 1) >= source.size()) return '\0';
+  while ((current + 1) >= source.size())
+    if (!fill()) return '\0';
   return source[current + 1];
 }
 
 void Scanner::tokenizeOne() {
   char c = peek();
   advance();
-  switch (c) {
-    case '(': addToken(TokenType::LEFT_PAREN); break;
-    case ')': addToken(TokenType::RIGHT_PAREN); break;
-    case '{': addToken(TokenType::LEFT_BRACE); break;
-    case '}': addToken(TokenType::RIGHT_BRACE); break;
-    case ',': addToken(TokenType::COMMA); break;
-    case ':': addToken(TokenType::COLON); break;
-    case '.': addToken(TokenType::DOT); break;
-    case '?': addToken(TokenType::QUESTION); break;
-    case ';': addToken(TokenType::SEMICOLON); break;
-    case '*': addToken(TokenType::STAR); break;
-    case '!':
-      addToken(matchNext('=') ? TokenType::BANG_EQUAL : TokenType::BANG);
-      break;
-    case '=':
-      addToken(matchNext('=') ? TokenType::EQUAL_EQUAL : TokenType::EQUAL);
-      break;
-    case '>':
-      addToken(matchNext('=') ? TokenType::GREATER_EQUAL : TokenType::GREATER);
-      break;
-    case '<':
-      addToken(matchNext('=') ? TokenType::LESS_EQUAL : TokenType::LESS);
-      break;
-    case '-':
-      addToken(matchNext('-') ? TokenType::MINUS_MINUS : TokenType::MINUS);
-      break;
-    case '+':
-      addToken(matchNext('+') ? TokenType::PLUS_PLUS : TokenType::PLUS);
+  const CharInfo& info = getCharInfo(c);
+  switch (info.charClass) {
+    case CharClass::SINGLE: addToken(info.single); break;
+    case CharClass::MAYBE_PAIR:
+      addToken(matchNext(info.second) ? info.paired : info.single);
       break;
-    case '/':
+    case CharClass::SLASH:
       if (matchNext('/'))
         skipComment();
       else if (matchNext('*'))
@@ -181,41 +362,59 @@ void Scanner::tokenizeOne() {
       else
         addToken(TokenType::SLASH);
       break;
-    case ' ':
-    case '\t':
-    case '\r': break;  // whitespace
-    case '\n': ++line; break;
-    case '"':
+    case CharClass::WHITESPACE: skipWhitespace(); break;
+    case CharClass::NEWLINE:
+      ++line;
+      skipWhitespace();
+      break;
+    case CharClass::QUOTE:
       eatString();
       addToken(TokenType::STRING);
       break;
-    default:
-      if (isDigit(c)) {
-        eatNumber();
-        addToken(TokenType::NUMBER);
-      } else if (isAlpha(c)) {
-        eatIdentifier();
-        const std::string identifier
-            = getLexeme(source, start, current - start);
-        addToken(ReservedOrIdentifier(identifier));
-      } else {
-        std::string message = "Unexpected character: ";
-        message.append(1, static_cast<char>(c));
-        eReporter.setError(line, message);
-      }
+    case CharClass::DIGIT:
+      eatNumber();
+      addToken(TokenType::NUMBER);
+      break;
+    case CharClass::ALPHA:
+      eatIdentifier();
+      addToken(ReservedOrIdentifier(source.substr(start, current - start)));
       break;
+    case CharClass::INVALID: {
+      std::string message = "Unexpected character: ";
+      message.append(1, static_cast<char>(c));
+      eReporter.setError(line, message);
+      break;
+    }
   }
 }
 
-auto Scanner::tokenize() -> std::vector<Token> {
+auto Scanner::tokenize() -> Types::TokenList {
+  // Real code averages well over 4 bytes per token; this avoids most of the
+  // regrowth without grossly over-allocating.
+  tokens.reserve(source.size() / 4 + 1);
   while (!isAtEnd()) {
     start = current;
     tokenizeOne();
   }
-  tokens.emplace_back(TokenType::LOX_EOF, "", std::nullopt, line);
-  std::vector<Token> tokensVec;
-  std::move(tokens.begin(), tokens.end(), std::back_inserter(tokensVec));
-  return tokensVec;
+  tokens.emplace_back(TokenType::LOX_EOF, source.substr(source.size()), line);
+  return Types::TokenList{std::move(tokens), std::move(literals)};
+}
+
+auto Scanner::nextToken(OptionalLiteral& literal) -> Token {
+  tokens.clear();
+  literals.clear();
+  while (tokens.empty()) {
+    if (isAtEnd())
+      return Token(TokenType::LOX_EOF, source.substr(source.size()), line);
+    start = current;
+    tokenizeOne();
+  }
+  const Token& token = tokens.back();
+  literal = token.getLiteralIndex() == Token::NO_LITERAL
+                ? std::nullopt
+                : OptionalLiteral(std::move(literals[token.getLiteralIndex()]));
+  // The literal index only means something within a TokenList.
+  return Token(token.getType(), token.getLexeme(), token.getLine());
 }
 
 }  // namespace cpplox
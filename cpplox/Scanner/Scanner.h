@@ -2,11 +2,15 @@
 #define CPPLOX_SCANNER_SCANNER_H
 #pragma once
 
-#include <list>
+#include <cstddef>
 #include <string>
+#include <string_view>
 #include <vector>
 
 #include "cpplox/ErrorsAndDebug/ErrorReporter.h"
+#include "cpplox/Scanner/ScanKernels.h"
+#include "cpplox/Scanner/SourceStream.h"
+#include "cpplox/Types/Literal.h"
 #include "cpplox/Types/Token.h"
 
 namespace cpplox {
@@ -17,11 +21,27 @@ using Types::TokenType;
 
 class Scanner {
  public:
-  Scanner(const std::string &p_source, ErrorReporter &p_eReporter);
+  // firstLine is the line number source starts on, for scanning part of a
+  // larger source.
+  Scanner(std::string_view p_source, ErrorReporter &p_eReporter,
+          const ScanKernels::Kernels &p_kernels = ScanKernels::bestKernels(),
+          int p_firstLine = 1);
 
-  auto tokenize() -> std::vector<Token>;
+  // Streams tokens from input that's read as needed; see nextToken().
+  Scanner(SourceStream &p_stream, ErrorReporter &p_eReporter,
+          const ScanKernels::Kernels &p_kernels = ScanKernels::bestKernels());
+
+  // Scans all of the source.
+  auto tokenize() -> Types::TokenList;
+
+  // Scans just the next token, for parsing while the input is still being
+  // read. Its literal value, if any, is moved into 'literal'. Returns LOX_EOF
+  // tokens once the input is exhausted.
+  auto nextToken(Types::OptionalLiteral &literal) -> Token;
 
  private:
+  // Reads more input when streaming. Returns false if there's no more.
+  auto fill() -> bool;
   auto isAtEnd() -> bool;
   void tokenizeOne();
   void advance();
@@ -29,16 +49,22 @@ class Scanner {
   auto peek() -> char;
   auto peekNext() -> char;
   void skipComment();
+  void skipWhitespace();
   void skipBlockComment();
   void eatIdentifier();
   void eatNumber();
   void eatString();
   void addToken(TokenType t);
+  [[nodiscard]] auto at(size_t offset) const -> const char *;
+  [[nodiscard]] auto offsetOf(const char *p) const -> size_t;
 
-  const std::string &source;
+  std::string_view source;
+  SourceStream *stream = nullptr;
   ErrorReporter &eReporter;
+  const ScanKernels::Kernels &kernels;
 
-  std::list<Token> tokens;
+  std::vector<Token> tokens;
+  std::vector<Types::Literal> literals;
   size_t start = 0;
   size_t current = 0;
   int line = 1;
@@ -0,0 +1,122 @@
+// Scanner throughput in MB/s on a large generated Lox source, for every kernel
+// set this CPU supports and for parallel scanning on up to every core, and raw
+// kernel throughput on long runs. Run with:
+//   bazel run -c opt //cpplox/Scanner:scanner_benchmark -- [MB]
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <thread>
+
+#include "cpplox/ErrorsAndDebug/ErrorReporter.h"
+#include "cpplox/Scanner/ParallelScanner.h"
+#include "cpplox/Scanner/ScanKernels.h"
+#include "cpplox/Scanner/Scanner.h"
+
+namespace {
+
+// Code with the usual mix of indentation, comments, long identifiers and
+// string literals.
+auto generateSource(size_t megabytes) -> std::string {
+  std::string source;
+  for (size_t i = 0; source.size() < megabytes * 1024 * 1024; ++i) {
+    const std::string n = std::to_string(i);
+    source += "// Helper number " + n + ": accumulates a running total.\n"
+              + "fun accumulate_running_total_" + n + "(previousValue) {\n"
+              + "    /* multi-line\n       block comment */\n"
+              + "    var message = \"the running total is now at least \";\n"
+              + "    print message + previousValue;\n"
+              + "    return previousValue + " + n + ".5;\n"
+              + "}\n\n";
+  }
+  return source;
+}
+
+// Runs fn over buffer a few times and returns the best MB/s.
+template <typename Fn>
+auto kernelThroughput(const std::string& buffer, Fn fn) -> double {
+  double best = 0;
+  for (int run = 0; run < 5; ++run) {
+    auto start = std::chrono::steady_clock::now();
+    const char* stop = fn(buffer.data(), buffer.data() + buffer.size());
+    auto end = std::chrono::steady_clock::now();
+    if (stop != buffer.data() + buffer.size()) std::abort();
+    double seconds = std::chrono::duration<double>(end - start).count();
+    double mbPerSecond
+        = static_cast<double>(buffer.size()) / (1024 * 1024) / seconds;
+    if (mbPerSecond > best) best = mbPerSecond;
+  }
+  return best;
+}
+
+}  // namespace
+
+auto main(int argc, char const* argv[]) -> int {
+  using cpplox::ScanKernels::availableKernelSets;
+  using cpplox::ScanKernels::getKernels;
+  using cpplox::ScanKernels::getKernelSetName;
+
+  const size_t megabytes = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 32;
+  const std::string source = generateSource(megabytes);
+  const double sizeMB = static_cast<double>(source.size()) / (1024 * 1024);
+
+  for (auto set : availableKernelSets()) {
+    double best = 0;
+    size_t tokens = 0;
+    for (int run = 0; run < 3; ++run) {
+      cpplox::ErrorsAndDebug::ErrorReporter eReporter;
+      auto start = std::chrono::steady_clock::now();
+      cpplox::Scanner scanner(source, eReporter, *getKernels(set));
+      tokens = scanner.tokenize().tokens.size();
+      auto end = std::chrono::steady_clock::now();
+      double seconds = std::chrono::duration<double>(end - start).count();
+      if (sizeMB / seconds > best) best = sizeMB / seconds;
+    }
+    std::cout << "scan, " << getKernelSetName(set) << ": " << best
+              << " MB/s (" << tokens << " tokens)" << std::endl;
+  }
+
+  for (unsigned threads = 2; threads <= std::thread::hardware_concurrency();
+       threads *= 2) {
+    double best = 0;
+    for (int run = 0; run < 3; ++run) {
+      cpplox::ErrorsAndDebug::ErrorReporter eReporter;
+      auto start = std::chrono::steady_clock::now();
+      cpplox::tokenizeParallel(source, eReporter, threads);
+      auto end = std::chrono::steady_clock::now();
+      double seconds = std::chrono::duration<double>(end - start).count();
+      if (sizeMB / seconds > best) best = sizeMB / seconds;
+    }
+    std::cout << "parallel scan, " << threads << " threads: " << best
+              << " MB/s" << std::endl;
+  }
+
+  const size_t runLength = megabytes * 1024 * 1024;
+  std::string whitespace;
+  std::string stringBody;
+  for (size_t i = 0; i < runLength; ++i) {
+    whitespace += i % 64 == 63 ? '\n' : ' ';
+    stringBody += i % 64 == 63 ? '\n' : static_cast<char>('a' + i % 26);
+  }
+  const std::string identifier(runLength, 'x');
+  for (auto set : availableKernelSets()) {
+    const auto& kernels = *getKernels(set);
+    int newlines = 0;
+    std::cout << getKernelSetName(set) << " kernels: whitespace "
+              << kernelThroughput(whitespace,
+                                  [&](const char* p, const char* end) {
+                                    return kernels.skipWhitespace(p, end,
+                                                                  &newlines);
+                                  })
+              << " MB/s, string body "
+              << kernelThroughput(stringBody,
+                                  [&](const char* p, const char* end) {
+                                    return kernels.findStringEnd(p, end,
+                                                                 &newlines);
+                                  })
+              << " MB/s, identifier "
+              << kernelThroughput(identifier, kernels.skipIdentifier)
+              << " MB/s" << std::endl;
+  }
+  return 0;
+}
@@ -16,7 +16,7 @@ TEST(ScannerTests, all_valid_tokens) {
         "else false fun "
         "for if nil or print return super this true var while";
   cpplox::Scanner scanner(source, eReporter);
-  std::vector<Types::Token> tokensVec = scanner.tokenize();
+  std::vector<Types::Token> tokensVec = scanner.tokenize().tokens;
 
   std::vector<Types::TokenType> expected = {TokenType::LEFT_PAREN,
                                             TokenType::RIGHT_PAREN,
@@ -64,11 +64,25 @@ TEST(ScannerTests, all_valid_tokens) {
   }
 }
 
+TEST(ScannerTests, keywords_need_an_exact_match) {
+  cpplox::ErrorsAndDebug::ErrorReporter eReporter;
+  std::string source
+      = "an andd classes els falsey fn fun_ fo If ni o orr printf ret super_ "
+        "thiss tru va whilee _while x while";
+  cpplox::Scanner scanner(source, eReporter);
+  std::vector<Types::Token> tokensVec = scanner.tokenize().tokens;
+  ASSERT_EQ(tokensVec.size(), 23);
+  for (size_t i = 0; i < 21; ++i)
+    EXPECT_EQ(tokensVec[i].getType(), TokenType::IDENTIFIER)
+        << tokensVec[i].getLexeme();
+  EXPECT_EQ(tokensVec[21].getType(), TokenType::WHILE);
+}
+
 TEST(ScannerTests, empty_buffer) {
   cpplox::ErrorsAndDebug::ErrorReporter eReporter;
   std::string source;
   cpplox::Scanner scanner(source, eReporter);
-  std::vector<Types::Token> tokensVec = scanner.tokenize();
+  std::vector<Types::Token> tokensVec = scanner.tokenize().tokens;
   ASSERT_EQ(eReporter.getStatus(), ErrorsAndDebug::LoxStatus::OK);
 }
 
@@ -76,7 +90,7 @@ TEST(ScannerTests, unterminated_string) {
   cpplox::ErrorsAndDebug::ErrorReporter eReporter;
   std::string source = "\"";
   cpplox::Scanner scanner(source, eReporter);
-  std::vector<Types::Token> tokensVec = scanner.tokenize();
+  std::vector<Types::Token> tokensVec = scanner.tokenize().tokens;
   ASSERT_EQ(eReporter.getStatus(), ErrorsAndDebug::LoxStatus::ERROR);
 }
 
@@ -84,7 +98,7 @@ TEST(ScannerTests, unexpected_char) {
   cpplox::ErrorsAndDebug::ErrorReporter eReporter;
   std::string source = "foo(a | b);";
   cpplox::Scanner scanner(source, eReporter);
-  std::vector<Types::Token> tokensVec = scanner.tokenize();
+  std::vector<Types::Token> tokensVec = scanner.tokenize().tokens;
   ASSERT_EQ(eReporter.getStatus(), ErrorsAndDebug::LoxStatus::ERROR);
 }
 
@@ -92,7 +106,7 @@ TEST(ScannerTests, single_line_comment) {
   cpplox::ErrorsAndDebug::ErrorReporter eReporter;
   std::string source = "// foo(a | b);";
   cpplox::Scanner scanner(source, eReporter);
-  std::vector<Types::Token> tokensVec = scanner.tokenize();
+  std::vector<Types::Token> tokensVec = scanner.tokenize().tokens;
   ASSERT_EQ(tokensVec.size(), 1);
   auto tokenIter = tokensVec.front();
   ASSERT_EQ(tokenIter.getType(), Types::TokenType::LOX_EOF);
@@ -102,7 +116,7 @@ TEST(ScannerTests, block_comment) {
   cpplox::ErrorsAndDebug::ErrorReporter eReporter;
   std::string source = "/* foo(a | b); */";
   cpplox::Scanner scanner(source, eReporter);
-  std::vector<Types::Token> tokensVec = scanner.tokenize();
+  std::vector<Types::Token> tokensVec = scanner.tokenize().tokens;
   ASSERT_EQ(tokensVec.size(), 1);
   auto tokenIter = tokensVec.front();
   ASSERT_EQ(tokenIter.getType(), Types::TokenType::LOX_EOF);
@@ -112,7 +126,7 @@ TEST(ScannerTests, nested_block_comment) {
   cpplox::ErrorsAndDebug::ErrorReporter eReporter;
   std::string source = "/* foo(a /* | */ b); */";
   cpplox::Scanner scanner(source, eReporter);
-  std::vector<Types::Token> tokensVec = scanner.tokenize();
+  std::vector<Types::Token> tokensVec = scanner.tokenize().tokens;
   ASSERT_EQ(tokensVec.size(), 1);
   auto tokenIter = tokensVec.front();
   ASSERT_EQ(tokenIter.getType(), Types::TokenType::LOX_EOF);
@@ -0,0 +1,70 @@
+#include "cpplox/Scanner/SourceStream.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <utility>
+
+namespace cpplox {
+
+auto SourceStream::open(const char* const path, size_t chunkSize)
+    -> std::unique_ptr<SourceStream> {
+  if (std::strcmp(path, "-") == 0)
+    return std::unique_ptr<SourceStream>(
+        new SourceStream(STDIN_FILENO, false, chunkSize));
+  const int fd = ::open(path, O_RDONLY | O_CLOEXEC);
+  if (fd < 0) return nullptr;
+  return std::unique_ptr<SourceStream>(new SourceStream(fd, true, chunkSize));
+}
+
+SourceStream::SourceStream(int fd, bool ownsFd, size_t chunkSize)
+    : fd(fd), ownsFd(ownsFd), chunkSize(std::max<size_t>(chunkSize, 16)) {}
+
+SourceStream::~SourceStream() {
+  if (ownsFd) ::close(fd);
+}
+
+auto SourceStream::window() const -> std::string_view {
+  if (chunks.empty()) return std::string_view();
+  return std::string_view(chunks.back().data.get(), windowEnd);
+}
+
+auto SourceStream::fill(size_t keepFrom) -> std::optional<size_t> {
+  if (exhausted) return std::nullopt;
+
+  size_t dropped = 0;
+  if (chunks.empty() || windowEnd == chunks.back().capacity) {
+    // Out of room: start a new chunk holding the bytes still needed. A token
+    // longer than a chunk gets a chunk twice its size, so that this copying
+    // stays linear overall.
+    const size_t kept = windowEnd - keepFrom;
+    const size_t capacity = std::max(chunkSize, 2 * kept);
+    Chunk chunk{std::unique_ptr<char[]>(new char[capacity]), capacity};
+    if (kept != 0)
+      std::memcpy(chunk.data.get(),
+                  chunks.back().data.get() + keepFrom, kept);
+    chunks.push_back(std::move(chunk));
+    windowEnd = kept;
+    dropped = keepFrom;
+  }
+
+  Chunk& chunk = chunks.back();
+  while (true) {
+    ssize_t n = ::read(fd, chunk.data.get() + windowEnd,
+                       chunk.capacity - windowEnd);
+    if (n > 0) {
+      windowEnd += static_cast<size_t>(n);
+      totalRead += static_cast<size_t>(n);
+      return dropped;
+    }
+    if (n < 0 && errno == EINTR) continue;
+    // End of input or a read error; either way there's nothing more to scan.
+    exhausted = true;
+    return dropped == 0 ? std::nullopt : std::make_optional(dropped);
+  }
+}
+
+}  // namespace cpplox
@@ -0,0 +1,60 @@
+#ifndef CPPLOX_SCANNER_SOURCESTREAM_H
+#define CPPLOX_SCANNER_SOURCESTREAM_H
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+#include "cpplox/Types/Uncopyable.h"
+
+namespace cpplox {
+
+// Source text read incrementally from a file descriptor (a pipe, stdin, or a
+// file), for scanning input before all of it has arrived.
+// The scanner sees a window of the input: the bytes read so far into the
+// current chunk. fill() reads more into the window. When the chunk is full,
+// the bytes the scanner still needs are copied into a fresh, larger chunk.
+// Old chunks are never freed or moved while the stream is alive, because
+// tokens (and the AST built from them) point into them.
+class SourceStream : public Types::Uncopyable {
+ public:
+  static const size_t DEFAULT_CHUNK_SIZE = 64 * 1024;
+
+  // Returns nullptr if path can't be opened. "-" reads stdin.
+  static auto open(const char* path, size_t chunkSize = DEFAULT_CHUNK_SIZE)
+      -> std::unique_ptr<SourceStream>;
+  ~SourceStream() override;
+
+  [[nodiscard]] auto window() const -> std::string_view;
+  // Total bytes read from the input so far.
+  [[nodiscard]] auto bytesRead() const -> size_t { return totalRead; }
+
+  // Reads more input into the window. Bytes of the window before keepFrom are
+  // no longer needed and may be dropped from its front. Returns how many
+  // bytes were dropped (offsets into the window shift down by that much), or
+  // nullopt if the window is unchanged because the input is exhausted.
+  auto fill(size_t keepFrom) -> std::optional<size_t>;
+
+ private:
+  SourceStream(int fd, bool ownsFd, size_t chunkSize);
+
+  struct Chunk {
+    std::unique_ptr<char[]> data;
+    size_t capacity;
+  };
+
+  int fd;
+  bool ownsFd;
+  bool exhausted = false;
+  size_t chunkSize;
+  std::vector<Chunk> chunks;
+  size_t windowEnd = 0;  // the window is chunks.back()[0, windowEnd)
+  size_t totalRead = 0;
+};
+
+}  // namespace cpplox
+
+#endif  // CPPLOX_SCANNER_SOURCESTREAM_H
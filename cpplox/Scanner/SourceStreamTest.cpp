@@ -0,0 +1,76 @@
+#include "gtest/gtest.h"
+
+#include <cstdio>
+#include <fstream>
+#include <string>
+
+#include "cpplox/ErrorsAndDebug/ErrorReporter.h"
+#include "cpplox/Scanner/Scanner.h"
+#include "cpplox/Scanner/SourceStream.h"
+#include "cpplox/TestUtil/TestUtil.h"
+#include "cpplox/Types/Literal.h"
+#include "cpplox/Types/Token.h"
+
+namespace cpplox {
+
+namespace {
+
+// Tokens that straddle chunk boundaries, and one longer than a whole chunk.
+const char* const SOURCE
+    = "var identifierLongerThanAChunk = \"a string longer than a chunk\";\n"
+      "/* a block\ncomment */ print 12.5 + 3; // line comment\n"
+      "fun f(a, b) { return a >= b and !false; }\n"
+      "print \"multi\nline\" == nil;";
+
+}  // namespace
+
+TEST(SourceStreamTest, streamed_tokens_match_tokenize) {
+  const std::string path = TestUtil::tempPath("source_stream_test_");
+  std::ofstream(path) << SOURCE;
+
+  ErrorsAndDebug::ErrorReporter batchErrors;
+  const std::string source = SOURCE;
+  Scanner batch(source, batchErrors);
+  const Types::TokenList expected = batch.tokenize();
+
+  auto stream = SourceStream::open(path.c_str(), 16);
+  ASSERT_NE(nullptr, stream);
+  ErrorsAndDebug::ErrorReporter streamErrors;
+  Scanner streaming(*stream, streamErrors);
+  for (const Types::Token& want : expected.tokens) {
+    Types::OptionalLiteral literal;
+    const Types::Token got = streaming.nextToken(literal);
+    EXPECT_EQ(want.getType(), got.getType());
+    EXPECT_EQ(want.getLexeme(), got.getLexeme());
+    EXPECT_EQ(want.getLine(), got.getLine());
+    const Types::OptionalLiteral wantLiteral = expected.getLiteral(want);
+    ASSERT_EQ(wantLiteral.has_value(), literal.has_value());
+    if (wantLiteral.has_value()) {
+      EXPECT_EQ(Types::getLiteralString(wantLiteral.value()),
+                Types::getLiteralString(literal.value()));
+    }
+  }
+  EXPECT_EQ(ErrorsAndDebug::LoxStatus::OK, streamErrors.getStatus());
+  EXPECT_EQ(source.size(), stream->bytesRead());
+  std::remove(path.c_str());
+}
+
+TEST(SourceStreamTest, keeps_returning_eof) {
+  const std::string path = TestUtil::tempPath("source_stream_eof_");
+  std::ofstream(path) << "1";
+  auto stream = SourceStream::open(path.c_str());
+  ASSERT_NE(nullptr, stream);
+  ErrorsAndDebug::ErrorReporter eReporter;
+  Scanner scanner(*stream, eReporter);
+  Types::OptionalLiteral literal;
+  EXPECT_EQ(Types::TokenType::NUMBER, scanner.nextToken(literal).getType());
+  EXPECT_EQ(Types::TokenType::LOX_EOF, scanner.nextToken(literal).getType());
+  EXPECT_EQ(Types::TokenType::LOX_EOF, scanner.nextToken(literal).getType());
+  std::remove(path.c_str());
+}
+
+TEST(SourceStreamTest, missing_file_fails_to_open) {
+  EXPECT_EQ(nullptr, SourceStream::open("/nonexistent/source_stream.lox"));
+}
+
+}  // namespace cpplox
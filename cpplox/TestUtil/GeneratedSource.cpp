@@ -0,0 +1,24 @@
+#include "cpplox/TestUtil/GeneratedSource.h"
+
+#include <string>
+
+namespace cpplox::TestUtil {
+
+auto generateSource(size_t bytes) -> std::string {
+  std::string source;
+  for (size_t i = 0; source.size() < bytes; ++i) {
+    const std::string n = std::to_string(i);
+    source += "fun f" + n + "(a, b) {\n"
+              + "  var x = (a + b) * 2 - a / (b + 1) > 3 == !false;\n"
+              + "  if (a < b and b >= " + n + " or a != nil) {\n"
+              + "    for (var i = 0; i < 10; i = i + 1) x = x + g(i, -a);\n"
+              + "  } else {\n"
+              + "    while (b > 0) { b = b - 1; print \"b\" + b; }\n"
+              + "  }\n"
+              + "  return a ? b : x.field.other;\n"
+              + "}\n";
+  }
+  return source;
+}
+
+}  // namespace cpplox::TestUtil
@@ -0,0 +1,16 @@
+#ifndef CPPLOX_TESTUTIL_GENERATEDSOURCE_H
+#define CPPLOX_TESTUTIL_GENERATEDSOURCE_H
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+namespace cpplox::TestUtil {
+
+// A Lox program of at least 'bytes' bytes, for benchmarks: functions full of
+// arithmetic, calls, conditionals and nested blocks.
+auto generateSource(size_t bytes) -> std::string;
+
+}  // namespace cpplox::TestUtil
+
+#endif  // CPPLOX_TESTUTIL_GENERATEDSOURCE_H
@@ -0,0 +1,29 @@
+#include "cpplox/TestUtil/TestUtil.h"
+
+#include <unistd.h>
+
+#include <cstdlib>
+
+#include "cpplox/ErrorsAndDebug/ErrorReporter.h"
+#include "cpplox/Parser/Parser.h"
+#include "cpplox/Scanner/Scanner.h"
+#include "gtest/gtest.h"
+
+namespace cpplox::TestUtil {
+
+auto tempPath(const std::string& name) -> std::string {
+  const char* dir = std::getenv("TEST_TMPDIR");
+  return std::string(dir != nullptr ? dir : "/tmp") + "/" + name
+         + std::to_string(::getpid());
+}
+
+auto parse(const std::string& source) -> std::vector<AST::StmtPtrVariant> {
+  ErrorsAndDebug::ErrorReporter eReporter;
+  Types::TokenList tokens = Scanner(source, eReporter).tokenize();
+  std::vector<AST::StmtPtrVariant> program
+      = Parser::RDParser(tokens, eReporter).parse();
+  EXPECT_EQ(ErrorsAndDebug::LoxStatus::OK, eReporter.getStatus());
+  return program;
+}
+
+}  // namespace cpplox::TestUtil
@@ -0,0 +1,25 @@
+#ifndef CPPLOX_TESTUTIL_TESTUTIL_H
+#define CPPLOX_TESTUTIL_TESTUTIL_H
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "cpplox/AST/NodeTypes.h"
+
+// Helpers shared by the tests.
+
+namespace cpplox::TestUtil {
+
+// A path for a scratch file or directory, under TEST_TMPDIR if Bazel set one,
+// made unique to this process by appending its pid to name.
+auto tempPath(const std::string& name) -> std::string;
+
+// Scans and parses source into the current Arena, failing the test if it
+// doesn't parse cleanly. Tokens point into the source, so it has to outlive the
+// tree.
+auto parse(const std::string& source) -> std::vector<AST::StmtPtrVariant>;
+
+}  // namespace cpplox::TestUtil
+
+#endif  // CPPLOX_TESTUTIL_TESTUTIL_H
@@ -1,5 +1,7 @@
 #include "cpplox/Types/Literal.h"
 
+#include "cpplox/Types/Number.h"
+
 namespace cpplox::Types {
 
 auto getLiteralString(const Literal& value) -> std::string {
@@ -7,15 +9,8 @@ auto getLiteralString(const Literal& value) -> std::string {
   switch (value.index()) {
     case 0:  // string
       return std::get<0>(value);
-    case 1: {  // double
-      std::string result = std::to_string(std::get<1>(value));
-      auto pos = result.find(".000000");
-      if (pos != std::string::npos)
-        result.erase(pos, std::string::npos);
-      else
-        result.erase(result.find_last_not_of('0') + 1, std::string::npos);
-      return result;
-    }
+    case 1:  // double
+      return formatNumber(std::get<1>(value));
     default:
       static_assert(
           std::variant_size_v<Literal> == 2,
@@ -0,0 +1,40 @@
+#include "cpplox/Types/Number.h"
+
+#include <charconv>
+#include <cmath>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <system_error>
+
+namespace cpplox::Types {
+
+auto formatNumber(double value, char* first, char* last) -> char* {
+  // With no precision, to_chars writes the shortest digits that round-trip,
+  // so 3.0 prints as "3" and 0.1 as "0.1". Left to pick the form itself it
+  // would also print 400000 as "4e+05", so numbers of everyday magnitudes
+  // are always written out in full, and only the rest (1e300, 1e-7) in
+  // scientific notation.
+  const double magnitude = std::fabs(value);
+  const bool fixed
+      = magnitude == 0 || (magnitude >= 1e-6 && magnitude < 1e21);
+  return std::to_chars(first, last, value,
+                       fixed ? std::chars_format::fixed
+                             : std::chars_format::scientific)
+      .ptr;
+}
+
+auto formatNumber(double value) -> std::string {
+  char buffer[MAX_NUMBER_CHARS];
+  char* end = formatNumber(value, buffer, buffer + sizeof buffer);
+  return std::string(buffer, end);
+}
+
+auto parseNumber(std::string_view str) -> std::optional<double> {
+  double value = 0;
+  auto [end, ec] = std::from_chars(str.data(), str.data() + str.size(), value);
+  if (ec != std::errc() || end != str.data() + str.size()) return std::nullopt;
+  return value;
+}
+
+}  // namespace cpplox::Types
@@ -0,0 +1,32 @@
+#ifndef CPPLOX_TYPES_NUMBER_H
+#define CPPLOX_TYPES_NUMBER_H
+#pragma once
+
+#include <cstddef>
+#include <optional>
+#include <string>
+#include <string_view>
+
+// Conversions between Lox numbers (doubles) and their text form. Both
+// directions go through <charconv>, so they don't allocate, don't depend on
+// the locale, and round-trip exactly: formatNumber emits the fewest digits
+// that parse back to the same double, written out in full from 1e-6 up to
+// 1e21 and in scientific notation beyond.
+
+namespace cpplox::Types {
+
+// Enough room for any double, e.g. "-2.2250738585072014e-308".
+constexpr size_t MAX_NUMBER_CHARS = 32;
+
+// Writes value into [first, last) and returns one past the last character
+// written. [first, last) must hold at least MAX_NUMBER_CHARS characters.
+auto formatNumber(double value, char* first, char* last) -> char*;
+
+auto formatNumber(double value) -> std::string;
+
+// Parses the whole of str as a number; std::nullopt if any of it isn't.
+auto parseNumber(std::string_view str) -> std::optional<double>;
+
+}  // namespace cpplox::Types
+
+#endif  // CPPLOX_TYPES_NUMBER_H
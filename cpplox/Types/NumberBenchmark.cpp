@@ -0,0 +1,67 @@
+// Microbenchmarks for number formatting and parsing: the <charconv> based
+// routines in Number.h against the std::to_string/std::stod code they
+// replaced. Run with: bazel run -c opt //cpplox/Types:number_benchmark
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "cpplox/Types/Number.h"
+
+namespace {
+
+// What getObjectString used to do with a double.
+auto toStringAndTrim(double value) -> std::string {
+  std::string result = std::to_string(value);
+  auto pos = result.find(".000000");
+  if (pos != std::string::npos)
+    result.erase(pos, std::string::npos);
+  else
+    result.erase(result.find_last_not_of('0') + 1, std::string::npos);
+  return result;
+}
+
+template <typename Fn>
+void bench(const std::string& name, size_t iterations, Fn fn) {
+  auto start = std::chrono::steady_clock::now();
+  size_t sink = 0;
+  for (size_t i = 0; i < iterations; ++i) sink += fn(i);
+  auto end = std::chrono::steady_clock::now();
+  double ns = std::chrono::duration<double, std::nano>(end - start).count();
+  std::cout << name << ": " << ns / iterations << " ns/op (" << sink % 10
+            << ")" << std::endl;
+}
+
+}  // namespace
+
+auto main() -> int {
+  using cpplox::Types::formatNumber;
+  using cpplox::Types::MAX_NUMBER_CHARS;
+  using cpplox::Types::parseNumber;
+
+  const size_t N = 2000000;
+  std::vector<double> values;
+  for (size_t i = 0; i < 1024; ++i)
+    values.push_back(i % 2 == 0 ? static_cast<double>(i * 37)
+                                : static_cast<double>(i) / 7.0);
+  std::vector<std::string> lexemes;
+  for (double v : values) lexemes.push_back(toStringAndTrim(v));
+
+  bench("format: to_string + trim", N,
+        [&](size_t i) { return toStringAndTrim(values[i & 1023]).size(); });
+  bench("format: formatNumber -> std::string", N,
+        [&](size_t i) { return formatNumber(values[i & 1023]).size(); });
+  bench("format: formatNumber -> buffer", N, [&](size_t i) {
+    char buffer[MAX_NUMBER_CHARS];
+    return static_cast<size_t>(
+        formatNumber(values[i & 1023], buffer, buffer + sizeof buffer)
+        - buffer);
+  });
+  bench("parse: std::stod", N, [&](size_t i) {
+    return static_cast<size_t>(std::stod(lexemes[i & 1023]));
+  });
+  bench("parse: parseNumber", N, [&](size_t i) {
+    return static_cast<size_t>(parseNumber(lexemes[i & 1023]).value());
+  });
+  return 0;
+}
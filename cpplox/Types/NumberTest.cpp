@@ -0,0 +1,57 @@
+#include "gtest/gtest.h"
+
+#include <cmath>
+#include <limits>
+#include <string>
+
+#include "cpplox/Types/Number.h"
+
+namespace cpplox::Types {
+
+TEST(NumberTest, formats_integers_without_a_fraction) {
+  EXPECT_EQ("0", formatNumber(0.0));
+  EXPECT_EQ("-0", formatNumber(-0.0));
+  EXPECT_EQ("123", formatNumber(123.0));
+  EXPECT_EQ("987654", formatNumber(987654.0));
+  EXPECT_EQ("100000", formatNumber(100000.0));
+  EXPECT_EQ("400000", formatNumber(400000.0));
+  EXPECT_EQ("1000000", formatNumber(1e6));
+  EXPECT_EQ("-2500000", formatNumber(-2.5e6));
+  EXPECT_EQ("100000000000000000000", formatNumber(1e20));
+}
+
+TEST(NumberTest, formats_shortest_round_trip) {
+  EXPECT_EQ("123.456", formatNumber(123.456));
+  EXPECT_EQ("-0.001", formatNumber(-0.001));
+  EXPECT_EQ("0.1", formatNumber(0.1));
+  EXPECT_EQ("0.30000000000000004", formatNumber(0.1 + 0.2));
+}
+
+TEST(NumberTest, formats_large_and_small_magnitudes) {
+  // std::to_string printed these as 301 digits and "0.000000" respectively.
+  EXPECT_EQ("1e+21", formatNumber(1e21));
+  EXPECT_EQ("1e+300", formatNumber(1e300));
+  EXPECT_EQ("0.000001", formatNumber(1e-6));
+  EXPECT_EQ("1e-07", formatNumber(1e-7));
+  EXPECT_EQ("1.7976931348623157e+308",
+            formatNumber(std::numeric_limits<double>::max()));
+  EXPECT_EQ("5e-324", formatNumber(std::numeric_limits<double>::denorm_min()));
+}
+
+TEST(NumberTest, round_trips) {
+  for (double value : {0.1, 1.0 / 3.0, 6.02214076e23, 1e-300, 123456789.125}) {
+    char buffer[MAX_NUMBER_CHARS];
+    char* end = formatNumber(value, buffer, buffer + sizeof buffer);
+    EXPECT_EQ(value, parseNumber(std::string_view(buffer, end - buffer)));
+  }
+}
+
+TEST(NumberTest, parses_whole_input_only) {
+  EXPECT_EQ(12.5, parseNumber("12.5"));
+  EXPECT_EQ(0.0, parseNumber("0"));
+  EXPECT_FALSE(parseNumber("12.5x").has_value());
+  EXPECT_FALSE(parseNumber("").has_value());
+  EXPECT_FALSE(parseNumber("1" + std::string(400, '0')).has_value());
+}
+
+}  // namespace cpplox::Types
@@ -1,8 +1,10 @@
 #include "cpplox/Types/Token.h"
 #include "cpplox/Types/Literal.h"
+#include "cpplox/Types/Number.h"
 
 #include <map>
 #include <string>
+#include <string_view>
 #include <type_traits>
 #include <utility>
 
@@ -60,28 +62,31 @@ auto TokenTypeString(const TokenType value) -> const std::string& {
 
 }  // namespace
 
-Token::Token(TokenType p_type, std::string p_lexeme, OptionalLiteral p_literal,
-             int p_line)
-    : type(p_type),
-      lexeme(std::move(p_lexeme)),
-      literal(std::move(p_literal)),
-      line(p_line) {}
-
-Token::Token(TokenType p_type, const char* p_lexeme, OptionalLiteral p_literal,
-             int p_line)
-    : type(p_type),
-      lexeme(p_lexeme),
-      literal(std::move(p_literal)),
-      line(p_line) {}
+Token::Token(TokenType p_type, std::string_view p_lexeme, int p_line,
+             uint32_t p_literalIndex)
+    : lexemeStart(p_lexeme.data()),
+      lexemeLength(static_cast<uint32_t>(p_lexeme.size())),
+      line(p_line),
+      literalIndex(p_literalIndex),
+      type(p_type) {}
 
 Token::Token(TokenType p_type, const char* p_lexeme)
-    : type(p_type), lexeme(p_lexeme) {}
+    : Token(p_type, std::string_view(p_lexeme), -1) {}
 
 auto Token::toString() const -> std::string {
-  std::string result
-      = std::to_string(line) + " " + TokenTypeString(type) + " " + lexeme + " ";
-  result
-      += literal.has_value() ? getLiteralString(literal.value()) : "No Literal";
+  std::string result = std::to_string(line) + " " + TokenTypeString(type) + " ";
+  result += getLexeme();
+  result += " ";
+  // Tokens don't carry their literal's value, but it can be recovered from the
+  // lexeme without the TokenList.
+  const std::string_view lexeme = getLexeme();
+  if (type == TokenType::STRING && lexeme.size() >= 2) {
+    result += lexeme.substr(1, lexeme.size() - 2);
+  } else if (type == TokenType::NUMBER && parseNumber(lexeme).has_value()) {
+    result += formatNumber(parseNumber(lexeme).value());
+  } else {
+    result += "No Literal";
+  }
   return result;
 }
 
@@ -89,10 +94,15 @@ auto Token::getType() const -> TokenType { return this->type; }
 auto Token::getTypeString() const -> const std::string& {
   return TokenTypeString(this->type);
 }
-auto Token::getLexeme() const -> const std::string& { return this->lexeme; };
-auto Token::getOptionalLiteral() const -> const OptionalLiteral& {
-  return this->literal;
+auto Token::getLexeme() const -> std::string_view {
+  return std::string_view(lexemeStart, lexemeLength);
 }
+auto Token::getLiteralIndex() const -> uint32_t { return this->literalIndex; }
 auto Token::getLine() const -> int { return this->line; }
 
+auto TokenList::getLiteral(const Token& token) const -> OptionalLiteral {
+  if (token.getLiteralIndex() == Token::NO_LITERAL) return std::nullopt;
+  return literals[token.getLiteralIndex()];
+}
+
 }  // namespace cpplox::Types
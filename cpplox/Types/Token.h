@@ -2,13 +2,17 @@
 #define TYPES_TOKEN_H
 #pragma once
 
+#include <cstdint>
 #include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
 
 #include "cpplox/Types/Literal.h"
 
 namespace cpplox::Types {
 
-enum class TokenType {
+enum class TokenType : uint8_t {
   // Single-character tokens.
   LEFT_PAREN,
   RIGHT_PAREN,
@@ -62,13 +66,17 @@ enum class TokenType {
   LOX_EOF
 };
 
+// A token is a small, trivially copyable record: its type, the line it was
+// found on, a view of its lexeme and, for NUMBER and STRING tokens, the index
+// of its value in the TokenList's literal table. The lexeme points into the
+// scanned source (or a string literal), which must outlive the token and
+// everything (e.g., AST nodes) the token is copied into.
 class Token {
  public:
-  Token(TokenType p_type, std::string p_lexeme, OptionalLiteral p_literal,
-        int p_line);
+  static constexpr uint32_t NO_LITERAL = UINT32_MAX;
 
-  Token(TokenType p_type, const char* p_lexeme, OptionalLiteral p_literal,
-        int p_line);
+  Token(TokenType p_type, std::string_view p_lexeme, int p_line,
+        uint32_t p_literalIndex = NO_LITERAL);
 
   Token(TokenType p_type, const char* p_lexeme);
 
@@ -76,15 +84,28 @@ class Token {
   [[nodiscard]] auto getType() const -> TokenType;
   [[nodiscard]] auto getTypeString() const -> const std::string&;
   [[nodiscard]] auto getLine() const -> int;
-  [[nodiscard]] auto getLexeme() const -> const std::string&;
-  [[nodiscard]] auto getOptionalLiteral() const -> const OptionalLiteral&;
+  [[nodiscard]] auto getLexeme() const -> std::string_view;
+  [[nodiscard]] auto getLiteralIndex() const -> uint32_t;
 
  private:
-  const TokenType type;
-  const std::string lexeme;
-  OptionalLiteral literal = std::nullopt;
-  const int line = -1;
+  const char* lexemeStart;
+  uint32_t lexemeLength;
+  int32_t line = -1;
+  uint32_t literalIndex = NO_LITERAL;
+  TokenType type;
 };  // class Token
 
+static_assert(std::is_trivially_copyable_v<Token>);
+static_assert(sizeof(Token) <= 24);
+
+// What the scanner produces and the parser consumes: tokens in source order,
+// and the values of the literals they refer to.
+struct TokenList {
+  std::vector<Token> tokens;
+  std::vector<Literal> literals;
+
+  [[nodiscard]] auto getLiteral(const Token& token) const -> OptionalLiteral;
+};
+
 }  // namespace cpplox::Types
 #endif  // TYPES_TOKEN_H
\ No newline at end of file
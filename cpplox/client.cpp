@@ -0,0 +1,45 @@
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <iterator>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include "cpplox/InterpreterDriver/ServerProtocol.h"
+
+// Runs a script on a `cpplox --serve` server, printing what it prints and
+// exiting with its exit code. We are using SYSEXITS exit codes.
+auto main(int argc, char const *argv[]) -> int {
+  if (argc < 3) {
+    std::cerr << "Usage: ./cpplox-client <socket> <script.lox> [args...] to \
+                  run a script on the server at socket (- sends the script \
+                  from stdin)"
+              << std::endl;
+    return 64;
+  }
+  cpplox::ServerProtocol::Request request;
+  if (std::strcmp(argv[2], "-") == 0) {
+    request.script.assign(std::istreambuf_iterator<char>(std::cin), {});
+  } else {
+    // The server's working directory isn't ours.
+    std::error_code error;
+    request.script = std::filesystem::absolute(argv[2], error).string();
+    request.isPath = true;
+  }
+  for (int i = 3; i < argc; ++i) request.arguments.emplace_back(argv[i]);
+
+  const std::optional<int> exitCode = cpplox::ServerProtocol::runOnServer(
+      argv[1], request, [](bool isError, std::string_view text) {
+        std::FILE *stream = isError ? stderr : stdout;
+        if (isError) std::fflush(stdout);
+        std::fwrite(text.data(), 1, text.size(), stream);
+      });
+  if (!exitCode.has_value()) {
+    std::cerr << "Couldn't get an answer from the server at " << argv[1]
+              << std::endl;
+    return 69;
+  }
+  return exitCode.value();
+}
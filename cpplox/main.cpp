@@ -1,22 +1,267 @@
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <csignal>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
 
+#include "cpplox/InterpreterDriver/BatchRunner.h"
 #include "cpplox/InterpreterDriver/InterpreterDriver.h"
+#include "cpplox/InterpreterDriver/ProgramCache.h"
+#include "cpplox/InterpreterDriver/Server.h"
+#include "cpplox/Output/OutputBuffer.h"
+
+namespace {
+
+void printUsageAndExit() {
+  std::cout << "Usage: ./lox [--output=line|full] [--stream] [--lazy] \
+                [--flat] [--cache[=dir]] [--fuel=n] [--timeout=seconds] \
+                [--max-memory=bytes[K|M|G]] [--mem-stats] [--reclaim-step=n] \
+                [--reclaim-thread] [--snapshot=file] [--from-snapshot=file] \
+                <script.lox> to execute a script (- streams it from stdin), \
+                ./lox [--lazy] [--cache[=dir]] --batch=manifest [--jobs=n] \
+                to execute each script listed in manifest, ./lox [--lazy] \
+                [--cache[=dir]] [--from-snapshot=file] --serve=socket \
+                [--jobs=n] [prelude.lox] to run scripts sent to socket, or \
+                just ./lox to drop into a REPL"
+            << std::endl;
+  std::exit(64);
+}
+
+// A number of bytes, optionally in K, M or G (powers of 1024).
+auto parseSize(const char *text) -> std::optional<size_t> {
+  char *end = nullptr;
+  const unsigned long long n = std::strtoull(text, &end, 10);
+  if (end == text || n == 0) return std::nullopt;
+  unsigned shift = 0;
+  switch (*end) {
+    case 'K': shift = 10; break;
+    case 'M': shift = 20; break;
+    case 'G': shift = 30; break;
+    case 0: break;
+    default: return std::nullopt;
+  }
+  if (*end != 0 && end[1] != 0) return std::nullopt;
+  if (n > (SIZE_MAX >> shift)) return std::nullopt;
+  return static_cast<size_t>(n) << shift;
+}
+
+// Prints each script's output after a line naming it and its exit code, and
+// its errors (if any) after a line naming it, in the order of the manifest.
+// Exits with the first failing script's exit code, if any failed.
+auto runBatch(const char *manifest, unsigned jobs,
+              const cpplox::ScriptOptions &options) -> int {
+  std::optional<std::vector<std::string>> scripts
+      = cpplox::BatchRunner::readManifest(manifest);
+  if (!scripts.has_value()) {
+    std::cerr << "Couldn't read the manifest " << manifest << std::endl;
+    return 66;
+  }
+  int status = 0;
+  cpplox::Output::OutputBuffer &out = cpplox::Output::stdOut();
+  cpplox::Output::OutputBuffer &err = cpplox::Output::stdErr();
+  cpplox::BatchRunner(jobs, options)
+      .run(scripts.value(), [&](cpplox::ScriptResult result) {
+        out.write("# " + result.script + ": "
+                  + std::to_string(result.exitCode));
+        out.endLine();
+        out.write(result.out);
+        if (!result.err.empty()) {
+          out.flush();
+          err.write("# " + result.script);
+          err.endLine();
+          err.write(result.err);
+          err.flush();
+        }
+        if (status == 0) status = result.exitCode;
+      });
+  return status;
+}
+
+void printMemoryStats(cpplox::InterpreterDriver &interpreter) {
+  cpplox::Output::stdOut().flush();
+  std::cerr << interpreter.getMemoryStats().toString();
+}
+
+cpplox::Server *server = nullptr;
+
+void stopServing(int /*signal*/) { server->stop(); }
+
+// Runs the prelude (the state in snapshotFrom, then the script prelude) once,
+// and serves requests to run scripts on top of it at socketPath until
+// interrupted.
+auto serve(const char *socketPath, const char *snapshotFrom,
+           const char *prelude, unsigned jobs,
+           const cpplox::ScriptOptions &options) -> int {
+  std::optional<std::string> snapshot;
+  {
+    cpplox::InterpreterDriver interpreter;
+    if (snapshotFrom != nullptr) {
+      if (const int status = interpreter.loadSnapshot(snapshotFrom);
+          status != 0)
+        return status;
+    }
+    if (prelude != nullptr) {
+      if (const int status = interpreter.runScript(prelude, options);
+          status != 0)
+        return status;
+    }
+    snapshot = interpreter.snapshot();
+    if (!snapshot.has_value()) return 65;
+  }
+
+  cpplox::Server listening(std::move(snapshot.value()), jobs, options);
+  if (!listening.listen(socketPath)) {
+    std::cerr << "Couldn't listen at " << socketPath << ": "
+              << std::strerror(errno) << std::endl;
+    return 71;
+  }
+  server = &listening;
+  std::signal(SIGINT, stopServing);
+  std::signal(SIGTERM, stopServing);
+  std::signal(SIGPIPE, SIG_IGN);
+  listening.serve();
+  return 0;
+}
+
+}  // namespace
 
 // We are using SYSEXITS exit codes
 auto main(int argc, char const *argv[]) -> int {
-  if (argc > 2) {
-    std::cout << "Usage: ./lox <script.lox> to execute a script or \
-                  just ./lox to drop into a REPL"
-              << std::endl;
-    std::exit(64);
+  using cpplox::Output::BufferMode;
+
+  // print output is line buffered in the REPL and fully buffered when running
+  // a script, unless overridden with --output=line or --output=full.
+  std::optional<BufferMode> outputMode;
+  const char *script = nullptr;
+  bool stream = false;
+  const char *snapshotTo = nullptr;
+  const char *snapshotFrom = nullptr;
+  const char *manifest = nullptr;
+  const char *socketPath = nullptr;
+  unsigned jobs = 0;
+  bool memStats = false;
+  cpplox::ScriptOptions options;
+  for (int i = 1; i < argc; ++i) {
+    if (std::strcmp(argv[i], "--stream") == 0) {
+      stream = true;
+    } else if (std::strcmp(argv[i], "--lazy") == 0) {
+      options.lazyFunctions = true;
+    } else if (std::strcmp(argv[i], "--flat") == 0) {
+      options.flat = true;
+    } else if (std::strcmp(argv[i], "--cache") == 0) {
+      options.cacheDirectory = cpplox::ProgramCache::defaultDirectory();
+    } else if (std::strncmp(argv[i], "--cache=", 8) == 0 && argv[i][8] != 0) {
+      options.cacheDirectory = argv[i] + 8;
+    } else if (std::strncmp(argv[i], "--snapshot=", 11) == 0
+               && argv[i][11] != 0) {
+      snapshotTo = argv[i] + 11;
+    } else if (std::strncmp(argv[i], "--from-snapshot=", 16) == 0
+               && argv[i][16] != 0) {
+      snapshotFrom = argv[i] + 16;
+    } else if (std::strncmp(argv[i], "--batch=", 8) == 0 && argv[i][8] != 0) {
+      manifest = argv[i] + 8;
+    } else if (std::strncmp(argv[i], "--serve=", 8) == 0 && argv[i][8] != 0) {
+      socketPath = argv[i] + 8;
+    } else if (std::strncmp(argv[i], "--jobs=", 7) == 0) {
+      char *end = nullptr;
+      const unsigned long n = std::strtoul(argv[i] + 7, &end, 10);
+      if (end == argv[i] + 7 || *end != 0 || n == 0 || n > 4096)
+        printUsageAndExit();
+      jobs = static_cast<unsigned>(n);
+    } else if (std::strncmp(argv[i], "--fuel=", 7) == 0) {
+      char *end = nullptr;
+      const unsigned long long n = std::strtoull(argv[i] + 7, &end, 10);
+      if (end == argv[i] + 7 || *end != 0 || n == 0) printUsageAndExit();
+      options.fuel = n;
+    } else if (std::strncmp(argv[i], "--timeout=", 10) == 0) {
+      char *end = nullptr;
+      const double seconds = std::strtod(argv[i] + 10, &end);
+      if (end == argv[i] + 10 || *end != 0 || !(seconds > 0)
+          || seconds > 1e6)
+        printUsageAndExit();
+      options.timeLimit = std::chrono::milliseconds(
+          static_cast<int64_t>(std::ceil(seconds * 1000)));
+    } else if (std::strncmp(argv[i], "--max-memory=", 13) == 0) {
+      const std::optional<size_t> limit = parseSize(argv[i] + 13);
+      if (!limit.has_value()) printUsageAndExit();
+      options.memoryLimit = limit.value();
+    } else if (std::strcmp(argv[i], "--mem-stats") == 0) {
+      memStats = true;
+    } else if (std::strncmp(argv[i], "--reclaim-step=", 15) == 0) {
+      char *end = nullptr;
+      const unsigned long long n = std::strtoull(argv[i] + 15, &end, 10);
+      if (end == argv[i] + 15 || *end != 0 || n == 0) printUsageAndExit();
+      options.reclaimStep = n;
+    } else if (std::strcmp(argv[i], "--reclaim-thread") == 0) {
+      options.reclaimThread = true;
+    } else if (std::strcmp(argv[i], "--output=line") == 0) {
+      outputMode = BufferMode::LINE;
+    } else if (std::strcmp(argv[i], "--output=full") == 0) {
+      outputMode = BufferMode::FULL;
+    } else if (script == nullptr
+               && (argv[i][0] != '-' || std::strcmp(argv[i], "-") == 0)) {
+      script = argv[i];
+    } else {
+      printUsageAndExit();
+    }
+  }
+
+  if (jobs != 0 && manifest == nullptr && socketPath == nullptr)
+    printUsageAndExit();
+  if (socketPath != nullptr) {
+    if (manifest != nullptr || stream || snapshotTo != nullptr || memStats
+        || (script != nullptr && std::strcmp(script, "-") == 0))
+      printUsageAndExit();
+    return serve(socketPath, snapshotFrom, script, jobs, options);
   }
+  if (manifest != nullptr) {
+    if (script != nullptr || stream || snapshotTo != nullptr
+        || snapshotFrom != nullptr || memStats)
+      printUsageAndExit();
+    cpplox::Output::stdOut().setMode(outputMode.value_or(BufferMode::FULL));
+    return runBatch(manifest, jobs, options);
+  }
+
+  // Only whole scripts are kept around to be snapshotted.
+  if (snapshotTo != nullptr
+      && (script == nullptr || stream || std::strcmp(script, "-") == 0))
+    printUsageAndExit();
 
   cpplox::InterpreterDriver interpreter;
+  if (snapshotFrom != nullptr) {
+    if (const int status = interpreter.loadSnapshot(snapshotFrom); status != 0)
+      return status;
+  }
 
-  if (2 == argc) {
-    return interpreter.runScript(argv[1]);
+  if (script != nullptr) {
+    // stdin may be a pipe that's still being written to, so start running
+    // it (and showing its output) before it's all been read.
+    const bool fromStdin = std::strcmp(script, "-") == 0;
+    cpplox::Output::stdOut().setMode(
+        outputMode.value_or(fromStdin ? BufferMode::LINE : BufferMode::FULL));
+    // Streaming doesn't keep tokens around to parse function bodies later,
+    // or have the whole source to look up in the cache or flatten, so --lazy,
+    // --cache and --flat only apply to whole scripts; --fuel and --timeout
+    // apply to both.
+    int status = stream || fromStdin
+                     ? interpreter.runScriptStreaming(script, options)
+                     : interpreter.runScript(script, options);
+    if (memStats) printMemoryStats(interpreter);
+    if (status == 0 && snapshotTo != nullptr)
+      status = interpreter.writeSnapshot(snapshotTo);
+    return status;
   }
 
+  cpplox::Output::stdOut().setMode(outputMode.value_or(BufferMode::LINE));
   interpreter.runREPL();
+  if (memStats) printMemoryStats(interpreter);
   return 0;
 }